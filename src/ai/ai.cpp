@@ -25,7 +25,8 @@
 
 const std::string Ai::default_type = "aistd";
 
-Ai::Ai()
+Ai::Ai() :
+	progress(0)
 {
 	AddFactory("aistd", new AiCarStandardFactory());
 	AddFactory("aiexp", new AiCarExperimentalFactory());
@@ -49,6 +50,7 @@ unsigned Ai::AddCar(unsigned carid, float difficulty, const std::string & type)
 	AiFactory * factory = it->second;
 
 	AiCar * aicar = factory->Create(carid, difficulty);
+	aicar->SetTrackProgress(progress);
 	ai_cars.push_back(aicar);
 
 	return ai_cars.size() - 1;
@@ -63,6 +65,15 @@ void Ai::ClearCars()
 	ai_cars.clear();
 }
 
+void Ai::SetTrackProgress(const TrackProgress * newprogress)
+{
+	progress = newprogress;
+	for (auto ai_car : ai_cars)
+	{
+		ai_car->SetTrackProgress(progress);
+	}
+}
+
 void Ai::Update(float dt, const CarDynamics cars[], const int cars_num)
 {
 	for (auto ai_car : ai_cars)
@@ -76,6 +87,11 @@ const std::vector<float> & Ai::GetInputs(unsigned id) const
 	return ai_cars[id]->GetInputs();
 }
 
+const AiCar::Decision & Ai::GetDecision(unsigned id) const
+{
+	return ai_cars[id]->GetDecision();
+}
+
 void Ai::AddFactory(const std::string & type_name, AiFactory * factory)
 {
 	ai_factories.insert(std::make_pair(type_name, factory));
@@ -39,20 +39,35 @@ public:
 
 	void ClearCars();
 
+	/// Share track progress with current and future ai cars.
+	void SetTrackProgress(const TrackProgress * progress);
+
 	void Update(float dt, const CarDynamics cars[], const int cars_num);
 
 	const std::vector<float> & GetInputs(unsigned id) const;
 
+	const AiCar::Decision & GetDecision(unsigned id) const;
+
 	void AddFactory(const std::string & type_name, AiFactory * factory);
 
 	std::vector<std::string> ListFactoryTypes();
 
 	void Visualize();
 
+	/// Controller state of all ai cars, for in-memory snapshots.
+	template <class Serializer>
+	bool Serialize(Serializer & s)
+	{
+		for (auto ai_car : ai_cars)
+			_SERIALIZE_(s, *ai_car);
+		return true;
+	}
+
 	static const std::string default_type;
 
 private:
 	std::vector <AiCar*> ai_cars;
+	const TrackProgress * progress;
 	std::map <std::string, AiFactory*> ai_factories;
 };
 
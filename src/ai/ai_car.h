@@ -21,9 +21,12 @@
 #define _AI_CAR_H
 
 #include "physics/carinput.h"
+#include "snapshot.h"
+#include "macros.h"
 #include <vector>
 
 class CarDynamics;
+class TrackProgress;
 
 /// AI Car controller interface.
 class AiCar
@@ -31,14 +34,37 @@ class AiCar
 public:
 	AiCar(unsigned carid, float difficulty);
 
+	/// Quantities behind the last control decision, for telemetry.
+	struct Decision
+	{
+		float target_speed; ///< speed limit of the current patch in m/s
+		float brake_lookahead; ///< distance checked ahead for braking in m
+		float heading_error; ///< angle to the steering target in degrees
+		bool braking_ahead; ///< braking for a slower patch ahead
+
+		Decision() : target_speed(0), brake_lookahead(0), heading_error(0), braking_ahead(false) {}
+	};
+
 	virtual ~AiCar();
 
 	unsigned GetCarId() const;
 
 	const std::vector<float> & GetInputs() const;
 
+	/// Controllers that don't fill it in report all zeros.
+	const Decision & GetDecision() const;
+
 	virtual void Update(float dt, const CarDynamics cars[], const unsigned cars_num) = 0;
 
+	/// Per tick track progress of all cars, null to read the wheel contacts.
+	void SetTrackProgress(const TrackProgress * progress);
+
+	/// Save controller state into an in-memory snapshot.
+	virtual bool Serialize(SnapshotWriter & s);
+
+	/// Restore controller state from an in-memory snapshot.
+	virtual bool Serialize(SnapshotReader & s);
+
 	/// This is optional for drawing debug stuff.
 	/// It will only be called, when VISUALIZE_AI_DEBUG macro is defined.
 	virtual void Visualize();
@@ -46,16 +72,23 @@ public:
 protected:
 	const unsigned carid;
 	const float difficulty;
+	const TrackProgress * progress;
 
 	/// Contains the car inputs, which is the output of the AI.
 	/// The vector is indexed by CARINPUT values.
 	std::vector <float> inputs;
+
+	Decision decision;
+
+	template <class Serializer>
+	bool SerializeInputs(Serializer & s);
 };
 
 
 inline AiCar::AiCar(unsigned carid, float difficulty) :
 	carid(carid),
 	difficulty(difficulty),
+	progress(0),
 	inputs(CarInput::INVALID, 0.0)
 {
 	// ctor
@@ -76,6 +109,34 @@ inline const std::vector<float> & AiCar::GetInputs() const
 	return inputs;
 }
 
+inline const AiCar::Decision & AiCar::GetDecision() const
+{
+	return decision;
+}
+
+inline void AiCar::SetTrackProgress(const TrackProgress * newprogress)
+{
+	progress = newprogress;
+}
+
+template <class Serializer>
+inline bool AiCar::SerializeInputs(Serializer & s)
+{
+	for (auto & input : inputs)
+		_SERIALIZE_(s, input);
+	return true;
+}
+
+inline bool AiCar::Serialize(SnapshotWriter & s)
+{
+	return SerializeInputs(s);
+}
+
+inline bool AiCar::Serialize(SnapshotReader & s)
+{
+	return SerializeInputs(s);
+}
+
 inline void AiCar::Visualize()
 {
 	// optional
@@ -23,6 +23,7 @@
 #include "minmax.h"
 #include "tobullet.h"
 #include "track.h"
+#include "track_progress.h"
 #include "unittest.h"
 
 #include <cassert>
@@ -84,6 +85,26 @@ AiCarExperimental::~AiCarExperimental()
 #endif
 }
 
+template <class Serializer>
+bool AiCarExperimental::SerializeState(Serializer & s)
+{
+	if (!SerializeInputs(s)) return false;
+	_SERIALIZE_(s, last_patch);
+	_SERIALIZE_(s, is_recovering);
+	_SERIALIZE_(s, recover_time);
+	return true;
+}
+
+bool AiCarExperimental::Serialize(SnapshotWriter & s)
+{
+	return SerializeState(s);
+}
+
+bool AiCarExperimental::Serialize(SnapshotReader & s)
+{
+	return SerializeState(s);
+}
+
 //note that rate_limit_neg should be positive, it gets inverted inside the function
 float AiCarExperimental::RateLimit(float old_value, float new_value, float rate_limit_pos, float rate_limit_neg)
 {
@@ -112,8 +133,11 @@ void AiCarExperimental::Update(float dt, const CarDynamics cars[], const unsigne
 		rateLimit, rateLimit);
 }
 
-const RoadPatch * AiCarExperimental::GetCurrentPatch(const CarDynamics & car)
+const RoadPatch * AiCarExperimental::GetCurrentPatch(const CarDynamics & car, unsigned id) const
 {
+	if (progress && id < progress->GetNumCars())
+		return progress->GetPatch(id);
+
 	const RoadPatch * curr_patch = car.GetWheelContact(WheelPosition(0)).GetPatch();
 	if (!curr_patch)
 	{
@@ -295,7 +319,11 @@ void AiCarExperimental::UpdateGasBrake(const CarDynamics & car)
 	else
 		inputs[CarInput::START_ENGINE] = 0;
 
-	const RoadPatch * curr_patch_ptr = GetCurrentPatch(car);
+	decision.target_speed = 0;
+	decision.brake_lookahead = 0;
+	decision.braking_ahead = false;
+
+	const RoadPatch * curr_patch_ptr = GetCurrentPatch(car, carid);
 	if (!curr_patch_ptr)
 	{
 		// if car is not on track, just let it roll
@@ -323,6 +351,7 @@ void AiCarExperimental::UpdateGasBrake(const CarDynamics & car)
 		speed_limit = CalcSpeedLimit(car, &curr_patch, &next_patch, width);
 	}
 	speed_limit *= difficulty;
+	decision.target_speed = speed_limit;
 
 	float speed_diff = speed_limit - currentspeed;
 	if (speed_diff < 0)
@@ -396,9 +425,11 @@ void AiCarExperimental::UpdateGasBrake(const CarDynamics & car)
 		{
 			brake_value = 1;
 			gas_value = 0;
+			decision.braking_ahead = true;
 			break;
 		}
 	}
+	decision.brake_lookahead = dist_checked;
 
 	inputs[CarInput::THROTTLE] = gas_value;
 	inputs[CarInput::BRAKE] = brake_value;
@@ -522,7 +553,7 @@ void AiCarExperimental::UpdateSteer(const CarDynamics & car, float dt)
 	steerlook.clear();
 #endif
 
-	const RoadPatch * curr_patch_ptr = GetCurrentPatch(car);
+	const RoadPatch * curr_patch_ptr = GetCurrentPatch(car, carid);
 
 	// if car has no contact with track, just let it roll
 	if (!curr_patch_ptr || is_recovering)
@@ -614,6 +645,8 @@ void AiCarExperimental::UpdateSteer(const CarDynamics & car, float dt)
 	else if (angle > 180 && angle <= 360)
 		angle = 360 - angle;
 
+	decision.heading_error = angle;
+
 	float steer_value = Clamp(angle / car.GetMaxSteeringAngle(), -1.0f, 1.0f);
 
 	// If we are driving backwards, we need to invert steer direction.
@@ -721,8 +754,8 @@ void AiCarExperimental::AnalyzeOthers(float dt, const CarDynamics cars[], const
 		const float fore_position_offset = -half_carlength;
 		if (fore_position > fore_position_offset)
 		{
-			const RoadPatch * othercarpatch = GetCurrentPatch(icar);
-			const RoadPatch * mycarpatch = GetCurrentPatch(car);
+			const RoadPatch * othercarpatch = GetCurrentPatch(icar, i);
+			const RoadPatch * mycarpatch = GetCurrentPatch(car, carid);
 
 			if (othercarpatch && mycarpatch)
 			{
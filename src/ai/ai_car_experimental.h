@@ -44,6 +44,10 @@ public:
 
 	void Update(float dt, const CarDynamics cars[], const unsigned cars_num);
 
+	bool Serialize(SnapshotWriter & s);
+
+	bool Serialize(SnapshotReader & s);
+
 #ifdef VISUALIZE_AI_DEBUG
 	void Visualize();
 #endif
@@ -64,6 +68,9 @@ private:
 	};
 	std::vector <OtherCarInfo> othercars;
 
+	template <class Serializer>
+	bool SerializeState(Serializer & s);
+
 	void UpdateGasBrake(const CarDynamics & car);
 
 	void CalcMu(const CarDynamics & car);
@@ -88,7 +95,8 @@ private:
 
 	static float RateLimit(float old_value, float new_value, float rate_limit_pos, float rate_limit_neg);
 
-	static const RoadPatch * GetCurrentPatch(const CarDynamics & car);
+	/// Patch under the front wheels of car id, from the track progress if set.
+	const RoadPatch * GetCurrentPatch(const CarDynamics & car, unsigned id) const;
 
 	static Vec3 GetPatchFrontCenter(const RoadPatch & patch);
 
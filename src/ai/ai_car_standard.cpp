@@ -23,6 +23,7 @@
 #include "minmax.h"
 #include "tobullet.h"
 #include "track.h"
+#include "track_progress.h"
 #include "unittest.h"
 
 #include <cassert>
@@ -78,6 +79,24 @@ AiCarStandard::~AiCarStandard()
 #endif
 }
 
+template <class Serializer>
+bool AiCarStandard::SerializeState(Serializer & s)
+{
+	if (!SerializeInputs(s)) return false;
+	_SERIALIZE_(s, last_patch);
+	return true;
+}
+
+bool AiCarStandard::Serialize(SnapshotWriter & s)
+{
+	return SerializeState(s);
+}
+
+bool AiCarStandard::Serialize(SnapshotReader & s)
+{
+	return SerializeState(s);
+}
+
 //note that rate_limit_neg should be positive, it gets inverted inside the function
 float AiCarStandard::RateLimit(float old_value, float new_value, float rate_limit_pos, float rate_limit_neg)
 {
@@ -96,8 +115,11 @@ void AiCarStandard::Update(float dt, const CarDynamics cars[], const unsigned ca
 	UpdateSteer(cars[carid]);
 }
 
-const RoadPatch * AiCarStandard::GetCurrentPatch(const CarDynamics & car)
+const RoadPatch * AiCarStandard::GetCurrentPatch(const CarDynamics & car, unsigned id) const
 {
+	if (progress && id < progress->GetNumCars())
+		return progress->GetPatch(id);
+
 	const RoadPatch *curr_patch = car.GetWheelContact(WheelPosition(0)).GetPatch();
 	if (!curr_patch)
 	{
@@ -278,7 +300,11 @@ void AiCarStandard::UpdateGasBrake(const CarDynamics & car)
 	else
 		inputs[CarInput::START_ENGINE] = 0.0;
 
-	const RoadPatch * curr_patch_ptr = GetCurrentPatch(car);
+	decision.target_speed = 0;
+	decision.brake_lookahead = 0;
+	decision.braking_ahead = false;
+
+	const RoadPatch * curr_patch_ptr = GetCurrentPatch(car, carid);
 	if (!curr_patch_ptr)
 	{
 		// if car is not on track, just let it roll
@@ -306,6 +332,7 @@ void AiCarStandard::UpdateGasBrake(const CarDynamics & car)
 		speed_limit = CalcSpeedLimit(car, &curr_patch, &next_patch, width);
 	}
 	speed_limit *= difficulty;
+	decision.target_speed = speed_limit;
 
 	float speed_diff = speed_limit - currentspeed;
 	if (speed_diff < 0)
@@ -379,9 +406,11 @@ void AiCarStandard::UpdateGasBrake(const CarDynamics & car)
 		{
 			brake_value = 1;
 			gas_value = 0;
+			decision.braking_ahead = true;
 			break;
 		}
 	}
+	decision.brake_lookahead = dist_checked;
 
 	gas_value = RateLimit(inputs[CarInput::THROTTLE], gas_value, THROTTLE_RATE_LIMIT, THROTTLE_RATE_LIMIT);
 	brake_value = RateLimit(inputs[CarInput::BRAKE], brake_value, BRAKE_RATE_LIMIT, BRAKE_RATE_LIMIT);
@@ -416,7 +445,7 @@ void AiCarStandard::UpdateSteer(const CarDynamics & car)
 	steerlook.clear();
 #endif
 
-	const RoadPatch *curr_patch_ptr = GetCurrentPatch(car);
+	const RoadPatch *curr_patch_ptr = GetCurrentPatch(car, carid);
 
 	//if car has no contact with track, just let it roll
 	if (!curr_patch_ptr)
@@ -503,6 +532,8 @@ void AiCarStandard::UpdateSteer(const CarDynamics & car)
 	else if (angle > 180 && angle <= 360)
 		angle = 360 - angle;
 
+	decision.heading_error = angle;
+
 	float steer_value = Clamp(angle / car.GetMaxSteeringAngle(), -1.0f, 1.0f);
 
 	inputs[CarInput::STEER_RIGHT] = steer_value;
@@ -606,8 +637,8 @@ void AiCarStandard::AnalyzeOthers(float dt, const CarDynamics cars[], const unsi
 		const float fore_position_offset = -half_carlength;
 		if (fore_position > fore_position_offset)
 		{
-			const RoadPatch * othercarpatch = GetCurrentPatch(icar);
-			const RoadPatch * mycarpatch = GetCurrentPatch(car);
+			const RoadPatch * othercarpatch = GetCurrentPatch(icar, i);
+			const RoadPatch * mycarpatch = GetCurrentPatch(car, carid);
 
 			if (othercarpatch && mycarpatch)
 			{
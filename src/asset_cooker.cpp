@@ -0,0 +1,885 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#include "asset_cooker.h"
+#include "collision_bvh.h"
+#include "graphics/model_joe03.h"
+#include "joepack.h"
+#include "parallel_for.h"
+#include "pathmanager.h"
+#include "unittest.h"
+
+#ifdef __APPLE__
+#include <SDL2_image/SDL_image.h>
+#else
+#include <SDL2/SDL_image.h>
+#endif
+#include <SDL2/SDL_timer.h>
+
+#include "BulletCollision/CollisionShapes/btTriangleIndexVertexArray.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+// bump to invalidate previously cooked assets of a kind
+static const char mesh_kind[] = "ova1";
+static const char track_mesh_kind[] = "ova1-bvh1";
+static const char color_kind[] = "dds2-dxt";
+static const char data_kind[] = "dds1-bgra";
+
+// the game only compresses textures above this size, see Texture::Load
+static const unsigned compress_min_size = 512;
+
+static bool HasExtension(const std::string & path, const std::string & ext)
+{
+	if (path.length() < ext.length())
+		return false;
+
+	for (unsigned i = 0; i < ext.length(); ++i)
+	{
+		if (std::tolower(path[path.length() - ext.length() + i]) != ext[i])
+			return false;
+	}
+	return true;
+}
+
+static bool IsMesh(const std::string & path)
+{
+	return HasExtension(path, ".joe");
+}
+
+static bool IsTexture(const std::string & path)
+{
+	return HasExtension(path, ".png") || HasExtension(path, ".jpg");
+}
+
+static bool IsPack(const std::string & path)
+{
+	return HasExtension(path, "objects.jpk");
+}
+
+// track meshes are static collision geometry
+static bool IsTrackMesh(const std::string & path)
+{
+	return path.compare(0, 7, "tracks/") == 0;
+}
+
+static bool IsConfig(const std::string & path)
+{
+	return HasExtension(path, ".car") || HasExtension(path, "objects.txt");
+}
+
+static std::string GetFileName(const std::string & path)
+{
+	const size_t n = path.find_last_of('/');
+	return (n == std::string::npos) ? path : path.substr(n + 1);
+}
+
+static std::string Trim(const std::string & str)
+{
+	const size_t b = str.find_first_not_of(" \t\r\n");
+	const size_t e = str.find_last_not_of(" \t\r\n");
+	return (b == std::string::npos) ? std::string() : str.substr(b, e - b + 1);
+}
+
+static bool ReadFile(const std::string & path, std::vector<char> & data)
+{
+	std::ifstream file(path.c_str(), std::ios::binary);
+	if (!file)
+		return false;
+
+	file.seekg(0, file.end);
+	data.resize(file.tellg());
+	file.seekg(0, file.beg);
+	if (!data.empty())
+		file.read(&data[0], data.size());
+	return bool(file);
+}
+
+static bool GetFileSize(const std::string & path, unsigned long & size)
+{
+	std::ifstream file(path.c_str(), std::ios::binary | std::ios::ate);
+	if (!file)
+		return false;
+
+	size = file.tellg();
+	return true;
+}
+
+// create all missing folders of path
+static void MakeDirs(const std::string & path)
+{
+	size_t n = 0;
+	while ((n = path.find('/', n + 1)) != std::string::npos)
+		PathManager::MakeDir(path.substr(0, n));
+	PathManager::MakeDir(path);
+}
+
+// write model as ova to dst, and its collision bvh to dst.bvh if bvh is set
+static bool WriteMesh(Model & model, const std::string & dst, bool bvh, std::string & error)
+{
+	if (!model.WriteToFile(dst))
+	{
+		error = "Can't write " + dst;
+		return false;
+	}
+
+	btTriangleIndexVertexArray mesh;
+	if (bvh)
+	{
+		mesh.addIndexedMesh(GetIndexedMesh(model));
+		if (!WriteCollisionBvh(mesh, dst + ".bvh"))
+		{
+			error = "Can't write " + dst + ".bvh";
+			return false;
+		}
+	}
+	return true;
+}
+
+static double GetSeconds(Uint64 start)
+{
+	return double(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+}
+
+static void Write32(std::vector<char> & out, uint32_t value)
+{
+	out.push_back(char(value));
+	out.push_back(char(value >> 8));
+	out.push_back(char(value >> 16));
+	out.push_back(char(value >> 24));
+}
+
+static unsigned Pack565(const float c[3])
+{
+	const unsigned r = unsigned(c[0] * (31 / 255.0f) + 0.5f);
+	const unsigned g = unsigned(c[1] * (63 / 255.0f) + 0.5f);
+	const unsigned b = unsigned(c[2] * (31 / 255.0f) + 0.5f);
+	return (r << 11) | (g << 5) | b;
+}
+
+static void Unpack565(unsigned c, int rgb[3])
+{
+	const int r = (c >> 11) & 31;
+	const int g = (c >> 5) & 63;
+	const int b = c & 31;
+	rgb[0] = (r << 3) | (r >> 2);
+	rgb[1] = (g << 2) | (g >> 4);
+	rgb[2] = (b << 3) | (b >> 2);
+}
+
+// range fit: end points are the block extremes along its principal axis
+static void EncodeColorBlock(const unsigned char block[64], unsigned char out[8])
+{
+	float mean[3] = {0, 0, 0};
+	for (int i = 0; i < 16; ++i)
+	{
+		for (int j = 0; j < 3; ++j)
+			mean[j] += block[i * 4 + j] * (1 / 16.0f);
+	}
+
+	float cov[6] = {0, 0, 0, 0, 0, 0};
+	for (int i = 0; i < 16; ++i)
+	{
+		const float r = block[i * 4 + 0] - mean[0];
+		const float g = block[i * 4 + 1] - mean[1];
+		const float b = block[i * 4 + 2] - mean[2];
+		cov[0] += r * r; cov[1] += r * g; cov[2] += r * b;
+		cov[3] += g * g; cov[4] += g * b; cov[5] += b * b;
+	}
+
+	float axis[3] = {1, 1, 1};
+	for (int k = 0; k < 8; ++k)
+	{
+		const float x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+		const float y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+		const float z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+		const float m = std::max(std::abs(x), std::max(std::abs(y), std::abs(z)));
+		if (m < 1E-6f)
+			break;
+		axis[0] = x / m; axis[1] = y / m; axis[2] = z / m;
+	}
+	const float len2 = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+
+	float tmin = 0, tmax = 0;
+	for (int i = 0; i < 16; ++i)
+	{
+		float t = 0;
+		for (int j = 0; j < 3; ++j)
+			t += (block[i * 4 + j] - mean[j]) * axis[j];
+		tmin = std::min(tmin, t);
+		tmax = std::max(tmax, t);
+	}
+
+	float cmax[3], cmin[3];
+	for (int j = 0; j < 3; ++j)
+	{
+		cmax[j] = std::min(std::max(mean[j] + axis[j] * tmax / len2, 0.0f), 255.0f);
+		cmin[j] = std::min(std::max(mean[j] + axis[j] * tmin / len2, 0.0f), 255.0f);
+	}
+
+	unsigned c0 = Pack565(cmax);
+	unsigned c1 = Pack565(cmin);
+	if (c0 < c1)
+		std::swap(c0, c1);
+
+	uint32_t indices = 0;
+	if (c0 != c1)
+	{
+		int palette[4][3];
+		Unpack565(c0, palette[0]);
+		Unpack565(c1, palette[1]);
+		for (int j = 0; j < 3; ++j)
+		{
+			palette[2][j] = (2 * palette[0][j] + palette[1][j]) / 3;
+			palette[3][j] = (palette[0][j] + 2 * palette[1][j]) / 3;
+		}
+
+		for (int i = 0; i < 16; ++i)
+		{
+			int best = 0, best_dist = 0x7fffffff;
+			for (int k = 0; k < 4; ++k)
+			{
+				int dist = 0;
+				for (int j = 0; j < 3; ++j)
+				{
+					const int d = block[i * 4 + j] - palette[k][j];
+					dist += d * d;
+				}
+				if (dist < best_dist)
+				{
+					best = k;
+					best_dist = dist;
+				}
+			}
+			indices |= uint32_t(best) << (i * 2);
+		}
+	}
+
+	out[0] = c0 & 0xff;
+	out[1] = c0 >> 8;
+	out[2] = c1 & 0xff;
+	out[3] = c1 >> 8;
+	for (int i = 0; i < 4; ++i)
+		out[4 + i] = (indices >> (i * 8)) & 0xff;
+}
+
+static void EncodeAlphaBlock(const unsigned char block[64], unsigned char out[8])
+{
+	int amin = 255, amax = 0;
+	for (int i = 0; i < 16; ++i)
+	{
+		amin = std::min(amin, int(block[i * 4 + 3]));
+		amax = std::max(amax, int(block[i * 4 + 3]));
+	}
+
+	uint64_t indices = 0;
+	if (amin != amax)
+	{
+		int palette[8] = {amax, amin};
+		for (int k = 1; k < 7; ++k)
+			palette[k + 1] = ((7 - k) * amax + k * amin) / 7;
+
+		for (int i = 0; i < 16; ++i)
+		{
+			int best = 0, best_dist = 256;
+			for (int k = 0; k < 8; ++k)
+			{
+				const int dist = std::abs(block[i * 4 + 3] - palette[k]);
+				if (dist < best_dist)
+				{
+					best = k;
+					best_dist = dist;
+				}
+			}
+			indices |= uint64_t(best) << (i * 3);
+		}
+	}
+
+	out[0] = amax;
+	out[1] = amin;
+	for (int i = 0; i < 6; ++i)
+		out[2 + i] = (indices >> (i * 8)) & 0xff;
+}
+
+// 2x2 box filter, odd rows/columns are dropped
+static void Downsample(
+	const std::vector<unsigned char> & src, unsigned w, unsigned h,
+	std::vector<unsigned char> & dst, unsigned dw, unsigned dh)
+{
+	dst.resize(dw * dh * 4);
+	for (unsigned y = 0; y < dh; ++y)
+	{
+		const unsigned y0 = std::min(y * 2, h - 1);
+		const unsigned y1 = std::min(y * 2 + 1, h - 1);
+		for (unsigned x = 0; x < dw; ++x)
+		{
+			const unsigned x0 = std::min(x * 2, w - 1);
+			const unsigned x1 = std::min(x * 2 + 1, w - 1);
+			for (unsigned c = 0; c < 4; ++c)
+			{
+				const unsigned sum =
+					src[(y0 * w + x0) * 4 + c] + src[(y0 * w + x1) * 4 + c] +
+					src[(y1 * w + x0) * 4 + c] + src[(y1 * w + x1) * 4 + c];
+				dst[(y * dw + x) * 4 + c] = (sum + 2) / 4;
+			}
+		}
+	}
+}
+
+AssetCooker::Options::Options() :
+	threads(1),
+	compress(true),
+	force(false)
+{
+	// ctor
+}
+
+AssetCooker::Result::Result() :
+	status(FAILED),
+	hash(0),
+	mtime(0),
+	compressed(false),
+	insize(0),
+	outsize(0),
+	time(0)
+{
+	// ctor
+}
+
+bool AssetCooker::Run(
+	const std::string & data_path,
+	const std::string & out_path,
+	const Options & options,
+	std::ostream & info_output,
+	std::ostream & error_output)
+{
+	const Uint64 start = SDL_GetPerformanceCounter();
+
+	results.clear();
+	manifest.Clear();
+	datamaps.clear();
+
+	CookedManifest previous;
+	if (!options.force)
+		previous.Load(out_path + "/" + CookedManifest::filename);
+
+	std::vector<std::string> assets, configs;
+	const char * folders[] = {"cars", "tracks", "carparts", "trackparts"};
+	for (const char * folder : folders)
+		FindAssets(data_path, folder, assets, configs);
+
+	if (assets.empty())
+	{
+		error_output << "No assets found in " << data_path << std::endl;
+		return false;
+	}
+
+	for (const auto & config : configs)
+		FindDataMaps(data_path + "/" + config);
+
+	// decoder libraries are loaded lazily, do it before going wide
+	IMG_Init(IMG_INIT_JPG | IMG_INIT_PNG);
+
+	results.resize(assets.size());
+	for (unsigned i = 0; i < assets.size(); ++i)
+	{
+		results[i].path = assets[i];
+		MakeDirs(out_path + "/" + assets[i].substr(0, assets[i].find_last_of('/')));
+	}
+
+	auto cook = [&](unsigned /*worker*/, unsigned i)
+	{
+		Cook(data_path, out_path, options, previous, results[i]);
+	};
+	Parallel::For(results.size(), options.threads, cook);
+
+	IMG_Quit();
+
+	unsigned cooked = 0, skipped = 0, failed = 0;
+	for (const auto & result : results)
+	{
+		if (result.status == Result::FAILED)
+		{
+			error_output << result.path << ": " << result.error << std::endl;
+			failed++;
+			continue;
+		}
+
+		// outputs not named after the asset, pack members and bvhs, follow it
+		CookedManifest::Entry entry;
+		entry.hash = result.hash;
+		entry.size = result.insize;
+		entry.mtime = result.mtime;
+		entry.compressed = result.compressed;
+		for (const auto & output : result.outputs)
+		{
+			entry.source = (output == result.path) ? std::string() : result.path;
+			manifest.Set(output, entry);
+		}
+		if (result.status == Result::COOKED)
+			cooked++;
+		else
+			skipped++;
+	}
+
+	if (!manifest.Save(out_path + "/" + CookedManifest::filename))
+	{
+		error_output << "Can't write manifest to " << out_path << std::endl;
+		return false;
+	}
+
+	info_output << "Cooked " << cooked << ", up to date " << skipped << ", failed " << failed <<
+		" of " << results.size() << " assets in " << GetSeconds(start) << " s" << std::endl;
+
+	return failed == 0;
+}
+
+const std::vector<AssetCooker::Result> & AssetCooker::GetResults() const
+{
+	return results;
+}
+
+void AssetCooker::Report(std::ostream & out) const
+{
+	std::vector<const Result *> sorted;
+	for (const auto & result : results)
+	{
+		if (result.status != Result::SKIPPED)
+			sorted.push_back(&result);
+	}
+	std::sort(sorted.begin(), sorted.end(),
+		[](const Result * a, const Result * b) { return a->time > b->time; });
+
+	double time = 0;
+	unsigned long insize = 0, outsize = 0;
+	out << std::setw(10) << "ms" << std::setw(10) << "in KB" << std::setw(10) << "out KB" << "  asset" << std::endl;
+	for (const auto result : sorted)
+	{
+		out << std::fixed << std::setprecision(1) <<
+			std::setw(10) << result->time * 1E3 <<
+			std::setw(10) << result->insize / 1024.0 <<
+			std::setw(10) << result->outsize / 1024.0 << "  " << result->path <<
+			(result->status == Result::FAILED ? " (failed)" : "") << std::endl;
+		time += result->time;
+		insize += result->insize;
+		outsize += result->outsize;
+	}
+	out << std::setw(10) << time * 1E3 <<
+		std::setw(10) << insize / 1024.0 <<
+		std::setw(10) << outsize / 1024.0 << "  total" << std::endl;
+}
+
+uint64_t AssetCooker::Hash(const void * data, unsigned long size, uint64_t hash)
+{
+	const unsigned char * bytes = static_cast<const unsigned char *>(data);
+	for (unsigned long i = 0; i < size; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+void AssetCooker::EncodeDXT1(const unsigned char block[64], unsigned char out[8])
+{
+	EncodeColorBlock(block, out);
+}
+
+void AssetCooker::EncodeDXT5(const unsigned char block[64], unsigned char out[16])
+{
+	EncodeAlphaBlock(block, out);
+	EncodeColorBlock(block, out + 8);
+}
+
+bool AssetCooker::WriteDDS(
+	const unsigned char * rgba,
+	unsigned width,
+	unsigned height,
+	bool compress,
+	std::vector<char> & out)
+{
+	bool opaque = true;
+	for (unsigned i = 0; i < width * height && opaque; ++i)
+		opaque = rgba[i * 4 + 3] == 255;
+
+	// the loader sizes compressed levels assuming power of two dimensions
+	const bool pot = !(width & (width - 1)) && !(height & (height - 1));
+	const bool dxt = compress && pot && width >= 4 && height >= 4;
+	const unsigned blocksize = opaque ? 8 : 16;
+
+	unsigned levels = 1;
+	for (unsigned w = width, h = height; w > 1 || h > 1; ++levels)
+	{
+		w = std::max(1u, w / 2);
+		h = std::max(1u, h / 2);
+	}
+
+	// header, see graphics/dds.cpp
+	out.clear();
+	Write32(out, 0x20534444); // magic
+	Write32(out, 124); // header size
+	Write32(out, 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | (dxt ? 0x80000 : 0x8)); // caps, height, width, format, mipmap count, linear size or pitch
+	Write32(out, height);
+	Write32(out, width);
+	Write32(out, dxt ? (width / 4) * (height / 4) * blocksize : width * 4);
+	Write32(out, 0); // depth
+	Write32(out, levels);
+	for (int i = 0; i < 11; ++i)
+		Write32(out, 0);
+	Write32(out, 32); // pixel format size
+	Write32(out, dxt ? 0x4 : 0x40 | 0x1); // fourcc or rgb with alpha
+	Write32(out, dxt ? (opaque ? 0x31545844 : 0x35545844) : 0); // DXT1, DXT5
+	Write32(out, dxt ? 0 : 32);
+	Write32(out, dxt ? 0 : 0x00FF0000);
+	Write32(out, dxt ? 0 : 0x0000FF00);
+	Write32(out, dxt ? 0 : 0x000000FF);
+	Write32(out, dxt ? 0 : 0xFF000000);
+	Write32(out, 0x1000 | (levels > 1 ? 0x400000 | 0x8 : 0)); // texture, mipmap, complex
+	for (int i = 0; i < 4; ++i)
+		Write32(out, 0);
+
+	std::vector<unsigned char> level(rgba, rgba + width * height * 4), next;
+	unsigned w = width, h = height;
+	for (unsigned l = 0; l < levels; ++l)
+	{
+		if (dxt)
+		{
+			unsigned char block[64], encoded[16];
+			for (unsigned by = 0; by < h; by += 4)
+			{
+				for (unsigned bx = 0; bx < w; bx += 4)
+				{
+					// levels smaller than a block repeat their edge pixels
+					for (unsigned y = 0; y < 4; ++y)
+					{
+						for (unsigned x = 0; x < 4; ++x)
+						{
+							const unsigned sx = std::min(bx + x, w - 1);
+							const unsigned sy = std::min(by + y, h - 1);
+							std::memcpy(block + (y * 4 + x) * 4, &level[(sy * w + sx) * 4], 4);
+						}
+					}
+					if (opaque)
+						EncodeDXT1(block, encoded);
+					else
+						EncodeDXT5(block, encoded);
+					out.insert(out.end(), encoded, encoded + blocksize);
+				}
+			}
+		}
+		else
+		{
+			for (unsigned i = 0; i < w * h; ++i)
+			{
+				out.push_back(level[i * 4 + 2]);
+				out.push_back(level[i * 4 + 1]);
+				out.push_back(level[i * 4 + 0]);
+				out.push_back(level[i * 4 + 3]);
+			}
+		}
+
+		const unsigned nw = std::max(1u, w / 2);
+		const unsigned nh = std::max(1u, h / 2);
+		Downsample(level, w, h, next, nw, nh);
+		level.swap(next);
+		w = nw;
+		h = nh;
+	}
+
+	return dxt;
+}
+
+void AssetCooker::FindAssets(
+	const std::string & data_path,
+	const std::string & folder,
+	std::vector<std::string> & assets,
+	std::vector<std::string> & configs) const
+{
+	PathManager paths;
+	std::list<std::string> entries;
+	if (!paths.GetFileList(data_path + "/" + folder, entries))
+		return;
+
+	entries.sort();
+	for (const auto & entry : entries)
+	{
+		const std::string path = folder + "/" + entry;
+		std::list<std::string> subentries;
+		if (paths.GetFileList(data_path + "/" + path, subentries))
+			FindAssets(data_path, path, assets, configs);
+		else if (IsMesh(entry) || IsTexture(entry) || IsPack(entry))
+			assets.push_back(path);
+		else if (IsConfig(entry))
+			configs.push_back(path);
+	}
+}
+
+void AssetCooker::FindDataMaps(const std::string & config)
+{
+	// drawable texture lists are color, misc, normal map
+	std::ifstream file(config.c_str());
+	std::string line;
+	while (std::getline(file, line))
+	{
+		const size_t n = line.find('=');
+		if (n == std::string::npos || Trim(line.substr(0, n)) != "texture")
+			continue;
+
+		std::istringstream s(line.substr(n + 1));
+		std::string name;
+		for (int i = 0; i < 3 && std::getline(s, name, ','); ++i)
+		{
+			if (i == 2 && !Trim(name).empty())
+				datamaps.insert(GetFileName(Trim(name)));
+		}
+	}
+}
+
+bool AssetCooker::IsDataMap(const std::string & path) const
+{
+	// old style track objects use -misc2 for normal maps
+	const std::string name = GetFileName(path);
+	return datamaps.count(name) || name.find("-misc2.") != std::string::npos;
+}
+
+void AssetCooker::Cook(
+	const std::string & data_path,
+	const std::string & out_path,
+	const Options & options,
+	const CookedManifest & previous,
+	Result & result) const
+{
+	const Uint64 start = SDL_GetPerformanceCounter();
+	const std::string src = data_path + "/" + result.path;
+	const std::string dst = out_path + "/" + result.path;
+
+	std::vector<char> data;
+	if (!CookedManifest::GetFileState(src, result.insize, result.mtime) || !ReadFile(src, data))
+	{
+		result.error = "Can't read " + src;
+		return;
+	}
+
+	const bool pack = IsPack(result.path);
+	const bool mesh = pack || IsMesh(result.path);
+	const bool bvh = mesh && IsTrackMesh(result.path);
+	const bool compress = options.compress && !mesh && !IsDataMap(result.path);
+	const char * kind = bvh ? track_mesh_kind : mesh ? mesh_kind : compress ? color_kind : data_kind;
+	result.hash = Hash(data.data(), data.size(), Hash(kind, std::strlen(kind)));
+
+	// pack meshes are unpacked next to the pack
+	JoePack joepack;
+	std::vector<std::string> members;
+	const std::string dir = result.path.substr(0, result.path.find_last_of('/') + 1);
+	if (pack)
+	{
+		if (!joepack.Load(src))
+		{
+			result.error = "Can't open pack " + src;
+			return;
+		}
+		joepack.GetFileList(members);
+		members.erase(std::remove_if(members.begin(), members.end(),
+			[](const std::string & name) { return !IsMesh(name); }), members.end());
+		for (const auto & member : members)
+			result.outputs.push_back(dir + member);
+	}
+	else
+	{
+		result.outputs.push_back(result.path);
+	}
+	if (bvh)
+	{
+		const size_t count = result.outputs.size();
+		for (size_t i = 0; i < count; ++i)
+			result.outputs.push_back(result.outputs[i] + ".bvh");
+	}
+
+	bool uptodate = true;
+	for (const auto & output : result.outputs)
+	{
+		const CookedManifest::Entry * entry = previous.Get(output);
+		unsigned long size;
+		uptodate = uptodate && entry && entry->hash == result.hash &&
+			GetFileSize(out_path + "/" + output, size);
+		if (uptodate)
+		{
+			result.compressed = entry->compressed;
+			result.outsize += size;
+		}
+	}
+	if (uptodate)
+	{
+		result.status = Result::SKIPPED;
+		result.time = GetSeconds(start);
+		return;
+	}
+	result.outsize = 0;
+
+	if (pack)
+	{
+		for (const auto & member : members)
+		{
+			const std::string member_dst = out_path + "/" + dir + member;
+			MakeDirs(member_dst.substr(0, member_dst.find_last_of('/')));
+
+			std::ostringstream error;
+			ModelJoe03 model;
+			if (!model.Load(member, error, &joepack))
+			{
+				result.error = member + ": " + Trim(error.str());
+				return;
+			}
+			if (!WriteMesh(model, member_dst, bvh, result.error))
+				return;
+		}
+	}
+	else if (mesh)
+	{
+		std::ostringstream error;
+		ModelJoe03 model;
+		if (!model.Load(src, error))
+		{
+			result.error = Trim(error.str());
+			return;
+		}
+		if (!WriteMesh(model, dst, bvh, result.error))
+			return;
+	}
+	else
+	{
+		SDL_Surface * surface = IMG_Load(src.c_str());
+		SDL_Surface * converted = surface ? SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_RGBA32, 0) : 0;
+		if (!converted)
+		{
+			result.error = IMG_GetError();
+			SDL_FreeSurface(surface);
+			return;
+		}
+
+		const unsigned w = converted->w;
+		const unsigned h = converted->h;
+		std::vector<unsigned char> pixels(w * h * 4);
+		for (unsigned y = 0; y < h; ++y)
+		{
+			const unsigned char * row = static_cast<const unsigned char *>(converted->pixels) + y * converted->pitch;
+			std::memcpy(&pixels[y * w * 4], row, w * 4);
+		}
+		SDL_FreeSurface(converted);
+		SDL_FreeSurface(surface);
+
+		const bool large = w > compress_min_size || h > compress_min_size;
+		result.compressed = WriteDDS(pixels.data(), w, h, compress && large, data);
+
+		std::ofstream file(dst.c_str(), std::ios::binary);
+		if (!file.write(data.data(), data.size()))
+		{
+			result.error = "Can't write " + dst;
+			return;
+		}
+	}
+
+	for (const auto & output : result.outputs)
+	{
+		unsigned long size = 0;
+		GetFileSize(out_path + "/" + output, size);
+		result.outsize += size;
+	}
+	result.status = Result::COOKED;
+	result.time = GetSeconds(start);
+}
+
+static void DecodeColorBlock(const unsigned char in[8], int rgb[16][3])
+{
+	int palette[4][3];
+	Unpack565(in[0] | (in[1] << 8), palette[0]);
+	Unpack565(in[2] | (in[3] << 8), palette[1]);
+	for (int j = 0; j < 3; ++j)
+	{
+		palette[2][j] = (2 * palette[0][j] + palette[1][j]) / 3;
+		palette[3][j] = (palette[0][j] + 2 * palette[1][j]) / 3;
+	}
+	for (int i = 0; i < 16; ++i)
+	{
+		const int k = (in[4 + i / 4] >> ((i % 4) * 2)) & 3;
+		std::copy(palette[k], palette[k] + 3, rgb[i]);
+	}
+}
+
+QT_TEST(asset_cooker_test)
+{
+	QT_CHECK_EQUAL(AssetCooker::Hash("a", 1), 0xaf63dc4c8601ec8cULL);
+
+	// two color block survives within 565 precision
+	unsigned char block[64];
+	for (int i = 0; i < 16; ++i)
+	{
+		const unsigned char v = (i % 2) ? 200 : 40;
+		block[i * 4 + 0] = v;
+		block[i * 4 + 1] = v;
+		block[i * 4 + 2] = 255 - v;
+		block[i * 4 + 3] = (i < 8) ? 255 : 0;
+	}
+
+	unsigned char dxt5[16];
+	AssetCooker::EncodeDXT5(block, dxt5);
+	QT_CHECK_EQUAL(dxt5[0], 255);
+	QT_CHECK_EQUAL(dxt5[1], 0);
+
+	int rgb[16][3];
+	DecodeColorBlock(dxt5 + 8, rgb);
+	bool close = true;
+	for (int i = 0; i < 16; ++i)
+	{
+		for (int j = 0; j < 3; ++j)
+			close = close && std::abs(rgb[i][j] - block[i * 4 + j]) <= 8;
+	}
+	QT_CHECK(close);
+
+	// solid color uses a single end point
+	std::fill(block, block + 64, 128);
+	unsigned char dxt1[8];
+	AssetCooker::EncodeDXT1(block, dxt1);
+	QT_CHECK_EQUAL(dxt1[0] | (dxt1[1] << 8), dxt1[2] | (dxt1[3] << 8));
+	QT_CHECK_EQUAL(dxt1[4] | dxt1[5] | dxt1[6] | dxt1[7], 0);
+
+	// opaque power of two image compresses to DXT1 with all levels
+	std::vector<unsigned char> image(16 * 8 * 4, 255);
+	std::vector<char> dds;
+	QT_CHECK(AssetCooker::WriteDDS(image.data(), 16, 8, true, dds));
+	QT_CHECK_EQUAL(dds.size(), 128u + (8 + 2 + 1 + 1 + 1) * 8);
+	QT_CHECK_EQUAL(dds[84], 'D');
+	QT_CHECK_EQUAL(dds[87], '1');
+
+	// odd sizes stay uncompressed
+	QT_CHECK(!AssetCooker::WriteDDS(image.data(), 6, 3, true, dds));
+	QT_CHECK_EQUAL(dds.size(), 128u + (6 * 3 + 3 * 1 + 1 * 1) * 4);
+
+	// so does everything if compression is off
+	QT_CHECK(!AssetCooker::WriteDDS(image.data(), 16, 8, false, dds));
+	QT_CHECK_EQUAL(dds.size(), 128u + (16 * 8 + 8 * 4 + 4 * 2 + 2 * 1 + 1 * 1) * 4);
+}
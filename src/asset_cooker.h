@@ -0,0 +1,126 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef _ASSET_COOKER_H
+#define _ASSET_COOKER_H
+
+#include "cooked_manifest.h"
+
+#include <iosfwd>
+#include <set>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+/// Offline conversion of car and track assets into load-optimized forms.
+/// Meshes (.joe) are written as serialized vertex arrays (ova), textures
+/// (.png, .jpg) as DDS with a precomputed mip chain, DXT compressed where
+/// possible. Meshes of track object packs (objects.jpk) are unpacked into
+/// ova files next to the pack, track meshes also get their serialized
+/// collision bvh (.joe.bvh). Output files keep the relative path and name of
+/// their source, the game picks them up through the cooked data overlay. The manifest of
+/// source content hashes makes repeated runs incremental, the source sizes
+/// and modification times in it let the game skip stale cooked files.
+class AssetCooker
+{
+public:
+	struct Options
+	{
+		unsigned threads;
+		bool compress; ///< write DXT1/DXT5 color textures larger than 512, like the game does, uncompressed BGRA otherwise
+		bool force; ///< ignore the manifest, cook everything
+
+		Options();
+	};
+
+	struct Result
+	{
+		enum Status { COOKED, SKIPPED, FAILED };
+
+		std::string path; ///< relative to the data directory
+		std::vector<std::string> outputs; ///< cooked files relative to the out directory
+		std::string error;
+		Status status;
+		uint64_t hash;
+		long long mtime; ///< source modification time
+		bool compressed; ///< output is DXT compressed
+		unsigned long insize;
+		unsigned long outsize;
+		double time; ///< seconds spent hashing and cooking
+
+		Result();
+	};
+
+	/// Cook the cars, tracks, carparts and trackparts folders of data_path into out_path.
+	/// Returns false if any asset failed to cook.
+	bool Run(
+		const std::string & data_path,
+		const std::string & out_path,
+		const Options & options,
+		std::ostream & info_output,
+		std::ostream & error_output);
+
+	/// Results of the last run in processing order.
+	const std::vector<Result> & GetResults() const;
+
+	/// Print cooked assets sorted by time spent, slowest first, and totals.
+	void Report(std::ostream & out) const;
+
+	/// 64 bit FNV-1a hash.
+	static uint64_t Hash(const void * data, unsigned long size, uint64_t hash = 14695981039346656037ULL);
+
+	/// Encode a 4x4 block of RGBA pixels, rows of 16 bytes.
+	static void EncodeDXT1(const unsigned char block[64], unsigned char out[8]);
+	static void EncodeDXT5(const unsigned char block[64], unsigned char out[16]);
+
+	/// Write a DDS image with a full box filtered mip chain of the RGBA pixels.
+	/// DXT is only used for power of two images, alpha selects DXT5 over DXT1.
+	/// Returns true if the image has been compressed.
+	static bool WriteDDS(
+		const unsigned char * rgba,
+		unsigned width,
+		unsigned height,
+		bool compress,
+		std::vector<char> & out);
+
+private:
+	std::vector<Result> results;
+	CookedManifest manifest;
+	std::set<std::string> datamaps; ///< textures holding non color data
+
+	void FindAssets(
+		const std::string & data_path,
+		const std::string & folder,
+		std::vector<std::string> & assets,
+		std::vector<std::string> & configs) const;
+
+	/// Collect normal map names from the drawable texture lists of a car or track objects config.
+	void FindDataMaps(const std::string & config);
+
+	bool IsDataMap(const std::string & path) const;
+
+	void Cook(
+		const std::string & data_path,
+		const std::string & out_path,
+		const Options & options,
+		const CookedManifest & previous,
+		Result & result) const;
+};
+
+#endif // _ASSET_COOKER_H
@@ -276,7 +276,7 @@ inline PTree & PTree::set(const std::string & key, const T & value)
 		return p;
 	}
 	p._value = i->first; ///< store node key for error reporting
-	return p.set(key.substr(next), value);
+	return p.set(key.substr(next + 1), value);
 }
 
 inline void PTree::set(const PTree & other)
@@ -0,0 +1,219 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#include "collision_bvh.h"
+#include "graphics/model.h"
+#include "unittest.h"
+
+#include "BulletCollision/CollisionShapes/btBvhTriangleMeshShape.h"
+#include "BulletCollision/CollisionShapes/btOptimizedBvh.h"
+#include "BulletCollision/CollisionShapes/btTriangleIndexVertexArray.h"
+#include "LinearMath/btAlignedAllocator.h"
+#include "LinearMath/btScalar.h"
+
+#include <fstream>
+#include <cassert>
+#include <cstring>
+#include <cstdio>
+#include <cstdint>
+
+struct BvhHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t bullet_version;
+	uint32_t pointer_size;
+	uint32_t scalar_size;
+	uint32_t endian;
+	uint32_t triangles;
+	uint32_t vertices;
+	uint64_t mesh_hash;
+	uint32_t size; ///< bvh data bytes following the header
+	uint32_t padding;
+};
+
+// bvh data follows the header, keep it 16 byte aligned in the file
+static_assert(sizeof(BvhHeader) % 16 == 0, "bvh header size not a multiple of 16");
+
+static const char bvh_magic[4] = {'V', 'B', 'V', 'H'};
+static const uint32_t bvh_version = 1;
+static const uint32_t bvh_endian = 0x01020304;
+
+// 64 bit FNV-1a over vertex and index data of all mesh parts
+static uint64_t HashMesh(btTriangleIndexVertexArray & mesh, uint32_t & triangles, uint32_t & vertices)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	triangles = 0;
+	vertices = 0;
+	const IndexedMeshArray & parts = mesh.getIndexedMeshArray();
+	for (int i = 0; i < parts.size(); ++i)
+	{
+		const btIndexedMesh & part = parts[i];
+		const unsigned char * data[2] = {part.m_vertexBase, part.m_triangleIndexBase};
+		const unsigned long size[2] = {
+			(unsigned long)part.m_numVertices * part.m_vertexStride,
+			(unsigned long)part.m_numTriangles * part.m_triangleIndexStride};
+		for (int n = 0; n < 2; ++n)
+		{
+			for (unsigned long k = 0; k < size[n]; ++k)
+			{
+				hash ^= data[n][k];
+				hash *= 1099511628211ULL;
+			}
+		}
+		triangles += part.m_numTriangles;
+		vertices += part.m_numVertices;
+	}
+	return hash;
+}
+
+static void InitHeader(btTriangleIndexVertexArray & mesh, BvhHeader & header)
+{
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, bvh_magic, sizeof(bvh_magic));
+	header.version = bvh_version;
+	header.bullet_version = BT_BULLET_VERSION;
+	header.pointer_size = sizeof(void*);
+	header.scalar_size = sizeof(btScalar);
+	header.endian = bvh_endian;
+	header.mesh_hash = HashMesh(mesh, header.triangles, header.vertices);
+}
+
+btIndexedMesh GetIndexedMesh(const Model & model)
+{
+	const float * vertices;
+	unsigned int vcount;
+	const unsigned int * faces;
+	unsigned int fcount;
+	model.GetVertexArray().GetVertices(vertices, vcount);
+	model.GetVertexArray().GetFaces(faces, fcount);
+
+	assert(fcount % 3 == 0); //Face count is not a multiple of 3
+
+	btIndexedMesh mesh;
+	mesh.m_numTriangles = fcount / 3;
+	mesh.m_triangleIndexBase = (const unsigned char *)faces;
+	mesh.m_triangleIndexStride = sizeof(unsigned int) * 3;
+	mesh.m_numVertices = vcount / 3;
+	mesh.m_vertexBase = (const unsigned char *)vertices;
+	mesh.m_vertexStride = sizeof(float) * 3;
+	mesh.m_vertexType = PHY_FLOAT;
+	return mesh;
+}
+
+bool WriteCollisionBvh(btTriangleIndexVertexArray & mesh, const std::string & path)
+{
+	// let the shape build the bvh, so it matches the one built at load
+	btBvhTriangleMeshShape shape(&mesh, true);
+	const btOptimizedBvh * bvh = shape.getOptimizedBvh();
+	if (!bvh)
+		return false;
+
+	BvhHeader header;
+	InitHeader(mesh, header);
+	header.size = bvh->calculateSerializeBufferSize();
+
+	void * buffer = btAlignedAlloc(header.size, 16);
+	bool ok = bvh->serializeInPlace(buffer, header.size, false);
+	if (ok)
+	{
+		std::ofstream file(path.c_str(), std::ios::binary);
+		file.write((const char *)&header, sizeof(header));
+		file.write((const char *)buffer, header.size);
+		ok = file.good();
+	}
+	btAlignedFree(buffer);
+	return ok;
+}
+
+btOptimizedBvh * ReadCollisionBvh(
+	btTriangleIndexVertexArray & mesh,
+	const std::string & path,
+	void *& buffer)
+{
+	buffer = 0;
+	std::ifstream file(path.c_str(), std::ios::binary);
+	BvhHeader header;
+	if (!file.read((char *)&header, sizeof(header)))
+		return 0;
+
+	BvhHeader expected;
+	InitHeader(mesh, expected);
+	expected.size = header.size;
+	if (std::memcmp(&header, &expected, sizeof(header)) != 0)
+		return 0;
+
+	// a truncated file would leave the bvh incomplete
+	file.seekg(0, file.end);
+	if ((unsigned long)file.tellg() != sizeof(header) + header.size)
+		return 0;
+	file.seekg(sizeof(header));
+
+	buffer = btAlignedAlloc(header.size, 16);
+	btOptimizedBvh * bvh = 0;
+	if (file.read((char *)buffer, header.size))
+		bvh = btOptimizedBvh::deSerializeInPlace(buffer, header.size, false);
+	if (!bvh)
+	{
+		btAlignedFree(buffer);
+		buffer = 0;
+	}
+	return bvh;
+}
+
+QT_TEST(collision_bvh_test)
+{
+	float vertices[] = {
+		0, 0, 0, 1, 0, 0, 1, 1, 0, 0, 1, 0,
+		0, 0, 1, 1, 0, 1, 1, 1, 1, 0, 1, 1};
+	unsigned int faces[] = {0, 1, 2, 0, 2, 3, 4, 5, 6, 4, 6, 7};
+
+	btIndexedMesh part;
+	part.m_numTriangles = 4;
+	part.m_triangleIndexBase = (const unsigned char *)faces;
+	part.m_triangleIndexStride = sizeof(unsigned int) * 3;
+	part.m_numVertices = 8;
+	part.m_vertexBase = (const unsigned char *)vertices;
+	part.m_vertexStride = sizeof(float) * 3;
+	part.m_vertexType = PHY_FLOAT;
+
+	btTriangleIndexVertexArray mesh;
+	mesh.addIndexedMesh(part);
+
+	const std::string path = "collision_bvh_test.bvh";
+	QT_CHECK(WriteCollisionBvh(mesh, path));
+
+	void * buffer = 0;
+	btOptimizedBvh * bvh = ReadCollisionBvh(mesh, path, buffer);
+	QT_CHECK(bvh != 0);
+	if (bvh)
+	{
+		btBvhTriangleMeshShape shape(&mesh, true, false);
+		shape.setOptimizedBvh(bvh);
+		QT_CHECK(shape.getOptimizedBvh() == bvh);
+	}
+	btAlignedFree(buffer);
+
+	// a bvh of other mesh data is rejected
+	vertices[2] = 2;
+	QT_CHECK(ReadCollisionBvh(mesh, path, buffer) == 0);
+	QT_CHECK(buffer == 0);
+
+	std::remove(path.c_str());
+}
@@ -0,0 +1,45 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef _COLLISION_BVH_H
+#define _COLLISION_BVH_H
+
+#include <string>
+
+class Model;
+class btOptimizedBvh;
+class btTriangleIndexVertexArray;
+struct btIndexedMesh;
+
+// bullet triangle mesh referencing the vertex array of model
+btIndexedMesh GetIndexedMesh(const Model & model);
+
+// write the quantized bvh btBvhTriangleMeshShape builds for mesh to path,
+// along with what is needed to tell whether it still fits the mesh
+bool WriteCollisionBvh(btTriangleIndexVertexArray & mesh, const std::string & path);
+
+// read a bvh written by WriteCollisionBvh, null if it is missing or was
+// built for other mesh data, another bullet version or another platform
+// the bvh lives in buffer, free it with btAlignedFree after the shapes using it
+btOptimizedBvh * ReadCollisionBvh(
+	btTriangleIndexVertexArray & mesh,
+	const std::string & path,
+	void *& buffer);
+
+#endif //_COLLISION_BVH_H
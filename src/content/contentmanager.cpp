@@ -18,10 +18,13 @@
 /************************************************************************/
 
 #include "contentmanager.h"
+#include "cooked_manifest.h"
 
+#include <fstream>
 #include <ostream>
 
 ContentManager::ContentManager(std::ostream & error) :
+	cooked(0),
 	error(error)
 {
 	// ctor
@@ -43,6 +46,48 @@ void ContentManager::addPath(const std::string & path)
 	basepaths.push_back(path);
 }
 
+void ContentManager::setCookedPath(
+	const std::string & cooked_path,
+	const std::string & data_path,
+	const CookedManifest * manifest)
+{
+	cookedpath = cooked_path;
+	datapath = data_path;
+	cooked = manifest;
+}
+
+std::string ContentManager::getCookedPath(
+	const std::string & path,
+	const std::string & name) const
+{
+	if (cookedpath.empty() || _stale(cookedpath, path, name))
+		return std::string();
+
+	std::string filepath = cookedpath;
+	if (!path.empty())
+		filepath += "/" + path;
+	filepath += "/" + name;
+	return std::ifstream(filepath.c_str()) ? filepath : std::string();
+}
+
+bool ContentManager::_stale(
+	const std::string & basepath,
+	const std::string & relpath,
+	const std::string & name) const
+{
+	if (!cooked ||
+		basepath.compare(0, cookedpath.length(), cookedpath) != 0 ||
+		(basepath.length() > cookedpath.length() && basepath[cookedpath.length()] != '/'))
+		return false;
+
+	// manifest paths are relative to the data directory
+	std::string source = basepath.substr(cookedpath.length());
+	if (!relpath.empty())
+		source += "/" + relpath;
+	source += "/" + name;
+	return !cooked->IsFresh(datapath, source.substr(1));
+}
+
 void ContentManager::sweep()
 {
 	for (auto & cache : factory_cached.m_caches)
@@ -27,6 +27,8 @@
 #include <vector>
 #include <map>
 
+class CookedManifest;
+
 class ContentManager
 {
 public:
@@ -62,6 +64,19 @@ public:
 	/// add content directory path
 	void addPath(const std::string & path);
 
+	/// content paths below cooked_path hold assets cooked from data_path
+	/// they are skipped unless the manifest lists them as fresh, see vdrift-cook
+	void setCookedPath(
+		const std::string & cooked_path,
+		const std::string & data_path,
+		const CookedManifest * manifest);
+
+	/// full path of the fresh cooked file path/name, empty if there is none
+	/// for cooked data without a content type, like collision bvhs
+	std::string getCookedPath(
+		const std::string & path,
+		const std::string & name) const;
+
 	/// garbage collect unused content
 	void sweep();
 
@@ -118,12 +133,23 @@ private:
 	std::vector<std::string> sharedpaths;
 	std::vector<std::string> basepaths;
 
+	/// cooked content
+	std::string cookedpath;
+	std::string datapath;
+	const CookedManifest * cooked;
+
 	/// error log
 	std::ostream & error;
 
 	/// content leak logger
 	bool _logleaks();
 
+	/// true if the content is a cooked file whose source changed
+	bool _stale(
+		const std::string & basepath,
+		const std::string & relpath,
+		const std::string & name) const;
+
 	/// error logger
 	bool _logerror(
 		const std::string & path,
@@ -219,6 +245,9 @@ inline bool ContentManager::_load(
 	Factory<T>& factory = getFactory<T>();
 	for (const auto & basepath : basepaths)
 	{
+		if (_stale(basepath, relpath, name))
+			continue;
+
 		if (factory.create(sptr, error, basepath, relpath, name, param))
 		{
 			// cache loaded content
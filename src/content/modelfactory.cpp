@@ -42,7 +42,17 @@ bool Factory<Model>::create(
 	const empty&)
 {
 	const std::string abspath = basepath + "/" + path + "/" + name;
-	if (std::ifstream(abspath.c_str()))
+	if (Model::IsSerialized(abspath))
+	{
+		// cooked mesh
+		std::shared_ptr<Model> temp(new Model());
+		if (temp->ReadFromFile(abspath, error))
+		{
+			sptr = temp;
+			return true;
+		}
+	}
+	else if (std::ifstream(abspath.c_str()))
 	{
 		std::shared_ptr<ModelJoe03> temp(new ModelJoe03());
 		if (temp->Load(abspath, error))
@@ -19,15 +19,18 @@
 
 #include "texturefactory.h"
 #include "graphics/texture.h"
+#include "graphics/texturestreamer.h"
 #include <fstream>
 #include <sstream>
 
 Factory<Texture>::Factory() :
 	m_default(new Texture()),
 	m_zero(new Texture()),
+	m_streamer(new TextureStreamer()),
 	m_size(TextureInfo::LARGE),
 	m_compress(true),
-	m_srgb(false)
+	m_srgb(false),
+	m_headless(false)
 {
 	// ctor
 }
@@ -58,6 +61,11 @@ void Factory<Texture>::init(int max_size, bool use_srgb, bool compress)
 	m_zero->Load("", info, error);
 }
 
+void Factory<Texture>::initHeadless()
+{
+	m_headless = true;
+}
+
 template <>
 bool Factory<Texture>::create(
 	std::shared_ptr<Texture> & sptr,
@@ -70,13 +78,27 @@ bool Factory<Texture>::create(
 	const std::string abspath = basepath + "/" + path + "/" + name;
 	if (info.data || std::ifstream(abspath.c_str()))
 	{
+		if (m_headless)
+		{
+			sptr = m_default;
+			return true;
+		}
+
 		TextureInfo info_temp = info;
 		info_temp.srgb = info.compress && m_srgb; 			// non compressible means non color data
 		info_temp.compress = info.compress && m_compress;	// allow to disable compression
 		info_temp.maxsize = TextureInfo::Size(m_size);
+
+		// textures sampled without mip filtering need all of their levels
+		const bool stream = m_streamer->Enabled() && info.mipmap && !info.data && !info.cube;
+		if (stream)
+			info_temp.streamsize = m_streamer->GetStreamSize();
+
 		std::shared_ptr<Texture> temp(new Texture());
 		if (temp->Load(abspath, info_temp, error))
 		{
+			if (m_streamer->Enabled())
+				m_streamer->Add(temp, abspath, stream);
 			sptr = temp;
 			return true;
 		}
@@ -93,3 +115,8 @@ const std::shared_ptr<Texture> & Factory<Texture>::getZero() const
 {
 	return m_zero;
 }
+
+TextureStreamer & Factory<Texture>::getStreamer()
+{
+	return *m_streamer;
+}
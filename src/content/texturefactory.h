@@ -24,6 +24,7 @@
 #include "graphics/textureinfo.h"
 
 class Texture;
+class TextureStreamer;
 
 template <>
 class Factory<Texture>
@@ -38,6 +39,10 @@ public:
 	/// limit texture size to max size
 	void init(int max_size, bool use_srgb, bool compress);
 
+	/// don't upload anything, existing textures resolve to the default texture
+	/// used to load content for simulation without a gl context
+	void initHeadless();
+
 	template <class P>
 	bool create(
 		std::shared_ptr<Texture> & sptr,
@@ -53,12 +58,18 @@ public:
 	/// zero texture is black: rgba (0, 0, 0, 0)
 	const std::shared_ptr<Texture> & getZero() const;
 
+	/// textures created while the streamer is enabled are tracked by it,
+	/// mipmapped ones are created with their coarse levels only
+	TextureStreamer & getStreamer();
+
 private:
 	std::shared_ptr<Texture> m_default;
 	std::shared_ptr<Texture> m_zero;
+	std::shared_ptr<TextureStreamer> m_streamer;
 	int m_size;
 	bool m_compress;
 	bool m_srgb;
+	bool m_headless;
 };
 
 #endif // _TEXTUREFACTORY_H
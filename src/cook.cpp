@@ -0,0 +1,166 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#include "asset_cooker.h"
+#include "pathmanager.h"
+#include "graphics/model_joe03.h"
+#include "graphics/model_obj.h"
+#include "unittest.h"
+
+#include <SDL2/SDL.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+// after the standard headers, it pulls in the thread headers inside its namespace
+#include "numprocessors.h"
+
+static void PrintHelp(std::ostream & out)
+{
+	out << "Usage: vdrift-cook [options]\n"
+		"Convert car and track assets into load-optimized forms.\n"
+		"  -data PATH      data directory to read, defaults to the game data directory\n"
+		"  -out PATH       directory to write cooked assets to, defaults to DATA/cooked\n"
+		"  -threads N      number of worker threads, defaults to the processor count\n"
+		"  -nocompress     write uncompressed textures\n"
+		"  -force          cook everything, ignore previous results\n"
+		"  -report         print time spent per cooked asset\n"
+		"  -convert IN OUT convert a joe, obj or cooked model to an obj file and exit\n"
+		"  -test           run the cooker unit tests and exit\n"
+		"  -help           show this message" << std::endl;
+}
+
+static std::string GetExtension(const std::string & path)
+{
+	const size_t dot = path.rfind('.');
+	return (dot == std::string::npos) ? std::string() : path.substr(dot + 1);
+}
+
+/// Replaces the standalone modelconvert tool, only obj output is supported.
+static bool ConvertModel(const std::string & in_path, const std::string & out_path)
+{
+	if (GetExtension(out_path) != "obj")
+	{
+		std::cerr << "Don't know how to save to " << out_path << std::endl;
+		return false;
+	}
+
+	ModelObj out_model;
+	const std::string in_ext = GetExtension(in_path);
+	if (Model::IsSerialized(in_path))
+	{
+		Model in_model;
+		if (!in_model.ReadFromFile(in_path, std::cerr) ||
+			!out_model.Load(in_model.GetVertexArray(), std::cerr))
+			return false;
+	}
+	else if (in_ext == "joe")
+	{
+		ModelJoe03 in_model;
+		if (!in_model.Load(in_path, std::cerr) ||
+			!out_model.Load(in_model.GetVertexArray(), std::cerr))
+			return false;
+	}
+	else if (in_ext == "obj")
+	{
+		if (!out_model.Load(in_path, std::cerr))
+			return false;
+	}
+	else
+	{
+		std::cerr << "Don't know how to read " << in_path << std::endl;
+		return false;
+	}
+
+	if (!out_model.Save(out_path, std::cerr))
+	{
+		std::cerr << "Error writing " << out_path << std::endl;
+		return false;
+	}
+	return true;
+}
+
+int main(int argc, char * argv[])
+{
+	PathManager paths;
+	std::ostringstream dummy;
+	paths.Init(dummy, dummy);
+
+	std::string data_path = paths.GetDataPath();
+	std::string out_path;
+	bool report = false;
+
+	AssetCooker::Options options;
+	options.threads = NUMPROCESSORS::GetNumProcessors();
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string arg = argv[i];
+		const bool has_value = i + 1 < argc;
+		if (arg == "-data" && has_value)
+			data_path = argv[++i];
+		else if (arg == "-out" && has_value)
+			out_path = argv[++i];
+		else if (arg == "-threads" && has_value)
+			options.threads = std::max(1, std::atoi(argv[++i]));
+		else if (arg == "-nocompress")
+			options.compress = false;
+		else if (arg == "-force")
+			options.force = true;
+		else if (arg == "-report")
+			report = true;
+		else if (arg == "-convert" && i + 2 < argc)
+		{
+			return ConvertModel(argv[i + 1], argv[i + 2]) ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+		else if (arg == "-test")
+		{
+			QT_SET_OUTPUT(&std::cout);
+			return QT_RUN_TESTS ? EXIT_FAILURE : EXIT_SUCCESS;
+		}
+		else
+		{
+			PrintHelp(arg == "-help" ? std::cout : std::cerr);
+			return (arg == "-help") ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+	}
+	if (out_path.empty())
+		out_path = data_path + "/cooked";
+
+	if (SDL_Init(0) < 0)
+	{
+		std::cerr << "SDL initialization failed: " << SDL_GetError() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::cout << "Cooking " << data_path << " into " << out_path <<
+		" on " << options.threads << " threads" << std::endl;
+
+	AssetCooker cooker;
+	const bool success = cooker.Run(data_path, out_path, options, std::cout, std::cerr);
+	if (report)
+		cooker.Report(std::cout);
+
+	SDL_Quit();
+
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
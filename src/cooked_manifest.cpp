@@ -0,0 +1,189 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#include "cooked_manifest.h"
+#include "unittest.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+const char * CookedManifest::filename = "cook.manifest";
+
+CookedManifest::Entry::Entry() :
+	hash(0),
+	size(0),
+	mtime(0),
+	compressed(false)
+{
+	// ctor
+}
+
+CookedManifest::CookedManifest() :
+	allow_compressed(true)
+{
+	// ctor
+}
+
+bool CookedManifest::Load(const std::string & path)
+{
+	std::ifstream file(path.c_str());
+	if (!file)
+		return false;
+
+	// one asset per line: hash size mtime compressed path, optionally followed by a tab and the source path
+	std::string line;
+	while (std::getline(file, line))
+	{
+		std::istringstream s(line);
+		Entry entry;
+		std::string name;
+		if (!(s >> std::hex >> entry.hash >> std::dec >> entry.size >> entry.mtime >> entry.compressed &&
+			std::getline(s >> std::ws, name)))
+			continue;
+
+		const size_t tab = name.find('\t');
+		if (tab != std::string::npos)
+		{
+			entry.source = name.substr(tab + 1);
+			name.erase(tab);
+		}
+		entries[name] = entry;
+	}
+	return true;
+}
+
+bool CookedManifest::Save(const std::string & path) const
+{
+	std::ofstream file(path.c_str());
+	for (const auto & entry : entries)
+	{
+		const Entry & e = entry.second;
+		file << std::hex << std::setw(16) << std::setfill('0') << e.hash << std::dec << ' ' <<
+			e.size << ' ' << e.mtime << ' ' << e.compressed << ' ' << entry.first;
+		if (!e.source.empty())
+			file << '\t' << e.source;
+		file << '\n';
+	}
+	return bool(file);
+}
+
+void CookedManifest::Clear()
+{
+	entries.clear();
+}
+
+const CookedManifest::Entry * CookedManifest::Get(const std::string & relpath) const
+{
+	auto i = entries.find(relpath);
+	return (i != entries.end()) ? &i->second : 0;
+}
+
+void CookedManifest::Set(const std::string & relpath, const Entry & entry)
+{
+	entries[relpath] = entry;
+}
+
+void CookedManifest::SetAllowCompressed(bool value)
+{
+	allow_compressed = value;
+}
+
+bool CookedManifest::IsFresh(const std::string & data_path, const std::string & relpath) const
+{
+	const Entry * entry = Get(relpath);
+	if (!entry || (entry->compressed && !allow_compressed))
+		return false;
+
+	unsigned long size;
+	long long mtime;
+	const std::string & source = entry->source.empty() ? relpath : entry->source;
+	return GetFileState(data_path + "/" + source, size, mtime) &&
+		size == entry->size && mtime == entry->mtime;
+}
+
+bool CookedManifest::GetFileState(const std::string & path, unsigned long & size, long long & mtime)
+{
+	struct stat s;
+	if (stat(path.c_str(), &s) != 0)
+		return false;
+
+	size = s.st_size;
+	mtime = s.st_mtime;
+	return true;
+}
+
+QT_TEST(cooked_manifest_test)
+{
+	const std::string source = "cooked_manifest_test.txt";
+	std::ofstream(source.c_str()) << "source";
+
+	CookedManifest manifest;
+	CookedManifest::Entry entry;
+	entry.hash = 0x0123456789abcdefULL;
+	entry.compressed = true;
+	QT_CHECK(CookedManifest::GetFileState(source, entry.size, entry.mtime));
+	QT_CHECK_EQUAL(entry.size, 6u);
+	manifest.Set(source, entry);
+	QT_CHECK(manifest.IsFresh(".", source));
+	QT_CHECK(!manifest.IsFresh(".", "cooked_manifest_test.none"));
+
+	manifest.SetAllowCompressed(false);
+	QT_CHECK(!manifest.IsFresh(".", source));
+	manifest.SetAllowCompressed(true);
+
+	// round trip through a file
+	const std::string path = "cooked_manifest_test.manifest";
+	QT_CHECK(manifest.Save(path));
+	CookedManifest loaded;
+	QT_CHECK(loaded.Load(path));
+	const CookedManifest::Entry * e = loaded.Get(source);
+	QT_CHECK(e != 0);
+	if (e)
+	{
+		QT_CHECK_EQUAL(e->hash, entry.hash);
+		QT_CHECK_EQUAL(e->mtime, entry.mtime);
+		QT_CHECK(e->compressed);
+	}
+	QT_CHECK(loaded.IsFresh(".", source));
+
+	// files cooked from another source follow that source
+	CookedManifest::Entry derived = entry;
+	derived.source = source;
+	loaded.Set("cooked_manifest_test.bvh", derived);
+	QT_CHECK(loaded.Save(path));
+	QT_CHECK(loaded.Load(path));
+	e = loaded.Get("cooked_manifest_test.bvh");
+	QT_CHECK(e != 0);
+	if (e)
+		QT_CHECK_EQUAL(e->source, source);
+	QT_CHECK(loaded.IsFresh(".", "cooked_manifest_test.bvh"));
+
+	// a changed source makes the cooked asset stale
+	std::ofstream(source.c_str()) << "changed source";
+	QT_CHECK(!loaded.IsFresh(".", source));
+	QT_CHECK(!loaded.IsFresh(".", "cooked_manifest_test.bvh"));
+
+	std::remove(source.c_str());
+	std::remove(path.c_str());
+}
@@ -0,0 +1,77 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef _COOKED_MANIFEST_H
+#define _COOKED_MANIFEST_H
+
+#include <map>
+#include <string>
+#include <cstdint>
+
+/// Index of the assets written by vdrift-cook, see AssetCooker.
+/// Records for each cooked file the size and modification time of the
+/// source it was made from, so the game only lets a cooked file stand in
+/// for its source while the source is unchanged. Cooked files without a
+/// source of their own, like meshes unpacked from an objects.jpk or the
+/// collision bvh of a mesh, name the file they were made from.
+class CookedManifest
+{
+public:
+	struct Entry
+	{
+		uint64_t hash; ///< source content hash, see AssetCooker
+		unsigned long size; ///< source file size
+		long long mtime; ///< source modification time
+		bool compressed; ///< cooked file holds DXT compressed texture data
+		std::string source; ///< path of the source relative to the data directory, if not the cooked path
+
+		Entry();
+	};
+
+	/// Manifest file name in the cooked data directory.
+	static const char * filename;
+
+	CookedManifest();
+
+	bool Load(const std::string & path);
+
+	bool Save(const std::string & path) const;
+
+	void Clear();
+
+	/// Cooked asset entry by path relative to the data directory, null if not cooked.
+	const Entry * Get(const std::string & relpath) const;
+
+	void Set(const std::string & relpath, const Entry & entry);
+
+	/// Reject compressed textures, used if texture compression is disabled.
+	void SetAllowCompressed(bool value);
+
+	/// True if the cooked asset may be used in place of its source in data_path.
+	bool IsFresh(const std::string & data_path, const std::string & relpath) const;
+
+	/// Get size and modification time of a file, returns false if it doesn't exist.
+	static bool GetFileState(const std::string & path, unsigned long & size, long long & mtime);
+
+private:
+	std::map<std::string, Entry> entries;
+	bool allow_compressed;
+};
+
+#endif // _COOKED_MANIFEST_H
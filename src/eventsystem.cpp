@@ -35,12 +35,14 @@ using std::endl;
 EventSystem::EventSystem() :
 	lasttick(0),
 	dt(0),
+	frameticks(0),
 	quit(false),
 	mousex(0),
 	mousey(0),
 	mousexrel(0),
 	mouseyrel(0),
-	fps_memory_window(10)
+	fps_memory_window(10),
+	probe_type(0)
 {
 	// ctor
 }
@@ -82,6 +84,8 @@ void EventSystem::Init(std::ostream & info_output)
 
 void EventSystem::BeginFrame()
 {
+	frameticks = SDL_GetTicks();
+
 	if (lasttick == 0)
 		lasttick = SDL_GetTicks();
 	else
@@ -133,6 +137,11 @@ inline void HandleHat(Joystick & joystick, uint8_t hatid, uint8_t hatvalue)
 }
 
 void EventSystem::ProcessEvents()
+{
+	ProcessEvents(SDL_GetTicks());
+}
+
+void EventSystem::ProcessEvents(Uint32 deadline)
 {
 	AgeToggles(keymap);
 	AgeToggles(mbutmap);
@@ -140,50 +149,67 @@ void EventSystem::ProcessEvents()
 	{
 		joystick.AgeToggles();
 	}
+	probes.clear();
 
+	const Uint32 pumptime = SDL_GetTicks();
 	SDL_Event event;
 	while (SDL_PollEvent(&event))
 	{
-		switch (event.type)
-		{
-		case SDL_MOUSEMOTION:
-			HandleMouseMotion(event.motion.x, event.motion.y, event.motion.xrel, event.motion.yrel);
-			break;
-		case SDL_MOUSEBUTTONDOWN:
-			HandleMouseButton(DOWN, event.button.button);
-			break;
-		case SDL_MOUSEBUTTONUP:
-			HandleMouseButton(UP, event.button.button);
-			break;
-		case SDL_KEYDOWN:
-			HandleKey(DOWN, event.key.keysym.sym);
-			break;
-		case SDL_KEYUP:
-			HandleKey(UP, event.key.keysym.sym);
-			break;
-		case SDL_JOYBUTTONDOWN:
-			assert(size_t(event.jbutton.which) < joysticks.size()); //ensure the event came from a known joystick
-			joysticks[event.jbutton.which].SetButton(event.jbutton.button, true);
-			break;
-		case SDL_JOYBUTTONUP:
-			assert(size_t(event.jbutton.which) < joysticks.size()); //ensure the event came from a known joystick
-			joysticks[event.jbutton.which].SetButton(event.jbutton.button, false);
-			break;
-		case SDL_JOYHATMOTION:
-			assert(size_t(event.jhat.which) < joysticks.size());
-			HandleHat(joysticks[event.jhat.which], event.jhat.hat, event.jhat.value);
-			break;
-		case SDL_JOYAXISMOTION:
-			assert(size_t(event.jaxis.which) < joysticks.size()); //ensure the event came from a known joystick
-			joysticks[event.jaxis.which].SetAxis(event.jaxis.axis, event.jaxis.value / 32768.0f);
-			//std::cout << "Joy " << (int) event.jaxis.which << " axis " << (int) event.jaxis.axis << " value " << event.jaxis.value / 32768.0f << endl;
-			break;
-		case SDL_QUIT:
-			HandleQuit();
-			break;
-		default:
-			break;
-		}
+		if (SDL_TICKS_PASSED(event.common.timestamp, pumptime))
+			event.common.timestamp = deadline;
+		pending.push_back(event);
+	}
+
+	while (!pending.empty() && SDL_TICKS_PASSED(deadline, pending.front().common.timestamp))
+	{
+		HandleEvent(pending.front());
+		pending.pop_front();
+	}
+}
+
+void EventSystem::HandleEvent(const SDL_Event & event)
+{
+	switch (event.type)
+	{
+	case SDL_MOUSEMOTION:
+		HandleMouseMotion(event.motion.x, event.motion.y, event.motion.xrel, event.motion.yrel);
+		break;
+	case SDL_MOUSEBUTTONDOWN:
+		HandleMouseButton(DOWN, event.button.button);
+		break;
+	case SDL_MOUSEBUTTONUP:
+		HandleMouseButton(UP, event.button.button);
+		break;
+	case SDL_KEYDOWN:
+		HandleKey(DOWN, event.key.keysym.sym);
+		break;
+	case SDL_KEYUP:
+		HandleKey(UP, event.key.keysym.sym);
+		break;
+	case SDL_JOYBUTTONDOWN:
+		assert(size_t(event.jbutton.which) < joysticks.size()); //ensure the event came from a known joystick
+		joysticks[event.jbutton.which].SetButton(event.jbutton.button, true);
+		break;
+	case SDL_JOYBUTTONUP:
+		assert(size_t(event.jbutton.which) < joysticks.size()); //ensure the event came from a known joystick
+		joysticks[event.jbutton.which].SetButton(event.jbutton.button, false);
+		break;
+	case SDL_JOYHATMOTION:
+		assert(size_t(event.jhat.which) < joysticks.size());
+		HandleHat(joysticks[event.jhat.which], event.jhat.hat, event.jhat.value);
+		break;
+	case SDL_JOYAXISMOTION:
+		assert(size_t(event.jaxis.which) < joysticks.size()); //ensure the event came from a known joystick
+		joysticks[event.jaxis.which].SetAxis(event.jaxis.axis, event.jaxis.value / 32768.0f);
+		//std::cout << "Joy " << (int) event.jaxis.which << " axis " << (int) event.jaxis.axis << " value " << event.jaxis.value / 32768.0f << endl;
+		break;
+	case SDL_QUIT:
+		HandleQuit();
+		break;
+	default:
+		if (probe_type && event.type == probe_type)
+			probes.push_back(event);
+		break;
 	}
 }
 
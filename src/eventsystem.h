@@ -26,6 +26,7 @@
 #include <vector>
 #include <map>
 #include <list>
+#include <deque>
 #include <iosfwd>
 #include <cassert>
 
@@ -116,12 +117,28 @@ public:
 
 	inline double Get_dt() {return dt;}
 
+	/// SDL tick count at the start of the frame.
+	Uint32 GetFrameTicks() const {return frameticks;}
+
 	inline bool GetQuit() const {return quit;}
 
 	void Quit() {quit = true;}
 
+	/// Handle all queued events.
 	void ProcessEvents();
 
+	/// Handle queued events which arrived up to deadline, in SDL ticks.
+	/// Events keep their arrival time if they were queued before the pump,
+	/// by the input sampler, events queued by the pump itself are due now.
+	/// Later events stay queued for the next call.
+	void ProcessEvents(Uint32 deadline);
+
+	/// Collect events of type as latency probes instead of handling them.
+	void SetProbeType(Uint32 type) {probe_type = type;}
+
+	/// Probes consumed by the last ProcessEvents call.
+	const std::vector <SDL_Event> & GetProbes() const {return probes;}
+
 	Toggle GetMouseButtonState(int id) const { return GetToggle(mbutmap, id); }
 
 	Toggle GetKeyState(SDL_Keycode id) const { return GetToggle(keymap, id); }
@@ -193,8 +210,13 @@ public:
 private:
 	double lasttick;
 	double dt;
+	Uint32 frameticks;
 	bool quit;
 
+	std::deque <SDL_Event> pending;
+	std::vector <SDL_Event> probes;
+	Uint32 probe_type;
+
 	std::vector <Joystick> joysticks;
 	std::map <SDL_Keycode, Toggle> keymap;
 	std::map <int, Toggle> mbutmap;
@@ -206,6 +228,8 @@ private:
 
 	enum DirectionEnum {UP, DOWN};
 
+	void HandleEvent(const SDL_Event & event);
+
 	void HandleMouseMotion(int x, int y, int xrel, int yrel);
 
 	void HandleMouseButton(DirectionEnum dir, int id);
@@ -29,7 +29,6 @@ ForceFeedback::ForceFeedback(
 	std::ostream & info_output) :
 	device_name(device),
 	enabled(true),
-	lastforce(0),
 	haptic(0),
 	effect_id(-1)
 {
@@ -99,39 +98,20 @@ ForceFeedback::~ForceFeedback()
 		SDL_HapticClose(haptic);
 }
 
-void ForceFeedback::update(
-	float force,
-	float /*dt*/,
-	std::ostream & error_output)
+bool ForceFeedback::Send(float force)
 {
-	if (!enabled || !haptic || (effect_id == -1))
-		return;
-
-	// Clamp force.
-	force = Clamp(force, -1.0f, 1.0f);
-
-	// Low pass filter.
-	lastforce = (lastforce + force) * 0.5f;
+	if (!Available())
+		return false;
 
 	// Update effect.
-	effect.constant.level = Sint16(lastforce * 32767);
+	effect.constant.level = Sint16(Clamp(force, -1.0f, 1.0f) * 32767);
 	int new_effect_id = SDL_HapticUpdateEffect(haptic, effect_id, &effect);
 	if (new_effect_id == -1)
-	{
-		error_output << "Failed to update force feedback effect: " << SDL_GetError();
-		return;
-	}
-	else
-	{
-		effect_id = new_effect_id;
-	}
+		return false;
+	effect_id = new_effect_id;
 
 	// Run effect.
-	if (SDL_HapticRunEffect(haptic, effect_id, 1) == -1)
-	{
-		error_output << "Failed to run force feedback effect: " << SDL_GetError();
-		return;
-	}
+	return SDL_HapticRunEffect(haptic, effect_id, 1) != -1;
 }
 
 void ForceFeedback::disable()
@@ -20,11 +20,14 @@
 #ifndef _FORCEFEEDBACK_H
 #define _FORCEFEEDBACK_H
 
+#include "forcefeedback_loop.h"
+
 #include <SDL2/SDL_haptic.h>
 #include <iosfwd>
 #include <string>
 
-class ForceFeedback
+/// Constant force effect on the first SDL haptic device.
+class ForceFeedback : public HapticOutput
 {
 public:
 	ForceFeedback(
@@ -34,17 +37,19 @@ public:
 
 	~ForceFeedback();
 
-	void update(
-		float force,
-		float dt,
-		std::ostream & error_output);
+	/// Device found and constant force effect uploaded.
+	bool Available() const
+	{
+		return enabled && haptic && effect_id != -1;
+	}
+
+	bool Send(float force);
 
 	void disable();
 
 private:
 	std::string device_name;
 	bool enabled;
-	float lastforce;
 
 	SDL_Haptic * haptic;
 	SDL_HapticEffect effect;
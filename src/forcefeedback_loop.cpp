@@ -0,0 +1,279 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#include "forcefeedback_loop.h"
+#include "perfclock.h"
+#include "minmax.h"
+#include "unittest.h"
+
+#include <SDL2/SDL_thread.h>
+#include <SDL2/SDL_timer.h>
+#include <ostream>
+#include <vector>
+
+ForceFeedbackLoop::Filter::Filter() :
+	lowpass(30),
+	slew(50)
+{
+	// ctor
+}
+
+ForceFeedbackLoop::ForceFeedbackLoop(HapticOutput & output, float delay) :
+	output(output),
+	delay(delay),
+	lock(SDL_CreateMutex()),
+	sample_count(0),
+	sample_head(0),
+	sync_time(0),
+	sync_wall(0),
+	thread(0),
+	stopping(false),
+	period(2000),
+	force(0),
+	first_send(0),
+	last_send(0),
+	max_interval(0),
+	sends(0),
+	send_errors(0)
+{
+	// ctor
+}
+
+ForceFeedbackLoop::~ForceFeedbackLoop()
+{
+	Stop();
+	SDL_DestroyMutex(lock);
+}
+
+bool ForceFeedbackLoop::Start(unsigned rate_hz, std::ostream & error_output)
+{
+	Stop();
+
+	period = 1000000 / Clamp(rate_hz, 50u, 1000u);
+	first_send = last_send = max_interval = 0;
+	sends = send_errors = 0;
+
+	stopping.store(false, std::memory_order_relaxed);
+	thread = SDL_CreateThread(LoopThread, "forcefeedback", this);
+	if (!thread)
+	{
+		error_output << "Failed to create force feedback thread: " << SDL_GetError() << std::endl;
+		return false;
+	}
+	return true;
+}
+
+void ForceFeedbackLoop::Stop()
+{
+	if (!thread)
+		return;
+
+	stopping.store(true, std::memory_order_release);
+	SDL_WaitThread(thread, 0);
+	thread = 0;
+
+	// release the wheel
+	output.Send(0);
+	force = 0;
+}
+
+void ForceFeedbackLoop::SetFilter(const Filter & newfilter)
+{
+	SDL_LockMutex(lock);
+	filter = newfilter;
+	SDL_UnlockMutex(lock);
+}
+
+void ForceFeedbackLoop::Publish(double time, float newforce)
+{
+	SDL_LockMutex(lock);
+	// a rewind restarts the timeline
+	if (sample_count > 0 && time < samples[(sample_head + max_samples - 1) % max_samples].time)
+		sample_count = 0;
+	samples[sample_head].time = time;
+	samples[sample_head].force = newforce;
+	sample_head = (sample_head + 1) % max_samples;
+	sample_count = Min(sample_count + 1, max_samples);
+	SDL_UnlockMutex(lock);
+}
+
+void ForceFeedbackLoop::Sync(double time)
+{
+	Sync(time, GetPerfClockTime());
+}
+
+void ForceFeedbackLoop::Sync(double time, unsigned long long now)
+{
+	SDL_LockMutex(lock);
+	sync_time = time;
+	sync_wall = now;
+	SDL_UnlockMutex(lock);
+}
+
+float ForceFeedbackLoop::Interpolate(double time) const
+{
+	if (sample_count == 0)
+		return 0;
+
+	// samples from newest to oldest
+	unsigned i = (sample_head + max_samples - 1) % max_samples;
+	if (time >= samples[i].time)
+		return samples[i].force;
+
+	for (unsigned n = 1; n < sample_count; ++n)
+	{
+		const unsigned j = (i + max_samples - 1) % max_samples;
+		if (time >= samples[j].time)
+		{
+			const double span = samples[i].time - samples[j].time;
+			const float t = span > 0 ? float((time - samples[j].time) / span) : 1;
+			return samples[j].force + (samples[i].force - samples[j].force) * t;
+		}
+		i = j;
+	}
+	return samples[i].force;
+}
+
+float ForceFeedbackLoop::Step(unsigned long long now)
+{
+	SDL_LockMutex(lock);
+	const double time = sync_time + double(now - sync_wall) * 1E-6 - delay;
+	const float target = Interpolate(time);
+	const Filter f = filter;
+	SDL_UnlockMutex(lock);
+
+	const float dt = sends > 0 ? float(now - last_send) * 1E-6f : 0;
+
+	float newforce = target;
+	if (f.lowpass > 0 && sends > 0)
+	{
+		const float rc = 1 / (2 * 3.14159265f * f.lowpass);
+		newforce = force + (target - force) * dt / (dt + rc);
+	}
+	if (f.slew > 0 && sends > 0)
+	{
+		const float max_change = f.slew * dt;
+		newforce = Clamp(newforce, force - max_change, force + max_change);
+	}
+	force = Clamp(newforce, -1.0f, 1.0f);
+
+	if (!output.Send(force))
+		send_errors++;
+
+	if (sends == 0)
+		first_send = now;
+	else
+		max_interval = Max(max_interval, now - last_send);
+	last_send = now;
+	sends++;
+
+	return force;
+}
+
+double ForceFeedbackLoop::GetSendRate() const
+{
+	if (sends < 2 || last_send == first_send)
+		return 0;
+	return (sends - 1) * 1E6 / double(last_send - first_send);
+}
+
+int ForceFeedbackLoop::LoopThread(void * loop)
+{
+	static_cast<ForceFeedbackLoop *>(loop)->Loop();
+	return 0;
+}
+
+void ForceFeedbackLoop::Loop()
+{
+	SDL_SetThreadPriority(SDL_THREAD_PRIORITY_HIGH);
+
+	unsigned long long next_send = GetPerfClockTime();
+	while (!stopping.load(std::memory_order_acquire))
+	{
+		Step(GetPerfClockTime());
+
+		next_send += period;
+		const unsigned long long now = GetPerfClockTime();
+		if (next_send > now)
+			SDL_Delay(Uint32((next_send - now + 999) / 1000));
+		else
+			next_send = now;
+	}
+}
+
+struct HapticOutputStub : HapticOutput
+{
+	std::vector<float> forces;
+	bool fail;
+
+	HapticOutputStub() : fail(false) {}
+
+	bool Send(float force)
+	{
+		forces.push_back(force);
+		return !fail;
+	}
+};
+
+QT_TEST(forcefeedback_loop_test)
+{
+	HapticOutputStub output;
+	ForceFeedbackLoop loop(output, 0.01f);
+
+	ForceFeedbackLoop::Filter filter;
+	filter.lowpass = 0;
+	filter.slew = 0;
+	loop.SetFilter(filter);
+
+	// no samples yet
+	QT_CHECK_EQUAL(loop.Step(900000), 0);
+
+	// ticks at 0 and 10 ms, simulation is at 15 ms after one second
+	loop.Publish(0.00, 0.0f);
+	loop.Publish(0.01, 1.0f);
+	loop.Sync(0.015, 1000000);
+
+	// playback runs one tick late and holds the last sample
+	QT_CHECK_CLOSE(loop.Step(1000000), 0.5f, 1E-4f);
+	QT_CHECK_CLOSE(loop.Step(1002500), 0.75f, 1E-4f);
+	QT_CHECK_CLOSE(loop.Step(1005000), 1.0f, 1E-4f);
+	QT_CHECK_CLOSE(loop.Step(1010000), 1.0f, 1E-4f);
+
+	// slew limit of 10 per second allows 0.1 in 10 ms
+	filter.slew = 10;
+	loop.SetFilter(filter);
+	loop.Publish(0.02, -1.0f);
+	loop.Publish(0.03, -1.0f);
+	loop.Sync(0.03, 1015000);
+	QT_CHECK_CLOSE(loop.Step(1020000), 0.9f, 1E-4f);
+
+	// statistics, a rejected send is counted
+	output.fail = true;
+	loop.Step(1022000);
+	QT_CHECK_EQUAL(loop.GetSends(), 7);
+	QT_CHECK_EQUAL(loop.GetSendErrors(), 1);
+	QT_CHECK_EQUAL(loop.GetMaxInterval(), 100000);
+	QT_CHECK_EQUAL(output.forces.size(), 7);
+
+	// a rewound timeline drops the newer samples
+	loop.Publish(0.0, 0.25f);
+	filter.slew = 0;
+	loop.SetFilter(filter);
+	QT_CHECK_CLOSE(loop.Step(1030000), 0.25f, 1E-4f);
+}
@@ -0,0 +1,147 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef _FORCEFEEDBACK_LOOP_H
+#define _FORCEFEEDBACK_LOOP_H
+
+#include <SDL2/SDL_mutex.h>
+#include <atomic>
+#include <iosfwd>
+
+struct SDL_Thread;
+
+/// Constant force output device.
+class HapticOutput
+{
+public:
+	virtual ~HapticOutput() {}
+
+	/// Send force in [-1, 1], false if the device rejected it.
+	virtual bool Send(float force) = 0;
+};
+
+/// Force feedback thread sending the steering force at a fixed rate,
+/// independent of render frames and physics ticks.
+///
+/// The game publishes the steering feedback of every physics tick with its
+/// simulation time and syncs simulation to wall clock time once per frame.
+/// The thread maps its wall clock back to simulation time, delayed by one
+/// tick so it interpolates between the two samples around it instead of
+/// extrapolating, then runs the force through a one pole low pass and a
+/// slew rate limit before sending it.
+class ForceFeedbackLoop
+{
+public:
+	struct Filter
+	{
+		float lowpass; ///< cutoff frequency in Hz, 0 to disable
+		float slew; ///< max force change per second, 0 to disable
+
+		Filter();
+	};
+
+	/// Output outlives the loop. Samples are played back delay seconds late.
+	ForceFeedbackLoop(HapticOutput & output, float delay);
+
+	~ForceFeedbackLoop();
+
+	/// Start the thread sending rate_hz times per second.
+	bool Start(unsigned rate_hz, std::ostream & error_output);
+
+	void Stop();
+
+	bool Running() const
+	{
+		return thread != 0;
+	}
+
+	void SetFilter(const Filter & filter);
+
+	/// Steering force of the physics tick at simulation time.
+	void Publish(double time, float force);
+
+	/// Simulation time of the current wall clock time, call once per frame.
+	void Sync(double time);
+
+	void Sync(double time, unsigned long long now);
+
+	/// Filter and send the force due at wall clock time now in microseconds.
+	/// Called by the thread, exposed for testing.
+	float Step(unsigned long long now);
+
+	/// Statistics, only stable while the thread is stopped.
+	unsigned GetSends() const
+	{
+		return sends;
+	}
+
+	unsigned GetSendErrors() const
+	{
+		return send_errors;
+	}
+
+	/// Average send rate in Hz.
+	double GetSendRate() const;
+
+	/// Longest interval between two sends in microseconds.
+	unsigned long long GetMaxInterval() const
+	{
+		return max_interval;
+	}
+
+private:
+	struct Sample
+	{
+		double time;
+		float force;
+	};
+
+	static const unsigned max_samples = 16;
+
+	HapticOutput & output;
+	const double delay;
+
+	// shared with the thread
+	SDL_mutex * lock;
+	Sample samples[max_samples];
+	unsigned sample_count;
+	unsigned sample_head; ///< next sample slot
+	double sync_time;
+	unsigned long long sync_wall;
+	Filter filter;
+
+	// thread state
+	SDL_Thread * thread;
+	std::atomic<bool> stopping;
+	unsigned period;
+	float force;
+	unsigned long long first_send;
+	unsigned long long last_send;
+	unsigned long long max_interval;
+	unsigned sends;
+	unsigned send_errors;
+
+	static int LoopThread(void * loop);
+
+	void Loop();
+
+	float Interpolate(double time) const;
+};
+
+#endif // _FORCEFEEDBACK_LOOP_H
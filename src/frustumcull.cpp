@@ -53,3 +53,26 @@ QT_TEST(frustum_cull_test)
 	QT_CHECK(!FrustumCull(frustum.frustum, Vec3(12, 0, 1), Vec3(3, 2, 1)));
 	QT_CHECK(!FrustumCull(frustum.frustum, Vec3(-12, 0, 1), Vec3(3, 2, 1)));
 }
+
+QT_TEST(shadow_caster_cull_test)
+{
+	Mat4 ident;
+	Mat4 ortho;
+	ortho.SetOrthographic(-10, 10, -5, 5, 1, -9);
+
+	Frustum receivers;
+	receivers.Extract(ident.GetArray(), ortho.GetArray());
+
+	// casters inside the view are kept whatever the light direction
+	QT_CHECK(!ShadowCasterCull(receivers.frustum, Vec3(-1, 0, 0), Vec3(2, 1, 1), 1.0f));
+	QT_CHECK(!ShadowCasterCull(receivers.frustum, Vec3(1, 0, 0), Vec3(2, 1, 1), 1.0f));
+
+	// casters outside the view are kept if their shadow is swept into it
+	QT_CHECK(!ShadowCasterCull(receivers.frustum, Vec3(-1, 0, 0), Vec3(12, 0, 1), 1.0f));
+	QT_CHECK(!ShadowCasterCull(receivers.frustum, Vec3(0, 1, 0), Vec3(2, -7, 1), 1.0f));
+
+	// and rejected if it is swept away from or alongside the view
+	QT_CHECK(ShadowCasterCull(receivers.frustum, Vec3(1, 0, 0), Vec3(12, 0, 1), 1.0f));
+	QT_CHECK(ShadowCasterCull(receivers.frustum, Vec3(0, -1, 0), Vec3(2, -7, 1), 1.0f));
+	QT_CHECK(ShadowCasterCull(receivers.frustum, Vec3(0, 1, 0), Vec3(12, 0, 1), 1.0f));
+}
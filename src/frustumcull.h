@@ -106,6 +106,25 @@ static inline bool ContributionCull2(T3 campos, T cull_threshold, T3 center, T r
 }
 
 
+// Cull shadow caster sphere whose shadow can't reach the receiver frustum
+// the sphere is swept along shadow_dir (pointing away from the light), so a plane
+// only rejects it if the sphere is outside and the sweep moves it further away
+
+template <typename T4, typename T3, typename T>
+static inline bool ShadowCasterCull(T4 receivers[6], T3 shadow_dir, T3 center, T radius)
+{
+	for (int i = 0; i < 6; i++)
+	{
+		auto plane = receivers[i];
+		auto distance = plane[0] * center[0] + plane[1] * center[1] + plane[2] * center[2] + plane[3];
+		auto approach = plane[0] * shadow_dir[0] + plane[1] * shadow_dir[1] + plane[2] * shadow_dir[2];
+		if (radius < -distance && approach <= 0)
+			return true;
+	}
+	return false;
+}
+
+
 // Frustum cull functors
 
 template <typename T4>
@@ -166,4 +185,46 @@ static inline FrustumCullerPersp<T4, T3, T> MakeFrustumCullerPersp(T4 (&frustum)
 	return FrustumCullerPersp<T4, T3, T>(frustum, campos, cull_threshold);
 }
 
+// Shadow caster culler
+// frustum is the shadow camera frustum, receivers is the view frustum extended toward the light
+// contribution culling is done relative to the viewer, as that's where the shadow is seen
+
+template <typename T4, typename T3, typename T>
+struct ShadowCasterCuller
+{
+	T4 (&frustum)[6];
+	T4 (&receivers)[6];
+	T3 shadow_dir;
+	T3 campos;
+	T cull_threshold;
+
+	ShadowCasterCuller(T4 (&nfrustum)[6], T4 (&nreceivers)[6], T3 nshadow_dir, T3 ncampos, T ncull_threshold) :
+		frustum(nfrustum),
+		receivers(nreceivers),
+		shadow_dir(nshadow_dir),
+		campos(ncampos),
+		cull_threshold(ncull_threshold)
+	{}
+
+	inline bool operator()(const T3 & center, T radius) const
+	{
+		return FrustumCull(frustum, center, radius) ||
+			ShadowCasterCull(receivers, shadow_dir, center, radius) ||
+			ContributionCull(campos, cull_threshold, center, radius);
+	}
+
+	inline bool operator()(const T3 & center, const T3 & extent, T radius) const
+	{
+		return FrustumCull(frustum, center, extent) ||
+			ShadowCasterCull(receivers, shadow_dir, center, radius) ||
+			ContributionCull(campos, cull_threshold, center, radius);
+	}
+};
+
+template <typename T4, typename T3, typename T>
+static inline ShadowCasterCuller<T4, T3, T> MakeShadowCasterCuller(T4 (&frustum)[6], T4 (&receivers)[6], T3 shadow_dir, T3 campos, T cull_threshold)
+{
+	return ShadowCasterCuller<T4, T3, T>(frustum, receivers, shadow_dir, campos, cull_threshold);
+}
+
 #endif
@@ -25,10 +25,14 @@
 #include "physics/tracksurface.h"
 #include "numprocessors.h"
 #include "performance_testing.h"
+#include "perfclock.h"
+#include "race_server.h"
+#include "setup_sweep.h"
 #include "quickprof.h"
 #include "utils.h"
 #include "graphics/graphics_gl2.h"
 #include "graphics/graphics_gl3v.h"
+#include "graphics/texturestreamer.h"
 #include "cfg/ptree.h"
 #include "svn_sourceforge.h"
 #include "game_downloader.h"
@@ -71,6 +75,9 @@ static T cast(const std::string &str) {
 	return t;
 }
 
+/// Rewind frame capture interval in seconds.
+static const float rewind_interval = 0.5f;
+
 static std::string GetTimeString(float time)
 {
 	if (time != 0)
@@ -129,8 +136,10 @@ Game::Game(std::ostream & info_out, std::ostream & error_out) :
 	particle_timer(0),
 	track(),
 	replay(timestep),
-	http("/tmp"),
-	ff_update_time(0)
+	telemetry_tick_channel(-1),
+	input_rate(0),
+	input_probe_rate(0),
+	http("/tmp")
 {
 	dynamics.setContactAddedCallback(&CarDynamics::WheelContactCallback);
 	RegisterActions();
@@ -226,7 +235,9 @@ void Game::Start(std::list <std::string> & args)
 
 	// Initialize force feedback.
 	forcefeedback.reset(new ForceFeedback(settings.GetFFDevice(), error_output, info_output));
-	ff_update_time = 0;
+	forcefeedback_loop.reset(new ForceFeedbackLoop(*forcefeedback, timestep));
+	if (forcefeedback->Available() && forcefeedback_loop->Start(settings.GetFFRate(), error_output))
+		info_output << "Force feedback rate: " << settings.GetFFRate() << " Hz" << std::endl;
 
 	if (benchmode)
 	{
@@ -265,6 +276,22 @@ void Game::End()
 	if (profilingmode)
 		info_output << "Profiling summary:\n" << PROFILER.getSummary(quickprof::PERCENT) << std::endl;
 
+	input_sampler.Stop();
+	if (forcefeedback_loop && forcefeedback_loop->Running())
+	{
+		forcefeedback_loop->Stop();
+		info_output << "Force feedback: " << forcefeedback_loop->GetSends() << " sends at "
+			<< forcefeedback_loop->GetSendRate() << " Hz, max interval "
+			<< forcefeedback_loop->GetMaxInterval() << " us, "
+			<< forcefeedback_loop->GetSendErrors() << " errors" << std::endl;
+	}
+	if (input_sampler.GetProbeCount() > 0)
+	{
+		info_output << "Input to physics latency: " << input_sampler.GetProbeCount() << " probes, "
+			<< input_sampler.GetAverageLatency() << " us average, "
+			<< input_sampler.GetMaxLatency() << " us max" << std::endl;
+	}
+
 	info_output << "Shutting down..." << std::endl;
 
 	LeaveGame();
@@ -272,6 +299,9 @@ void Game::End()
 	// Save settings first incase later deinits cause crashes.
 	settings.Save(pathmanager.GetSettingsFile(), error_output);
 
+	frame_pipeline.Deinit();
+	graphics->SetTextureStreamer(NULL);
+	content.getFactory<Texture>().getStreamer().Deinit();
 	graphics->Deinit();
 	delete graphics;
 }
@@ -357,6 +387,7 @@ bool Game::InitCoreSubsystems()
 
 		bool success = graphics->Init(
 			pathmanager.GetShaderPath() + "/" + render_ver,
+			pathmanager.GetShaderCachePath(),
 			settings.GetResolutionX(), settings.GetResolutionY(),
 			settings.GetAntialiasing(), settings.GetShadows(),
 			settings.GetShadowDistance(), settings.GetShadowQuality(),
@@ -386,6 +417,13 @@ bool Game::InitCoreSubsystems()
 		return false;
 	}
 
+	if (settings.GetFramesInFlight() > 0)
+	{
+		frame_pipeline.Init(settings.GetFramesInFlight());
+		if (!frame_pipeline.Enabled())
+			info_output << "GL sync objects not supported, frame pipelining disabled." << std::endl;
+	}
+
 	Vec3 ldir(-0.250, -0.588, 0.769);
 	ldir = ldir.Normalize();
 	graphics->SetSunDirection(ldir);
@@ -396,15 +434,40 @@ bool Game::InitCoreSubsystems()
 	content.getFactory<Texture>().init(texture_size, using_gl3, settings.GetTextureCompress());
 	content.getFactory<PTree>().init(read_ini, write_ini, content);
 
+	// Textures beyond the budget keep their mip levels up to 256 texels resident,
+	// finer levels are streamed in for the visible ones.
+	if (settings.GetTextureBudget() > 0)
+	{
+		TextureStreamer & streamer = content.getFactory<Texture>().getStreamer();
+		if (streamer.Init((unsigned long)settings.GetTextureBudget() << 20, 256, error_output))
+			graphics->SetTextureStreamer(&streamer);
+	}
+
 	// Init content paths
 	// Always add writeable data paths first so they are checked first
+	// Cooked assets (see vdrift-cook) shadow the read only data they were made from
 	content.addPath(pathmanager.GetWriteableDataPath());
+	content.addPath(pathmanager.GetCookedDataPath());
 	content.addPath(pathmanager.GetDataPath());
+	content.addSharedPath(pathmanager.GetCookedDataPath() + "/carparts");
 	content.addSharedPath(pathmanager.GetCarPartsPath());
+	content.addSharedPath(pathmanager.GetCookedDataPath() + "/trackparts");
 	content.addSharedPath(pathmanager.GetTrackPartsPath());
 
+	// Cooked files are only used while their source is unchanged,
+	// compressed textures only if texture compression is enabled
+	cooked_manifest.Load(pathmanager.GetCookedDataPath() + "/" + CookedManifest::filename);
+	cooked_manifest.SetAllowCompressed(settings.GetTextureCompress());
+	content.setCookedPath(pathmanager.GetCookedDataPath(), pathmanager.GetDataPath(), &cooked_manifest);
+
 	eventsystem.Init(info_output);
 
+	if (input_rate > 0 && input_sampler.Start(input_rate, input_probe_rate, error_output))
+	{
+		eventsystem.SetProbeType(input_sampler.GetProbeType());
+		info_output << "Sampling input at " << input_rate << " Hz" << std::endl;
+	}
+
 	return true;
 }
 
@@ -507,6 +570,184 @@ bool Game::InitSound()
 	return true;
 }
 
+static void PopulateCarSet(
+	std::set<std::pair<std::string, std::string> > & set,
+	const std::string & path,
+	const PathManager & pathmanager,
+	const bool cardironly);
+
+// match name against a pattern with * and ? wildcards
+static bool WildcardMatch(const char * pattern, const char * name)
+{
+	if (*pattern == '*')
+		return WildcardMatch(pattern + 1, name) || (*name && WildcardMatch(pattern, name + 1));
+	if (*name && (*pattern == '?' || *pattern == *name))
+		return WildcardMatch(pattern + 1, name + 1);
+	return !*pattern && !*name;
+}
+
+// expand a comma separated list of car names or wildcard patterns
+static void GetCarTestList(
+	const std::string & carpattern,
+	const PathManager & pathmanager,
+	std::vector<std::string> & cardirs,
+	std::vector<std::string> & carnames)
+{
+	std::set<std::pair<std::string, std::string> > carset;
+	PopulateCarSet(carset, pathmanager.GetReadOnlyCarsPath(), pathmanager, true);
+	PopulateCarSet(carset, pathmanager.GetWriteableCarsPath(), pathmanager, true);
+
+	std::set<std::string> added;
+	for (const auto & pattern : Tokenize(carpattern, ","))
+	{
+		if (pattern.find_first_of("*?") == std::string::npos)
+		{
+			if (added.insert(pattern).second)
+				carnames.push_back(pattern);
+			continue;
+		}
+
+		for (const auto & car : carset)
+		{
+			if (WildcardMatch(pattern.c_str(), car.first.c_str()) && added.insert(car.first).second)
+				carnames.push_back(car.first);
+		}
+	}
+
+	for (const auto & carname : carnames)
+	{
+		cardirs.push_back(pathmanager.GetCarsDir() + "/" + carname);
+	}
+}
+
+// variant config keys are flattened to dotted paths like "engine.peak-engine-rpm"
+static void GetSweepParams(
+	const PTree & cfg,
+	const std::string & prefix,
+	std::vector<std::pair<std::string, std::string> > & params)
+{
+	for (const auto & child : cfg)
+	{
+		const std::string key = prefix.empty() ? child.first : prefix + "." + child.first;
+		if (child.second.size())
+			GetSweepParams(child.second, key, params);
+		else
+			params.push_back(std::make_pair(key, child.second.value()));
+	}
+}
+
+bool Game::CarTestSweep(
+	const std::string & carname,
+	const std::string & trackname,
+	const std::string & variantfile,
+	float duration,
+	unsigned threads,
+	const std::string & outfile)
+{
+	// every section of the variant file is a setup variant, the unmodified car runs first
+	std::vector<SetupSweep::Variant> variants(1);
+	variants[0].name = "base";
+	if (!variantfile.empty())
+	{
+		std::ifstream in(variantfile.c_str());
+		if (!in)
+		{
+			error_output << "Failed to open " << variantfile << std::endl;
+			return false;
+		}
+		PTree variantcfg;
+		read_ini(in, variantcfg);
+		for (const auto & section : variantcfg)
+		{
+			SetupSweep::Variant variant;
+			variant.name = section.first;
+			GetSweepParams(section.second, "", variant.params);
+			variants.push_back(variant);
+		}
+	}
+
+	if (!track.DeferredLoad(
+		content, dynamics,
+		info_output, error_output,
+		pathmanager.GetTracksPath(trackname),
+		pathmanager.GetTracksDir() + "/" + trackname,
+		pathmanager.GetEffectsTextureDir(),
+		pathmanager.GetTrackPartsPath(),
+		0, false, true, false))
+	{
+		error_output << "Error loading track: " << trackname << std::endl;
+		return false;
+	}
+	while (!track.Loaded())
+	{
+		if (!track.ContinueDeferredLoad())
+		{
+			error_output << "Error loading track: " << trackname << std::endl;
+			return false;
+		}
+	}
+
+	const std::string cardir = pathmanager.GetCarsDir() + "/" + carname;
+	std::shared_ptr<PTree> carcfg;
+	content.load(carcfg, cardir, carname + ".car");
+	if (!carcfg->size())
+	{
+		error_output << "Failed to load " << carname << std::endl;
+		return false;
+	}
+
+	const std::pair<Vec3, Quat> start = track.GetStart(0);
+	CarDynamics car;
+	if (!car.Load(
+		*carcfg, cardir, "",
+		ToBulletVector(start.first),
+		ToBulletQuaternion(start.second),
+		false, dynamics, content, error_output))
+	{
+		error_output << "Failed to load " << carname << std::endl;
+		return false;
+	}
+	car.AlignWithGround();
+
+	SetupSweep sweep(track, content, timestep);
+	if (!sweep.Init(carcfg, cardir, "", car, error_output))
+		return false;
+
+	std::vector<SetupSweep::Result> results;
+	sweep.Run(variants, duration, threads, results, Ai::default_type);
+
+	std::ofstream out;
+	if (!outfile.empty())
+	{
+		out.open(outfile.c_str());
+		if (!out.is_open())
+			error_output << "Failed to open " << outfile << std::endl;
+		else
+			out << "variant,valid,distance,sectors,last_split,sim_time,wall_time" << std::endl;
+	}
+
+	for (const auto & result : results)
+	{
+		const float last_split = result.splits.empty() ? 0 : result.splits.back().time;
+		if (!result.valid)
+			error_output << result.name << ": " << result.error << std::endl;
+		else
+			info_output << result.name << ": " << result.distance << " m, "
+				<< result.splits.size() << " sectors, last at " << last_split << " s, "
+				<< result.wall_time << " s wall time" << std::endl;
+
+		if (out.is_open())
+		{
+			out << result.name << "," << result.valid << "," << result.distance << ","
+				<< result.splits.size() << "," << last_split << ","
+				<< result.sim_time << "," << result.wall_time << std::endl;
+		}
+	}
+
+	track.Clear();
+	return true;
+}
+
 bool Game::ParseArguments(std::list <std::string> & args)
 {
 	bool continue_game(true);
@@ -539,6 +780,14 @@ bool Game::ParseArguments(std::list <std::string> & args)
 	}
 	arghelp["-test"] = "Run unit tests.";
 
+	if (argmap.find("-testbench") != argmap.end())
+	{
+		QT_SET_OUTPUT(&info_output);
+		QT_RUN_BENCHMARKS;
+		continue_game = false;
+	}
+	arghelp["-testbench"] = "Run micro benchmarks.";
+
 	if (!argmap["-cartest"].empty())
 	{
 		pathmanager.Init(info_output, error_output);
@@ -548,14 +797,140 @@ bool Game::ParseArguments(std::list <std::string> & args)
 		content.addSharedPath(pathmanager.GetCarPartsPath());
 		content.addSharedPath(pathmanager.GetTrackPartsPath());
 
-		const std::string carname = argmap["-cartest"];
-		const std::string cardir = pathmanager.GetCarsDir() + "/" + carname;
+		const std::string carpattern = argmap["-cartest"];
+		const std::string outfile = argmap["-cartest-out"];
+		if (!argmap["-cartest-sweep"].empty())
+		{
+			content.getFactory<Texture>().initHeadless();
+
+			unsigned threads = NUMPROCESSORS::GetNumProcessors();
+			if (!argmap["-cartest-threads"].empty())
+				threads = cast<unsigned>(argmap["-cartest-threads"]);
+
+			const float duration = argmap["-cartest-time"].empty() ? 60 : cast<float>(argmap["-cartest-time"]);
+			CarTestSweep(
+				carpattern, argmap["-cartest-sweep"], argmap["-cartest-variants"],
+				duration, threads, outfile);
+		}
+		else if (carpattern.find_first_of(",*?") == std::string::npos && outfile.empty())
+		{
+			const std::string carname = carpattern;
+			const std::string cardir = pathmanager.GetCarsDir() + "/" + carname;
+
+			PerformanceTesting perftest(dynamics);
+			perftest.Test(cardir, carname, content, info_output, error_output);
+		}
+		else
+		{
+			std::vector<std::string> cardirs, carnames;
+			GetCarTestList(carpattern, pathmanager, cardirs, carnames);
+
+			unsigned threads = NUMPROCESSORS::GetNumProcessors();
+			if (!argmap["-cartest-threads"].empty())
+				threads = cast<unsigned>(argmap["-cartest-threads"]);
+
+			std::vector<PerformanceTesting::Result> results;
+			PerformanceTesting::TestBatch(
+				cardirs, carnames, content, timestep, threads,
+				info_output, error_output, results);
+
+			if (!outfile.empty())
+			{
+				std::ofstream out(outfile.c_str());
+				if (!out)
+					error_output << "Failed to open " << outfile << std::endl;
+				else if (outfile.size() > 5 && outfile.substr(outfile.size() - 5) == ".json")
+					PerformanceTesting::WriteJSON(results, out);
+				else
+					PerformanceTesting::WriteCSV(results, out);
+			}
+		}
+		continue_game = false;
+	}
+	arghelp["-cartest CAR"] = "Run car performance testing on given CAR. "
+		"Accepts a comma separated list or a wildcard pattern like \"XS*\" to test cars in parallel.";
+	arghelp["-cartest-out FILE"] = "Write car performance test results to FILE, as JSON if it ends in .json, else CSV.";
+	arghelp["-cartest-threads N"] = "Number of threads used to test multiple cars, defaults to the processor count.";
+	arghelp["-cartest-sweep TRACK"] = "Drive setup variants of the -cartest CAR with the ai on TRACK instead of the performance tests.";
+	arghelp["-cartest-variants FILE"] = "Setup variants of the sweep, one ini section of car config overrides per variant.";
+	arghelp["-cartest-time SECONDS"] = "Simulated time per setup variant, defaults to 60.";
+
+	if (!argmap["-server"].empty())
+	{
+		pathmanager.Init(info_output, error_output);
+		content.getFactory<Texture>().initHeadless();
+		content.getFactory<PTree>().init(read_ini, write_ini, content);
+		content.addPath(pathmanager.GetWriteableDataPath());
+		content.addPath(pathmanager.GetDataPath());
+		content.addSharedPath(pathmanager.GetCarPartsPath());
+		content.addSharedPath(pathmanager.GetTrackPartsPath());
+
+		const std::string trackname = argmap["-server"];
+		const std::string carpattern = argmap["-server-cars"].empty() ? "XS" : argmap["-server-cars"];
+		const unsigned race_count = argmap["-server-races"].empty() ? 1 : cast<unsigned>(argmap["-server-races"]);
+		const unsigned laps = argmap["-server-laps"].empty() ? 1 : cast<unsigned>(argmap["-server-laps"]);
+		const float duration = argmap["-server-time"].empty() ? 600 : cast<float>(argmap["-server-time"]);
+
+		unsigned threads = NUMPROCESSORS::GetNumProcessors();
+		if (!argmap["-server-threads"].empty())
+			threads = cast<unsigned>(argmap["-server-threads"]);
+
+		RaceServer server(content, timestep);
+		if (server.LoadTrack(
+			pathmanager.GetTracksPath(trackname),
+			pathmanager.GetTracksDir() + "/" + trackname,
+			pathmanager.GetEffectsTextureDir(),
+			pathmanager.GetTrackPartsPath(),
+			false, info_output, error_output))
+		{
+			// rotate the grid between races, identical races would give identical results
+			std::vector<std::string> cardirs, carnames;
+			GetCarTestList(carpattern, pathmanager, cardirs, carnames);
+			std::vector<RaceServer::Race> races(race_count);
+			for (unsigned r = 0; r < race_count; ++r)
+			{
+				for (unsigned i = 0; i < carnames.size(); ++i)
+				{
+					const unsigned n = (i + r) % carnames.size();
+					races[r].cardirs.push_back(cardirs[n]);
+					races[r].carnames.push_back(carnames[n]);
+				}
+			}
+
+			quickprof::Clock timer;
+			std::vector<RaceServer::Result> results;
+			server.Run(races, laps, duration, threads, results);
+			float wall_time = timer.getTimeMicroseconds() * 1E-6f;
 
-		PerformanceTesting perftest(dynamics);
-		perftest.Test(cardir, carname, content, info_output, error_output);
+			float sim_time = 0;
+			for (unsigned r = 0; r < results.size(); ++r)
+			{
+				if (!results[r].valid)
+					error_output << "Race " << r << ": " << results[r].error << std::endl;
+				sim_time += results[r].sim_time;
+			}
+			info_output << "Ran " << race_count << " races on " << trackname << ": "
+				<< sim_time << " s simulated, " << wall_time << " s wall time" << std::endl;
+
+			const std::string outfile = argmap["-server-out"];
+			if (!outfile.empty())
+			{
+				std::ofstream out(outfile.c_str());
+				if (!out)
+					error_output << "Failed to open " << outfile << std::endl;
+				else
+					RaceServer::WriteCSV(results, out);
+			}
+		}
 		continue_game = false;
 	}
-	arghelp["-cartest CAR"] = "Run car performance testing on given CAR.";
+	arghelp["-server TRACK"] = "Run headless ai races on TRACK in one process, without a window or sound.";
+	arghelp["-server-cars CARS"] = "Cars of each server race, a comma separated list or wildcard pattern.";
+	arghelp["-server-races N"] = "Number of independent server races, the grid is rotated between races.";
+	arghelp["-server-laps N"] = "Laps per server race, 0 to run for the time limit.";
+	arghelp["-server-time SECONDS"] = "Simulated time limit of a server race.";
+	arghelp["-server-threads N"] = "Number of threads running server races, defaults to the processor count.";
+	arghelp["-server-out FILE"] = "Write server race results to FILE as CSV.";
 
 	if (!argmap["-profile"].empty())
 	{
@@ -563,6 +938,42 @@ bool Game::ParseArguments(std::list <std::string> & args)
 	}
 	arghelp["-profile NAME"] = "Store settings, controls, and records under a separate profile.";
 
+	if (!argmap["-telemetry-csv"].empty())
+	{
+		const std::string infile = argmap["-telemetry-csv"];
+		const std::string outfile = infile + ".csv";
+		std::ifstream in(infile.c_str(), std::ios::binary);
+		std::ofstream out(outfile.c_str());
+		if (!in)
+			error_output << "Failed to open " << infile << std::endl;
+		else if (!out)
+			error_output << "Failed to open " << outfile << std::endl;
+		else if (TelemetryRecorder::ConvertToCsv(in, out, error_output))
+			info_output << "Wrote " << outfile << std::endl;
+		continue_game = false;
+	}
+	arghelp["-telemetry-csv FILE"] = "Convert the telemetry recording FILE to FILE.csv.";
+
+	if (!argmap["-telemetry"].empty())
+	{
+		telemetry_file = argmap["-telemetry"];
+	}
+	arghelp["-telemetry FILE"] = "Record per tick car telemetry of each race to FILE.";
+
+	if (!argmap["-input-rate"].empty())
+	{
+		input_rate = cast<unsigned>(argmap["-input-rate"]);
+	}
+	arghelp["-input-rate HZ"] = "Sample joysticks HZ times per second on a separate thread.";
+
+	if (!argmap["-input-latency"].empty())
+	{
+		input_probe_rate = cast<unsigned>(argmap["-input-latency"]);
+		if (input_rate == 0)
+			input_rate = 1000;
+	}
+	arghelp["-input-latency HZ"] = "Inject HZ synthetic input events per second and report the input to physics latency.";
+
 	if (argmap.find("-profiling") != argmap.end() || argmap.find("-benchmark") != argmap.end())
 	{
 		PROFILER.init(20);
@@ -757,14 +1168,26 @@ void Game::Draw(float dt)
 	graphics->UpdateScene(dt);
 	PROFILER.endBlock("render setup");
 
+	// Keep at most frames_in_flight frames queued on the GPU.
+	PROFILER.beginBlock("render wait");
+	frame_pipeline.Wait();
+	PROFILER.endBlock("render wait");
+
 	// Sync CPU and GPU (flip the page).
 	PROFILER.beginBlock("render sync");
 	window.SwapBuffers();
 	PROFILER.endBlock("render sync");
 
 	PROFILER.beginBlock("render draw");
+	frame_pipeline.BeginFrame();
 	graphics->DrawScene(error_output);
+	frame_pipeline.EndFrame();
 	PROFILER.endBlock("render draw");
+
+	// Stream texture levels for the next frame.
+	PROFILER.beginBlock("render stream");
+	content.getFactory<Texture>().getStreamer().Update(error_output);
+	PROFILER.endBlock("render stream");
 }
 
 void Game::Run()
@@ -820,6 +1243,9 @@ void Game::Tick(float deltat)
 		curticks++;
 	}
 
+	// Map the force feedback thread clock to simulation time.
+	forcefeedback_loop->Sync(target_time);
+
 	// Debug draw dynamics
 	if (dynamics_drawmode && track.Loaded())
 	{
@@ -842,7 +1268,9 @@ void Game::AdvanceGameLogic()
 {
 	//PROFILER.beginBlock("input-processing");
 
-	eventsystem.ProcessEvents();
+	// Events are due at the wall clock time of this tick.
+	const double tick_lag = target_time - timestep * frame;
+	eventsystem.ProcessEvents(eventsystem.GetFrameTicks() - Uint32(tick_lag * 1000));
 
 	float car_speed = !pause ? car_dynamics[player_car_id].GetSpeed() : 0;
 	car_controls_local.ProcessInput(
@@ -874,10 +1302,20 @@ void Game::AdvanceGameLogic()
 		ProcessCarInputs();
 		//PROFILER.endBlock("input");
 
+		const unsigned long long tick_start = telemetry_clock.getTimeMicroseconds();
+
 		PROFILER.beginBlock("physics");
+		const unsigned long long physics_start = telemetry_clock.getTimeMicroseconds();
+		UpdateCarPhysicsLod();
 		dynamics.update(timestep);
+		const unsigned long long physics_end = telemetry_clock.getTimeMicroseconds();
 		PROFILER.endBlock("physics");
 
+		for (const auto & probe : eventsystem.GetProbes())
+			input_sampler.RecordProbe(probe, GetPerfClockTime());
+
+		track_progress.Update(&car_dynamics[0], car_dynamics.size());
+
 		PROFILER.beginBlock("car");
 		ProcessCameraInputs();
 		UpdateCars(timestep);
@@ -890,6 +1328,10 @@ void Game::AdvanceGameLogic()
 		UpdateTimer();
 		//PROFILER.endBlock("timer");
 
+		PROFILER.beginBlock("rewind");
+		UpdateRewind();
+		PROFILER.endBlock("rewind");
+
 		//PROFILER.beginBlock("particles");
 		UpdateParticles(timestep);
 		//PROFILER.endBlock("particles");
@@ -897,6 +1339,14 @@ void Game::AdvanceGameLogic()
 		//PROFILER.beginBlock("trackmap-update");
 		UpdateTrackMap();
 		//PROFILER.endBlock("trackmap-update");
+
+		if (telemetry.Recording())
+		{
+			const unsigned long long tick_end = telemetry_clock.getTimeMicroseconds();
+			telemetry.Set(telemetry_tick_channel, tick_end - tick_start);
+			telemetry.Set(telemetry_tick_channel + 1, physics_end - physics_start);
+			telemetry.Commit(frame);
+		}
 	}
 
 	if (sound.Enabled())
@@ -916,7 +1366,7 @@ void Game::AdvanceGameLogic()
 	}
 
 	//PROFILER.beginBlock("force-feedback");
-	UpdateForceFeedback(timestep);
+	UpdateForceFeedback();
 	//PROFILER.endBlock("force-feedback");
 }
 
@@ -950,6 +1400,11 @@ void Game::ProcessGameInputs()
 			error_output << "Couldn't find a file to which to save the captured screenshot" << std::endl;
 	}
 
+	if (car_controls_local.GetInput(GameInput::REPLAY_RW) == 1 && !pause)
+	{
+		RewindGame();
+	}
+
 	if (car_controls_local.GetInput(GameInput::RELOAD_SHADERS) == 1)
 	{
 		info_output << "Reloading shaders" << std::endl;
@@ -981,71 +1436,114 @@ void Game::UpdateTimer()
 	// Check for cars doing a lap.
 	for (int i = 0; i < car_dynamics.size(); ++i)
 	{
-		const CarDynamics & car = car_dynamics[i];
-		bool advance = false;
-		int nextsector = 0;
 		if (track.GetSectors() > 0)
 		{
-			nextsector = (timer.GetLastSector(i) + 1) % track.GetSectors();
-			for (int p = 0; p < 4; ++p)
+			int nextsector = (timer.GetLastSector(i) + 1) % track.GetSectors();
+			if (track_progress.OnSectorStart(i, nextsector))
 			{
-				const RoadPatch * patch = car.GetWheelContact(WheelPosition(p)).GetPatch();
-				if (patch == track.GetSectorPatch(nextsector))
-				{
-					advance = true;
-				}
+				timer.Lap(i, nextsector);
+				standings.CrossSector(i);
 			}
 		}
 
-		if (advance)
-			timer.Lap(i, nextsector);
+		// Only update if car is on track.
+		if (track_progress.GetPatch(i))
+			timer.UpdateDistance(i, track_progress.GetDistance(i));
 
-		// Update how far the car is on the track...
-		// Find the patch under the front left wheel...
-		const RoadPatch * curpatch = car.GetWheelContact(FRONT_LEFT).GetPatch();
-		if (!curpatch)
-			curpatch = car.GetWheelContact(FRONT_RIGHT).GetPatch();
+		standings.SetDistance(i, track_progress.GetDistance(i));
+	}
+	standings.Update();
 
-		// Only update if car is on track.
-		if (curpatch)
-		{
-			Vec3 pos = ToMathVector<float>(car.GetCenterOfMass());
-			Vec3 back_left, back_right, front_left;
-			if (!track.IsReversed())
-			{
-				back_left = curpatch->GetBL();
-				back_right = curpatch->GetBR();
-				front_left = curpatch->GetFL();
-			}
-			else
-			{
-				back_left = curpatch->GetFL();
-				back_right = curpatch->GetFR();
-				front_left = curpatch->GetBL();
-			}
+	timer.Tick(timestep);
+	if (!timer.Staging())
+		standings.Tick(timestep);
+	//timer.DebugPrint(info_output);
+}
 
-			Vec3 forwardvec = front_left - back_left;
-			Vec3 relative_pos = pos - back_left;
-			float dist_from_back = 0;
+static bool SerializeCarState(SnapshotWriter & s, CarDynamics & car)
+{
+	return car.SaveState(s);
+}
 
-			if (forwardvec.MagnitudeSquared() > 1E-8f)
-				dist_from_back = relative_pos.dot(forwardvec.Normalize());
+static bool SerializeCarState(SnapshotReader & s, CarDynamics & car)
+{
+	return car.LoadState(s);
+}
 
-			timer.UpdateDistance(i, curpatch->GetDistFromStart() + dist_from_back);
-			//std::cout << curpatch->GetDistFromStart() << ", " << dist_from_back << std::endl;
-			//std::cout << curpatch->GetDistFromStart() + dist_from_back << std::endl;
-		}
+template <class Serializer>
+bool Game::SerializeState(Serializer & s)
+{
+	for (int i = 0; i < car_dynamics.size(); ++i)
+	{
+		if (!SerializeCarState(s, car_dynamics[i])) return false;
+	}
+	_SERIALIZE_(s, ai);
+	_SERIALIZE_(s, timer);
+	_SERIALIZE_(s, standings);
+	_SERIALIZE_(s, track);
+	return true;
+}
+
+void Game::InitRewind()
+{
+	rewind.Clear();
 
-		/*info_output << "sector=" << i->GetSector() << ", next=" << track.GetSectorPatch(nextsector) << ", ";
-		for (int w = 0; w < 4; w++)
+	// Rewinding would invalidate recorded replay frames.
+	if (settings.GetRewindTime() <= 0 || replay.GetPlaying() || replay.GetRecording())
+		return;
+
+	// Measure state frame size with a trial capture.
+	const unsigned max_frame_size = 1 << 24;
+	std::vector<unsigned char> buffer(1 << 16);
+	SnapshotWriter writer(&buffer[0], buffer.size());
+	while (!SerializeState(writer))
+	{
+		if (buffer.size() >= max_frame_size)
 		{
-			info_output << w << "=" << i->GetCurPatch(WHEEL_POSITION(w)) << ", ";
+			error_output << "Race state too large for rewind buffer" << std::endl;
+			return;
 		}
-		info_output << std::endl;*/
+		buffer.resize(buffer.size() * 2);
+		writer = SnapshotWriter(&buffer[0], buffer.size());
 	}
 
-	timer.Tick(timestep);
-	//timer.DebugPrint(info_output);
+	const unsigned interval_ticks = Max(1u, unsigned(rewind_interval / timestep));
+	const unsigned frames = unsigned(settings.GetRewindTime() / rewind_interval) + 1;
+	rewind.Init(frames, writer.GetSize(), interval_ticks);
+
+	info_output << "Rewind buffer: " << frames << " frames, "
+		<< rewind.GetMemory() / 1024 << " KB" << std::endl;
+}
+
+void Game::UpdateRewind()
+{
+	if (!rewind.Tick())
+		return;
+
+	SnapshotWriter writer = rewind.BeginCapture();
+	rewind.EndCapture(writer, SerializeState(writer));
+}
+
+void Game::RewindGame()
+{
+	if (!rewind.Enabled())
+		return;
+
+	// Skip frames captured less than half an interval ago,
+	// so that repeated rewinds step back through the frames.
+	const unsigned min_age = 0.5f * rewind_interval / timestep;
+	SnapshotReader reader(0, 0);
+	if (!rewind.Restore(min_age, reader))
+		return;
+
+	// Check the frame layout before applying it to the race state.
+	SnapshotWriter measure(0, ~0u);
+	if (!SerializeState(measure) || !reader.Matches(measure) ||
+		!SerializeState(reader) || !reader.Valid())
+	{
+		error_output << "Rewind frame doesn't match race state" << std::endl;
+		rewind.Reset();
+	}
 }
 
 void Game::UpdateTrackMap()
@@ -1286,6 +1784,9 @@ void Game::UpdateCars(float dt)
 		AddTireSmokeParticles(car_dynamics[i], dt);
 
 		UpdateDriftScore(i, dt);
+
+		if (telemetry.Recording())
+			RecordCarTelemetry(i);
 	}
 }
 
@@ -1327,7 +1828,18 @@ void Game::ProcessCarInputs()
 		else if (carid == player_car_id && player_control)
 			carinputs = car_controls_local.GetInputs();
 		else
+		{
+			if (telemetry.Recording())
+			{
+				const AiCar::Decision & decision = ai.GetDecision(aiid);
+				const int channel = telemetry_ai_channel[carid];
+				telemetry.Set(channel, decision.target_speed);
+				telemetry.Set(channel + 1, decision.brake_lookahead);
+				telemetry.Set(channel + 2, decision.heading_error);
+				telemetry.Set(channel + 3, decision.braking_ahead);
+			}
 			carinputs = ai.GetInputs(aiid++);
+		}
 
 		assert(carinputs.size() >= CarInput::INVALID);
 
@@ -1350,6 +1862,14 @@ void Game::ProcessCarInputs()
 		car.Update(carinputs);
 		car_gfx.Update(carinputs);
 
+		if (telemetry.Recording())
+		{
+			const int channel = telemetry_car_channel[carid];
+			telemetry.Set(channel, carinputs[CarInput::THROTTLE]);
+			telemetry.Set(channel + 1, carinputs[CarInput::BRAKE]);
+			telemetry.Set(channel + 2, carinputs[CarInput::STEER_RIGHT] - carinputs[CarInput::STEER_LEFT]);
+		}
+
 		// Record car state.
 		if (replay.GetRecording())
 			replay.RecordFrame(carid, carinputs, car);
@@ -1359,6 +1879,48 @@ void Game::ProcessCarInputs()
 	}
 }
 
+void Game::UpdateCarPhysicsLod()
+{
+	// Proxy cars ignore inputs, keep replays in full physics.
+	const float lod_distance = settings.GetPhysicsLodDistance();
+	const bool enabled = lod_distance > 0 && !timer.Staging() &&
+		!replay.GetPlaying() && !replay.GetRecording();
+
+	// Cars need to be this far from the player or camera car and from
+	// every other car to become a proxy. They return to full physics
+	// within 80% of the distance, so that they don't toggle at the edge.
+	const float car_distance = 50;
+	const float hysteresis = 0.8f;
+
+	const int car_count = car_dynamics.size();
+	for (int i = 0; i < car_count; ++i)
+	{
+		CarDynamics & car = car_dynamics[i];
+		bool proxy = enabled && i != int(player_car_id) && i != int(camera_car_id);
+		if (proxy)
+		{
+			const float scale = car.IsProxy() ? hysteresis : 1.0f;
+			const float player_dist2 = lod_distance * lod_distance * scale * scale;
+			const float car_dist2 = car_distance * car_distance * scale * scale;
+			const btVector3 & pos = car.GetCenterOfMass();
+			for (int j = 0; j < car_count && proxy; ++j)
+			{
+				if (j == i)
+					continue;
+
+				const btScalar dist2 = (car_dynamics[j].GetCenterOfMass() - pos).length2();
+				const bool player = (j == int(player_car_id) || j == int(camera_car_id));
+				proxy = dist2 > (player ? player_dist2 : car_dist2);
+			}
+		}
+
+		if (proxy && !car.IsProxy())
+			car.EnterProxy();
+		else if (!proxy && car.IsProxy())
+			car.LeaveProxy();
+	}
+}
+
 void Game::ProcessCameraInputs()
 {
 	CarControlMap & carcontrol = car_controls_local;
@@ -1462,7 +2024,9 @@ void Game::UpdateHUD(const size_t carid, const std::vector<float> & carinputs)
 		else if (frame % 10 == 0)
 		{
 			std::ostringstream gpu_profile;
+			frame_pipeline.PrintProfilingInfo(gpu_profile);
 			graphics->printProfilingInfo(gpu_profile);
+			content.getFactory<Texture>().getStreamer().PrintProfilingInfo(gpu_profile);
 
 			signal_debug_info[0](PROFILER.getAvgSummary(quickprof::MICROSECONDS));
 			signal_debug_info[1](gpu_profile.str());
@@ -1481,9 +2045,8 @@ void Game::UpdateHUD(const size_t carid, const std::vector<float> & carinputs)
 		signal_brake(brakestr.str());
 	}
 
-	std::pair <int, int> curplace = timer.GetCarPlace(carid);
 	std::ostringstream placestr;
-	placestr << curplace.first << " / " << curplace.second;
+	placestr << standings.GetPlace(carid) << " / " << standings.GetNumCars();
 
 	int cur_lap = Clamp(timer.GetCurrentLap(carid), 1, race_laps);
 	std::ostringstream lapstr;
@@ -1640,6 +2203,10 @@ bool Game::NewGame(bool playreplay, bool addopponents, int num_laps)
 	timer.SetPlayerCarId(
 		car_info[player_car_id].driver.empty() ? player_car_id : car_info.size());
 
+	track_progress.Reset(track.GetAsset(), car_dynamics.size());
+	standings.Reset(car_dynamics.size(), track.GetSectors());
+	ai.SetTrackProgress(&track_progress);
+
 	// Bind vertex data.
 	std::vector<SceneNode *> nodes;
 	nodes.push_back(&track.GetRacinglineNode());
@@ -1683,6 +2250,12 @@ bool Game::NewGame(bool playreplay, bool addopponents, int num_laps)
 		replay.StartRecording(car_info, settings.GetTrack(), error_output);
 	}
 
+	// Allocate rewind buffer.
+	InitRewind();
+
+	if (!telemetry_file.empty())
+		StartTelemetry();
+
 	// Clean up asset cache.
 	content.sweep();
 
@@ -1696,6 +2269,63 @@ bool Game::NewGame(bool playreplay, bool addopponents, int num_laps)
 	return true;
 }
 
+void Game::StartTelemetry()
+{
+	static const char * wheel_names[WHEEL_COUNT] = {"fl", "fr", "rl", "rr"};
+
+	// per car: inputs, drivetrain, per wheel slip, slip angle, load, suspension,
+	// then the ai decision, only updated while the car is ai driven
+	telemetry.ClearChannels();
+	telemetry_car_channel.resize(car_dynamics.size());
+	telemetry_ai_channel.resize(car_dynamics.size());
+	for (int i = 0; i < car_dynamics.size(); ++i)
+	{
+		std::ostringstream prefix;
+		prefix << "car" << i << ".";
+		const std::string car = prefix.str();
+		telemetry_car_channel[i] = telemetry.AddChannel(car + "throttle");
+		telemetry.AddChannel(car + "brake");
+		telemetry.AddChannel(car + "steer");
+		telemetry.AddChannel(car + "speed");
+		telemetry.AddChannel(car + "rpm");
+		telemetry.AddChannel(car + "gear");
+		for (int w = 0; w < WHEEL_COUNT; ++w)
+		{
+			const std::string wheel = car + wheel_names[w] + ".";
+			telemetry.AddChannel(wheel + "slip");
+			telemetry.AddChannel(wheel + "slip_angle");
+			telemetry.AddChannel(wheel + "load");
+			telemetry.AddChannel(wheel + "suspension");
+		}
+		telemetry_ai_channel[i] = telemetry.AddChannel(car + "ai.target_speed");
+		telemetry.AddChannel(car + "ai.brake_lookahead");
+		telemetry.AddChannel(car + "ai.heading_error");
+		telemetry.AddChannel(car + "ai.braking_ahead");
+	}
+	telemetry_tick_channel = telemetry.AddChannel("tick_us");
+	telemetry.AddChannel("physics_us");
+
+	if (telemetry.Start(telemetry_file, error_output))
+		info_output << "Recording telemetry to " << telemetry_file << std::endl;
+}
+
+void Game::RecordCarTelemetry(int carid)
+{
+	const CarDynamics & car = car_dynamics[carid];
+	int channel = telemetry_car_channel[carid] + 3;
+	telemetry.Set(channel++, car.GetSpeedMPS());
+	telemetry.Set(channel++, car.GetTachoRPM());
+	telemetry.Set(channel++, car.GetTransmission().GetGear());
+	for (int w = 0; w < WHEEL_COUNT; ++w)
+	{
+		const WheelPosition wp = WheelPosition(w);
+		telemetry.Set(channel++, car.GetTire(wp).getSlip());
+		telemetry.Set(channel++, car.GetTire(wp).getSlipAngle());
+		telemetry.Set(channel++, car.GetWheelLoad(wp));
+		telemetry.Set(channel++, car.GetSuspension(wp).GetDisplacement());
+	}
+}
+
 std::string Game::GetReplayRecordingFilename()
 {
 	// Get time.
@@ -1828,6 +2458,13 @@ bool Game::LoadTrack(const std::string & trackname)
 		return false;
 	}
 
+	// Roads are loaded now, generate the track map while the objects load.
+	trackmap.BeginBuild(
+		track.GetRoadList(),
+		trackname,
+		settings.GetTrackReverse(),
+		pathmanager.GetTrackMapCachePath());
+
 	bool success = true;
 	int count = 0;
 	int count_max = track.ObjectsNum();
@@ -1854,8 +2491,6 @@ bool Game::LoadTrack(const std::string & trackname)
 	if (!trackmap.BuildMap(
 			window.GetW(),
 			window.GetH(),
-			track.GetRoadList(),
-			trackname,
 			pathmanager.GetHUDTextureDir(),
 			content,
 			error_output))
@@ -2471,30 +3106,23 @@ bool Game::Download(const std::vector <std::string> & urls)
 	return true;
 }
 
-void Game::UpdateForceFeedback(float dt)
+void Game::UpdateForceFeedback()
 {
-	const float ffdt = 0.02f;
 	float feedback = 0.0f;
 	if (!pause)
 	{
-		ff_update_time += dt;
-		if (ff_update_time >= ffdt)
-		{
-			ff_update_time = 0;
-
-			feedback = car_dynamics[player_car_id].GetFeedback();
+		feedback = car_dynamics[player_car_id].GetFeedback();
 
-			// scale
-			feedback = feedback * settings.GetFFGain();
+		// scale
+		feedback = feedback * settings.GetFFGain();
 
-			// invert
-			if (settings.GetFFInvert()) feedback = -feedback;
+		// invert
+		if (settings.GetFFInvert()) feedback = -feedback;
 
-			// clamp
-			feedback = Clamp(feedback, -1.0f, 1.0f);
-		}
+		// clamp
+		feedback = Clamp(feedback, -1.0f, 1.0f);
 	}
-	forcefeedback->update(feedback, ffdt, error_output);
+	forcefeedback_loop->Publish(frame * double(timestep), feedback);
 }
 
 void Game::AddTireSmokeParticles(const CarDynamics & car, float dt)
@@ -2541,14 +3169,7 @@ void Game::UpdateDriftScore(const int carid, const float dt)
 	const CarDynamics & car = car_dynamics[carid];
 
 	// Make sure the car is not off track.
-	int wheel_count = 0;
-	for (int i = 0; i < 4; i++)
-	{
-		if (car.GetWheelContact(WheelPosition(i)).GetPatch())
-			wheel_count++;
-	}
-
-	bool on_track = (wheel_count > 1);
+	bool on_track = (track_progress.GetWheelsOnRoad(carid) > 1);
 	bool is_drifting = false;
 	bool spin_out = false;
 	if (on_track)
@@ -2638,6 +3259,22 @@ void Game::LeaveGame()
 	if (replay.GetPlaying())
 		replay.Reset();
 
+	if (telemetry.Recording())
+	{
+		telemetry.Stop();
+		info_output << "Saved telemetry to " << telemetry_file;
+		if (telemetry.GetDroppedRows())
+			info_output << ", dropped " << telemetry.GetDroppedRows() << " rows";
+		info_output << std::endl;
+	}
+
+	if (rewind.Enabled())
+	{
+		info_output << "Rewind capture time: " << rewind.GetAverageCaptureTime() << " us per frame, "
+			<< rewind.GetAverageTickTime() << " us per tick" << std::endl;
+		rewind.Clear();
+	}
+
 	graphics->ClearStaticDrawables();
 
 	tire_smoke.Clear();
@@ -2648,6 +3285,8 @@ void Game::LeaveGame()
 	sound.Update(true);
 	trackmap.Unload();
 	timer.Unload();
+	track_progress.Clear();
+	standings.Clear();
 	active_camera = NULL;
 	camera_car_id = 0;
 	race_laps = 0;
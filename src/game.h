@@ -22,11 +22,14 @@
 
 #include "window.h"
 #include "graphics/graphics.h"
+#include "graphics/frame_pipeline.h"
 #include "graphics/gl3v/stringidmap.h"
 #include "eventsystem.h"
+#include "input_sampler.h"
 #include "settings.h"
 #include "pathmanager.h"
 #include "track.h"
+#include "track_progress.h"
 #include "mathvector.h"
 #include "quaternion.h"
 #include "http.h"
@@ -45,11 +48,16 @@
 #include "camera_free.h"
 #include "trackmap.h"
 #include "timer.h"
+#include "race_standings.h"
+#include "quickprof.h"
 #include "replay.h"
+#include "rewind.h"
+#include "telemetry_recorder.h"
 #include "forcefeedback.h"
 #include "particle.h"
 #include "ai/ai.h"
 #include "content/contentmanager.h"
+#include "cooked_manifest.h"
 #include "updatemanager.h"
 #include "game_downloader.h"
 
@@ -97,6 +105,15 @@ private:
 
 	void Test();
 
+	/// Simulate setup variants of a car on a track and report the results.
+	bool CarTestSweep(
+		const std::string & carname,
+		const std::string & trackname,
+		const std::string & variantfile,
+		float duration,
+		unsigned threads,
+		const std::string & outfile);
+
 	void Tick(float dt);
 
 	void Draw();
@@ -105,6 +122,9 @@ private:
 
 	void UpdateCars(float dt);
 
+	/// Switch distant ai cars between full and proxy physics.
+	void UpdateCarPhysicsLod();
+
 	void ProcessCarInputs();
 
 	/// Updates camera, call after physics update
@@ -114,6 +134,25 @@ private:
 
 	void UpdateTimer();
 
+	/// Allocate rewind buffer for the current race.
+	void InitRewind();
+
+	/// Capture rewind frame if due, call at the end of a tick.
+	void UpdateRewind();
+
+	/// Jump back to the previous rewind frame.
+	void RewindGame();
+
+	/// Register telemetry channels for the current race and start recording.
+	void StartTelemetry();
+
+	/// Sample car state into the telemetry row, call after the physics update.
+	void RecordCarTelemetry(int carid);
+
+	/// Race state of cars, ai, timer and track objects.
+	template <class Serializer>
+	bool SerializeState(Serializer & s);
+
 	/// Check eventsystem state and update GUI
 	void ProcessGUIInputs();
 
@@ -190,7 +229,8 @@ private:
 
 	void LoadControlsIntoGUI();
 
-	void UpdateForceFeedback(float dt);
+	/// Publish the steering force of this tick to the force feedback thread.
+	void UpdateForceFeedback();
 
 	void AddTireSmokeParticles(const CarDynamics & car, float dt);
 
@@ -318,8 +358,10 @@ private:
 	Settings settings;
 	Window window;
 	Graphics * graphics;
+	FramePipeline frame_pipeline;
 	StringIdMap stringMap;
 	EventSystem eventsystem;
+	CookedManifest cooked_manifest;
 	ContentManager content;
 	Sound sound;
 	AutoUpdate autoupdate;
@@ -362,7 +404,7 @@ private:
 	bool practice;
 
 	btDefaultCollisionConfiguration collisionconfig;
-	btCollisionDispatcher collisiondispatch;
+	FractureDispatcher collisiondispatch;
 	btDbvtBroadphase collisionbroadphase;
 	btSequentialImpulseConstraintSolver collisionsolver;
 	DynamicsDraw dynamicsdraw;
@@ -374,14 +416,26 @@ private:
 
 	TrackMap trackmap;
 	Track track;
+	TrackProgress track_progress;
 	Gui gui;
 	Timer timer;
+	RaceStandings standings;
 	Replay replay;
+	Rewind rewind;
+	TelemetryRecorder telemetry;
+	std::string telemetry_file;
+	std::vector<int> telemetry_car_channel; ///< first channel of each car
+	std::vector<int> telemetry_ai_channel; ///< first ai decision channel of each car
+	int telemetry_tick_channel;
+	quickprof::Clock telemetry_clock;
+	InputSampler input_sampler;
+	unsigned input_rate; ///< joystick sampling rate, 0 to sample on the main thread
+	unsigned input_probe_rate; ///< latency probes per second, 0 if off
 	Ai ai;
 	Http http;
 
 	std::unique_ptr <ForceFeedback> forcefeedback;
-	float ff_update_time;
+	std::unique_ptr <ForceFeedbackLoop> forcefeedback_loop;
 };
 
 #endif
@@ -21,6 +21,7 @@
 #define _DRAWABLE_H
 
 #include "rendermodelext_drawable.h"
+#include "scenerevision.h"
 #include "vertexbuffer.h"
 #include "mathvector.h"
 #include "matrix4.h"
@@ -98,6 +99,7 @@ private:
 	bool textures_changed;
 	bool uniforms_changed;
 	RenderModelExtDrawable render_model;
+	SceneRevision revision;
 };
 
 inline bool Drawable::operator < (const Drawable & other) const
@@ -162,6 +164,8 @@ inline bool Drawable::GetDrawEnable() const
 
 inline void Drawable::SetDrawEnable(bool value)
 {
+	if (drawenabled != value)
+		SceneRevision::Bump();
 	drawenabled = value;
 }
 
@@ -153,6 +153,15 @@ struct DrawableContainer
 		#undef X
 	}
 
+	/// adds the drawable pointers of this pointer container to the second
+	template <template <typename UU> class ContainerU>
+	void AppendPointersTo(DrawableContainer <ContainerU> & dest) const
+	{
+		#define X(Y) dest.Y.insert(dest.Y.end(), Y.begin(), Y.end());
+		DRAWABLES_LIST
+		#undef X
+	}
+
 	/// this is slow, don't do it often
 	reseatable_reference <Container <Drawable> > GetByName(const std::string & name)
 	{
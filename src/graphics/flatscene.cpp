@@ -0,0 +1,172 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#include "flatscene.h"
+#include "unittest.h"
+
+FlatScene::FlatScene() :
+	root(0),
+	revision(0)
+{
+	// ctor
+}
+
+bool FlatScene::Update(SceneNode & node, const Mat4 & root_transform)
+{
+	bool rebuild = (&node != root) || (revision != SceneRevision::Get());
+	if (rebuild)
+		Rebuild(node);
+
+	// root node compares against its cached transform, the parent transform isn't tracked
+	Mat4 last_transform(node.cached_transform);
+	node.UpdateTransform(root_transform);
+	dirty[0] = rebuild || (last_transform != node.cached_transform);
+
+	// pre-order guarantees that parents are updated before their children
+	for (unsigned i = 0; i < nodes.size(); ++i)
+	{
+		SceneNode & cur = *nodes[i];
+		if (i > 0)
+		{
+			dirty[i] = dirty[parents[i]] || cur.transform.GetChanged();
+			if (dirty[i])
+				cur.UpdateTransform(nodes[parents[i]]->cached_transform);
+		}
+
+		if (dirty[i])
+		{
+			const Mat4 & transform = cur.cached_transform;
+			cur.drawlist.ForEachDrawable([&transform](Drawable & d) { d.SetTransform(transform); });
+		}
+	}
+
+	return rebuild;
+}
+
+void FlatScene::Rebuild(SceneNode & node)
+{
+	nodes.clear();
+	parents.clear();
+	AddNode(node, 0);
+	dirty.assign(nodes.size(), 1);
+
+	Mat4 identity;
+	drawlist.clear();
+	for (auto cur : nodes)
+	{
+		cur->drawlist.AppendTo<PtrVector, false>(drawlist, identity);
+	}
+
+	root = &node;
+	revision = SceneRevision::Get();
+}
+
+void FlatScene::AddNode(SceneNode & node, unsigned parent)
+{
+	unsigned index = nodes.size();
+	nodes.push_back(&node);
+	parents.push_back(parent);
+	for (auto & child : node.childlist)
+	{
+		AddNode(child, index);
+	}
+}
+
+FlatSceneSet::FlatSceneSet() :
+	count(0),
+	changed(true)
+{
+	// ctor
+}
+
+void FlatSceneSet::Clear()
+{
+	count = 0;
+}
+
+void FlatSceneSet::Invalidate()
+{
+	changed = true;
+}
+
+void FlatSceneSet::Add(SceneNode & node)
+{
+	if (count == scenes.size())
+		scenes.push_back(FlatScene());
+
+	Mat4 identity;
+	changed |= scenes[count].Update(node, identity);
+	count++;
+}
+
+QT_TEST(flatscene_test)
+{
+	SceneNode root;
+	SceneNode::Handle childh = root.AddNode();
+	SceneNode & child = root.GetNode(childh);
+	SceneNode::DrawableHandle drawh = child.GetDrawList().normal_noblend.insert(Drawable());
+	Drawable & draw = child.GetDrawList().normal_noblend.get(drawh);
+
+	FlatScene scene;
+	Mat4 identity;
+	QT_CHECK(scene.Update(root, identity));
+	QT_CHECK_EQUAL(scene.GetNodeCount(), 2);
+	QT_CHECK_EQUAL(scene.GetDrawList().normal_noblend.size(), 1);
+
+	// moving a node updates its drawables without rebuilding the list
+	child.GetTransform().SetTranslation(Vec3(1, 2, 3));
+	QT_CHECK(!scene.Update(root, identity));
+	QT_CHECK_EQUAL(draw.GetTransform()[12], 1);
+	QT_CHECK_EQUAL(draw.GetTransform()[14], 3);
+
+	// so does moving the root
+	Mat4 offset;
+	offset.Translate(1, 0, 0);
+	QT_CHECK(!scene.Update(root, offset));
+	QT_CHECK_EQUAL(draw.GetTransform()[12], 2);
+
+	// unchanged visibility doesn't invalidate the list
+	draw.SetDrawEnable(true);
+	QT_CHECK(!scene.Update(root, offset));
+
+	draw.SetDrawEnable(false);
+	QT_CHECK(scene.Update(root, offset));
+	QT_CHECK(scene.GetDrawList().empty());
+
+	child.AddNode();
+	QT_CHECK(scene.Update(root, offset));
+	QT_CHECK_EQUAL(scene.GetNodeCount(), 3);
+
+	// the set keeps its output until one of the scenes or the scene order changes
+	FlatSceneSet set;
+	FlatScene::DrawableList output;
+	draw.SetDrawEnable(true);
+	set.Add(root);
+	QT_CHECK(set.GetDrawList(output));
+	QT_CHECK_EQUAL(output.normal_noblend.size(), 1);
+
+	set.Clear();
+	set.Add(root);
+	QT_CHECK(!set.GetDrawList(output));
+	QT_CHECK_EQUAL(output.normal_noblend.size(), 1);
+
+	set.Clear();
+	QT_CHECK(set.GetDrawList(output));
+	QT_CHECK(output.empty());
+}
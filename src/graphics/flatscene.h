@@ -0,0 +1,127 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef _FLATSCENE_H
+#define _FLATSCENE_H
+
+#include "scenenode.h"
+
+#include <vector>
+
+/// Flattened scene graph, kept across frames.
+/// Nodes are stored in pre-order with parent indices, world transforms are
+/// updated in a single pass over the nodes whose local transform changed.
+/// The enabled drawables are only collected again after the scene structure
+/// or drawable visibility changed, see SceneRevision.
+class FlatScene
+{
+public:
+	template <typename T> class PtrVector : public std::vector<T*> {};
+	typedef DrawableContainer <PtrVector> DrawableList;
+
+	FlatScene();
+
+	/// update world transforms of changed nodes
+	/// returns true if the drawable list had to be rebuilt
+	bool Update(SceneNode & node, const Mat4 & root_transform);
+
+	const SceneNode * GetRoot() const;
+
+	const DrawableList & GetDrawList() const;
+
+	unsigned GetNodeCount() const;
+
+private:
+	std::vector<SceneNode*> nodes;
+	std::vector<unsigned> parents;
+	std::vector<char> dirty;
+	DrawableList drawlist;
+	SceneNode * root;
+	unsigned revision;
+
+	void Rebuild(SceneNode & node);
+
+	void AddNode(SceneNode & node, unsigned parent);
+};
+
+/// Scene graphs added to the renderer every frame.
+/// Drawable lists are reused as long as the same nodes are added in the same
+/// order and none of them changed structure.
+class FlatSceneSet
+{
+public:
+	FlatSceneSet();
+
+	/// start a new frame, the drawable lists are kept
+	void Clear();
+
+	/// force the drawable lists to be rebuilt
+	void Invalidate();
+
+	/// update the transforms of the next scene graph
+	void Add(SceneNode & node);
+
+	/// rebuild drawlist_output if any scene changed since the last call
+	/// returns true if drawlist_output has been rebuilt
+	template <template <typename U> class T>
+	bool GetDrawList(DrawableContainer <T> & drawlist_output);
+
+private:
+	std::vector<FlatScene> scenes;
+	unsigned count;
+	bool changed;
+};
+
+inline const SceneNode * FlatScene::GetRoot() const
+{
+	return root;
+}
+
+inline const FlatScene::DrawableList & FlatScene::GetDrawList() const
+{
+	return drawlist;
+}
+
+inline unsigned FlatScene::GetNodeCount() const
+{
+	return nodes.size();
+}
+
+template <template <typename U> class T>
+inline bool FlatSceneSet::GetDrawList(DrawableContainer <T> & drawlist_output)
+{
+	if (count != scenes.size())
+	{
+		scenes.resize(count);
+		changed = true;
+	}
+
+	if (!changed)
+		return false;
+
+	drawlist_output.clear();
+	for (const auto & scene : scenes)
+	{
+		scene.GetDrawList().AppendPointersTo(drawlist_output);
+	}
+	changed = false;
+	return true;
+}
+
+#endif // _FLATSCENE_H
@@ -0,0 +1,174 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#include "frame_pipeline.h"
+#include "quickprof.h"
+
+#include <ostream>
+
+// Number of samples averaged before the reported timings are updated.
+static const unsigned average_samples = 30;
+
+static bool HasVersion(int major, int minor)
+{
+	int cur_major = glcGetMajorVersion();
+	return cur_major > major || (cur_major == major && glcGetMinorVersion() >= minor);
+}
+
+FramePipeline::FramePipeline() :
+	current(0),
+	timer_queries(false),
+	gpu_time(0),
+	wait_time(0),
+	gpu_samples(0),
+	wait_samples(0),
+	gpu_time_avg(0),
+	wait_time_avg(0)
+{
+	// ctor
+}
+
+FramePipeline::~FramePipeline()
+{
+	Deinit();
+}
+
+void FramePipeline::Init(unsigned frames_in_flight)
+{
+	Deinit();
+
+	// sync objects are core since 3.2, timestamp queries since 3.3
+	if (!HasVersion(3, 2) && GLC_ARB_sync != GLC_LOAD_SUCCEEDED)
+		return;
+
+	timer_queries = HasVersion(3, 3) || GLC_ARB_timer_query == GLC_LOAD_SUCCEEDED;
+
+	frames.resize(frames_in_flight > 0 ? frames_in_flight : 1);
+	if (timer_queries)
+	{
+		for (auto & frame : frames)
+			glGenQueries(2, frame.queries);
+	}
+	current = 0;
+}
+
+void FramePipeline::Deinit()
+{
+	for (auto & frame : frames)
+	{
+		if (frame.fence)
+			glDeleteSync(frame.fence);
+		if (frame.queries[0])
+			glDeleteQueries(2, frame.queries);
+	}
+	frames.clear();
+	timer_queries = false;
+	gpu_time = wait_time = 0;
+	gpu_samples = wait_samples = 0;
+	gpu_time_avg = wait_time_avg = 0;
+}
+
+bool FramePipeline::Enabled() const
+{
+	return !frames.empty();
+}
+
+void FramePipeline::Wait()
+{
+	if (frames.empty())
+		return;
+
+	// The slot we are about to reuse holds the oldest frame still in flight.
+	Frame & frame = frames[current];
+	if (!frame.fence)
+		return;
+
+	quickprof::Clock clock;
+	unsigned long long start = clock.getTimeMicroseconds();
+	glClientWaitSync(frame.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+	wait_time += clock.getTimeMicroseconds() - start;
+
+	Retire(frame);
+
+	if (++wait_samples == average_samples)
+	{
+		wait_time_avg = wait_time / wait_samples;
+		wait_time = 0;
+		wait_samples = 0;
+	}
+}
+
+void FramePipeline::BeginFrame()
+{
+	if (frames.empty())
+		return;
+
+	Frame & frame = frames[current];
+	if (frame.fence)
+		Retire(frame);
+
+	if (timer_queries)
+		glQueryCounter(frame.queries[0], GL_TIMESTAMP);
+}
+
+void FramePipeline::EndFrame()
+{
+	if (frames.empty())
+		return;
+
+	Frame & frame = frames[current];
+	if (timer_queries)
+		glQueryCounter(frame.queries[1], GL_TIMESTAMP);
+	frame.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	current = (current + 1) % frames.size();
+}
+
+void FramePipeline::PrintProfilingInfo(std::ostream & out) const
+{
+	if (frames.empty())
+		return;
+
+	out << "frames in flight: " << frames.size() << std::endl;
+	if (timer_queries)
+		out << "gpu frame: " << gpu_time_avg << " us" << std::endl;
+	out << "gpu wait: " << wait_time_avg << " us" << std::endl;
+}
+
+void FramePipeline::Retire(Frame & frame)
+{
+	// Blocks only if the frame has not completed yet, which Wait prevents.
+	if (timer_queries)
+	{
+		GLuint64 begin = 0, end = 0;
+		glGetQueryObjectui64v(frame.queries[0], GL_QUERY_RESULT, &begin);
+		glGetQueryObjectui64v(frame.queries[1], GL_QUERY_RESULT, &end);
+		gpu_time += (end - begin) * 1E-3;
+
+		if (++gpu_samples == average_samples)
+		{
+			gpu_time_avg = gpu_time / gpu_samples;
+			gpu_time = 0;
+			gpu_samples = 0;
+		}
+	}
+
+	glDeleteSync(frame.fence);
+	frame.fence = 0;
+}
@@ -0,0 +1,81 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef _FRAME_PIPELINE_H
+#define _FRAME_PIPELINE_H
+
+#include "glcore.h"
+
+#include <iosfwd>
+#include <vector>
+
+/// Paces CPU frame building against GPU execution.
+/// Every submitted frame is bracketed by GPU timestamp queries and followed
+/// by a fence. Before a new frame is submitted the pipeline blocks on the
+/// fence of the frame submitted frames_in_flight frames earlier, so the CPU
+/// may run at most that many frames ahead of the GPU. Query results are only
+/// read once their fence has signaled, so timing never stalls the pipeline.
+class FramePipeline
+{
+public:
+	FramePipeline();
+
+	~FramePipeline();
+
+	/// Needs a current GL context. Without sync object support the
+	/// pipeline is disabled and all other calls are no-ops.
+	void Init(unsigned frames_in_flight);
+
+	void Deinit();
+
+	bool Enabled() const;
+
+	/// Block until at most frames_in_flight - 1 frames are pending on the GPU.
+	void Wait();
+
+	/// Bracket the GL submission of the current frame.
+	void BeginFrame();
+
+	void EndFrame();
+
+	/// Average GPU frame time and CPU wait time in microseconds.
+	void PrintProfilingInfo(std::ostream & out) const;
+
+private:
+	struct Frame
+	{
+		GLsync fence;
+		GLuint queries[2];
+		Frame() : fence(0) { queries[0] = queries[1] = 0; }
+	};
+	std::vector<Frame> frames;
+	unsigned current;
+	bool timer_queries;
+
+	double gpu_time;
+	double wait_time;
+	unsigned gpu_samples;
+	unsigned wait_samples;
+	double gpu_time_avg;
+	double wait_time_avg;
+
+	void Retire(Frame & frame);
+};
+
+#endif // _FRAME_PIPELINE_H
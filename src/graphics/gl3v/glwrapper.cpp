@@ -201,7 +201,13 @@ bool GLWrapper::createAndCompileShader(const std::string & shaderSource, GLenum
 		return true;
 }
 
-bool GLWrapper::linkShaderProgram(const std::vector <std::string> & shaderAttributeBindings, const std::vector <GLuint> & shaderHandles, GLuint & handle, const std::map <GLuint, std::string> & fragDataLocations, std::ostream & shaderErrorOutput)
+bool GLWrapper::linkShaderProgram(const std::vector <std::string> & shaderAttributeBindings, const std::vector <GLuint> & shaderHandles, GLuint & handle, const std::map <GLuint, std::string> & fragDataLocations, std::ostream & shaderErrorOutput, bool binaryRetrievable)
+{
+	submitShaderProgram(shaderAttributeBindings, shaderHandles, handle, fragDataLocations, binaryRetrievable);
+	return checkShaderProgram(handle, shaderErrorOutput);
+}
+
+void GLWrapper::submitShaderProgram(const std::vector <std::string> & shaderAttributeBindings, const std::vector <GLuint> & shaderHandles, GLuint & handle, const std::map <GLuint, std::string> & fragDataLocations, bool binaryRetrievable)
 {
 	handle = GLLOG(glCreateProgram());ERROR_CHECK;
 
@@ -218,8 +224,17 @@ bool GLWrapper::linkShaderProgram(const std::vector <std::string> & shaderAttrib
 	for (const auto & location : fragDataLocations)
 		GLLOG(glBindFragDataLocation(handle, location.first, location.second.c_str()));ERROR_CHECK;
 
+	if (binaryRetrievable)
+		GLLOG(glProgramParameteri(handle, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE));ERROR_CHECK;
+
 	// Attempt to link the program.
 	GLLOG(glLinkProgram(handle));ERROR_CHECK;
+}
+
+bool GLWrapper::checkShaderProgram(GLuint & handle, std::ostream & shaderErrorOutput)
+{
+	if (!handle)
+		return false;
 
 	// Handle the result.
 	GLint linkStatus;
@@ -288,6 +303,22 @@ void GLWrapper::BindFramebufferWithoutValidation(GLuint fbo)
 	GLLOG(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbo));ERROR_CHECK;
 }
 
+void GLWrapper::BindReadFramebuffer(GLuint fbo)
+{
+	GLLOG(glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo));ERROR_CHECK;
+}
+
+void GLWrapper::ReadBuffer(GLenum mode)
+{
+	GLLOG(glReadBuffer(mode));ERROR_CHECK;
+}
+
+void GLWrapper::BlitFramebuffer(GLuint w, GLuint h, GLbitfield mask)
+{
+	// Depth and stencil can only be copied with nearest filtering.
+	GLLOG(glBlitFramebuffer(0, 0, w, h, 0, 0, w, h, mask, GL_NEAREST));ERROR_CHECK;
+}
+
 void GLWrapper::Viewport(GLuint w, GLuint h)
 {
 	GLLOG(glViewport(0,0,w,h));ERROR_CHECK;
@@ -80,7 +80,16 @@ public:
 	/// Link a shader program given the specified shaders.
 	/// Returns true on success.
 	/// Puts the generated shader program handle into the provided handle variable.
-	bool linkShaderProgram(const std::vector <std::string> & shaderAttributeBindings, const std::vector <GLuint> & shaderHandles, GLuint & handle, const std::map <GLuint, std::string> & fragDataLocations, std::ostream & shaderErrorOutput);
+	/// If binaryRetrievable is set the driver is asked to keep the program binary around.
+	bool linkShaderProgram(const std::vector <std::string> & shaderAttributeBindings, const std::vector <GLuint> & shaderHandles, GLuint & handle, const std::map <GLuint, std::string> & fragDataLocations, std::ostream & shaderErrorOutput, bool binaryRetrievable = false);
+
+	/// Starts linking a shader program, like linkShaderProgram but without waiting for the result.
+	/// Use checkShaderProgram before using the program.
+	void submitShaderProgram(const std::vector <std::string> & shaderAttributeBindings, const std::vector <GLuint> & shaderHandles, GLuint & handle, const std::map <GLuint, std::string> & fragDataLocations, bool binaryRetrievable = false);
+
+	/// Queries the link status of a submitted shader program, deleting the program and zeroing handle on failure.
+	/// Returns true on success.
+	bool checkShaderProgram(GLuint & handle, std::ostream & shaderErrorOutput);
 
 	/// Relinks a shader program that has previously been linked. does nothing and returns false if handle is zero.
 	/// Returns true on success.
@@ -90,6 +99,10 @@ public:
 	// Some return bools where true means success.
 	bool BindFramebuffer(GLuint fbo);
 	void BindFramebufferWithoutValidation(GLuint fbo);
+	void BindReadFramebuffer(GLuint fbo);
+	void ReadBuffer(GLenum mode);
+	/// Copies the given buffers from the read to the draw framebuffer, without scaling.
+	void BlitFramebuffer(GLuint w, GLuint h, GLbitfield mask);
 	void Viewport(GLuint w, GLuint h);
 	void Clear(GLbitfield mask);
 	void UseProgram(GLuint program);
@@ -35,7 +35,7 @@ static std::set <T> mergeSets(const std::set <T> & set1, const std::set <T> & se
 	return result;
 }
 
-bool Renderer::initialize(const std::vector <RealtimeExportPassInfo> & config, StringIdMap & stringMap, const std::string & shaderPath, unsigned int w,unsigned int h, const std::set <std::string> & globalDefines, std::ostream & errorOutput)
+bool Renderer::initialize(const std::vector <RealtimeExportPassInfo> & config, StringIdMap & stringMap, const std::string & shaderPath, unsigned int w,unsigned int h, const std::set <std::string> & globalDefines, std::ostream & errorOutput, ShaderCache * shaderCache)
 {
 	// Clear existing passes.
 	clear();
@@ -65,7 +65,7 @@ bool Renderer::initialize(const std::vector <RealtimeExportPassInfo> & config, S
 		// Initialize the pass.
 		int passIdx = passes.size();
 		passes.push_back(RenderPass());
-		if (!passes.back().initialize(passCount, passInfo, stringMap, gl, shaders.find(vertexShaderName)->second, shaders.find(fragmentShaderName)->second, sharedTextures, w, h, errorOutput))
+		if (!passes.back().initialize(passCount, passInfo, stringMap, gl, shaders.find(vertexShaderName)->second, shaders.find(fragmentShaderName)->second, sharedTextures, w, h, errorOutput, shaderCache))
 			return false;
 
 		// Put the pass's output render targets into a map so we can feed them to subsequent passes.
@@ -80,6 +80,13 @@ bool Renderer::initialize(const std::vector <RealtimeExportPassInfo> & config, S
 		passCount++;
 	}
 
+	// Only now wait for the programs, the driver may have linked them in parallel.
+	for (auto & pass : passes)
+	{
+		if (!pass.finishInitialize(stringMap, gl, errorOutput))
+			return false;
+	}
+
 	return true;
 }
 
@@ -87,7 +94,8 @@ void Renderer::clear()
 {
 	// Destroy shaders.
 	for (auto & shader : shaders)
-		gl.DeleteShader(shader.second.handle);
+		if (shader.second.handle)
+			gl.DeleteShader(shader.second.handle);
 	shaders.clear();
 
 	// Tell each pass to clean itself up.
@@ -110,6 +118,7 @@ void Renderer::render(unsigned int w, unsigned int h, StringIdMap & stringMap, s
 	render(w, h, stringMap, std::map <StringId, std::vector <RenderModelExt*> >(), errorOutput);
 }
 
+static const std::vector <const std::vector <RenderModelExt*>*> noModels;
 void Renderer::render(unsigned int w, unsigned int h, StringIdMap & stringMap, const std::map <StringId, std::vector <RenderModelExt*> > & externalModels, std::ostream & errorOutput)
 {
 	for (auto & pass : passes)
@@ -126,7 +135,7 @@ void Renderer::render(unsigned int w, unsigned int h, StringIdMap & stringMap, c
 				drawList.push_back(&drawGroupIter->second);
 		}
 
-		if (pass.render(gl, w, h, stringMap, drawList, sharedTextures, errorOutput))
+		if (pass.render(gl, w, h, stringMap, drawList, noModels, sharedTextures, errorOutput))
 		{
 			// Render targets have been recreated due to display dimension change.
 			// Call setGlobalTexture to update sharedTextures and let downstream passes know.
@@ -155,7 +164,23 @@ void Renderer::render(unsigned int w, unsigned int h, StringIdMap & stringMap, c
 					drawList.push_back(drawGroupIter->second);
 			}
 
-		if (pass.render(gl, w, h, stringMap, drawList, sharedTextures, errorOutput))
+		if (pass.render(gl, w, h, stringMap, drawList, noModels, sharedTextures, errorOutput))
+		{
+			// Render targets have been recreated due to display dimension change.
+			// Call setGlobalTexture to update sharedTextures and let downstream passes know.
+			for (const auto & rt : passes.back().getRenderTargets())
+				setGlobalTexture(rt.first, RenderTextureEntry(rt.first, rt.second.handle, rt.second.target));
+		}
+	}
+}
+
+void Renderer::render(unsigned int w, unsigned int h, StringIdMap & stringMap, const std::vector <std::vector <const std::vector <RenderModelExt*>*> > & passModels, const std::vector <std::vector <const std::vector <RenderModelExt*>*> > & passStaticModels, std::ostream & errorOutput)
+{
+	assert(passModels.size() == passes.size());
+	assert(passStaticModels.size() == passes.size());
+	for (unsigned int i = 0; i < passes.size(); i++)
+	{
+		if (passes[i].render(gl, w, h, stringMap, passModels[i], passStaticModels[i], sharedTextures, errorOutput))
 		{
 			// Render targets have been recreated due to display dimension change.
 			// Call setGlobalTexture to update sharedTextures and let downstream passes know.
@@ -316,6 +341,24 @@ void Renderer::setPassUniform(StringId passName, const RenderUniformEntry & unif
 	}
 }
 
+void Renderer::setPassUniform(unsigned int passIndex, const RenderUniformEntry & uniform)
+{
+	assert(passIndex < passes.size());
+	passes[passIndex].setDefaultUniform(uniform);
+}
+
+void Renderer::setPassUniform(unsigned int passIndex, GLuint location, const RenderUniformEntry & uniform)
+{
+	assert(passIndex < passes.size());
+	passes[passIndex].setDefaultUniform(location, uniform);
+}
+
+int Renderer::getPassUniformLocation(unsigned int passIndex, StringId uniformName) const
+{
+	assert(passIndex < passes.size());
+	return passes[passIndex].getUniformLocation(uniformName);
+}
+
 void Renderer::removePassUniform(StringId passName, StringId uniformName)
 {
 	auto i = passIndexMap.find(passName);
@@ -359,6 +402,30 @@ bool Renderer::getPassEnabled(StringId passName) const
 	return false;
 }
 
+bool Renderer::getPassEnabled(unsigned int passIndex) const
+{
+	assert(passIndex < passes.size());
+	return passes[passIndex].getEnabled();
+}
+
+void Renderer::setPassStaticCacheEnabled(unsigned int passIndex, bool enable)
+{
+	assert(passIndex < passes.size());
+	passes[passIndex].setStaticCacheEnabled(gl, enable);
+}
+
+bool Renderer::getPassStaticCacheValid(unsigned int passIndex) const
+{
+	assert(passIndex < passes.size());
+	return passes[passIndex].getStaticCacheValid();
+}
+
+void Renderer::invalidatePassStaticCache(unsigned int passIndex)
+{
+	assert(passIndex < passes.size());
+	passes[passIndex].invalidateStaticCache();
+}
+
 static const std::map <std::string, std::string> emptyStringMap;
 const std::map <std::string, std::string> & Renderer::getUserDefinedFields(StringId passName) const
 {
@@ -454,8 +521,18 @@ void Renderer::printRendererStatus(RendererStatusVerbosity verbosity, const Stri
 
 void Renderer::printProfilingInfo(std::ostream & out) const
 {
+	RenderPassStats total;
 	for (const auto & pass : passes)
-		out << pass.getName() << ": " << pass.getLastTime() * 1E6f << " us" << std::endl;
+	{
+		const RenderPassStats & stats = pass.getLastStats();
+		out << pass.getName() << ": " << pass.getLastTime() * 1E6f << " us, "
+			<< stats.draws << " draws, " << stats.textureBinds << " tex, "
+			<< stats.uniformUpdates << " uni, " << stats.vertexArrayChanges << " vao" << std::endl;
+		total += stats;
+	}
+	out << "State changes: " << total.textureBinds << " tex, " << total.uniformUpdates << " uni, "
+		<< total.vertexArrayChanges << " vao, " << total.redundantChanges << " skipped, "
+		<< total.draws << " draws" << std::endl;
 }
 
 bool Renderer::loadShader(const std::string & path, const std::string & name, const std::set <std::string> & defines, GLenum shaderType, std::ostream & errorOutput)
@@ -479,19 +556,13 @@ bool Renderer::loadShader(const std::string & path, const std::string & name, co
 	else
 		shaderSource = blockstream.str() + shaderSource;
 
-	GLuint handle(0);
-	std::ostringstream shaderOutput;
-	bool success = gl.createAndCompileShader(shaderSource, shaderType, handle, shaderOutput);
+	// Compilation is deferred to the render pass, a program binary cache hit skips it.
+	RenderShader shader;
+	shader.handle = 0;
+	shader.type = shaderType;
+	shader.source = shaderSource;
+	shader.defines = defines; // for debug only
+	shaders.insert(std::make_pair(name, shader));
 
-	if (success)
-	{
-		RenderShader shader;
-		shader.handle = handle;
-		shader.defines = defines; // for debug only
-		shaders.insert(std::make_pair(name, shader));
-	}
-	else
-		errorOutput << "Unable to compile shader " << name << " from file " << path << ":\n" << shaderOutput.str() << std::endl;
-
-	return success;
+	return true;
 }
@@ -40,7 +40,8 @@ public:
 	/// The passes will be rendered in the order they appear in the vector.
 	/// The provided StringIdMap will be used to convert strings into unique numeric IDs.
 	/// w and h are the width and height of the application's window and will be used to initialize FBOs.
-	bool initialize(const std::vector <RealtimeExportPassInfo> & config, StringIdMap & stringMap, const std::string & shaderPath, unsigned int w, unsigned int h, const std::set <std::string> & globalDefines, std::ostream & errorOutput);
+	/// Shader programs are looked up in the optional shader cache before anything is compiled.
+	bool initialize(const std::vector <RealtimeExportPassInfo> & config, StringIdMap & stringMap, const std::string & shaderPath, unsigned int w, unsigned int h, const std::set <std::string> & globalDefines, std::ostream & errorOutput, ShaderCache * shaderCache = 0);
 
 	/// Render all passes.
 	/// w and h are the width and height of the application's window.
@@ -57,6 +58,12 @@ public:
 	/// externalModels is a map of pass ID to a map of draw group name ID and a pointer to a vector array of pointers to external models to be drawn along with models that have been added to the pass with addModel.
 	void render(unsigned int w, unsigned int h, StringIdMap & stringMap, const std::map <StringId, std::map <StringId, std::vector <RenderModelExt*> *> > & externalModels, std::ostream & errorOutput);
 
+	/// Render all passes.
+	/// w and h are the width and height of the application's window.
+	/// passModels holds for every pass, in the order of getPassNames, the external model vectors to be drawn along with models that have been added to the pass with addModel.
+	/// passStaticModels is laid out the same way and holds the models that may be served from a pass's static cache, see setPassStaticCacheEnabled.
+	void render(unsigned int w, unsigned int h, StringIdMap & stringMap, const std::vector <std::vector <const std::vector <RenderModelExt*>*> > & passModels, const std::vector <std::vector <const std::vector <RenderModelExt*>*> > & passStaticModels, std::ostream & errorOutput);
+
 	/// Cleanup all data.
 	void clear();
 
@@ -110,6 +117,16 @@ public:
 	/// The mapping is keyed on the name of the uniform. If the name already exists, the existing RenderUniformEntry is overridden with the new one.
 	void setPassUniform(StringId passName, const RenderUniformEntry & uniform);
 
+	/// Same as above for the pass at passIndex in the order of getPassNames.
+	void setPassUniform(unsigned int passIndex, const RenderUniformEntry & uniform);
+
+	/// Same as above without the name lookup, for a location returned by getPassUniformLocation.
+	void setPassUniform(unsigned int passIndex, GLuint location, const RenderUniformEntry & uniform);
+
+	/// Location of a uniform in the pass at passIndex, -1 if the pass doesn't use it.
+	/// Locations stay valid until the renderer is initialized again.
+	int getPassUniformLocation(unsigned int passIndex, StringId uniformName) const;
+
 	/// Remove a uniform mapping previously set.
 	void removePassUniform(StringId passName, StringId uniformName);
 
@@ -120,6 +137,12 @@ public:
 	/// Turn a specific pass on or off.
 	void setPassEnabled(StringId passName, bool enable);
 	bool getPassEnabled(StringId passName) const;
+	bool getPassEnabled(unsigned int passIndex) const;
+
+	/// Keep the static models of the pass at passIndex in a cache, see RenderPass::setStaticCacheEnabled.
+	void setPassStaticCacheEnabled(unsigned int passIndex, bool enable);
+	bool getPassStaticCacheValid(unsigned int passIndex) const;
+	void invalidatePassStaticCache(unsigned int passIndex);
 
 	/// Get user-defined fields for a pass.
 	const std::map <std::string, std::string> & getUserDefinedFields(StringId passName) const;
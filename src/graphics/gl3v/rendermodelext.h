@@ -42,6 +42,8 @@ public:
 
 	virtual ~RenderModelExt();
 	virtual void draw(GLWrapper & gl) const;
+	/// The vertex array draw uses, lets the renderer group draws sharing it.
+	virtual GLuint getVertexArray() const;
 	bool drawEnabled() const;
 	void setVertexArrayObject(GLuint newVao, unsigned int newElementCount);
 
@@ -85,6 +87,11 @@ inline void RenderModelExt::draw(GLWrapper & gl) const
 	gl.drawGeometry(vao, elementCount);
 }
 
+inline GLuint RenderModelExt::getVertexArray() const
+{
+	return vao;
+}
+
 inline bool RenderModelExt::drawEnabled() const
 {
 	return enabled;
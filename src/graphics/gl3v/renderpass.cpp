@@ -18,6 +18,8 @@
 /************************************************************************/
 
 #include <unordered_set>
+#include <algorithm>
+#include <sstream>
 #include <cassert>
 
 #include "utils.h"
@@ -37,8 +39,17 @@ RenderPass::RenderPass() :
 	clearDepth(1),
 	clearStencil(0),
 	shaderProgram(0),
+	shaderProgramPending(false),
+	shaderProgramCache(0),
+	shaderProgramKey(0),
 	framebufferObject(0),
 	renderbuffer(0),
+	staticCacheEnabled(false),
+	staticCacheValid(false),
+	staticCacheFramebuffer(0),
+	staticCacheMask(0),
+	sortDrawStream(false),
+	drawStamp(0),
 	passIndex(0),
 	timerQuery(0),
 	lastTime(-1)
@@ -46,7 +57,7 @@ RenderPass::RenderPass() :
 	// Constructor.
 }
 
-bool RenderPass::initialize(int passCount, const RealtimeExportPassInfo & config, StringIdMap & stringMap, GLWrapper & gl, RenderShader & vertexShader, RenderShader & fragmentShader, const NameTexMap & sharedTextures, unsigned int w, unsigned int h, std::ostream & errorOutput)
+bool RenderPass::initialize(int passCount, const RealtimeExportPassInfo & config, StringIdMap & stringMap, GLWrapper & gl, RenderShader & vertexShader, RenderShader & fragmentShader, const NameTexMap & sharedTextures, unsigned int w, unsigned int h, std::ostream & errorOutput, ShaderCache * shaderCache)
 {
 	originalConfiguration = config;
 
@@ -75,30 +86,12 @@ bool RenderPass::initialize(int passCount, const RealtimeExportPassInfo & config
 		drawGroups.insert(stringMap.addStringId(dg));
 
 	// The shader program.
-	if (!createShaderProgram(gl, config.shaderAttributeBindings, vertexShader, fragmentShader, config.renderTargets, errorOutput))
+	if (!createShaderProgram(gl, config.shaderAttributeBindings, vertexShader, fragmentShader, config.renderTargets, shaderCache, errorOutput))
 	{
 		errorOutput << "Unable to create shader program" << std::endl;
 		return false;
 	}
 
-	// Uniforms.
-	// TODO: Optimize.
-	for (const auto & uniform : config.uniforms)
-	{
-		// Attempt to find a location for the uniform.
-		std::string uniformName = uniform.first;
-		GLint uniformLocation = gl.GetUniformLocation(shaderProgram, uniformName);
-		if (uniformLocation != -1)
-		{
-			variableNameToUniformLocation[stringMap.addStringId(uniformName)] = uniformLocation;
-
-			// If the uniform data in the renderpassinfo isn't empty, then that means it has default data and we need to add it to our defaultUniformBindings.
-			const std::vector <float> & uniformData = uniform.second.data;
-			if (!uniformData.empty())
-				defaultUniformBindings.push_back(RenderUniform(uniformLocation,uniformData));
-		}
-	}
-
 	// Render states.
 	for (const auto & s : config.stateEnable)
 		stateEnable.push_back(GLEnumHelper.getEnum(s));
@@ -111,6 +104,13 @@ bool RenderPass::initialize(int passCount, const RealtimeExportPassInfo & config
 	for (const auto & s : config.stateEnum)
 		stateEnum.push_back(RenderState(GLEnumHelper.getEnum(s.first), s.second, GLEnumHelper));
 
+	// Blended or depth-test-free passes (like the 2D overlays) rely on their draw order, everything else can be sorted by state.
+	bool blend = std::find(stateEnable.begin(), stateEnable.end(), GL_BLEND) != stateEnable.end();
+	for (const auto & s : stateEnablei)
+		blend = blend || s.first == GL_BLEND;
+	bool depthTest = std::find(stateEnable.begin(), stateEnable.end(), GL_DEPTH_TEST) != stateEnable.end();
+	sortDrawStream = depthTest && !blend;
+
 	// We must get the uniform location for the sampler name, then upload a uniform corresponding to the TU we want to use.
 	for (const auto & s : config.samplers)
 	{
@@ -135,17 +135,6 @@ bool RenderPass::initialize(int passCount, const RealtimeExportPassInfo & config
 			sampler.addState(RenderState(GLEnumHelper.getEnum(state.first), state.second, GLEnumHelper));
 		samplers.push_back(sampler);
 
-		// Find the sampler's uniform location, then upload the TU.
-		// TODO: Optimize.
-		GLint samplerLocation = gl.GetUniformLocation(shaderProgram, samplerName);
-		if (samplerLocation != -1)
-		{
-			gl.UseProgram(shaderProgram);
-			std::vector <int> tuvec;
-			tuvec.push_back(tu);
-			gl.applyUniform(samplerLocation, tuvec);
-		}
-
 		// Fill default textures from passed-in shared textures.
 		// Fexture bindings that can be overridden (or not) by specific models.
 		auto defaultTexIter = sharedTextures.find(stringMap.addStringId(textureName));
@@ -189,6 +178,59 @@ bool RenderPass::initialize(int passCount, const RealtimeExportPassInfo & config
 	return true;
 }
 
+bool RenderPass::finishInitialize(StringIdMap & stringMap, GLWrapper & gl, std::ostream & errorOutput)
+{
+	if (!shaderProgramPending)
+		return true;
+
+	shaderProgramPending = false;
+	if (!gl.checkShaderProgram(shaderProgram, errorOutput))
+	{
+		errorOutput << "Unable to create shader program" << std::endl;
+		return false;
+	}
+
+	if (shaderProgramCache)
+		shaderProgramCache->Save(shaderProgram, shaderProgramKey);
+	shaderProgramCache = 0;
+
+	// Uniforms.
+	// TODO: Optimize.
+	for (const auto & uniform : originalConfiguration.uniforms)
+	{
+		// Attempt to find a location for the uniform.
+		std::string uniformName = uniform.first;
+		GLint uniformLocation = gl.GetUniformLocation(shaderProgram, uniformName);
+		if (uniformLocation != -1)
+		{
+			variableNameToUniformLocation[stringMap.addStringId(uniformName)] = uniformLocation;
+
+			// If the uniform data in the renderpassinfo isn't empty, then that means it has default data and we need to add it to our defaultUniformBindings.
+			const std::vector <float> & uniformData = uniform.second.data;
+			if (!uniformData.empty())
+				defaultUniformBindings.push_back(RenderUniform(uniformLocation,uniformData));
+		}
+	}
+
+	// Find the sampler uniform locations, then upload the TUs assigned by initialize.
+	// TODO: Optimize.
+	GLuint tu = 0;
+	for (const auto & s : originalConfiguration.samplers)
+	{
+		GLint samplerLocation = gl.GetUniformLocation(shaderProgram, s.first);
+		if (samplerLocation != -1)
+		{
+			gl.UseProgram(shaderProgram);
+			std::vector <int> tuvec;
+			tuvec.push_back(tu);
+			gl.applyUniform(samplerLocation, tuvec);
+		}
+		tu++;
+	}
+
+	return true;
+}
+
 void RenderPass::clear(GLWrapper & gl)
 {
 	// Delete the FBO, renderbuffers, and render targets.
@@ -233,8 +275,10 @@ void RenderPass::clear(GLWrapper & gl)
 	configured = false;
 }
 
-bool RenderPass::render(GLWrapper & gl, unsigned int w, unsigned int h, StringIdMap & stringMap, const std::vector <const std::vector <RenderModelExt*>*> & externalModels, const NameTexMap & sharedTextures, std::ostream & errorOutput)
+bool RenderPass::render(GLWrapper & gl, unsigned int w, unsigned int h, StringIdMap & stringMap, const std::vector <const std::vector <RenderModelExt*>*> & externalModels, const std::vector <const std::vector <RenderModelExt*>*> & staticModels, const NameTexMap & sharedTextures, std::ostream & errorOutput)
 {
+	stats = RenderPassStats();
+
 	if (!enabled)
 		return false;
 
@@ -288,23 +332,20 @@ bool RenderPass::render(GLWrapper & gl, unsigned int w, unsigned int h, StringId
 	for (const auto & s : stateEnum)
 		s.apply(gl);
 
-	// Clear.
-	// We do this here so our write masks will have already been applied.
-	gl.ClearColor(clearColor[0],clearColor[1],clearColor[2],clearColor[3]);
-	gl.ClearDepth(clearDepth);
-	gl.ClearStencil(clearStencil);
-	gl.Clear(clearMask);
-
-	// Apply default uniforms.
-	std::vector <const RenderUniform*> defaultUniforms; // Indexed by location, either NULL or a pointer to the RenderUniform bound to the location.
+	// Apply default uniforms, keeping track of which uniforms are in which locations.
+	uniformSlots.clear();
 	for (const auto & u : defaultUniformBindings)
 	{
-		defaultUniforms.resize(std::max(defaultUniforms.size(),(size_t)(u.location+1)),NULL);
-		defaultUniforms[u.location] = &u;
+		if (uniformSlots.size() <= u.location)
+			uniformSlots.resize(u.location + 1);
+		uniformSlots[u.location].defaultUniform = &u;
+		uniformSlots[u.location].bound = &u;
 		gl.applyUniform(u.location, u.data);
+		stats.uniformUpdates++;
 	}
 
 	// Apply samplers.
+	textureSlots.assign(samplers.size(), TextureSlot());
 	for (GLuint tu = 0; tu < samplers.size(); tu++)
 	{
 		samplers[tu].apply(gl);
@@ -312,203 +353,55 @@ bool RenderPass::render(GLWrapper & gl, unsigned int w, unsigned int h, StringId
 		// TODO: replace GL_TEXTURE_2D with the sampler's target (need to add target to the sampler's data).
 		gl.ActiveTexture(tu);
 		gl.unbindTexture(GL_TEXTURE_2D);
+		textureSlots[tu].target = GL_TEXTURE_2D;
+		textureSlots[tu].known = true;
 	}
 
 	// Apply default textures, keeping track of which textures are in which TUs.
-	std::vector <const RenderTexture*> defaultTextures; // Indexed by TU, either NULL or a pointer to the RenderTexture bound to the TU.
 	for (const auto & t : defaultTextureBindings)
 	{
-		defaultTextures.resize(std::max(defaultTextures.size(),(size_t)(t.tu+1)),NULL);
-		defaultTextures[t.tu] = &t;
-		applyTexture(gl, t);
+		if (textureSlots.size() <= t.tu)
+			textureSlots.resize(t.tu + 1);
+		textureSlots[t.tu].defaultTexture = &t;
+		setTexture(gl, t.tu, t);
 	}
 
-	typedef std::vector <GLuint> override_tracking_type;
-	std::vector <const RenderTextureBase*> textureState(defaultTextures.begin(), defaultTextures.end()); //Indexed by tu.
-	textureState.resize(std::max(textureState.size(),samplers.size()),NULL);
-	std::vector <const RenderUniformBase*> uniformState(defaultUniforms.begin(), defaultUniforms.end()); //Indexed by location.
+	lastOverriddenTextures.clear();
+	lastOverriddenUniforms.clear();
+	drawStamp = 0;
 
-	override_tracking_type overriddenTextures;
-	override_tracking_type lastOverriddenTextures;
-	override_tracking_type overriddenUniforms;
-	override_tracking_type lastOverriddenUniforms;
+	// Clear.
+	// We do this here so our write masks will have already been applied.
+	gl.ClearColor(clearColor[0],clearColor[1],clearColor[2],clearColor[3]);
+	gl.ClearDepth(clearDepth);
+	gl.ClearStencil(clearStencil);
 
-	// For each model.
-	for (const auto & m : models)
+	// Restore the static models from the cache, redrawing them into it first if needed.
+	// A recreated framebuffer comes with an empty cache, while staticModels may have been left
+	// empty because the cache was valid before. Draw that frame uncached and fill the cache next frame.
+	GLbitfield restoredMask = 0;
+	if (staticCacheMask && !changed)
 	{
-		// Apply texture overrides, keeping track of which TUs we've overridden.
-		overriddenTextures.clear();
-		for (const auto & texture : m.textureBindingOverrides)
+		if (!staticCacheValid)
 		{
-			overriddenTextures.push_back(texture.tu);
-
-			applyTexture(gl, texture);
+			gl.BindFramebuffer(staticCacheFramebuffer);
+			gl.Clear(clearMask);
+			compileDrawStream(staticModels, NULL, false);
+			emitDrawStream(gl);
+			gl.BindFramebuffer(framebufferObject);
+			staticCacheValid = true;
 		}
 
-		// Apply uniform overrides, keeping track of which locations we've overridden.
-		overriddenUniforms.clear();
-		for (const auto & uniform : m.uniformOverrides)
-		{
-			overriddenUniforms.push_back(uniform.location);
-
-			gl.applyUniform(uniform.location, uniform.data);
-		}
-
-		// Draw geometry.
-		gl.drawGeometry(m.vao, m.elementCount);
-
-		// Restore overridden uniforms.
-		for (auto location : overriddenUniforms)
-		{
-			if (location < defaultUniforms.size())
-			{
-				const RenderUniform * u = defaultUniforms[location];
-				if (u)
-					gl.applyUniform(u->location, u->data);
-			}
-		}
-
-		// Restore overridden textures.
-		for (auto tu : overriddenTextures)
-		{
-			if (tu < defaultTextures.size()) // Sometimes we override sampler TUs that don't have defaults defined (think of diffuse textures).
-			{
-				const RenderTexture * t = defaultTextures[tu];
-				if (t)
-					applyTexture(gl, *t);
-			}
-		}
+		gl.BindReadFramebuffer(staticCacheFramebuffer);
+		gl.BlitFramebuffer(width, height, staticCacheMask);
+		gl.BindReadFramebuffer(0);
+		restoredMask = staticCacheMask;
 	}
+	gl.Clear(clearMask & ~restoredMask);
 
-	// For each external model.
-	for (auto drawGroup : externalModels)
-	{
-		// Loop through all models in the draw group.
-		for (auto m : *drawGroup)
-		{
-			assert(m);
-
-			if (m->drawEnabled())
-			{
-				// Restore textures that were overridden the by the previous model.
-				for (auto tu : lastOverriddenTextures)
-					if (tu < defaultTextures.size()) // Sometimes we override sampler TUs that don't have defaults defined (think of diffuse textures).
-						textureState[tu] = defaultTextures[tu];
-					else
-						textureState[tu] = NULL;
-
-				// Apply texture overrides, keeping track of which TUs we've overridden.
-				overriddenTextures.clear();
-
-				// Check if we have cached information and if so use that.
-#ifdef USE_EXTERNAL_MODEL_CACHE
-				if (m->perPassTextureCache.size() > passIndex)
-				{
-					for (const auto & t : m->perPassTextureCache[passIndex])
-					{
-						// Get the TU associated with this texture name id.
-						GLuint tu = t.tu;
-						overriddenTextures.push_back(tu);
-						textureState[tu] = &t;
-					}
-				}
-				else
-#endif
-				{
-					for (const auto & t : m->textures)
-					{
-						// Get the TU associated with this texture name id.
-						auto tui = textureNameToTextureUnit.find(t.name);
-						if (tui != textureNameToTextureUnit.end()) // if the texture isn't used in this pass, it might not be in textureNameToTextureUnit.
-						{
-							GLuint tu = tui->second;
-							overriddenTextures.push_back(tu);
-							textureState[tu] = &t;
-#ifdef USE_EXTERNAL_MODEL_CACHE
-							m->perPassTextureCache[passIndex].push_back(RenderTexture(tu, t)); // Make cache entry.
-#endif
-						}
-					}
-				}
-
-				// Go through and actually apply the textures to the GL.
-				for (auto tu : lastOverriddenTextures)
-				{
-					const RenderTextureBase * texture = textureState[tu];
-					if (texture)
-						applyTexture(gl, tu, texture->target, texture->handle);
-				}
-				for (auto tu : overriddenTextures)
-				{
-					const RenderTextureBase * texture = textureState[tu];
-
-					// We shouldn't need to null-check texture.
-					applyTexture(gl, tu, texture->target, texture->handle);
-				}
-
-				lastOverriddenTextures.swap(overriddenTextures);
-
-				// Restore uniforms that were overridden the by the previous model.
-				for (auto location : lastOverriddenUniforms)
-					if (location < defaultUniforms.size())
-					{
-						const RenderUniform * u = defaultUniforms[location];
-						uniformState[u->location] = u;
-					}
-
-				// Apply uniform overrides, keeping track of which locations we've overridden.
-				overriddenUniforms.clear();
-
-				// Check if we have cached information and if so use that.
-#ifdef USE_EXTERNAL_MODEL_CACHE
-				if (m->perPassUniformCache.size() > passIndex)
-				{
-					for (const auto & u : m->perPassUniformCache[passIndex])
-					{
-						GLuint location = u.location;
-						overriddenUniforms.push_back(location);
-						uniformState[location] = &u;
-					}
-				}
-				else
-#endif
-				{
-					for (const auto & u : m->uniforms)
-					{
-						auto loci = variableNameToUniformLocation.find(u.name);
-						if (loci != variableNameToUniformLocation.end()) // If the texture isn't used in this pass, it might not be in variableNameToUniformLocation.
-						{
-							GLuint location = loci->second;
-							overriddenUniforms.push_back(location);
-							uniformState[location] = &u;
-#ifdef USE_EXTERNAL_MODEL_CACHE
-							m->perPassUniformCache[passIndex].push_back(RenderUniform(location, u)); // Make cache entry.
-#endif
-						}
-					}
-				}
-
-				// Go through and actually apply the uniforms to the GL.
-				for (auto location : lastOverriddenUniforms)
-				{
-					const RenderUniformBase * uniform = uniformState[location];
-					if (uniform)
-						gl.applyUniform(location, uniform->data);
-				}
-				for (auto location : overriddenUniforms)
-				{
-					const RenderUniformBase * uniform = uniformState[location];
-					//if (uniform) // TODO: Review this...
-						gl.applyUniform(location, uniform->data);
-				}
-
-				lastOverriddenUniforms.swap(overriddenUniforms);
-
-				// Draw geometry.
-				m->draw(gl);
-			}
-		}
-	}
+	// Draw the internal and external models.
+	compileDrawStream(externalModels, restoredMask ? NULL : &staticModels, true);
+	emitDrawStream(gl);
 
 	// Unbind framebuffer.
 	gl.unbindFramebuffer();
@@ -728,25 +621,36 @@ bool RenderPass::setDefaultUniform(const RenderUniformEntry & uniform)
 	auto locIter = variableNameToUniformLocation.find(uniform.name);
 	if (locIter != variableNameToUniformLocation.end())
 	{
-		GLuint location = locIter->second;
-
-		// Scan defaultUniformBindings to see if there's an existing uniform with a location that corresponds to this name id.
-		for (auto & u : defaultUniformBindings)
-			if (u.location == location)
-			{
-				// Overwrite the existing entry, then return.
-				u = RenderUniform(location, uniform);
-				return true;
-			}
-
-		// If we've gotten here, we don't have an existing entry. Make one!
-		defaultUniformBindings.push_back(RenderUniform(location, uniform));
+		setDefaultUniform(locIter->second, uniform);
 		return true;
 	}
 
 	return false;
 }
 
+void RenderPass::setDefaultUniform(GLuint location, const RenderUniformEntry & uniform)
+{
+	// Scan defaultUniformBindings to see if there's an existing uniform with this location.
+	for (auto & u : defaultUniformBindings)
+		if (u.location == location)
+		{
+			// Overwrite the existing entry, then return.
+			u = RenderUniform(location, uniform);
+			return;
+		}
+
+	// If we've gotten here, we don't have an existing entry. Make one!
+	defaultUniformBindings.push_back(RenderUniform(location, uniform));
+}
+
+int RenderPass::getUniformLocation(StringId name) const
+{
+	auto locIter = variableNameToUniformLocation.find(name);
+	if (locIter != variableNameToUniformLocation.end())
+		return locIter->second;
+	return -1;
+}
+
 void RenderPass::removeDefaultUniform(StringId name)
 {
 	// See if we have a mapping for this name id.
@@ -999,6 +903,32 @@ float RenderPass::getLastTime() const
 	return lastTime;
 }
 
+const RenderPassStats & RenderPass::getLastStats() const
+{
+	return stats;
+}
+
+void RenderPass::setStaticCacheEnabled(GLWrapper & gl, bool enable)
+{
+	staticCacheEnabled = enable;
+
+	// Without a framebuffer yet, the cache is created along with it on the first render.
+	if (enable && framebufferObject != 0)
+		createStaticCache(gl);
+	else if (!enable)
+		deleteStaticCache(gl);
+}
+
+bool RenderPass::getStaticCacheValid() const
+{
+	return staticCacheMask && staticCacheValid;
+}
+
+void RenderPass::invalidateStaticCache()
+{
+	staticCacheValid = false;
+}
+
 bool RenderPass::createFramebufferObject(GLWrapper & gl, unsigned int w, unsigned int h, StringIdMap & stringMap, const NameTexMap & sharedTextures, std::ostream & errorOutput)
 {
 	deleteFramebufferObject(gl);
@@ -1070,6 +1000,9 @@ bool RenderPass::createFramebufferObject(GLWrapper & gl, unsigned int w, unsigne
 
 		// Attach the renderbuffer.
 		gl.FramebufferRenderbuffer(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, renderbuffer);
+
+		FramebufferAttachment depth = {GL_DEPTH_ATTACHMENT, GL_DEPTH_COMPONENT24, width, height};
+		framebufferAttachments.push_back(depth);
 	}
 
 	// Create and attach color and depth render targets.
@@ -1137,6 +1070,9 @@ bool RenderPass::createFramebufferObject(GLWrapper & gl, unsigned int w, unsigne
 		// Only 2d render targets are supported.
 		GLenum target = GL_TEXTURE_2D;
 
+		FramebufferAttachment attachment = {attachmentPoint, internalFormat, rtWidth, rtHeight};
+		framebufferAttachments.push_back(attachment);
+
 		StringId renderTargetNameId = stringMap.addStringId(rt.second.name);
 
 		// Either use an existing render target texture or create a new one.
@@ -1195,11 +1131,17 @@ bool RenderPass::createFramebufferObject(GLWrapper & gl, unsigned int w, unsigne
 
 	gl.unbindFramebuffer();
 
+	if (staticCacheEnabled)
+		createStaticCache(gl);
+
 	return true;
 }
 
 void RenderPass::deleteFramebufferObject(GLWrapper & gl)
 {
+	deleteStaticCache(gl);
+	framebufferAttachments.clear();
+
 	if (framebufferObject != 0)
 		gl.deleteFramebufferObject(framebufferObject);
 	framebufferObject = 0;
@@ -1218,13 +1160,73 @@ void RenderPass::deleteFramebufferObject(GLWrapper & gl)
 	externalRenderTargets.clear();
 }
 
-bool RenderPass::createShaderProgram(GLWrapper & gl, const std::vector <std::string> & shaderAttributeBindings, const RenderShader & vertexShader, const RenderShader & fragmentShader, const std::map <std::string, RealtimeExportPassInfo::RenderTargetInfo> & renderTargets, std::ostream & errorOutput)
+void RenderPass::createStaticCache(GLWrapper & gl)
 {
-	deleteShaderProgram(gl);
+	deleteStaticCache(gl);
 
-	std::vector <GLuint> shaderHandles;
-	shaderHandles.push_back(vertexShader.handle);
-	shaderHandles.push_back(fragmentShader.handle);
+	// The cache replaces the clear, and a blit can only copy a single color buffer.
+	int colorAttachments = 0;
+	bool colorAttachment0 = false;
+	for (const auto & a : framebufferAttachments)
+	{
+		if (a.attachment != GL_DEPTH_ATTACHMENT)
+			colorAttachments++;
+		colorAttachment0 = colorAttachment0 || a.attachment == GL_COLOR_ATTACHMENT0;
+	}
+	if (framebufferObject == 0 || !(clearMask & GL_DEPTH_BUFFER_BIT))
+		return;
+	if (colorAttachments > 1 || (colorAttachments == 1 && (!colorAttachment0 || !(clearMask & GL_COLOR_BUFFER_BIT))))
+		return;
+
+	// Mirror the pass's attachments with renderbuffers, we only ever blit from them.
+	staticCacheFramebuffer = gl.GenFramebuffer();
+	gl.BindFramebufferWithoutValidation(staticCacheFramebuffer);
+	for (const auto & a : framebufferAttachments)
+	{
+		GLuint cacheRenderbuffer = gl.GenRenderbuffer();
+		gl.BindRenderbuffer(GL_RENDERBUFFER, cacheRenderbuffer);
+		gl.RenderbufferStorage(GL_RENDERBUFFER, a.internalFormat, a.width, a.height);
+		gl.FramebufferRenderbuffer(GL_DRAW_FRAMEBUFFER, a.attachment, GL_RENDERBUFFER, cacheRenderbuffer);
+		staticCacheRenderbuffers.push_back(cacheRenderbuffer);
+	}
+
+	// Depth only framebuffers need their draw and read buffers disabled to be complete.
+	GLenum colorBuffer = colorAttachments ? GL_COLOR_ATTACHMENT0 : GL_NONE;
+	gl.DrawBuffers(1, &colorBuffer);
+	gl.BindReadFramebuffer(staticCacheFramebuffer);
+	gl.ReadBuffer(colorBuffer);
+	gl.BindReadFramebuffer(0);
+
+	// Calling BindFramebuffer will do validation for us, on failure the pass simply stays uncached.
+	bool complete = gl.BindFramebuffer(staticCacheFramebuffer);
+	gl.unbindFramebuffer();
+	if (!complete)
+	{
+		deleteStaticCache(gl);
+		return;
+	}
+
+	staticCacheMask = GL_DEPTH_BUFFER_BIT | (colorAttachments ? GL_COLOR_BUFFER_BIT : 0);
+	staticCacheValid = false;
+}
+
+void RenderPass::deleteStaticCache(GLWrapper & gl)
+{
+	if (staticCacheFramebuffer != 0)
+		gl.deleteFramebufferObject(staticCacheFramebuffer);
+	staticCacheFramebuffer = 0;
+
+	for (auto rb : staticCacheRenderbuffers)
+		gl.deleteRenderbuffer(rb);
+	staticCacheRenderbuffers.clear();
+
+	staticCacheMask = 0;
+	staticCacheValid = false;
+}
+
+bool RenderPass::createShaderProgram(GLWrapper & gl, const std::vector <std::string> & shaderAttributeBindings, RenderShader & vertexShader, RenderShader & fragmentShader, const std::map <std::string, RealtimeExportPassInfo::RenderTargetInfo> & renderTargets, ShaderCache * shaderCache, std::ostream & errorOutput)
+{
+	deleteShaderProgram(gl);
 
 	// Bind render target variable names to frag data locations.
 	std::map <GLuint, std::string> fragDataLocations;
@@ -1241,7 +1243,56 @@ bool RenderPass::createShaderProgram(GLWrapper & gl, const std::vector <std::str
 			fragDataLocations[colorNumber] = rt.second.variable;
 		}
 
-	return gl.linkShaderProgram(shaderAttributeBindings, shaderHandles, shaderProgram, fragDataLocations, errorOutput);
+	// Try the program binary cache before compiling anything.
+	ShaderCache::Key cacheKey = 0;
+	if (shaderCache && shaderCache->Enabled())
+	{
+		std::vector <std::string> inputs;
+		inputs.push_back(vertexShader.source);
+		inputs.push_back(fragmentShader.source);
+		inputs.push_back(Utils::implode(shaderAttributeBindings, " "));
+		for (const auto & location : fragDataLocations)
+			inputs.push_back(location.second);
+		cacheKey = shaderCache->GetKey(inputs);
+
+		shaderProgram = gl.CreateProgram();
+		if (shaderCache->Load(shaderProgram, cacheKey))
+			return true;
+		deleteShaderProgram(gl);
+	}
+	else
+		shaderCache = 0;
+
+	if (!compileShader(gl, vertexShader, originalConfiguration.vertexShader, errorOutput) ||
+		!compileShader(gl, fragmentShader, originalConfiguration.fragmentShader, errorOutput))
+		return false;
+
+	std::vector <GLuint> shaderHandles;
+	shaderHandles.push_back(vertexShader.handle);
+	shaderHandles.push_back(fragmentShader.handle);
+
+	// The link status is queried by finishInitialize, so the driver can link all passes concurrently.
+	gl.submitShaderProgram(shaderAttributeBindings, shaderHandles, shaderProgram, fragDataLocations, shaderCache != 0);
+	shaderProgramPending = true;
+	shaderProgramCache = shaderCache;
+	shaderProgramKey = cacheKey;
+
+	return true;
+}
+
+bool RenderPass::compileShader(GLWrapper & gl, RenderShader & shader, const std::string & name, std::ostream & errorOutput)
+{
+	if (shader.handle)
+		return true;
+
+	std::ostringstream shaderOutput;
+	if (!gl.createAndCompileShader(shader.source, shader.type, shader.handle, shaderOutput))
+	{
+		errorOutput << "Unable to compile shader " << name << ":\n" << shaderOutput.str() << std::endl;
+		return false;
+	}
+
+	return true;
 }
 
 void RenderPass::deleteShaderProgram(GLWrapper & gl)
@@ -1249,6 +1300,226 @@ void RenderPass::deleteShaderProgram(GLWrapper & gl)
 	if (shaderProgram != 0)
 		gl.DeleteProgram(shaderProgram);
 	shaderProgram = 0;
+	shaderProgramPending = false;
+	shaderProgramCache = 0;
+}
+
+void RenderPass::compileDrawStream(const std::vector <const std::vector <RenderModelExt*>*> & externalModels, const std::vector <const std::vector <RenderModelExt*>*> * moreModels, bool internalModels)
+{
+	drawStream.clear();
+	drawTextures.clear();
+	drawUniforms.clear();
+
+	DrawItem item;
+	item.key = 0;
+
+	// Internal models carry their overrides already resolved.
+	item.externalModel = NULL;
+	for (const auto & m : models)
+	{
+		if (!internalModels)
+			break;
+
+		item.internalModel = &m;
+		item.vao = m.vao;
+
+		item.texturesBegin = drawTextures.size();
+		for (const auto & t : m.textureBindingOverrides)
+			drawTextures.push_back(std::make_pair(t.tu, &t));
+		item.texturesEnd = drawTextures.size();
+
+		item.uniformsBegin = drawUniforms.size();
+		for (const auto & u : m.uniformOverrides)
+			drawUniforms.push_back(std::make_pair(u.location, &u));
+		item.uniformsEnd = drawUniforms.size();
+
+		item.order = drawStream.size();
+		drawStream.push_back(item);
+	}
+
+	// External models refer to textures and uniforms by name.
+	item.internalModel = NULL;
+	const unsigned int externalDrawGroups = externalModels.size() + (moreModels ? moreModels->size() : 0);
+	for (unsigned int g = 0; g < externalDrawGroups; g++)
+	{
+		const std::vector <RenderModelExt*> * drawGroup = (g < externalModels.size()) ? externalModels[g] : (*moreModels)[g - externalModels.size()];
+		for (auto m : *drawGroup)
+		{
+			assert(m);
+
+			if (!m->drawEnabled())
+				continue;
+
+			item.externalModel = m;
+			item.vao = m->getVertexArray();
+
+			item.texturesBegin = drawTextures.size();
+			// Check if we have cached information and if so use that.
+#ifdef USE_EXTERNAL_MODEL_CACHE
+			if (m->perPassTextureCache.size() > passIndex)
+			{
+				for (const auto & t : m->perPassTextureCache[passIndex])
+					drawTextures.push_back(std::make_pair(t.tu, &t));
+			}
+			else
+#endif
+			{
+				for (const auto & t : m->textures)
+				{
+					// Get the TU associated with this texture name id.
+					auto tui = textureNameToTextureUnit.find(t.name);
+					if (tui != textureNameToTextureUnit.end()) // if the texture isn't used in this pass, it might not be in textureNameToTextureUnit.
+					{
+						drawTextures.push_back(std::make_pair(tui->second, &t));
+#ifdef USE_EXTERNAL_MODEL_CACHE
+						m->perPassTextureCache[passIndex].push_back(RenderTexture(tui->second, t)); // Make cache entry.
+#endif
+					}
+				}
+			}
+			item.texturesEnd = drawTextures.size();
+
+			item.uniformsBegin = drawUniforms.size();
+#ifdef USE_EXTERNAL_MODEL_CACHE
+			if (m->perPassUniformCache.size() > passIndex)
+			{
+				for (const auto & u : m->perPassUniformCache[passIndex])
+					drawUniforms.push_back(std::make_pair(u.location, &u));
+			}
+			else
+#endif
+			{
+				for (const auto & u : m->uniforms)
+				{
+					auto loci = variableNameToUniformLocation.find(u.name);
+					if (loci != variableNameToUniformLocation.end()) // If the uniform isn't used in this pass, it might not be in variableNameToUniformLocation.
+					{
+						drawUniforms.push_back(std::make_pair(loci->second, &u));
+#ifdef USE_EXTERNAL_MODEL_CACHE
+						m->perPassUniformCache[passIndex].push_back(RenderUniform(loci->second, u)); // Make cache entry.
+#endif
+					}
+				}
+			}
+			item.uniformsEnd = drawUniforms.size();
+
+			item.order = drawStream.size();
+			drawStream.push_back(item);
+		}
+	}
+
+	if (!sortDrawStream)
+		return;
+
+	// The shader program is fixed for the pass, so draws are keyed by their texture set and then their VAO.
+	// Uniforms are left out, they are mostly per model (transforms) and would only split up the texture runs.
+	for (auto & d : drawStream)
+	{
+		uint32_t hash = 2166136261u;
+		for (unsigned int i = d.texturesBegin; i < d.texturesEnd; i++)
+		{
+			hash = (hash ^ drawTextures[i].first) * 16777619u;
+			hash = (hash ^ drawTextures[i].second->handle) * 16777619u;
+		}
+		d.key = (uint64_t(hash) << 32) | d.vao;
+	}
+	std::sort(drawStream.begin(), drawStream.end());
+}
+
+void RenderPass::emitDrawStream(GLWrapper & gl)
+{
+	GLuint lastVao = 0;
+	for (unsigned int i = 0; i < drawStream.size(); i++)
+	{
+		const DrawItem & d = drawStream[i];
+		const unsigned int stamp = ++drawStamp;
+
+		// Apply this draw's texture overrides.
+		overriddenTextures.clear();
+		for (unsigned int n = d.texturesBegin; n < d.texturesEnd; n++)
+		{
+			GLuint tu = drawTextures[n].first;
+			setTexture(gl, tu, *drawTextures[n].second);
+			textureSlots[tu].stamp = stamp;
+			overriddenTextures.push_back(tu);
+		}
+
+		// Restore the defaults of TUs the previous draw overrode and this one doesn't.
+		// Sometimes we override sampler TUs that don't have defaults defined (think of diffuse textures), those keep whatever was bound.
+		for (auto tu : lastOverriddenTextures)
+		{
+			const TextureSlot & slot = textureSlots[tu];
+			if (slot.stamp != stamp && slot.defaultTexture)
+				setTexture(gl, tu, *slot.defaultTexture);
+		}
+		lastOverriddenTextures.swap(overriddenTextures);
+
+		// Same for uniforms.
+		overriddenUniforms.clear();
+		for (unsigned int n = d.uniformsBegin; n < d.uniformsEnd; n++)
+		{
+			GLuint location = drawUniforms[n].first;
+			setUniform(gl, location, *drawUniforms[n].second);
+			uniformSlots[location].stamp = stamp;
+			overriddenUniforms.push_back(location);
+		}
+		for (auto location : lastOverriddenUniforms)
+		{
+			const UniformSlot & slot = uniformSlots[location];
+			if (slot.stamp != stamp && slot.defaultUniform)
+				setUniform(gl, location, *slot.defaultUniform);
+		}
+		lastOverriddenUniforms.swap(overriddenUniforms);
+
+		// Draw geometry.
+		// The VAO binding itself is left to the draw call, GLWrapper skips it if it's already bound.
+		if (i == 0 || d.vao != lastVao)
+			stats.vertexArrayChanges++;
+		lastVao = d.vao;
+
+		if (d.externalModel)
+			d.externalModel->draw(gl);
+		else
+			gl.drawGeometry(d.internalModel->vao, d.internalModel->elementCount);
+		stats.draws++;
+	}
+}
+
+void RenderPass::setTexture(GLWrapper & gl, GLuint tu, const RenderTextureBase & texture)
+{
+	if (textureSlots.size() <= tu)
+		textureSlots.resize(tu + 1);
+
+	TextureSlot & slot = textureSlots[tu];
+	if (slot.known && slot.handle == texture.handle && slot.target == texture.target)
+	{
+		stats.redundantChanges++;
+		return;
+	}
+
+	applyTexture(gl, tu, texture.target, texture.handle);
+	slot.target = texture.target;
+	slot.handle = texture.handle;
+	slot.known = true;
+	stats.textureBinds++;
+}
+
+void RenderPass::setUniform(GLWrapper & gl, GLuint location, const RenderUniformBase & uniform)
+{
+	if (uniformSlots.size() <= location)
+		uniformSlots.resize(location + 1);
+
+	// Only compare the source, GLWrapper's uniform cache catches equal values coming from different models.
+	UniformSlot & slot = uniformSlots[location];
+	if (slot.bound == &uniform)
+	{
+		stats.redundantChanges++;
+		return;
+	}
+
+	gl.applyUniform(location, uniform.data);
+	slot.bound = &uniform;
+	stats.uniformUpdates++;
 }
 
 void RenderPass::applyTexture(GLWrapper & gl, const RenderTexture & texture)
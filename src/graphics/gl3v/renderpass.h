@@ -36,8 +36,10 @@
 #include "renderuniformentry.h"
 #include "renderstatusverbosity.h"
 #include "rendermodelext.h"
+#include "shader_cache.h"
 
 #include <unordered_map>
+#include <cstdint>
 #include <vector>
 #include <iosfwd>
 #include <string>
@@ -47,6 +49,29 @@
 typedef std::unordered_map <StringId, RenderTextureEntry, StringId::hash> NameTexMap;
 typedef std::unordered_map <StringId, unsigned int, StringId::hash> NameIdMap;
 
+/// State change counters for one frame of a pass.
+struct RenderPassStats
+{
+	unsigned int draws;
+	unsigned int textureBinds;
+	unsigned int uniformUpdates;
+	unsigned int vertexArrayChanges;
+	/// Texture and uniform changes that weren't issued because the slot already held the value.
+	unsigned int redundantChanges;
+
+	RenderPassStats() : draws(0), textureBinds(0), uniformUpdates(0), vertexArrayChanges(0), redundantChanges(0) {}
+
+	RenderPassStats & operator+=(const RenderPassStats & other)
+	{
+		draws += other.draws;
+		textureBinds += other.textureBinds;
+		uniformUpdates += other.uniformUpdates;
+		vertexArrayChanges += other.vertexArrayChanges;
+		redundantChanges += other.redundantChanges;
+		return *this;
+	}
+};
+
 class RenderPass
 {
 public:
@@ -58,7 +83,13 @@ public:
 	/// The provided GLWrapper will be used for OpenGL context.
 	/// The provided StringIdMap will be used to convert strings into unique numeric IDs.
 	/// w and h are the width and height of the application's window and will be used to initialize FBOs.
-	bool initialize(int passCount, const RealtimeExportPassInfo & config, StringIdMap & stringMap, GLWrapper & gl, RenderShader & vertexShader, RenderShader & fragmentShader, const std::unordered_map <StringId, RenderTextureEntry, StringId::hash> & sharedTextures, unsigned int w, unsigned int h, std::ostream & errorOutput);
+	/// The shader cache is optional, shaders are compiled as needed if the cache misses.
+	/// The shader program is only submitted for linking, call finishInitialize before using the pass.
+	bool initialize(int passCount, const RealtimeExportPassInfo & config, StringIdMap & stringMap, GLWrapper & gl, RenderShader & vertexShader, RenderShader & fragmentShader, const std::unordered_map <StringId, RenderTextureEntry, StringId::hash> & sharedTextures, unsigned int w, unsigned int h, std::ostream & errorOutput, ShaderCache * shaderCache = 0);
+
+	/// Checks the link status and looks up the uniform and sampler locations of the shader program.
+	/// This waits for the driver to finish linking, so call it once all passes have been initialized.
+	bool finishInitialize(StringIdMap & stringMap, GLWrapper & gl, std::ostream & errorOutput);
 
 	/// Prepare for destruction by cleaning up any resources that we are using.
 	void clear(GLWrapper & gl);
@@ -67,7 +98,8 @@ public:
 	/// w and h are the width and height of the application's window.
 	/// Returns true if the framebuffer dimensions have changed, which is a signal that the render targets have been recreated.
 	/// externalModels is a map of draw group name ID to a vector array of pointers to external models to be drawn along with models that have been added to the pass with addModel.
-	bool render(GLWrapper & gl, unsigned int w, unsigned int h, StringIdMap & stringMap, const std::vector <const std::vector <RenderModelExt*>*> & externalModels, const std::unordered_map <StringId, RenderTextureEntry, StringId::hash> & sharedTextures, std::ostream & errorOutput);
+	/// staticModels are drawn like externalModels, unless the static cache is enabled, see setStaticCacheEnabled.
+	bool render(GLWrapper & gl, unsigned int w, unsigned int h, StringIdMap & stringMap, const std::vector <const std::vector <RenderModelExt*>*> & externalModels, const std::vector <const std::vector <RenderModelExt*>*> & staticModels, const std::unordered_map <StringId, RenderTextureEntry, StringId::hash> & sharedTextures, std::ostream & errorOutput);
 
 	// These functions handle modifications to the models container.
 	void addModel(const RenderModelEntry & entry, RenderModelHandle handle);
@@ -87,6 +119,12 @@ public:
 	bool setDefaultUniform(const RenderUniformEntry & uniform);
 	void removeDefaultUniform(StringId name);
 
+	// Same as setDefaultUniform, without the name lookup. The location comes from getUniformLocation.
+	void setDefaultUniform(GLuint location, const RenderUniformEntry & uniform);
+
+	// Returns the uniform's location in the pass's shader program, or -1 if the program doesn't use it.
+	int getUniformLocation(StringId name) const;
+
 	const std::string & getName() const;
 	StringId getNameId() const;
 
@@ -103,13 +141,90 @@ public:
 
 	float getLastTime() const;
 
+	/// State changes issued during the last rendered frame.
+	const RenderPassStats & getLastStats() const;
+
+	/// The static cache keeps a copy of the pass's depth (and color) buffer holding only the static models.
+	/// While the cache is valid, render restores the copy instead of clearing and only draws the other models on top.
+	/// Only passes that clear depth and have at most a single color attachment can be cached, the others keep drawing everything.
+	void setStaticCacheEnabled(GLWrapper & gl, bool enable);
+
+	/// Returns true if the next render will reuse the static cache, staticModels are ignored in that case.
+	/// If that render has to recreate the framebuffer, it draws staticModels uncached and leaves the cache invalid.
+	bool getStaticCacheValid() const;
+
+	/// Forces the static models to be redrawn into the cache, to be called when they or the pass camera change.
+	void invalidateStaticCache();
+
 private:
+	/// One draw of the stream compiled by compileDrawStream.
+	/// Exactly one of internalModel and externalModel is set.
+	struct DrawItem
+	{
+		const RenderModel * internalModel;
+		const RenderModelExt * externalModel;
+		GLuint vao;
+		/// Texture set hash in the high bits, VAO in the low bits.
+		uint64_t key;
+		/// Submission order, breaks ties so the sort is deterministic.
+		unsigned int order;
+		// Ranges in drawTextures and drawUniforms.
+		unsigned int texturesBegin, texturesEnd;
+		unsigned int uniformsBegin, uniformsEnd;
+
+		bool operator<(const DrawItem & other) const
+		{
+			return key < other.key || (key == other.key && order < other.order);
+		}
+	};
+
+	/// What we know about a TU while emitting the draw stream.
+	struct TextureSlot
+	{
+		const RenderTexture * defaultTexture;
+		GLenum target;
+		GLuint handle;
+		unsigned int stamp; ///< drawStamp of the last draw that overrode the TU.
+		bool known; ///< False until we've bound something to the TU in this pass.
+
+		TextureSlot() : defaultTexture(NULL), target(0), handle(0), stamp(0), known(false) {}
+	};
+
+	/// What we know about a uniform location while emitting the draw stream.
+	struct UniformSlot
+	{
+		const RenderUniform * defaultUniform;
+		const RenderUniformBase * bound;
+		unsigned int stamp; ///< drawStamp of the last draw that overrode the location.
+
+		UniformSlot() : defaultUniform(NULL), bound(NULL), stamp(0) {}
+	};
+
+	/// Gathers the internal (if requested) and external models into drawStream, with their texture and uniform overrides resolved to TUs and locations.
+	/// moreModels is optional and is appended to externalModels.
+	/// The stream is sorted by texture set and VAO when the draw order doesn't affect the result.
+	void compileDrawStream(const std::vector <const std::vector <RenderModelExt*>*> & externalModels, const std::vector <const std::vector <RenderModelExt*>*> * moreModels, bool internalModels);
+
+	/// Issues the draw stream, only touching the TUs and uniform locations whose contents change between consecutive draws.
+	void emitDrawStream(GLWrapper & gl);
+
+	/// Binds the texture unless the TU already holds it.
+	void setTexture(GLWrapper & gl, GLuint tu, const RenderTextureBase & texture);
+
+	/// Uploads the uniform unless the location already holds it.
+	void setUniform(GLWrapper & gl, GLuint location, const RenderUniformBase & uniform);
+
 	/// Returns true on success.
 	bool createFramebufferObject(GLWrapper & gl, unsigned int w, unsigned int h, StringIdMap & stringMap, const NameTexMap & sharedTextures, std::ostream & errorOutput);
 	void deleteFramebufferObject(GLWrapper & gl);
 
+	/// Creates the static cache framebuffer mirroring framebufferAttachments, if the pass can be cached.
+	void createStaticCache(GLWrapper & gl);
+	void deleteStaticCache(GLWrapper & gl);
+
 	/// Returns true on success.
-	bool createShaderProgram(GLWrapper & gl, const std::vector <std::string> & shaderAttributeBindings, const RenderShader & vertexShader, const RenderShader & fragmentShader, const std::map <std::string, RealtimeExportPassInfo::RenderTargetInfo> & renderTargets, std::ostream & errorOutput);
+	bool createShaderProgram(GLWrapper & gl, const std::vector <std::string> & shaderAttributeBindings, RenderShader & vertexShader, RenderShader & fragmentShader, const std::map <std::string, RealtimeExportPassInfo::RenderTargetInfo> & renderTargets, ShaderCache * shaderCache, std::ostream & errorOutput);
+	bool compileShader(GLWrapper & gl, RenderShader & shader, const std::string & name, std::ostream & errorOutput);
 	void deleteShaderProgram(GLWrapper & gl);
 
 	/// Switches to the texture's TU and binds the texture.
@@ -145,6 +260,11 @@ private:
 
 	/// The shader program.
 	GLuint shaderProgram;
+	/// Set while the program link status hasn't been queried yet.
+	bool shaderProgramPending;
+	/// Where to store the program binary once it is known to be linked, if anywhere.
+	ShaderCache * shaderProgramCache;
+	ShaderCache::Key shaderProgramKey;
 
 	// Variables that can be overridden (or not) by specific models.
 	std::vector <RenderUniform> defaultUniformBindings;
@@ -166,12 +286,44 @@ private:
 	std::map <StringId, RenderTexture> renderTargets; // The key is the render target name loaded from the RealtimeExportPassInfo.
 	std::map <StringId, RenderTexture> externalRenderTargets; // The key is the render target name loaded from the RealtimeExportPassInfo.
 
+	/// Attachments of framebufferObject, remembered so the static cache can mirror them.
+	struct FramebufferAttachment
+	{
+		GLenum attachment;
+		GLenum internalFormat;
+		unsigned int width, height;
+	};
+	std::vector <FramebufferAttachment> framebufferAttachments;
+
+	// Static cache.
+	bool staticCacheEnabled;
+	bool staticCacheValid;
+	GLuint staticCacheFramebuffer;
+	std::vector <GLuint> staticCacheRenderbuffers;
+	GLbitfield staticCacheMask; // Buffers restored from the cache instead of being cleared, zero if the pass isn't cached.
+
 	/// Samplers.
 	std::vector <RenderSampler> samplers;
 
 	/// Draw groups.
 	std::set <StringId> drawGroups;
 
+	/// Set if the pass depth tests and doesn't blend, so the draw order only affects performance.
+	bool sortDrawStream;
+
+	// The draw stream and the state tracking used to emit it.
+	// They are rebuilt every frame, but are kept around to reuse their memory.
+	std::vector <DrawItem> drawStream;
+	std::vector <std::pair <GLuint, const RenderTextureBase*> > drawTextures;
+	std::vector <std::pair <GLuint, const RenderUniformBase*> > drawUniforms;
+	std::vector <TextureSlot> textureSlots; // Indexed by TU.
+	std::vector <UniformSlot> uniformSlots; // Indexed by location.
+	std::vector <GLuint> overriddenTextures;
+	std::vector <GLuint> lastOverriddenTextures;
+	std::vector <GLuint> overriddenUniforms;
+	std::vector <GLuint> lastOverriddenUniforms;
+	unsigned int drawStamp; // Counts the draws of the frame.
+
 	/// Our index in the renderer's list of passes.
 	unsigned int passIndex;
 
@@ -182,6 +334,9 @@ private:
 	GLuint timerQuery;
 	/// Timing query object.
 	float lastTime;
+
+	/// State change counters of the last frame.
+	RenderPassStats stats;
 };
 
 #endif
@@ -24,9 +24,12 @@
 #include <string>
 
 /// The bare minimum required to attach a shader to a shader program
+/// The shader is compiled lazily, only when a program using it misses the shader cache
 struct RenderShader
 {
 	GLuint handle;
+	GLenum type;
+	std::string source;
 
 	// for debug only
 	std::set <std::string> defines;
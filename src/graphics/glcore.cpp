@@ -65,6 +65,11 @@ static PROC WinGetProcAddress(const char *name)
 int GLC_EXT_texture_compression_s3tc = GLC_LOAD_FAILED;
 int GLC_EXT_texture_sRGB = GLC_LOAD_FAILED;
 int GLC_EXT_texture_filter_anisotropic = GLC_LOAD_FAILED;
+int GLC_ARB_get_program_binary = GLC_LOAD_FAILED;
+int GLC_ARB_parallel_shader_compile = GLC_LOAD_FAILED;
+int GLC_KHR_parallel_shader_compile = GLC_LOAD_FAILED;
+int GLC_ARB_sync = GLC_LOAD_FAILED;
+int GLC_ARB_timer_query = GLC_LOAD_FAILED;
 int GLC_ARB_vertex_array_object = GLC_LOAD_FAILED;
 int GLC_ARB_framebuffer_object = GLC_LOAD_FAILED;
 int GLC_ARB_half_float_pixel = GLC_LOAD_FAILED;
@@ -72,6 +77,42 @@ int GLC_ARB_texture_float = GLC_LOAD_FAILED;
 int GLC_ARB_texture_rectangle = GLC_LOAD_FAILED;
 int GLC_ARB_multisample = GLC_LOAD_FAILED;
 
+void (CODEGEN_FUNCPTR *_ptrc_glGetProgramBinary)(GLuint, GLsizei, GLsizei *, GLenum *, GLvoid *) = NULL;
+void (CODEGEN_FUNCPTR *_ptrc_glProgramBinary)(GLuint, GLenum, const GLvoid *, GLsizei) = NULL;
+void (CODEGEN_FUNCPTR *_ptrc_glProgramParameteri)(GLuint, GLenum, GLint) = NULL;
+
+static int Load_ARB_get_program_binary(void)
+{
+	int numFailed = 0;
+	_ptrc_glGetProgramBinary = (void (CODEGEN_FUNCPTR *)(GLuint, GLsizei, GLsizei *, GLenum *, GLvoid *))IntGetProcAddress("glGetProgramBinary");
+	if(!_ptrc_glGetProgramBinary) numFailed++;
+	_ptrc_glProgramBinary = (void (CODEGEN_FUNCPTR *)(GLuint, GLenum, const GLvoid *, GLsizei))IntGetProcAddress("glProgramBinary");
+	if(!_ptrc_glProgramBinary) numFailed++;
+	_ptrc_glProgramParameteri = (void (CODEGEN_FUNCPTR *)(GLuint, GLenum, GLint))IntGetProcAddress("glProgramParameteri");
+	if(!_ptrc_glProgramParameteri) numFailed++;
+	return numFailed;
+}
+
+void (CODEGEN_FUNCPTR *_ptrc_glMaxShaderCompilerThreadsARB)(GLuint) = NULL;
+
+static int Load_ARB_parallel_shader_compile(void)
+{
+	int numFailed = 0;
+	_ptrc_glMaxShaderCompilerThreadsARB = (void (CODEGEN_FUNCPTR *)(GLuint))IntGetProcAddress("glMaxShaderCompilerThreadsARB");
+	if(!_ptrc_glMaxShaderCompilerThreadsARB) numFailed++;
+	return numFailed;
+}
+
+void (CODEGEN_FUNCPTR *_ptrc_glMaxShaderCompilerThreadsKHR)(GLuint) = NULL;
+
+static int Load_KHR_parallel_shader_compile(void)
+{
+	int numFailed = 0;
+	_ptrc_glMaxShaderCompilerThreadsKHR = (void (CODEGEN_FUNCPTR *)(GLuint))IntGetProcAddress("glMaxShaderCompilerThreadsKHR");
+	if(!_ptrc_glMaxShaderCompilerThreadsKHR) numFailed++;
+	return numFailed;
+}
+
 void (CODEGEN_FUNCPTR *_ptrc_glSampleCoverageARB)(GLfloat, GLboolean) = NULL;
 
 static int Load_ARB_multisample(void)
@@ -1140,10 +1181,15 @@ typedef struct glcStrToExtMap_s
 	PFN_LOADFUNCPOINTERS LoadExtension;
 } glcStrToExtMap;
 
-static glcStrToExtMap ExtensionMap[9] = {
+static glcStrToExtMap ExtensionMap[14] = {
 	{"GL_EXT_texture_compression_s3tc", &GLC_EXT_texture_compression_s3tc, NULL},
 	{"GL_EXT_texture_sRGB", &GLC_EXT_texture_sRGB, NULL},
 	{"GL_EXT_texture_filter_anisotropic", &GLC_EXT_texture_filter_anisotropic, NULL},
+	{"GL_ARB_get_program_binary", &GLC_ARB_get_program_binary, Load_ARB_get_program_binary},
+	{"GL_ARB_parallel_shader_compile", &GLC_ARB_parallel_shader_compile, Load_ARB_parallel_shader_compile},
+	{"GL_KHR_parallel_shader_compile", &GLC_KHR_parallel_shader_compile, Load_KHR_parallel_shader_compile},
+	{"GL_ARB_sync", &GLC_ARB_sync, NULL},
+	{"GL_ARB_timer_query", &GLC_ARB_timer_query, NULL},
 	{"GL_ARB_vertex_array_object", &GLC_ARB_vertex_array_object, NULL},
 	{"GL_ARB_framebuffer_object", &GLC_ARB_framebuffer_object, NULL},
 	{"GL_ARB_half_float_pixel", &GLC_ARB_half_float_pixel, NULL},
@@ -1152,8 +1198,8 @@ static glcStrToExtMap ExtensionMap[9] = {
 	{"GL_ARB_multisample", &GLC_ARB_multisample, Load_ARB_multisample},
 };
 
-static int g_extensionMapSizeCore = 3;
-static int g_extensionMapSize = 9;
+static int g_extensionMapSizeCore = 8;
+static int g_extensionMapSize = 14;
 
 static glcStrToExtMap *FindExtEntry(const char *extensionName, int extensionMapSize)
 {
@@ -1173,6 +1219,11 @@ static void ClearExtensionVars(void)
 	GLC_EXT_texture_compression_s3tc = GLC_LOAD_FAILED;
 	GLC_EXT_texture_sRGB = GLC_LOAD_FAILED;
 	GLC_EXT_texture_filter_anisotropic = GLC_LOAD_FAILED;
+	GLC_ARB_get_program_binary = GLC_LOAD_FAILED;
+	GLC_ARB_parallel_shader_compile = GLC_LOAD_FAILED;
+	GLC_KHR_parallel_shader_compile = GLC_LOAD_FAILED;
+	GLC_ARB_sync = GLC_LOAD_FAILED;
+	GLC_ARB_timer_query = GLC_LOAD_FAILED;
 	GLC_ARB_vertex_array_object = GLC_LOAD_FAILED;
 	GLC_ARB_framebuffer_object = GLC_LOAD_FAILED;
 	GLC_ARB_half_float_pixel = GLC_LOAD_FAILED;
@@ -147,6 +147,11 @@ extern "C" {
 extern int GLC_EXT_texture_compression_s3tc;
 extern int GLC_EXT_texture_sRGB;
 extern int GLC_EXT_texture_filter_anisotropic;
+extern int GLC_ARB_get_program_binary;
+extern int GLC_ARB_parallel_shader_compile;
+extern int GLC_KHR_parallel_shader_compile;
+extern int GLC_ARB_sync;
+extern int GLC_ARB_timer_query;
 extern int GLC_ARB_vertex_array_object;
 extern int GLC_ARB_framebuffer_object;
 extern int GLC_ARB_half_float_pixel;
@@ -179,6 +184,30 @@ extern int GLC_ARB_multisample;
 #define GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT 0x84FF
 #define GL_TEXTURE_MAX_ANISOTROPY_EXT 0x84FE
 
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#define GL_PROGRAM_BINARY_FORMATS 0x87FF
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+
+#define GL_COMPLETION_STATUS_ARB 0x91B1
+#define GL_MAX_SHADER_COMPILER_THREADS_ARB 0x91B0
+
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+
+extern void (CODEGEN_FUNCPTR *_ptrc_glGetProgramBinary)(GLuint, GLsizei, GLsizei *, GLenum *, GLvoid *);
+#define glGetProgramBinary _ptrc_glGetProgramBinary
+extern void (CODEGEN_FUNCPTR *_ptrc_glProgramBinary)(GLuint, GLenum, const GLvoid *, GLsizei);
+#define glProgramBinary _ptrc_glProgramBinary
+extern void (CODEGEN_FUNCPTR *_ptrc_glProgramParameteri)(GLuint, GLenum, GLint);
+#define glProgramParameteri _ptrc_glProgramParameteri
+
+extern void (CODEGEN_FUNCPTR *_ptrc_glMaxShaderCompilerThreadsARB)(GLuint);
+#define glMaxShaderCompilerThreadsARB _ptrc_glMaxShaderCompilerThreadsARB
+
+extern void (CODEGEN_FUNCPTR *_ptrc_glMaxShaderCompilerThreadsKHR)(GLuint);
+#define glMaxShaderCompilerThreadsKHR _ptrc_glMaxShaderCompilerThreadsKHR
+
 /* GL 2 compat */
 #define GL_COMPARE_R_TO_TEXTURE 0x884E
 #define GL_GENERATE_MIPMAP 0x8191
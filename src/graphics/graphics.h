@@ -28,6 +28,7 @@
 #include <vector>
 
 class SceneNode;
+class TextureStreamer;
 
 /// an abstract base class that defines the graphics interface
 /// expects a valid OpenGL context with initialized extension entry points (glewInit)
@@ -38,6 +39,7 @@ public:
 	/// returns true on success
 	virtual bool Init(
 		const std::string & shaderpath,
+		const std::string & shadercachepath,
 		unsigned resx, unsigned resy,
 		unsigned antialiasing,
 		bool enableshadows, int shadow_distance,
@@ -105,6 +107,9 @@ public:
 
 	virtual void printProfilingInfo(std::ostream & /*out*/) const { }
 
+	/// report the screen size of visible textures to the streamer while culling, null to stop
+	virtual void SetTextureStreamer(TextureStreamer * /*streamer*/) {};
+
 	virtual ~Graphics() {}
 };
 
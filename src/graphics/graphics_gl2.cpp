@@ -27,6 +27,7 @@
 #include "frustumcull.h"
 #include "model.h"
 #include "sky.h"
+#include "texturestreamer.h"
 #include "tokenize.h"
 
 /// array end ptr
@@ -202,7 +203,8 @@ GraphicsGL2::GraphicsGL2() :
 	postprocess(vertex_buffer, screen_quad),
 	light_direction(1,1,1),
 	sky_dynamic(false),
-	fixed_skybox(true)
+	fixed_skybox(true),
+	texture_streamer(NULL)
 {
 	const unsigned int faces[2 * 3] = {
 		0, 1, 2,
@@ -233,6 +235,7 @@ GraphicsGL2::~GraphicsGL2()
 
 bool GraphicsGL2::Init(
 	const std::string & newshaderpath,
+	const std::string & shadercachepath,
 	unsigned resx, unsigned resy,
 	unsigned antialiasing,
 	bool enableshadows, int new_shadow_distance,
@@ -291,6 +294,8 @@ bool GraphicsGL2::Init(
 
 	ChangeDisplay(resx, resy, error_output);
 
+	shader_cache.Init(shadercachepath, info_output);
+
 	if (GLC_EXT_texture_filter_anisotropic)
 		glGetIntegerv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &max_anisotropy);
 	info_output << "Maximum anisotropy: " << max_anisotropy << std::endl;
@@ -395,8 +400,7 @@ void GraphicsGL2::BindStaticVertexData(std::vector<SceneNode*> nodes)
 
 void GraphicsGL2::AddDynamicNode(SceneNode & node)
 {
-	Mat4 identity;
-	node.Traverse(dynamic_draw_lists, identity);
+	dynamic_scenes.Add(node);
 }
 
 void GraphicsGL2::AddStaticNode(SceneNode & node)
@@ -408,7 +412,7 @@ void GraphicsGL2::AddStaticNode(SceneNode & node)
 
 void GraphicsGL2::ClearDynamicDrawables()
 {
-	dynamic_draw_lists.clear();
+	dynamic_scenes.Clear();
 }
 
 void GraphicsGL2::ClearStaticDrawables()
@@ -425,6 +429,8 @@ void GraphicsGL2::SetupScene(
 {
 	SetupCameras(fov, new_view_distance, cam_position, cam_rotation, dynamic_reflection_sample_pos);
 
+	dynamic_scenes.GetDrawList(dynamic_draw_lists);
+
 	// sort the two dimentional drawlist so we get correct ordering
 	std::sort(dynamic_draw_lists.twodim.begin(), dynamic_draw_lists.twodim.end(), &SortDraworder);
 
@@ -523,6 +529,11 @@ void GraphicsGL2::SetLocalTimeSpeed(float value)
 		sky->SetTimeSpeed(value);
 }
 
+void GraphicsGL2::SetTextureStreamer(TextureStreamer * streamer)
+{
+	texture_streamer = streamer;
+}
+
 GraphicsState & GraphicsGL2::GetState()
 {
 	return glstate;
@@ -621,6 +632,7 @@ bool GraphicsGL2::EnableShaders(std::ostream & info_output, std::ostream & error
 	CheckForOpenGLErrors("EnableShaders: FBO deinit", error_output);
 
 	dynamic_draw_lists.clear();
+	dynamic_scenes.Invalidate();
 	static_draw_lists.clear();
 	culled_draw_lists.clear();
 	passes.clear();
@@ -816,18 +828,23 @@ bool GraphicsGL2::SetupFrameBufferObjectsAndShaders(std::ostream & info_output,
 			defines.insert(defines.end(), global_defines.begin(), global_defines.end());
 
 			Shader & shader = shaders[cs->name];
-			if (!shader.Load(
+			shader.BeginLoad(
 				glsl_330, outputs.size(),
 				shaderpath + "/" + cs->vertex,
 				shaderpath + "/" + cs->fragment,
-				defines, uniforms, attributes,
-				info_output, error_output))
-			{
-				return false;
-			}
+				defines, attributes,
+				error_output, &shader_cache);
 		}
 	}
-	return true;
+
+	// all shaders are submitted, wait for the driver to finish them
+	bool shaders_loaded = true;
+	for (auto & shader : shaders)
+	{
+		if (!shader.second.EndLoad(uniforms, info_output, error_output))
+			shaders_loaded = false;
+	}
+	return shaders_loaded;
 }
 
 void GraphicsGL2::SetupCameras(
@@ -979,6 +996,7 @@ bool GraphicsGL2::InitScenePass(
 	pass.clear_color = pass_config.clear_color;
 	pass.postprocess = (pass_config.draw.back() == "postprocess");
 	pass.cull = pass_config.cull;
+	pass.shadow_caster = (pass_config.camera.compare(0, 8, "shadows_") == 0);
 
 	// set textures
 	GetScenePassInputTextures(pass_config.inputs, pass.textures);
@@ -1078,6 +1096,18 @@ void GraphicsGL2::CullScenePass(
 	// for each pass, we have which camera and which draw layer to use
 	// we want to do culling for each unique camera and draw layer combination
 	auto & output = *pass.output;
+
+	// shadow casters only matter if their shadow can reach the default camera's view
+	Frustum receivers;
+	float receivers_ct = 0;
+	const GraphicsCamera * view = NULL;
+	if (pass.shadow_caster)
+	{
+		view = &cameras["default"];
+		receivers.Extract(GetProjMatrix(*view).GetArray(), GetViewMatrix(*view).GetArray());
+		receivers_ct = ContributionCullThreshold(view->h, view->fov * float(M_PI/180));
+	}
+
 	int cubesides = (output.IsFBO() && output.RenderToFBO().IsCubemap()) ? 6 : 1;
 	for (int cubeside = 0; cubeside < cubesides; cubeside++)
 	{
@@ -1119,6 +1149,23 @@ void GraphicsGL2::CullScenePass(
 						if (!cull(drawable->GetCenter(), drawable->GetRadius()))
 							draw_list.drawables.push_back(drawable);
 					}
+
+					if (texture_streamer)
+						RequestTextures(draw_list.drawables, cam, 0.5f * height / std::tan(0.5f * fov));
+				}
+				else if (view)
+				{
+					auto cull = MakeShadowCasterCuller(frustum.frustum, receivers.frustum, -light_direction, view->pos, receivers_ct);
+
+					// cull static drawlist
+					pass.static_draw_lists[i]->Query(cull, draw_list.drawables);
+
+					// cull dynamic drawlist
+					for (const auto & drawable : *pass.dynamic_draw_lists[i])
+					{
+						if (!cull(drawable->GetCenter(), drawable->GetRadius()))
+							draw_list.drawables.push_back(drawable);
+					}
 				}
 				else
 				{
@@ -1147,11 +1194,35 @@ void GraphicsGL2::CullScenePass(
 					draw_list.drawables.end(),
 					pass.dynamic_draw_lists[i]->begin(),
 					pass.dynamic_draw_lists[i]->end());
+
+				if (texture_streamer)
+					RequestTextures(draw_list.drawables, NULL, std::max(output.GetWidth(), output.GetHeight()));
 			}
 		}
 	}
 }
 
+void GraphicsGL2::RequestTextures(
+	const PtrVector<Drawable> & drawables,
+	const GraphicsCamera * cam,
+	float pixel_scale)
+{
+	for (const auto & drawable : drawables)
+	{
+		float pixels = pixel_scale;
+		if (cam)
+		{
+			const float radius = drawable->GetRadius();
+			const float distance = std::max((drawable->GetCenter() - cam->pos).Magnitude(), radius);
+			if (distance > 0)
+				pixels = 2 * radius * pixel_scale / distance;
+		}
+		texture_streamer->Request(drawable->GetTexture0(), pixels);
+		texture_streamer->Request(drawable->GetTexture1(), pixels);
+		texture_streamer->Request(drawable->GetTexture2(), pixels);
+	}
+}
+
 void GraphicsGL2::DrawScenePass(
 	const GraphicsPass & pass,
 	std::ostream & error_output)
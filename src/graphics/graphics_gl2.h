@@ -26,9 +26,11 @@
 #include "texture.h"
 #include "aabb_tree_adapter.h"
 #include "drawable_container.h"
+#include "flatscene.h"
 #include "render_input_postprocess.h"
 #include "render_input_scene.h"
 #include "render_output.h"
+#include "shader_cache.h"
 #include "vertexarray.h"
 #include "vertexbuffer.h"
 
@@ -49,6 +51,7 @@ public:
 	/// returns true on success
 	virtual bool Init(
 		const std::string & shaderpath,
+		const std::string & shadercachepath,
 		unsigned resx, unsigned resy,
 		unsigned antialiasing,
 		bool enableshadows, int shadow_distance,
@@ -107,6 +110,8 @@ public:
 
 	virtual void SetLocalTimeSpeed(float value);
 
+	virtual void SetTextureStreamer(TextureStreamer * streamer);
+
 	// Allow external code to use gl state manager.
 	GraphicsState & GetState();
 
@@ -155,6 +160,7 @@ private:
 	// shaders
 	typedef std::map <std::string, Shader> ShaderMap;
 	ShaderMap shaders;
+	ShaderCache shader_cache;
 
 	// vertex data buffer
 	VertexBuffer vertex_buffer;
@@ -167,6 +173,7 @@ private:
 	template <typename T> class PtrVector : public std::vector<T*> {};
 	typedef DrawableContainer <PtrVector> DynamicDrawables;
 	DynamicDrawables dynamic_draw_lists; //used for objects that move or change
+	FlatSceneSet dynamic_scenes; //rebuilds dynamic_draw_lists only if the dynamic nodes changed
 
 	typedef DrawableContainer<AabbTreeNodeAdapter> StaticDrawables;
 	StaticDrawables static_draw_lists; //used for objects that will never change
@@ -218,6 +225,7 @@ private:
 		bool clear_color;
 		bool postprocess;
 		bool cull;
+		bool shadow_caster; ///< cull against the default camera's view extended toward the light
 	};
 	std::vector<GraphicsPass> passes;
 
@@ -225,6 +233,7 @@ private:
 	std::shared_ptr<Sky> sky;
 	bool sky_dynamic;
 	bool fixed_skybox;
+	TextureStreamer * texture_streamer;
 
 
 	void ChangeDisplay(
@@ -270,6 +279,13 @@ private:
 		const GraphicsPass & pass,
 		std::ostream & error_output);
 
+	/// report the screen size of the drawables' textures to the streamer
+	/// pixel_scale converts size over distance to pixels, without a camera it is the screen size
+	void RequestTextures(
+		const PtrVector<Drawable> & drawables,
+		const GraphicsCamera * cam,
+		float pixel_scale);
+
 	void DrawScenePass(
 		const GraphicsPass & pass,
 		std::ostream & error_output);
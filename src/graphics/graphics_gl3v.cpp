@@ -22,7 +22,7 @@
 #include "joeserialize.h"
 #include "frustumcull.h"
 #include "model.h"
-#include "utils.h"
+#include "texturestreamer.h"
 
 #include <unordered_map>
 #include <sstream>
@@ -30,6 +30,7 @@
 #include <map>
 #include <algorithm>
 #include <cctype>
+#include <cstdlib>
 
 GraphicsGL3::GraphicsGL3(StringIdMap & map) :
 	stringMap(map),
@@ -38,13 +39,23 @@ GraphicsGL3::GraphicsGL3(StringIdMap & map) :
 	logNextGlFrame(false),
 	initialized(false),
 	fixed_skybox(true),
+	textureStreamer(NULL),
+	cameras(CAMERA_COUNT),
+	staticShadowsChanged(true),
 	closeshadow(5.f)
 {
+	for (unsigned i = 0; i < CAMERA_COUNT - CAMERA_SHADOW; i++)
+	{
+		staticShadowsStable[i] = 0;
+		staticShadowsViewCulled[i] = false;
+	}
+
 	// initialize the full screen quad
 	fullscreenquadVertices.SetTo2DQuad(0,0,1,1, 0,1,1,0, 0);
 	fullscreenquad.SetVertArray(&fullscreenquadVertices);
 
 	initDrawableAttributes(drawAttribs, stringMap);
+	initUniformIds(uniformIds, stringMap);
 }
 
 GraphicsGL3::~GraphicsGL3()
@@ -54,6 +65,7 @@ GraphicsGL3::~GraphicsGL3()
 
 bool GraphicsGL3::Init(
 	const std::string & shader_path,
+	const std::string & shader_cache_path,
 	unsigned resx,
 	unsigned resy,
 	unsigned antialiasing,
@@ -85,6 +97,8 @@ bool GraphicsGL3::Init(
 		return false;
 	}
 
+	shader_cache.Init(shader_cache_path, info_output);
+
 	#ifdef _WIN32
 	// workaround for broken vao implementation Intel/Windows
 	{
@@ -156,8 +170,7 @@ void GraphicsGL3::BindStaticVertexData(std::vector<SceneNode*> nodes)
 
 void GraphicsGL3::AddDynamicNode(SceneNode & node)
 {
-	Mat4 identity;
-	node.Traverse(dynamic_drawlist, identity);
+	dynamic_scenes.Add(node);
 }
 
 void GraphicsGL3::AddStaticNode(SceneNode & node)
@@ -165,19 +178,21 @@ void GraphicsGL3::AddStaticNode(SceneNode & node)
 	Mat4 identity;
 	node.Traverse(static_drawlist, identity);
 	static_drawlist.ForEach(OptimizeFunctor());
+	staticShadowsChanged = true;
 }
 
 void GraphicsGL3::ClearDynamicDrawables()
 {
-	dynamic_drawlist.clear();
+	dynamic_scenes.Clear();
 }
 
 void GraphicsGL3::ClearStaticDrawables()
 {
 	static_drawlist.clear();
+	staticShadowsChanged = true;
 }
 
-GraphicsGL3::CameraMatrices & GraphicsGL3::setCameraPerspective(const std::string & name,
+void GraphicsGL3::setCameraPerspective(CameraMatrices & matrices,
 	const Vec3 & position,
 	const Quat & rotation,
 	float fov,
@@ -186,8 +201,6 @@ GraphicsGL3::CameraMatrices & GraphicsGL3::setCameraPerspective(const std::strin
 	float w,
 	float h)
 {
-	CameraMatrices & matrices = cameras[name];
-
 	// generate view matrix
 	rotation.GetMatrix4(matrices.viewMatrix);
 	Vec3 rotated_cam_position = position;
@@ -202,18 +215,14 @@ GraphicsGL3::CameraMatrices & GraphicsGL3::setCameraPerspective(const std::strin
 
 	// generate inverse view matrix
 	matrices.inverseViewMatrix = matrices.viewMatrix.Inverse();
-
-	return matrices;
 }
 
-GraphicsGL3::CameraMatrices & GraphicsGL3::setCameraOrthographic(const std::string & name,
+void GraphicsGL3::setCameraOrthographic(CameraMatrices & matrices,
 	const Vec3 & position,
 	const Quat & rotation,
 	const Vec3 & orthoMin,
 	const Vec3 & orthoMax)
 {
-	CameraMatrices & matrices = cameras[name];
-
 	// generate view matrix
 	rotation.GetMatrix4(matrices.viewMatrix);
 	Vec3 rotated_cam_position = position;
@@ -228,8 +237,6 @@ GraphicsGL3::CameraMatrices & GraphicsGL3::setCameraOrthographic(const std::stri
 
 	// generate inverse projection matrix
 	matrices.inverseProjectionMatrix = matrices.projectionMatrix.Inverse();
-
-	return matrices;
 }
 
 void GraphicsGL3::SetupScene(
@@ -243,7 +250,8 @@ void GraphicsGL3::SetupScene(
 
 	const float nearDistance = 0.1;
 
-	setCameraPerspective("default",
+	const CameraMatrices & defaultCamera = cameras[CAMERA_DEFAULT];
+	setCameraPerspective(cameras[CAMERA_DEFAULT],
 		cam_position,
 		cam_rotation,
 		fov,
@@ -256,7 +264,7 @@ void GraphicsGL3::SetupScene(
 	if (fixed_skybox)
 		skyboxCamPosition[2] = cam_position[2];
 
-	setCameraPerspective("skybox",
+	setCameraPerspective(cameras[CAMERA_SKYBOX],
 		skyboxCamPosition,
 		cam_rotation,
 		fov,
@@ -277,7 +285,8 @@ void GraphicsGL3::SetupScene(
 	}
 
 	// shadow cameras
-	for (int i = 0; i < 3; i++)
+	Mat4 shadowReconstruction[CAMERA_COUNT - CAMERA_SHADOW];
+	for (int i = 0; i < CAMERA_COUNT - CAMERA_SHADOW; i++)
 	{
 		//float shadow_radius = (1<<i)*closeshadow+(i)*20; //5,30,60
 		float shadow_radius = (1<<(2-i))*closeshadow+(2-i)*20;
@@ -308,59 +317,62 @@ void GraphicsGL3::SetupScene(
 		(-light_rotation).RotateVector(cameraSpaceShadowPosition);
 		shadowPosition = cameraSpaceShadowPosition;
 
-		std::string suffix = Utils::tostr(i+1);
-
-		CameraMatrices & shadowcam = setCameraOrthographic("shadow"+suffix,
+		CameraMatrices & shadowcam = cameras[CAMERA_SHADOW + i];
+		setCameraOrthographic(shadowcam,
 			shadowPosition,
 			light_rotation,
 			-shadowbox,
 			shadowbox);
 
-		std::string matrixName = "shadowMatrix";
-
-		// create and send shadow reconstruction matrices
+		// create shadow reconstruction matrices
 		// the reconstruction matrix should transform from view to world, then from world to shadow view, then from shadow view to shadow clip space
-		const CameraMatrices & defaultcam = cameras.find("default")->second;
-		Mat4 shadowReconstruction = defaultcam.inverseViewMatrix.Multiply(shadowcam.viewMatrix).Multiply(shadowcam.projectionMatrix);
-		/*//Mat4 shadowReconstruction = shadowcam.projectionMatrix.Multiply(shadowcam.viewMatrix.Multiply(defaultcam.inverseViewMatrix));
-		std::cout << "shadowcam.projectionMatrix: " << std::endl;
-		shadowcam.projectionMatrix.DebugPrint(std::cout);
-		std::cout << "defaultcam.inverseViewMatrix: " << std::endl;
-		defaultcam.inverseViewMatrix.DebugPrint(std::cout);
-		std::cout << "shadowcam.viewMatrix: " << std::endl;
-		shadowcam.viewMatrix.DebugPrint(std::cout);
-		std::cout << "defaultcam.inverseViewMatrix.Multiply(shadowcam.viewMatrix): " << std::endl;
-		defaultcam.inverseViewMatrix.Multiply(shadowcam.viewMatrix).DebugPrint(std::cout);
-		std::cout << matrixName << ":" << std::endl;
-		shadowReconstruction.DebugPrint(std::cout);*/
-
-		//renderer.setGlobalUniform(RenderUniformEntry(stringMap.addStringId(matrixName), shadowReconstruction.GetArray(),16));
-
-		// examine the user-defined fields to find out which shadow matrix to send to a pass
-		for (const auto & passName : renderer.getPassNames())
+		shadowReconstruction[i] = defaultCamera.inverseViewMatrix.Multiply(shadowcam.viewMatrix).Multiply(shadowcam.projectionMatrix);
+
+		// static casters only need to be redrawn once the snapped cascade moves
+		// or if the cache was filled with view culled casters
+		CameraMatrices & cachedcam = cachedShadowCameras[i];
+		if (staticShadowsChanged ||
+			!std::equal(shadowcam.viewMatrix.GetArray(), shadowcam.viewMatrix.GetArray() + 16, cachedcam.viewMatrix.GetArray()) ||
+			!std::equal(shadowcam.projectionMatrix.GetArray(), shadowcam.projectionMatrix.GetArray() + 16, cachedcam.projectionMatrix.GetArray()))
 		{
-			auto fields = renderer.getUserDefinedFields(passName);
-			auto field = fields.find(matrixName);
-			if (field != fields.end() && field->second == suffix)
-			{
-				renderer.setPassUniform(passName, RenderUniformEntry(stringMap.addStringId(matrixName), shadowReconstruction.GetArray(),16));
-			}
+			cachedcam = shadowcam;
+			staticShadowsStable[i] = 0;
+			InvalidateStaticShadows(CAMERA_SHADOW + i);
 		}
+		else
+		{
+			staticShadowsStable[i] = std::min(staticShadowsStable[i] + 1, unsigned(staticShadowsStableFrames));
+			if (staticShadowsViewCulled[i])
+				InvalidateStaticShadows(CAMERA_SHADOW + i);
+		}
+		staticShadowsViewCulled[i] = false;
 	}
+	staticShadowsChanged = false;
 
-	// send cameras to passes
-	for (const auto & passCam : passNameToCameraName)
+	// send cameras and shadow matrices to passes
+	for (unsigned i = 0; i < planPasses.size(); i++)
 	{
-		renderer.setPassUniform(stringMap.addStringId(passCam.first), RenderUniformEntry(stringMap.addStringId("viewMatrix"), cameras[passCam.second].viewMatrix.GetArray(),16));
-		renderer.setPassUniform(stringMap.addStringId(passCam.first), RenderUniformEntry(stringMap.addStringId("projectionMatrix"), cameras[passCam.second].projectionMatrix.GetArray(),16));
+		const PlanPass & pass = planPasses[i];
+		if (pass.camera >= 0)
+		{
+			const CameraMatrices & camera = cameras[pass.camera];
+			if (pass.uniforms.viewMatrix >= 0)
+				renderer.setPassUniform(i, pass.uniforms.viewMatrix, RenderUniformEntry(uniformIds.viewMatrix, camera.viewMatrix.GetArray(), 16));
+			if (pass.uniforms.projectionMatrix >= 0)
+				renderer.setPassUniform(i, pass.uniforms.projectionMatrix, RenderUniformEntry(uniformIds.projectionMatrix, camera.projectionMatrix.GetArray(), 16));
+		}
+		if (pass.shadowCamera >= 0 && pass.uniforms.shadowMatrix >= 0)
+		{
+			const Mat4 & shadowMatrix = shadowReconstruction[pass.shadowCamera - CAMERA_SHADOW];
+			renderer.setPassUniform(i, pass.uniforms.shadowMatrix, RenderUniformEntry(uniformIds.shadowMatrix, shadowMatrix.GetArray(), 16));
+		}
 	}
 
 	// send matrices for the default camera
-	const CameraMatrices & defaultCamera = cameras.find("default")->second;
-	renderer.setGlobalUniform(RenderUniformEntry(stringMap.addStringId("invProjectionMatrix"), defaultCamera.inverseProjectionMatrix.GetArray(),16));
-	renderer.setGlobalUniform(RenderUniformEntry(stringMap.addStringId("invViewMatrix"), defaultCamera.inverseViewMatrix.GetArray(),16));
-	renderer.setGlobalUniform(RenderUniformEntry(stringMap.addStringId("defaultViewMatrix"), defaultCamera.viewMatrix.GetArray(),16));
-	renderer.setGlobalUniform(RenderUniformEntry(stringMap.addStringId("defaultProjectionMatrix"), defaultCamera.projectionMatrix.GetArray(),16));
+	SetFrameUniform(&PlanUniforms::invProjectionMatrix, RenderUniformEntry(uniformIds.invProjectionMatrix, defaultCamera.inverseProjectionMatrix.GetArray(),16));
+	SetFrameUniform(&PlanUniforms::invViewMatrix, RenderUniformEntry(uniformIds.invViewMatrix, defaultCamera.inverseViewMatrix.GetArray(),16));
+	SetFrameUniform(&PlanUniforms::defaultViewMatrix, RenderUniformEntry(uniformIds.defaultViewMatrix, defaultCamera.viewMatrix.GetArray(),16));
+	SetFrameUniform(&PlanUniforms::defaultProjectionMatrix, RenderUniformEntry(uniformIds.defaultProjectionMatrix, defaultCamera.projectionMatrix.GetArray(),16));
 
 	// send sun light direction for the default camera
 
@@ -372,8 +384,8 @@ void GraphicsGL3::SetupScene(
 	defaultCamera.viewMatrix.MultiplyVector4(&lightDirection4[0]);
 
 	// upload to the shaders
-	RenderUniformEntry lightDirectionUniform(stringMap.addStringId("eyespaceLightDirection"), &lightDirection4[0], 3);
-	renderer.setGlobalUniform(lightDirectionUniform);
+	RenderUniformEntry lightDirectionUniform(uniformIds.eyespaceLightDirection, &lightDirection4[0], 3);
+	SetFrameUniform(&PlanUniforms::eyespaceLightDirection, lightDirectionUniform);
 
 	// set the reflection strength
 	// TODO: read this from the track definition
@@ -381,7 +393,7 @@ void GraphicsGL3::SetupScene(
 	for (int i = 0; i < 3; i++)
 		reflectedLightColor[i] = 0.5;
 	reflectedLightColor[3] = 1.;
-	renderer.setGlobalUniform(RenderUniformEntry(stringMap.addStringId("reflectedLightColor"), reflectedLightColor, 4));
+	SetFrameUniform(&PlanUniforms::reflectedLightColor, RenderUniformEntry(uniformIds.reflectedLightColor, reflectedLightColor, 4));
 
 	// set the ambient strength
 	// TODO: read this from the track definition
@@ -389,7 +401,7 @@ void GraphicsGL3::SetupScene(
 	for (int i = 0; i < 3; i++)
 		ambientLightColor[i] = 1.56;
 	ambientLightColor[3] = 1.;
-	renderer.setGlobalUniform(RenderUniformEntry(stringMap.addStringId("ambientLightColor"), ambientLightColor, 4));
+	SetFrameUniform(&PlanUniforms::ambientLightColor, RenderUniformEntry(uniformIds.ambientLightColor, ambientLightColor, 4));
 
 	// set the sun strength
 	// TODO: read this from the track definition
@@ -397,35 +409,51 @@ void GraphicsGL3::SetupScene(
 	for (int i = 0; i < 3; i++)
 		directionalLightColor[i] = 8.3;
 	directionalLightColor[3] = 1.;
-	renderer.setGlobalUniform(RenderUniformEntry(stringMap.addStringId("directionalLightColor"), directionalLightColor, 4));
+	SetFrameUniform(&PlanUniforms::directionalLightColor, RenderUniformEntry(uniformIds.directionalLightColor, directionalLightColor, 4));
 
 	AssembleDrawMap(error_output);
 }
 
-// returns empty string if no camera
-std::string GraphicsGL3::getCameraForPass(StringId pass) const
+static bool SortDraworder(Drawable * d1, Drawable * d2)
+{
+	assert(d1 && d2);
+	return (d1->GetDrawOrder() < d2->GetDrawOrder());
+}
+
+template <class Culler>
+void GraphicsGL3::AssembleDrawList(const std::vector <Drawable*> & drawables, std::vector <RenderModelExt*> & out, const Culler & cull)
 {
-	std::string passString = stringMap.getString(pass);
-	std::string cameraString;
-	auto camIter = passNameToCameraName.find(passString);
-	if (camIter != passNameToCameraName.end())
-		cameraString = camIter->second;
-	return cameraString;
+	for (auto d : drawables)
+	{
+		if (!cull(d->GetCenter(), d->GetRadius()))
+			out.push_back(&d->GenRenderModelData(drawAttribs));
+	}
 }
 
-std::string GraphicsGL3::getCameraDrawGroupKey(StringId pass, StringId group) const
+template <class Culler>
+void GraphicsGL3::AssembleDrawList(const AabbTreeNodeAdapter <Drawable> & adapter, std::vector <RenderModelExt*> & out, const Culler & cull)
 {
-	return getCameraForPass(pass)+"/"+stringMap.getString(group);
+	static std::vector <Drawable*> queryResults;
+	queryResults.clear();
+
+	adapter.Query(cull, queryResults);
+
+	for (auto d : queryResults)
+	{
+		out.push_back(&d->GenRenderModelData(drawAttribs));
+	}
 }
 
-static bool SortDraworder(Drawable * d1, Drawable * d2)
+// screen size in pixels of a drawable seen from camPos
+static float ScreenSize(const Drawable & d, const Vec3 & camPos, float pixelScale)
 {
-	assert(d1 && d2);
-	return (d1->GetDrawOrder() < d2->GetDrawOrder());
+	const float radius = d.GetRadius();
+	const float distance = std::max((d.GetCenter() - camPos).Magnitude(), radius);
+	return distance > 0 ? 2 * radius * pixelScale / distance : pixelScale;
 }
 
 // if frustum is NULL, don't do frustum or contribution culling
-void GraphicsGL3::AssembleDrawList(const std::vector <Drawable*> & drawables, std::vector <RenderModelExt*> & out, Frustum * frustum, const Vec3 & camPos)
+void GraphicsGL3::AssembleDrawList(const std::vector <Drawable*> & drawables, std::vector <RenderModelExt*> & out, Frustum * frustum, const Vec3 & camPos, float pixelScale)
 {
 	if (frustum)
 	{
@@ -434,7 +462,11 @@ void GraphicsGL3::AssembleDrawList(const std::vector <Drawable*> & drawables, st
 		for (auto d : drawables)
 		{
 			if (!cull(d->GetCenter(), d->GetRadius()))
+			{
 				out.push_back(&d->GenRenderModelData(drawAttribs));
+				if (pixelScale > 0)
+					RequestTextures(*d, ScreenSize(*d, camPos, pixelScale));
+			}
 		}
 	}
 	else
@@ -442,12 +474,14 @@ void GraphicsGL3::AssembleDrawList(const std::vector <Drawable*> & drawables, st
 		for (auto d : drawables)
 		{
 			out.push_back(&d->GenRenderModelData(drawAttribs));
+			if (pixelScale > 0)
+				RequestTextures(*d, pixelScale);
 		}
 	}
 }
 
 // if frustum is NULL, don't do frustum or contribution culling
-void GraphicsGL3::AssembleDrawList(const AabbTreeNodeAdapter <Drawable> & adapter, std::vector <RenderModelExt*> & out, Frustum * frustum, const Vec3 & camPos)
+void GraphicsGL3::AssembleDrawList(const AabbTreeNodeAdapter <Drawable> & adapter, std::vector <RenderModelExt*> & out, Frustum * frustum, const Vec3 & camPos, float pixelScale)
 {
 	static std::vector <Drawable*> queryResults;
 	queryResults.clear();
@@ -466,94 +500,261 @@ void GraphicsGL3::AssembleDrawList(const AabbTreeNodeAdapter <Drawable> & adapte
 	for (auto d : queryResults)
 	{
 		out.push_back(&d->GenRenderModelData(drawAttribs));
+		if (pixelScale > 0)
+			RequestTextures(*d, frustum ? ScreenSize(*d, camPos, pixelScale) : pixelScale);
 	}
 }
 
+void GraphicsGL3::RequestTextures(const Drawable & d, float pixels)
+{
+	textureStreamer->Request(d.GetTexture0(), pixels);
+	textureStreamer->Request(d.GetTexture1(), pixels);
+	textureStreamer->Request(d.GetTexture2(), pixels);
+}
+
 void GraphicsGL3::AssembleDrawMap(std::ostream & /*error_output*/)
 {
+	dynamic_scenes.GetDrawList(dynamic_drawlist);
+
 	//sort the two dimentional drawlist so we get correct ordering
 	std::sort(dynamic_drawlist.twodim.begin(),dynamic_drawlist.twodim.end(),&SortDraworder);
 
-	drawMap.clear();
-
-	// for each pass, we have which camera and which draw groups to use
-	// we want to do culling for each unique camera and draw group combination
-	// use "camera/group" as a unique key string
-	// this is cached to avoid extra memory allocations each frame, so we need to clear old data
-	for (auto & camGroup : cameraDrawGroupDrawLists)
+	uint64_t enabledPasses = 0;
+	for (unsigned i = 0; i < planPasses.size(); i++)
 	{
-		camGroup.second.clear();
+		if (renderer.getPassEnabled(i))
+			enabledPasses |= PassBit(i);
 	}
 
-	// because the cameraDrawGroupDrawLists are cached, this is how we keep track of which combinations
-	// we have already generated
-	std::set <std::string> cameraDrawGroupCombinationsGenerated;
+	// shadow casters are culled against the default camera's view extended toward the light
+	const CameraMatrices & defaultCamera = cameras[CAMERA_DEFAULT];
+	Frustum receivers;
+	receivers.Extract(defaultCamera.projectionMatrix.GetArray(), defaultCamera.viewMatrix.GetArray());
+	const Vec3 shadowDirection = -light_direction;
+	const float contributionThreshold = ContributionCullThreshold(float(h));
 
-	// for each pass, do culling of the dynamic and static drawlists and put the results into the cameraDrawGroupDrawLists
-	for (auto passName : renderer.getPassNames())
+	// do culling of the dynamic and static drawlists for each camera and draw group combination
+	// the draw lists keep their capacity, so this doesn't allocate once warmed up
+	for (auto & cull : planCulls)
 	{
-		if (renderer.getPassEnabled(passName))
+		cull.drawList.clear();
+		if (!(cull.passMask & enabledPasses))
+			continue;
+
+		if (cull.staticCache && !StaticCacheStale(cull.passMask & enabledPasses))
+			continue;
+
+		Frustum frustum;
+		Frustum * frustumPtr = NULL;
+		if (cull.camera >= 0)
+		{
+			const CameraMatrices & camera = cameras[cull.camera];
+			frustum.Extract(camera.projectionMatrix.GetArray(), camera.viewMatrix.GetArray());
+			frustumPtr = &frustum;
+		}
+
+		const int cascade = cull.camera - CAMERA_SHADOW;
+		if (cull.staticCache && staticShadowsStable[cascade] >= staticShadowsStableFrames)
 		{
-			for (auto drawGroupId : renderer.getDrawGroups(passName))
+			// the cache will likely outlive the current view, so it gets every caster of the cascade
+			auto caster = MakeFrustumCuller(frustum.frustum);
+			AssembleDrawList(*cull.staticDrawables, cull.drawList, caster);
+		}
+		else if (cull.staticCache)
+		{
+			// a moving cascade redraws its cache every frame anyway, so cull against the view
+			// and make sure the cache is redrawn next frame even if the cascade stops
+			auto caster = MakeShadowCasterCuller(frustum.frustum, receivers.frustum, shadowDirection, lastCameraPosition, contributionThreshold);
+			AssembleDrawList(*cull.staticDrawables, cull.drawList, caster);
+			staticShadowsViewCulled[cascade] = true;
+		}
+		else if (cull.shadowCaster)
+		{
+			auto caster = MakeShadowCasterCuller(frustum.frustum, receivers.frustum, shadowDirection, lastCameraPosition, contributionThreshold);
+			if (cull.dynamicDrawables)
+				AssembleDrawList(*cull.dynamicDrawables, cull.drawList, caster);
+			if (cull.staticDrawables)
+				AssembleDrawList(*cull.staticDrawables, cull.drawList, caster);
+		}
+		else
+		{
+			// the perspective cameras and unculled lists report texture sizes to the streamer
+			float pixelScale = 0;
+			if (textureStreamer && !frustumPtr)
+				pixelScale = float(std::max(w, h));
+			else if (textureStreamer && (cull.camera == CAMERA_DEFAULT || cull.camera == CAMERA_SKYBOX))
+				pixelScale = cameras[cull.camera].projectionMatrix[5] * h * 0.5f;
+
+			if (cull.dynamicDrawables)
+				AssembleDrawList(*cull.dynamicDrawables, cull.drawList, frustumPtr, lastCameraPosition, pixelScale);
+
+			if (cull.staticDrawables)
+				AssembleDrawList(*cull.staticDrawables, cull.drawList, frustumPtr, lastCameraPosition, pixelScale);
+		}
+
+		if (cull.fullscreenRect)
+			cull.drawList.push_back(&fullscreenquad.GenRenderModelData(drawAttribs));
+	}
+}
+
+void GraphicsGL3::CompileFramePlan()
+{
+	const char * cameraNames[CAMERA_COUNT] = {"default", "skybox", "shadow1", "shadow2", "shadow3"};
+	std::vector <std::string> cameraIndexToName(cameraNames, cameraNames + CAMERA_COUNT);
+
+	const std::vector <StringId> passNames = renderer.getPassNames();
+	assert(passNames.size() <= 64 && "passes beyond 64 share a cull mask bit");
+
+	planPasses.clear();
+	planCulls.clear();
+	planDrawLists.clear();
+	planStaticDrawLists.clear();
+	planPasses.resize(passNames.size());
+	planDrawLists.resize(passNames.size());
+	planStaticDrawLists.resize(passNames.size());
+
+	// draw list index of each pass and draw group, resolved to pointers once planCulls is complete
+	std::vector <std::vector <unsigned> > passCulls(passNames.size());
+	std::vector <std::vector <unsigned> > passStaticCulls(passNames.size());
+	std::map <std::pair <int, StringId>, unsigned> cullIndex;
+	std::map <std::pair <int, StringId>, unsigned> staticCullIndex;
+
+	for (unsigned i = 0; i < passNames.size(); i++)
+	{
+		const auto & fields = renderer.getUserDefinedFields(passNames[i]);
+		PlanPass & pass = planPasses[i];
+
+		// camera used by the pass, unknown cameras are never updated
+		pass.camera = -1;
+		auto field = fields.find("camera");
+		if (field != fields.end())
+		{
+			auto name = std::find(cameraIndexToName.begin(), cameraIndexToName.end(), field->second);
+			pass.camera = name - cameraIndexToName.begin();
+			if (name == cameraIndexToName.end())
 			{
-				std::string drawGroupString = stringMap.getString(drawGroupId);
-				std::string cameraDrawGroupKey = getCameraDrawGroupKey(passName, drawGroupId);
+				cameraIndexToName.push_back(field->second);
+				cameras.resize(cameraIndexToName.size());
+			}
+		}
 
-				auto & outDrawList = cameraDrawGroupDrawLists[cameraDrawGroupKey];
+		// frame uniform locations, so that per frame updates skip the name lookups
+		PlanUniforms & uniforms = pass.uniforms;
+		uniforms.viewMatrix = renderer.getPassUniformLocation(i, uniformIds.viewMatrix);
+		uniforms.projectionMatrix = renderer.getPassUniformLocation(i, uniformIds.projectionMatrix);
+		uniforms.shadowMatrix = renderer.getPassUniformLocation(i, uniformIds.shadowMatrix);
+		uniforms.invProjectionMatrix = renderer.getPassUniformLocation(i, uniformIds.invProjectionMatrix);
+		uniforms.invViewMatrix = renderer.getPassUniformLocation(i, uniformIds.invViewMatrix);
+		uniforms.defaultViewMatrix = renderer.getPassUniformLocation(i, uniformIds.defaultViewMatrix);
+		uniforms.defaultProjectionMatrix = renderer.getPassUniformLocation(i, uniformIds.defaultProjectionMatrix);
+		uniforms.eyespaceLightDirection = renderer.getPassUniformLocation(i, uniformIds.eyespaceLightDirection);
+		uniforms.reflectedLightColor = renderer.getPassUniformLocation(i, uniformIds.reflectedLightColor);
+		uniforms.ambientLightColor = renderer.getPassUniformLocation(i, uniformIds.ambientLightColor);
+		uniforms.directionalLightColor = renderer.getPassUniformLocation(i, uniformIds.directionalLightColor);
+
+		// shadow cascade 1, 2 or 3 the pass wants a reconstruction matrix for
+		pass.shadowCamera = -1;
+		field = fields.find("shadowMatrix");
+		if (field != fields.end())
+		{
+			const int cascade = std::atoi(field->second.c_str());
+			if (cascade >= 1 && cascade <= CAMERA_COUNT - CAMERA_SHADOW)
+				pass.shadowCamera = CAMERA_SHADOW + cascade - 1;
+		}
 
-				// see if we have already generated this combination
-				if (cameraDrawGroupCombinationsGenerated.find(cameraDrawGroupKey) == cameraDrawGroupCombinationsGenerated.end())
-				{
-					// we need to generate this combination
-
-					// extract frustum information
-					Frustum frustum;
-					Frustum * frustumPtr = NULL;
-					if (!getCameraForPass(passName).empty())
-					{
-						RenderUniform proj, view;
-						if (renderer.getPassUniform(passName, stringMap.addStringId("viewMatrix"), view) &&
-							renderer.getPassUniform(passName, stringMap.addStringId("projectionMatrix"), proj))
-						{
-							frustum.Extract(&proj.data[0], &view.data[0]);
-							frustumPtr = &frustum;
-						}
-					}
-
-					// assemble dynamic entries
-					auto dynamicDrawablesPtr = dynamic_drawlist.GetByName(drawGroupString);
-					if (dynamicDrawablesPtr)
-						AssembleDrawList(*dynamicDrawablesPtr, outDrawList, frustumPtr, lastCameraPosition);
-
-					// assemble static entries
-					auto staticDrawablesPtr = static_drawlist.GetByName(drawGroupString);
-					if (staticDrawablesPtr)
-						AssembleDrawList(*staticDrawablesPtr, outDrawList, frustumPtr, lastCameraPosition);
-
-					// if it's requesting the full screen rect draw group, feed it our special drawable
-					if (drawGroupString == "full screen rect")
-					{
-						std::vector <Drawable*> rect;
-						rect.push_back(&fullscreenquad);
-						AssembleDrawList(rect, outDrawList, NULL, lastCameraPosition);
-					}
-				}
+		// shadow cascade passes keep their static casters in a cache and composite the dynamic ones on top
+		const bool shadowCaster = pass.camera >= CAMERA_SHADOW && pass.camera < CAMERA_COUNT;
+		renderer.setPassStaticCacheEnabled(i, shadowCaster);
 
-				// use the generated combination in our drawMap
-				drawMap[passName][drawGroupId] = &outDrawList;
+		for (auto group : renderer.getDrawGroups(passNames[i]))
+		{
+			const std::string groupName = stringMap.getString(group);
+			auto dynamicDrawables = dynamic_drawlist.GetByName(groupName);
+			auto staticDrawables = static_drawlist.GetByName(groupName);
+
+			auto key = std::make_pair(pass.camera, group);
+			auto c = cullIndex.find(key);
+			if (c == cullIndex.end())
+			{
+				PlanCull cull;
+				cull.camera = pass.camera;
+				cull.passMask = 0;
+				cull.dynamicDrawables = dynamicDrawables ? &dynamicDrawables.get() : NULL;
+				cull.staticDrawables = (staticDrawables && !shadowCaster) ? &staticDrawables.get() : NULL;
+				cull.fullscreenRect = (groupName == "full screen rect");
+				cull.shadowCaster = shadowCaster;
+				cull.staticCache = false;
+
+				c = cullIndex.insert(std::make_pair(key, planCulls.size())).first;
+				planCulls.push_back(cull);
+			}
+			planCulls[c->second].passMask |= PassBit(i);
+			passCulls[i].push_back(c->second);
+
+			if (!shadowCaster || !staticDrawables)
+				continue;
 
-				cameraDrawGroupCombinationsGenerated.insert(cameraDrawGroupKey);
+			c = staticCullIndex.find(key);
+			if (c == staticCullIndex.end())
+			{
+				PlanCull cull;
+				cull.camera = pass.camera;
+				cull.passMask = 0;
+				cull.dynamicDrawables = NULL;
+				cull.staticDrawables = &staticDrawables.get();
+				cull.fullscreenRect = false;
+				cull.shadowCaster = true;
+				cull.staticCache = true;
+
+				c = staticCullIndex.insert(std::make_pair(key, planCulls.size())).first;
+				planCulls.push_back(cull);
 			}
+			planCulls[c->second].passMask |= PassBit(i);
+			passStaticCulls[i].push_back(c->second);
 		}
 	}
 
-	/*for (const auto & camGroup : cameraDrawGroupDrawLists)
+	for (unsigned i = 0; i < passNames.size(); i++)
 	{
-		std::cout << camGroup.first << ": " << camGroup.second.size() << std::endl;
+		for (auto c : passCulls[i])
+			planDrawLists[i].push_back(&planCulls[c].drawList);
+		for (auto c : passStaticCulls[i])
+			planStaticDrawLists[i].push_back(&planCulls[c].drawList);
 	}
-	std::cout << "----------" << std::endl;*/
-	//if (enableContributionCull) std::cout << "Contribution cull count: " << assembler.contributionCullCount << std::endl;
-	//std::cout << "normal_noblend: " << drawGroups[stringMap.addStringId("normal_noblend")].size() << "/" << static_drawlist.GetDrawList().GetByName("normal_noblend")->size() << std::endl;
+}
+
+void GraphicsGL3::SetFrameUniform(int PlanUniforms::* location, const RenderUniformEntry & uniform)
+{
+	for (unsigned i = 0; i < planPasses.size(); i++)
+	{
+		const int passLocation = planPasses[i].uniforms.*location;
+		if (passLocation >= 0)
+			renderer.setPassUniform(i, passLocation, uniform);
+	}
+}
+
+void GraphicsGL3::InvalidateStaticShadows(int camera)
+{
+	for (unsigned i = 0; i < planPasses.size(); i++)
+	{
+		if (planPasses[i].camera == camera)
+			renderer.invalidatePassStaticCache(i);
+	}
+}
+
+bool GraphicsGL3::StaticCacheStale(uint64_t passMask) const
+{
+	for (unsigned i = 0; i < planPasses.size(); i++)
+	{
+		if ((passMask & PassBit(i)) && !renderer.getPassStaticCacheValid(i))
+			return true;
+	}
+	return false;
+}
+
+uint64_t GraphicsGL3::PassBit(unsigned pass)
+{
+	return uint64_t(1) << std::min(pass, 63u);
 }
 
 void GraphicsGL3::DrawScene(std::ostream & error_output)
@@ -562,7 +763,7 @@ void GraphicsGL3::DrawScene(std::ostream & error_output)
 	gl.unbindVertexArray();
 
 	gl.logging(logNextGlFrame);
-	renderer.render(w, h, stringMap, drawMap, error_output);
+	renderer.render(w, h, stringMap, planDrawLists, planStaticDrawLists, error_output);
 	gl.logging(false);
 
 	logNextGlFrame = false;
@@ -616,17 +817,11 @@ bool GraphicsGL3::ReloadShaders(std::ostream & info_output, std::ostream & error
 			allcapsConditions.insert(c);
 		}
 
-		bool initSuccess = renderer.initialize(passInfos, stringMap, shaderpath, w, h, allcapsConditions, error_output);
+		bool initSuccess = renderer.initialize(passInfos, stringMap, shaderpath, w, h, allcapsConditions, error_output, &shader_cache);
 		if (initSuccess)
 		{
-			// assign cameras to each pass
-			for (auto passName : renderer.getPassNames())
-			{
-				auto fields = renderer.getUserDefinedFields(passName);
-				auto field = fields.find("camera");
-				if (field != fields.end())
-					passNameToCameraName[stringMap.getString(passName)] = field->second;
-			}
+			// assign cameras and draw lists to each pass
+			CompileFramePlan();
 
 			// set viewport size
 			float viewportSize[2] = {float(w), float(h)};
@@ -672,6 +867,11 @@ bool GraphicsGL3::GetShadows() const
 	return true;
 }
 
+void GraphicsGL3::SetTextureStreamer(TextureStreamer * streamer)
+{
+	textureStreamer = streamer;
+}
+
 void GraphicsGL3::SetFixedSkybox(bool enable)
 {
 	fixed_skybox = enable;
@@ -695,3 +895,18 @@ void GraphicsGL3::initDrawableAttributes(DrawableAttributes & attribs, StringIdM
 	attribs.transform = map.addStringId("modelMatrix");
 	attribs.color = map.addStringId("colorTint");
 }
+
+void GraphicsGL3::initUniformIds(UniformIds & ids, StringIdMap & map)
+{
+	ids.viewMatrix = map.addStringId("viewMatrix");
+	ids.projectionMatrix = map.addStringId("projectionMatrix");
+	ids.shadowMatrix = map.addStringId("shadowMatrix");
+	ids.invProjectionMatrix = map.addStringId("invProjectionMatrix");
+	ids.invViewMatrix = map.addStringId("invViewMatrix");
+	ids.defaultViewMatrix = map.addStringId("defaultViewMatrix");
+	ids.defaultProjectionMatrix = map.addStringId("defaultProjectionMatrix");
+	ids.eyespaceLightDirection = map.addStringId("eyespaceLightDirection");
+	ids.reflectedLightColor = map.addStringId("reflectedLightColor");
+	ids.ambientLightColor = map.addStringId("ambientLightColor");
+	ids.directionalLightColor = map.addStringId("directionalLightColor");
+}
@@ -23,6 +23,7 @@
 #include "graphics.h"
 #include "aabb_tree_adapter.h"
 #include "drawable_container.h"
+#include "flatscene.h"
 #include "matrix4.h"
 #include "texture.h"
 #include "vertexarray.h"
@@ -31,12 +32,14 @@
 #include "gl3v/glwrapper.h"
 #include "gl3v/renderer.h"
 #include "gl3v/stringidmap.h"
+#include "shader_cache.h"
 
 #include <iosfwd>
 #include <string>
 #include <map>
 #include <list>
 #include <vector>
+#include <cstdint>
 
 class SceneNode;
 
@@ -48,6 +51,7 @@ public:
 	/// returns true on success
 	virtual bool Init(
 		const std::string & shaderpath,
+		const std::string & shadercachepath,
 		unsigned resx, unsigned resy,
 		unsigned antialiasing,
 		bool enableshadows, int shadow_distance,
@@ -102,6 +106,8 @@ public:
 
 	virtual void printProfilingInfo(std::ostream & out) const {renderer.printProfilingInfo(out);}
 
+	virtual void SetTextureStreamer(TextureStreamer * streamer);
+
 	GraphicsGL3(StringIdMap & map);
 
 	~GraphicsGL3();
@@ -111,6 +117,7 @@ private:
 	VertexBuffer vertex_buffer;
 	GLWrapper gl;
 	Renderer renderer;
+	ShaderCache shader_cache;
 	std::string rendercfg;
 	std::string shaderpath;
 	int w, h;
@@ -119,6 +126,7 @@ private:
 	bool fixed_skybox;
 	Vec3 lastCameraPosition;
 	Vec3 light_direction;
+	TextureStreamer * textureStreamer;
 
 	struct CameraMatrices
 	{
@@ -127,8 +135,18 @@ private:
 		Mat4 viewMatrix;
 		Mat4 inverseViewMatrix;
 	};
-	std::map <std::string, CameraMatrices> cameras;
-	CameraMatrices & setCameraPerspective(const std::string & name,
+
+	/// cameras updated by SetupScene, cameras named by passes but unknown to us follow
+	enum CameraIndex
+	{
+		CAMERA_DEFAULT,
+		CAMERA_SKYBOX,
+		CAMERA_SHADOW, ///< first of three shadow cascades
+		CAMERA_COUNT = CAMERA_SHADOW + 3
+	};
+	std::vector <CameraMatrices> cameras;
+
+	void setCameraPerspective(CameraMatrices & matrices,
 							  const Vec3 & position,
 							  const Quat & rotation,
 							  float fov,
@@ -136,19 +154,17 @@ private:
 							  float farDistance,
 							  float w,
 							  float h);
-	CameraMatrices & setCameraOrthographic(const std::string & name,
+	void setCameraOrthographic(CameraMatrices & matrices,
 							   const Vec3 & position,
 							   const Quat & rotation,
 							   const Vec3 & orthoMin,
 							   const Vec3 & orthoMax);
 
-	std::string getCameraDrawGroupKey(StringId pass, StringId group) const;
-	std::string getCameraForPass(StringId pass) const;
-
 	// scenegraph output
 	template <typename T> class PtrVector : public std::vector<T*> {};
 	typedef DrawableContainer <PtrVector> DynamicDrawables;
 	DynamicDrawables dynamic_drawlist; //used for objects that move or change
+	FlatSceneSet dynamic_scenes; //rebuilds dynamic_drawlist only if the dynamic nodes changed
 
 	typedef DrawableContainer<AabbTreeNodeAdapter> StaticDrawables;
 	StaticDrawables static_drawlist; //used for objects that will never change
@@ -157,21 +173,79 @@ private:
 	Drawable fullscreenquad;
 	VertexArray fullscreenquadVertices;
 
-	// drawlist cache
-	std::map <std::string, std::vector <RenderModelExt*> > cameraDrawGroupDrawLists;
-
-	// this maps passes to maps of draw groups and draw list vector pointers
-	// so drawMap[passName][drawGroup] is a pointer to a vector of RenderModelExternal pointers
-	// this is complicated but it lets us do culling per camera position and draw group combination
-	std::map <StringId, std::map <StringId, std::vector <RenderModelExt*> *> > drawMap;
-
 	// drawlist assembly functions
-	void AssembleDrawList(const std::vector <Drawable*> & drawables, std::vector <RenderModelExt*> & out, Frustum * frustum, const Vec3 & camPos);
-	void AssembleDrawList(const AabbTreeNodeAdapter <Drawable> & adapter, std::vector <RenderModelExt*> & out, Frustum * frustum, const Vec3 & camPos);
+	// pixelScale converts the size of drawables over distance to screen pixels, without a frustum it is
+	// their screen size, the sizes are reported to the texture streamer unless pixelScale is zero
+	void AssembleDrawList(const std::vector <Drawable*> & drawables, std::vector <RenderModelExt*> & out, Frustum * frustum, const Vec3 & camPos, float pixelScale);
+	void AssembleDrawList(const AabbTreeNodeAdapter <Drawable> & adapter, std::vector <RenderModelExt*> & out, Frustum * frustum, const Vec3 & camPos, float pixelScale);
+	template <class Culler> void AssembleDrawList(const std::vector <Drawable*> & drawables, std::vector <RenderModelExt*> & out, const Culler & cull);
+	template <class Culler> void AssembleDrawList(const AabbTreeNodeAdapter <Drawable> & adapter, std::vector <RenderModelExt*> & out, const Culler & cull);
 	void AssembleDrawMap(std::ostream & error_output);
+	void RequestTextures(const Drawable & d, float pixels);
 
-	// a map that stores which camera each pass uses
-	std::map <std::string, std::string> passNameToCameraName;
+	// frame plan, compiled from the pass configuration by CompileFramePlan whenever
+	// the renderer is initialized, so that per frame setup needs no string or map lookups
+	// locations of the frame uniforms in a pass, -1 if the pass doesn't use one
+	struct PlanUniforms
+	{
+		int viewMatrix;
+		int projectionMatrix;
+		int shadowMatrix;
+		int invProjectionMatrix;
+		int invViewMatrix;
+		int defaultViewMatrix;
+		int defaultProjectionMatrix;
+		int eyespaceLightDirection;
+		int reflectedLightColor;
+		int ambientLightColor;
+		int directionalLightColor;
+	};
+
+	struct PlanPass
+	{
+		int camera; ///< index into cameras, -1 if the pass has no camera
+		int shadowCamera; ///< shadow cascade camera whose reconstruction matrix the pass gets, -1 if none
+		PlanUniforms uniforms;
+	};
+
+	// culling is done once per unique camera and draw group combination
+	struct PlanCull
+	{
+		int camera;
+		uint64_t passMask; ///< bits of the passes drawing the result, see PassBit
+		const std::vector <Drawable*> * dynamicDrawables;
+		const AabbTreeNodeAdapter <Drawable> * staticDrawables;
+		bool fullscreenRect;
+		bool shadowCaster; ///< only keep drawables whose shadow can reach the default camera's view
+		bool staticCache; ///< static drawables of passes with a static cache, only culled while a cache is stale
+		std::vector <RenderModelExt*> drawList;
+	};
+
+	std::vector <PlanPass> planPasses; ///< in renderer pass order
+	std::vector <PlanCull> planCulls;
+	std::vector <std::vector <const std::vector <RenderModelExt*>*> > planDrawLists; ///< per pass draw lists handed to the renderer
+	std::vector <std::vector <const std::vector <RenderModelExt*>*> > planStaticDrawLists; ///< per pass draw lists the renderer may serve from a static cache
+
+	void CompileFramePlan();
+
+	/// Set a frame uniform on every pass using it, location selects one of PlanUniforms.
+	void SetFrameUniform(int PlanUniforms::* location, const RenderUniformEntry & uniform);
+
+	static uint64_t PassBit(unsigned pass);
+
+	// shadow cascades keep their static casters cached until they move or the static geometry changes
+	CameraMatrices cachedShadowCameras[CAMERA_COUNT - CAMERA_SHADOW];
+	bool staticShadowsChanged;
+
+	// a cascade's cache is only filled with every caster of the cascade once it has been still for
+	// this many frames, before that the cache is unlikely to be reused and gets the view culled casters
+	static const unsigned staticShadowsStableFrames = 4;
+	unsigned staticShadowsStable[CAMERA_COUNT - CAMERA_SHADOW]; ///< frames the cascade hasn't moved
+	bool staticShadowsViewCulled[CAMERA_COUNT - CAMERA_SHADOW]; ///< cache holds view culled casters, redraw next frame
+
+	void InvalidateStaticShadows(int camera);
+
+	bool StaticCacheStale(uint64_t passMask) const;
 
 	// a set storing all configuration option conditions (bloom enabled, etc)
 	std::set <std::string> conditions;
@@ -180,6 +254,24 @@ private:
 	DrawableAttributes drawAttribs;
 	static void initDrawableAttributes(DrawableAttributes & attribs, StringIdMap & map);
 
+	// cache frame uniform ids
+	struct UniformIds
+	{
+		StringId viewMatrix;
+		StringId projectionMatrix;
+		StringId shadowMatrix;
+		StringId invProjectionMatrix;
+		StringId invViewMatrix;
+		StringId defaultViewMatrix;
+		StringId defaultProjectionMatrix;
+		StringId eyespaceLightDirection;
+		StringId reflectedLightColor;
+		StringId ambientLightColor;
+		StringId directionalLightColor;
+	};
+	UniformIds uniformIds;
+	static void initUniformIds(UniformIds & ids, StringIdMap & map);
+
 	Texture static_reflection;
 
 	float closeshadow;
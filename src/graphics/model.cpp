@@ -74,7 +74,7 @@ bool Model::Load(const VertexArray & nvarray, std::ostream & /*error_output*/)
 
 bool Model::WriteToFile(const std::string & filepath)
 {
-	std::ofstream fileout(filepath.c_str());
+	std::ofstream fileout(filepath.c_str(), std::ios_base::binary);
 	if (!fileout)
 		return false;
 
@@ -83,6 +83,14 @@ bool Model::WriteToFile(const std::string & filepath)
 	return Serialize(s);
 }
 
+bool Model::IsSerialized(const std::string & filepath)
+{
+	std::ifstream filein(filepath.c_str(), std::ios_base::binary);
+	std::vector<char> fmagic(file_magic.size() + 1, 0);
+	filein.read(&fmagic[0], file_magic.size());
+	return filein && !file_magic.compare(&fmagic[0]);
+}
+
 bool Model::ReadFromFile(const std::string & filepath, std::ostream & error_output)
 {
 	std::ifstream filein(filepath.c_str(), std::ios_base::binary);
@@ -100,7 +108,7 @@ bool Model::ReadFromFile(const std::string & filepath, std::ostream & error_outp
 		return false;
 	}
 
-	if (!file_magic.compare(&fmagic[0]))
+	if (file_magic.compare(&fmagic[0]))
 	{
 		error_output << "File magic is incorrect: \"" << file_magic << "\" != \"" << &fmagic[0] << "\" in " << filepath << std::endl;
 		return false;
@@ -51,6 +51,9 @@ public:
 
 	bool ReadFromFile(const std::string & filepath, std::ostream & error_output);
 
+	/// Returns true if the file was written by WriteToFile.
+	static bool IsSerialized(const std::string & filepath);
+
 	/// vertex buffer interface
 	VertexBuffer::Segment & GetVertexBufferSegment() { return vbs; };
 
@@ -30,8 +30,15 @@ class ModelObj : public Model
 private:
 
 public:
+	ModelObj()
+	{
+		// ctor
+	}
+
 	ModelObj(const std::string & filepath, std::ostream & error_output) : Model(filepath, error_output) {}
 
+	using Model::Load;
+
 	///returns true on success
 	virtual bool Load(const std::string & filepath, std::ostream & error_log);
 	virtual bool CanSave() const {return true;}
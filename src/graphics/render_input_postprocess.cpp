@@ -150,11 +150,7 @@ void RenderInputPostprocess::SetCamera(const GraphicsCamera & cam)
 	// frustum corners in world space for dynamic sky shader
 	Mat4 view_rot_inv;
 	(-cam.rot).GetMatrix4(view_rot_inv);
-	for (int i = 0; i < 4; i++)
-	{
-		frustum_corners_ws[i] = frustum_corners[i];
-		view_rot_inv.TransformVectorOut(frustum_corners_ws[i][0], frustum_corners_ws[i][1], frustum_corners_ws[i][2]);
-	}
+	view_rot_inv.TransformVectorsOut(frustum_corners, frustum_corners_ws, 4);
 }
 
 void RenderInputPostprocess::SetSunDirection(const Vec3 & newsun)
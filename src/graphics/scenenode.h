@@ -22,6 +22,7 @@
 
 #include "drawable_container.h"
 #include "keyed_container.h"
+#include "scenerevision.h"
 #include "transform.h"
 
 class SceneNode
@@ -58,6 +59,8 @@ public:
 	template <class Stream>
 	void DebugPrint(Stream & out, int curdepth = 0) const;
 
+	/// append drawables to drawlist_output, updating the world transforms of changed subtrees
+	/// world transforms are only recomputed for nodes whose transform or parent changed
 	template <template <typename U> class T>
 	void Traverse(DrawableContainer <T> & drawlist_output, const Mat4 & prev_transform);
 
@@ -74,10 +77,17 @@ public:
 	void ApplyDrawableFunctor(T functor);
 
 private:
+	friend class FlatScene;
 	List childlist;
 	DrawableList drawlist;
 	Transform transform;
 	Mat4 cached_transform;
+	SceneRevision revision;
+
+	template <template <typename U> class T>
+	void AppendDrawables(DrawableContainer <T> & drawlist_output, bool changed);
+
+	void UpdateTransform(const Mat4 & prev_transform);
 };
 
 
@@ -186,30 +196,42 @@ inline void SceneNode::DebugPrint(Stream & out, int curdepth) const
 	}
 }
 
-template <template <typename U> class T>
-inline void SceneNode::Traverse(DrawableContainer <T> & drawlist_output, const Mat4 & prev_transform)
+inline void SceneNode::UpdateTransform(const Mat4 & prev_transform)
 {
-	Mat4 this_transform(prev_transform);
-
-	bool identitytransform = transform.IsIdentityTransform();
-	if (!identitytransform)
+	cached_transform = prev_transform;
+	if (!transform.IsIdentityTransform())
 	{
-		transform.GetRotation().GetMatrix4(this_transform);
-		this_transform.Translate(transform.GetTranslation()[0], transform.GetTranslation()[1], transform.GetTranslation()[2]);
-		this_transform = this_transform.Multiply(prev_transform);
+		transform.GetRotation().GetMatrix4(cached_transform);
+		cached_transform.Translate(transform.GetTranslation()[0], transform.GetTranslation()[1], transform.GetTranslation()[2]);
+		cached_transform = cached_transform.Multiply(prev_transform);
 	}
+	transform.ClearChanged();
+}
 
-	if (this_transform != cached_transform)
-		drawlist.AppendTo<T,true>(drawlist_output, this_transform);
+template <template <typename U> class T>
+inline void SceneNode::Traverse(DrawableContainer <T> & drawlist_output, const Mat4 & prev_transform)
+{
+	// root nodes compare against the cached transform, the parent transform isn't tracked
+	Mat4 last_transform(cached_transform);
+	UpdateTransform(prev_transform);
+	AppendDrawables(drawlist_output, last_transform != cached_transform);
+}
+
+template <template <typename U> class T>
+inline void SceneNode::AppendDrawables(DrawableContainer <T> & drawlist_output, bool changed)
+{
+	if (changed)
+		drawlist.AppendTo<T,true>(drawlist_output, cached_transform);
 	else
-		drawlist.AppendTo<T,false>(drawlist_output, this_transform);
+		drawlist.AppendTo<T,false>(drawlist_output, cached_transform);
 
 	for (auto & child : childlist)
 	{
-		child.Traverse(drawlist_output, this_transform);
+		bool child_changed = changed || child.transform.GetChanged();
+		if (child_changed)
+			child.UpdateTransform(cached_transform);
+		child.AppendDrawables(drawlist_output, child_changed);
 	}
-
-	cached_transform = this_transform;
 }
 
 template <typename T>
@@ -0,0 +1,54 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef _SCENEREVISION_H
+#define _SCENEREVISION_H
+
+#include <atomic>
+
+/// Scene structure revision counter. Embedded in scene nodes and drawables,
+/// it is bumped whenever one of them is created, copied, moved or destroyed,
+/// which is also when pointers cached into the scene graph may dangle.
+class SceneRevision
+{
+public:
+	SceneRevision() { Bump(); }
+	SceneRevision(const SceneRevision &) { Bump(); }
+	SceneRevision & operator=(const SceneRevision &) { Bump(); return *this; }
+	~SceneRevision() { Bump(); }
+
+	static unsigned Get()
+	{
+		return Counter().load(std::memory_order_relaxed);
+	}
+
+	static void Bump()
+	{
+		Counter().fetch_add(1, std::memory_order_relaxed);
+	}
+
+private:
+	static std::atomic<unsigned> & Counter()
+	{
+		static std::atomic<unsigned> counter(0);
+		return counter;
+	}
+};
+
+#endif // _SCENEREVISION_H
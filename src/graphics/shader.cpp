@@ -57,7 +57,10 @@ void PrintWithLineNumbers(ostream & out, const string & str)
 Shader::Shader() :
 	program(0),
 	vertex_shader(0),
-	fragment_shader(0)
+	fragment_shader(0),
+	cache(0),
+	cache_key(0),
+	cached(false)
 {
 	// ctor
 }
@@ -98,16 +101,41 @@ bool Shader::Load(
 	const std::vector<std::string> & defines,
 	const std::vector<std::string> & uniforms,
 	const std::vector<std::string> & attributes,
-	std::ostream & /*info_output*/,
-	std::ostream & error_output)
+	std::ostream & info_output,
+	std::ostream & error_output,
+	ShaderCache * cache)
+{
+	BeginLoad(
+		glsl_330, output_count,
+		vertex_filename, fragment_filename,
+		defines, attributes,
+		error_output, cache);
+
+	return EndLoad(uniforms, info_output, error_output);
+}
+
+void Shader::BeginLoad(
+	const bool glsl_330,
+	const unsigned int output_count,
+	const std::string & vertex_filename,
+	const std::string & fragment_filename,
+	const std::vector<std::string> & defines,
+	const std::vector<std::string> & attributes,
+	std::ostream & error_output,
+	ShaderCache * shader_cache)
 {
 	Unload();
 
+	vertex_name = vertex_filename;
+	fragment_name = fragment_filename;
+	cache = (shader_cache && shader_cache->Enabled()) ? shader_cache : 0;
+	cached = false;
+
 	// get shader sources
-	std::string vertexshader_source = Utils::LoadFileIntoString(vertex_filename, error_output);
-	std::string fragmentshader_source = Utils::LoadFileIntoString(fragment_filename, error_output);
-	assert(!vertexshader_source.empty());
-	assert(!fragmentshader_source.empty());
+	vertex_source = Utils::LoadFileIntoString(vertex_filename, error_output);
+	fragment_source = Utils::LoadFileIntoString(fragment_filename, error_output);
+	assert(!vertex_source.empty());
+	assert(!fragment_source.empty());
 
 	// prepend #version and #define values
 	std::ostringstream dstr;
@@ -116,36 +144,44 @@ bool Shader::Load(
 	{
 		dstr << "#define " << define << "\n";
 	}
-	vertexshader_source = dstr.str() + vertexshader_source;
-	fragmentshader_source = dstr.str() + fragmentshader_source;
+	vertex_source = dstr.str() + vertex_source;
+	fragment_source = dstr.str() + fragment_source;
 
-	// create shader objects
 	program = glCreateProgram();
+
+	// try the program binary cache first
+	if (cache)
+	{
+		std::ostringstream bindings;
+		bindings << output_count;
+		for (const auto & attribute : attributes)
+			bindings << " " << attribute;
+
+		std::vector<std::string> inputs;
+		inputs.push_back(vertex_source);
+		inputs.push_back(fragment_source);
+		inputs.push_back(bindings.str());
+		cache_key = cache->GetKey(inputs);
+
+		cached = cache->Load(program, cache_key);
+		if (cached)
+			return;
+	}
+
+	// create shader objects
 	vertex_shader = glCreateShader(GL_VERTEX_SHADER);
 	fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
 
 	// load shader sources
-	const GLchar * vertshad = vertexshader_source.c_str();
-	const GLchar * fragshad = fragmentshader_source.c_str();
+	const GLchar * vertshad = vertex_source.c_str();
+	const GLchar * fragshad = fragment_source.c_str();
 	glShaderSource(vertex_shader, 1, &vertshad, NULL);
 	glShaderSource(fragment_shader, 1, &fragshad, NULL);
 
-	// compile the shaders
+	// compile the shaders, status is checked in EndLoad
 	glCompileShader(vertex_shader);
 	glCompileShader(fragment_shader);
 
-	GLint vertex_compiled(0);
-	GLint fragment_compiled(0);
-
-	glGetShaderiv(vertex_shader, GL_COMPILE_STATUS, &vertex_compiled);
-	glGetShaderiv(fragment_shader, GL_COMPILE_STATUS, &fragment_compiled);
-
-	if (!vertex_compiled)
-		PrintShaderLog(vertex_shader, vertex_filename, error_output);
-
-	if (!fragment_compiled)
-		PrintShaderLog(fragment_shader, fragment_filename, error_output);
-
 	// attach shader objects to the program object
 	glAttachShader(program, vertex_shader);
 	glAttachShader(program, fragment_shader);
@@ -175,6 +211,8 @@ bool Shader::Load(
 	}
 
 	// link the program
+	if (cache)
+		cache->Prepare(program);
 	glLinkProgram(program);
 /*
 	// verify attributes
@@ -184,26 +222,58 @@ bool Shader::Load(
 		error_output << loc << " " << i << " " << attributes[i] << "\n";
 	}
 */
-	GLint program_linked(0);
-	glGetProgramiv(program, GL_LINK_STATUS, &program_linked);
+}
 
-	if (!program_linked)
-		PrintProgramLog(program, vertex_filename + " and " + fragment_filename, error_output);
+bool Shader::EndLoad(
+	const std::vector<std::string> & uniforms,
+	std::ostream & /*info_output*/,
+	std::ostream & error_output)
+{
+	if (!program)
+		return false;
 
-	if (!(vertex_compiled && fragment_compiled && program_linked))
+	if (!cached)
 	{
-		error_output << "Shader compilation failure: " + vertex_filename + " and " + fragment_filename << endl << endl;
-		error_output << "Vertex shader:" << endl;
-		PrintWithLineNumbers(error_output, vertexshader_source);
-		error_output << endl;
+		GLint vertex_compiled(0);
+		GLint fragment_compiled(0);
+
+		glGetShaderiv(vertex_shader, GL_COMPILE_STATUS, &vertex_compiled);
+		glGetShaderiv(fragment_shader, GL_COMPILE_STATUS, &fragment_compiled);
+
+		if (!vertex_compiled)
+			PrintShaderLog(vertex_shader, vertex_name, error_output);
 
-		error_output << "Fragment shader:" << endl;
-		PrintWithLineNumbers(error_output, fragmentshader_source);
-		error_output << endl;
+		if (!fragment_compiled)
+			PrintShaderLog(fragment_shader, fragment_name, error_output);
+		GLint program_linked(0);
+		glGetProgramiv(program, GL_LINK_STATUS, &program_linked);
 
-		Unload();
+		if (!program_linked)
+			PrintProgramLog(program, vertex_name + " and " + fragment_name, error_output);
+
+		if (!(vertex_compiled && fragment_compiled && program_linked))
+		{
+			error_output << "Shader compilation failure: " + vertex_name + " and " + fragment_name << endl << endl;
+			error_output << "Vertex shader:" << endl;
+			PrintWithLineNumbers(error_output, vertex_source);
+			error_output << endl;
+
+			error_output << "Fragment shader:" << endl;
+			PrintWithLineNumbers(error_output, fragment_source);
+			error_output << endl;
+
+			Unload();
+		}
+		else if (cache)
+		{
+			cache->Save(program, cache_key);
+		}
 	}
-	else
+
+	vertex_source.clear();
+	fragment_source.clear();
+
+	if (program)
 	{
 		// need to enable to be able to set passed variable info
 		glUseProgram(program);
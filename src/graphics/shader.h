@@ -21,6 +21,7 @@
 #define _SHADER_H
 
 #include "glcore.h"
+#include "shader_cache.h"
 
 #include <iosfwd>
 #include <string>
@@ -44,6 +45,26 @@ public:
 		const std::vector<std::string> & uniforms,
 		const std::vector<std::string> & attributes,
 		std::ostream & info_output,
+		std::ostream & error_output,
+		ShaderCache * cache = 0);
+
+	/// Split load, BeginLoad only submits the compile and link (or loads a
+	/// cached program binary) without waiting on the driver. Beginning all
+	/// shader loads before ending any lets the driver compile them in parallel.
+	void BeginLoad(
+		const bool glsl_330,
+		const unsigned int output_count,
+		const std::string & vertex_filename,
+		const std::string & fragment_filename,
+		const std::vector<std::string> & defines,
+		const std::vector<std::string> & attributes,
+		std::ostream & error_output,
+		ShaderCache * cache = 0);
+
+	/// Check the link result and query uniform locations.
+	bool EndLoad(
+		const std::vector<std::string> & uniforms,
+		std::ostream & info_output,
 		std::ostream & error_output);
 
 	bool GetLoaded() const;
@@ -80,6 +101,15 @@ private:
 	GLuint fragment_shader;
 	std::vector <int> uniform_locations;
 
+	// pending load state, kept between BeginLoad and EndLoad
+	ShaderCache * cache;
+	ShaderCache::Key cache_key;
+	bool cached;
+	std::string vertex_name;
+	std::string fragment_name;
+	std::string vertex_source;
+	std::string fragment_source;
+
 	/// query the card for the shader compile log and print it out
 	void PrintShaderLog(const GLuint pshader, const std::string & name, std::ostream & out);
 
@@ -0,0 +1,283 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#include "shader_cache.h"
+#include "pathmanager.h"
+#include "unittest.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <sys/utime.h>
+#else
+#include <utime.h>
+#endif
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <iterator>
+#include <list>
+#include <cstring>
+
+static const char cache_magic[4] = {'V', 'D', 'P', 'C'};
+
+// 64 bit FNV-1a
+static ShaderCache::Key Hash(const std::string & data, ShaderCache::Key hash)
+{
+	for (unsigned char c : data)
+	{
+		hash ^= c;
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+static std::string GetString(GLenum name)
+{
+	const GLubyte * str = glGetString(name);
+	return str ? std::string((const char *)str) : std::string();
+}
+
+ShaderCache::ShaderCache() :
+	enabled(false)
+{
+	// ctor
+}
+
+ShaderCache::ShaderCache(const std::string & newpath) :
+	path(newpath),
+	enabled(false)
+{
+	// ctor
+}
+
+void ShaderCache::Init(const std::string & newpath, std::ostream & info_output)
+{
+	path = newpath;
+	driver = GetString(GL_VENDOR) + "\n" + GetString(GL_RENDERER) + "\n" + GetString(GL_VERSION);
+	enabled = false;
+
+	// Hand shader compilation to the driver's own threads, compile and
+	// link status queries are only made once all programs are submitted.
+	if (GLC_KHR_parallel_shader_compile == GLC_LOAD_SUCCEEDED)
+		glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+	else if (GLC_ARB_parallel_shader_compile == GLC_LOAD_SUCCEEDED)
+		glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+
+	if (path.empty() || GLC_ARB_get_program_binary != GLC_LOAD_SUCCEEDED)
+		return;
+
+	GLint formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	if (formats <= 0)
+	{
+		info_output << "Shader cache disabled, no program binary formats." << std::endl;
+		return;
+	}
+
+	enabled = true;
+}
+
+bool ShaderCache::Enabled() const
+{
+	return enabled;
+}
+
+ShaderCache::Key ShaderCache::GetKey(const std::vector<std::string> & inputs) const
+{
+	Key key = Hash(driver, 14695981039346656037ULL);
+	for (const auto & input : inputs)
+	{
+		// Hash the length too, so that moving text between inputs changes the key.
+		std::ostringstream size;
+		size << input.size() << ":";
+		key = Hash(size.str(), key);
+		key = Hash(input, key);
+	}
+	return key;
+}
+
+void ShaderCache::Prepare(GLuint program) const
+{
+	if (enabled)
+		glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+bool ShaderCache::Load(GLuint program, Key key) const
+{
+	if (!enabled)
+		return false;
+
+	GLenum format = 0;
+	std::vector<char> binary;
+	if (!Read(key, format, binary))
+		return false;
+
+	glProgramBinary(program, format, &binary[0], binary.size());
+
+	GLint linked = 0;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	return linked != 0;
+}
+
+void ShaderCache::Save(GLuint program, Key key) const
+{
+	if (!enabled)
+		return;
+
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+		return;
+
+	std::vector<char> binary(length);
+	GLenum format = 0;
+	glGetProgramBinary(program, length, &length, &format, &binary[0]);
+	if (length <= 0)
+		return;
+
+	binary.resize(length);
+	if (Write(key, format, binary))
+		Trim(max_files);
+}
+
+std::string ShaderCache::GetFilename(Key key) const
+{
+	std::ostringstream name;
+	name << path << "/" << std::hex << std::setw(16) << std::setfill('0') << key << ".bin";
+	return name.str();
+}
+
+bool ShaderCache::Read(Key key, GLenum & format, std::vector<char> & binary) const
+{
+	const std::string filename = GetFilename(key);
+	std::ifstream file(filename.c_str(), std::ios::binary);
+	if (!file)
+		return false;
+
+	// Guard against truncated files and key hash collisions.
+	char magic[4];
+	Key file_key = 0;
+	if (!file.read(magic, sizeof(magic)) ||
+		!file.read((char *)&file_key, sizeof(file_key)) ||
+		!file.read((char *)&format, sizeof(format)) ||
+		std::memcmp(magic, cache_magic, sizeof(magic)) != 0 ||
+		file_key != key)
+		return false;
+
+	binary.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	if (binary.empty())
+		return false;
+
+	// Access times aren't reliable, the modification time tracks use instead.
+	file.close();
+	utime(filename.c_str(), 0);
+	return true;
+}
+
+bool ShaderCache::Write(Key key, GLenum format, const std::vector<char> & binary) const
+{
+	std::ofstream file(GetFilename(key).c_str(), std::ios::binary);
+	file.write(cache_magic, sizeof(cache_magic));
+	file.write((const char *)&key, sizeof(key));
+	file.write((const char *)&format, sizeof(format));
+	file.write(&binary[0], binary.size());
+	return file.good();
+}
+
+void ShaderCache::Trim(unsigned count) const
+{
+	PathManager paths;
+	std::list<std::string> files;
+	if (!paths.GetFileList(path, files, ".bin") || files.size() <= count)
+		return;
+
+	std::vector<std::pair<time_t, std::string> > used;
+	for (const auto & file : files)
+	{
+		const std::string filename = path + "/" + file;
+		struct stat s;
+		if (stat(filename.c_str(), &s) == 0)
+			used.push_back(std::make_pair(s.st_mtime, filename));
+	}
+
+	// Least recently used first.
+	std::sort(used.begin(), used.end());
+	for (unsigned i = 0; i + count < used.size(); i++)
+		PathManager::RemoveFile(used[i].second);
+}
+
+QT_TEST(shader_cache_test)
+{
+	ShaderCache cache;
+	std::vector<std::string> a = {"#define A\nvoid main(){}", "FragColor"};
+	std::vector<std::string> b = {"#define A\nvoid main(){}", "FragColor"};
+	std::vector<std::string> c = {"#define A\nvoid main(){}Frag", "Color"};
+	std::vector<std::string> d = {"#define B\nvoid main(){}", "FragColor"};
+	QT_CHECK_EQUAL(cache.GetKey(a), cache.GetKey(b));
+	QT_CHECK(cache.GetKey(a) != cache.GetKey(c));
+	QT_CHECK(cache.GetKey(a) != cache.GetKey(d));
+	QT_CHECK(!cache.Enabled());
+
+	QT_CHECK_EQUAL(cache.GetFilename(0x1ff), "/00000000000001ff.bin");
+	QT_CHECK_EQUAL(cache.GetFilename(0xff), "/00000000000000ff.bin");
+}
+
+QT_TEST(shader_cache_files_test)
+{
+	const std::string path = "shader_cache_test";
+	PathManager::MakeDir(path);
+	ShaderCache cache(path);
+
+	// keys sharing their low bits are cached side by side
+	const ShaderCache::Key keys[3] = {0x1ff, 0xff, 0x2ff};
+	for (int i = 0; i < 3; i++)
+		QT_CHECK(cache.Write(keys[i], GLenum(i), std::vector<char>(16, char(i))));
+
+	GLenum format = 0;
+	std::vector<char> binary;
+	for (int i = 0; i < 3; i++)
+	{
+		QT_CHECK(cache.Read(keys[i], format, binary));
+		QT_CHECK_EQUAL(format, GLenum(i));
+		QT_CHECK(binary == std::vector<char>(16, char(i)));
+	}
+	QT_CHECK(!cache.Read(0x3ff, format, binary));
+
+	// age the files, then use the oldest one
+	for (int i = 0; i < 3; i++)
+	{
+		struct utimbuf times;
+		times.actime = times.modtime = 1000 + i;
+		utime(cache.GetFilename(keys[i]).c_str(), &times);
+	}
+	QT_CHECK(cache.Read(keys[0], format, binary));
+
+	// the least recently used file is evicted
+	cache.Trim(2);
+	QT_CHECK(cache.Read(keys[0], format, binary));
+	QT_CHECK(!cache.Read(keys[1], format, binary));
+	QT_CHECK(cache.Read(keys[2], format, binary));
+
+	cache.Trim(0);
+	QT_CHECK(!cache.Read(keys[0], format, binary));
+	PathManager::RemoveDir(path);
+}
@@ -0,0 +1,87 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef _SHADER_CACHE_H
+#define _SHADER_CACHE_H
+
+#include "glcore.h"
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+/// On-disk cache of linked shader program binaries.
+/// Entries are keyed by a hash of everything that goes into a program: the
+/// final shader sources (defines included), the attribute and output
+/// bindings and the driver identification strings. An edited shader or a
+/// driver update simply misses the cache, a rejected binary is relinked.
+/// Each program is stored in a file named after its key. The cache is
+/// bounded to a number of files, saving evicts the least recently used
+/// programs beyond that. Loading a program refreshes its file's time.
+class ShaderCache
+{
+public:
+	typedef unsigned long long Key;
+
+	/// Number of cache files at most.
+	static const unsigned max_files = 256;
+
+	ShaderCache();
+
+	/// File access only, the cache stays disabled until Init is called.
+	explicit ShaderCache(const std::string & path);
+
+	/// Needs a current GL context. The cache stays disabled if path is empty
+	/// or the driver offers no program binary formats. Also lets the driver
+	/// compile shaders on its own threads if it supports that.
+	void Init(const std::string & path, std::ostream & info_output);
+
+	bool Enabled() const;
+
+	/// Hash the program inputs together with the driver strings.
+	Key GetKey(const std::vector<std::string> & inputs) const;
+
+	/// Call before linking so the driver keeps the program binary around.
+	void Prepare(GLuint program) const;
+
+	/// Returns true if a cached binary with a matching key was found and accepted by the driver.
+	bool Load(GLuint program, Key key) const;
+
+	/// Store the binary of a successfully linked program.
+	void Save(GLuint program, Key key) const;
+
+	/// The file a key is stored in.
+	std::string GetFilename(Key key) const;
+
+	/// Read a program binary from the cache file of key, marking it as used.
+	bool Read(Key key, GLenum & format, std::vector<char> & binary) const;
+
+	/// Write a program binary to the cache file of key.
+	bool Write(Key key, GLenum format, const std::vector<char> & binary) const;
+
+	/// Remove the least recently used cache files until at most count are left.
+	void Trim(unsigned count) const;
+
+private:
+	std::string path;
+	std::string driver;
+	bool enabled;
+};
+
+#endif // _SHADER_CACHE_H
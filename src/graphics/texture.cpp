@@ -167,6 +167,15 @@ static void GetTextureFormat(
 	}
 }
 
+// approximate texture memory
+static unsigned long EstimateMemory(unsigned w, unsigned h, unsigned bytespp, bool compressed, bool mipmaps)
+{
+	unsigned long size = (unsigned long)w * h * (compressed ? 1 : bytespp);
+	if (mipmaps)
+		size += size / 3;
+	return size;
+}
+
 static void SetSampler(const TextureInfo & info, bool hasmiplevels = false)
 {
 	if (info.repeatu)
@@ -213,7 +222,11 @@ static void SetSampler(const TextureInfo & info, bool hasmiplevels = false)
 		glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, (float)info.anisotropy);
 }
 
-Texture::Texture()
+Texture::Texture() :
+	format(0),
+	iformat(0),
+	baselevel(0),
+	memory(0)
 {
 	// ctor
 }
@@ -345,6 +358,9 @@ bool Texture::Load(const std::string & path, const TextureInfo & info, std::ostr
 	glTexImage2D(GL_TEXTURE_2D, 0, internalformat, w, h, 0, format, GL_UNSIGNED_BYTE, pixels);
 	CheckForOpenGLErrors("Texture creation", error);
 
+	const bool compressed = info.compress && (surface->w > 512 || surface->h > 512);
+	memory = EstimateMemory(w, h, bytespp, compressed, info.mipmap || GLC_ARB_framebuffer_object);
+
 	// If we support generatemipmap, go ahead and do it regardless of the info.mipmap setting.
 	// In the GL3 renderer the sampler decides whether or not to do mip filtering,
 	// so we conservatively make mipmaps available for all textures.
@@ -361,6 +377,82 @@ void Texture::Unload()
 	if (texid)
 		glDeleteTextures(1, &texid);
 	texid = 0;
+	offsets.clear();
+	baselevel = 0;
+	memory = 0;
+}
+
+bool Texture::IsStreamable() const
+{
+	return offsets.size() > 2;
+}
+
+unsigned Texture::GetLevels() const
+{
+	return offsets.empty() ? 0 : offsets.size() - 1;
+}
+
+unsigned Texture::GetBaseLevel() const
+{
+	return baselevel;
+}
+
+unsigned long Texture::GetLevelSize(unsigned level) const
+{
+	assert(level + 1 < offsets.size());
+	return offsets[level + 1] - offsets[level];
+}
+
+unsigned long Texture::GetLevelOffset(unsigned level) const
+{
+	assert(level < offsets.size());
+	return offsets[level];
+}
+
+unsigned long Texture::GetMemory() const
+{
+	if (IsStreamable())
+		return offsets.back() - offsets[baselevel];
+	return memory;
+}
+
+void Texture::SetBaseLevel(unsigned level, const char * data, std::ostream & error)
+{
+	assert(IsStreamable() && level < GetLevels());
+	if (level == baselevel)
+		return;
+
+	glBindTexture(GL_TEXTURE_2D, texid);
+	if (level < baselevel)
+	{
+		// upload the finer levels before sampling them
+		for (unsigned i = level; i < baselevel; ++i)
+		{
+			const unsigned long size = GetLevelSize(i);
+			UploadLevel(i, data, size, error);
+			data += size;
+		}
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+	}
+	else
+	{
+		// redefine dropped levels as empty images to release their storage
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+		for (unsigned i = baselevel; i < level; ++i)
+			UploadLevel(i, 0, 0, error);
+	}
+	baselevel = level;
+}
+
+void Texture::UploadLevel(unsigned level, const char * data, unsigned long size, std::ostream & error)
+{
+	const unsigned w = data ? std::max(1u, width >> level) : 0;
+	const unsigned h = data ? std::max(1u, height >> level) : 0;
+	if (format == GL_BGR || format == GL_BGRA)
+		glTexImage2D(GL_TEXTURE_2D, level, iformat, w, h, 0, format, GL_UNSIGNED_BYTE, data);
+	else
+		glCompressedTexImage2D(GL_TEXTURE_2D, level, iformat, w, h, 0, size, data);
+	CheckForOpenGLErrors("Texture creation", error);
 }
 
 bool Texture::LoadCubeVerticalCross(const std::string & path, const TextureInfo & info, std::ostream & error)
@@ -474,6 +566,8 @@ bool Texture::LoadCubeVerticalCross(const std::string & path, const TextureInfo
 
 	CheckForOpenGLErrors("Cubemap creation", error);
 
+	memory = 6 * EstimateMemory(width, height, bytespp, false, info.mipmap);
+
 	SDL_FreeSurface(surface);
 
 	return true;
@@ -552,6 +646,7 @@ bool Texture::LoadCube(const std::string & path, const TextureInfo & info, std::
 
 		// Create MipMapped Texture
 		glTexImage2D(targetparam[i], 0, format, surface->w, surface->h, 0, format, GL_UNSIGNED_BYTE, surface->pixels );
+		memory += EstimateMemory(width, height, surface->format->BytesPerPixel, false, false);
 
 		SDL_FreeSurface(surface);
 	}
@@ -591,7 +686,6 @@ bool Texture::LoadDDS(const std::string & path, const TextureInfo & info, std::o
 	// load dds
 	const char * texdata(0);
 	unsigned long texlen(0);
-	unsigned format(0);
 	unsigned levels(0);
 	if (!ReadDDS(
 		(void*)&data[0], length,
@@ -602,7 +696,7 @@ bool Texture::LoadDDS(const std::string & path, const TextureInfo & info, std::o
 	}
 
 	// gl3 renderer expects srgb
-	unsigned iformat = format;
+	iformat = format;
 	if (info.srgb)
 	{
 		if (format == GL_BGR)
@@ -616,6 +710,31 @@ bool Texture::LoadDDS(const std::string & path, const TextureInfo & info, std::o
 		else if (format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT)
 			iformat = GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT;
 	}
+	else if (format == GL_BGR)
+	{
+		iformat = GL_RGB8;
+	}
+	else if (format == GL_BGRA)
+	{
+		iformat = GL_RGBA8;
+	}
+
+	// downsample if requested by application, by dropping mip levels
+	unsigned skip = 0;
+	const unsigned maxdim = std::max(width, height);
+	if (info.maxsize == TextureInfo::SMALL)
+		skip = (maxdim > 256) ? 2 : (maxdim > 128) ? 1 : 0;
+	else if (info.maxsize == TextureInfo::MEDIUM)
+		skip = (maxdim > 256) ? 1 : 0;
+	skip = std::min(skip, std::max(levels, 1u) - 1);
+
+	// streamed textures start out with the coarse levels only
+	unsigned base = skip;
+	if (info.streamsize > 0 && info.mipmap)
+	{
+		while (base + 1 < levels && (maxdim >> base) > unsigned(info.streamsize))
+			++base;
+	}
 
 	// load texture
 	target = GL_TEXTURE_2D;
@@ -626,36 +745,56 @@ bool Texture::LoadDDS(const std::string & path, const TextureInfo & info, std::o
 
 	glBindTexture(GL_TEXTURE_2D, texid);
 
-	SetSampler(info, levels > 1);
+	SetSampler(info, levels - skip > 1);
 
 	const char * idata = texdata;
 	unsigned blocklen = 16 * texlen / (width * height);
 	unsigned ilen = texlen;
 	unsigned iw = width;
 	unsigned ih = height;
+	offsets.clear();
 	for (unsigned i = 0; i < levels; ++i)
 	{
+		if (i == skip)
+		{
+			width = iw;
+			height = ih;
+		}
+
 		if (format == GL_BGR || format == GL_BGRA)
 		{
 			// fixme: support compression here?
 			ilen = iw * ih * blocklen / 16;
-			glTexImage2D(GL_TEXTURE_2D, i, iformat, iw, ih, 0, format, GL_UNSIGNED_BYTE, idata);
 		}
 		else
 		{
 			ilen = std::max(1u, iw / 4) * std::max(1u, ih / 4) * blocklen;
-			glCompressedTexImage2D(GL_TEXTURE_2D, i, iformat, iw, ih, 0, ilen, idata);
 		}
-		CheckForOpenGLErrors("Texture creation", error);
+
+		if (i >= skip)
+			offsets.push_back(idata - &data[0]);
+		if (i >= base)
+			UploadLevel(i - skip, idata, ilen, error);
 
 		idata += ilen;
 		iw = std::max(1u, iw / 2);
 		ih = std::max(1u, ih / 2);
 	}
+	offsets.push_back(idata - &data[0]);
+	levels -= skip;
+
+	baselevel = base - skip;
+	if (baselevel > 0)
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, baselevel);
 
 	// force mipmaps for GL3
-	if (levels == 1 && GLC_ARB_framebuffer_object)
+	const bool genmipmap = (levels == 1 && GLC_ARB_framebuffer_object);
+	if (genmipmap)
 		glGenerateMipmap(GL_TEXTURE_2D);
 
+	memory = offsets.back() - offsets[baselevel];
+	if (genmipmap)
+		memory += memory / 3;
+
 	return true;
 }
@@ -25,6 +25,7 @@
 
 #include <iosfwd>
 #include <string>
+#include <vector>
 
 class Texture : public TextureInterface
 {
@@ -37,7 +38,40 @@ public:
 
 	void Unload();
 
+	/// Textures loaded from mipmapped dds files can have their finer mip levels
+	/// dropped and streamed back in, see TextureStreamer.
+	bool IsStreamable() const;
+
+	/// Number of mip levels of a dds texture, 0 otherwise.
+	unsigned GetLevels() const;
+
+	/// Finest resident mip level.
+	unsigned GetBaseLevel() const;
+
+	/// Size in bytes of a dds mip level.
+	unsigned long GetLevelSize(unsigned level) const;
+
+	/// Offset in bytes of a dds mip level in the texture file.
+	/// The levels of a file are stored back to back, finest first.
+	unsigned long GetLevelOffset(unsigned level) const;
+
+	/// Approximate size in bytes of the resident mip levels.
+	unsigned long GetMemory() const;
+
+	/// Make mip levels [level, GetLevels()) resident. When raising residency
+	/// data holds levels [level, GetBaseLevel()) as stored in the texture file.
+	/// Dropped levels are released. Binds the texture, the id doesn't change.
+	void SetBaseLevel(unsigned level, const char * data, std::ostream & error);
+
 private:
+	std::vector<unsigned long> offsets; ///< dds file offsets of the mip levels and their end
+	unsigned format;
+	unsigned iformat;
+	unsigned baselevel;
+	unsigned long memory;
+
+	void UploadLevel(unsigned level, const char * data, unsigned long size, std::ostream & error);
+
 	bool LoadCubeVerticalCross(const std::string & path, const TextureInfo & info, std::ostream & error);
 
 	bool LoadCube(const std::string & path, const TextureInfo & info, std::ostream & error);
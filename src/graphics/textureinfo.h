@@ -28,6 +28,7 @@ struct TextureInfo
 	short height;			///< texture height, only set if data not null
 	char bytespp;			///< bytes per pixel, only set if data not null
 	char anisotropy;		///< anisotropic filter level
+	short streamsize;		///< if not zero, mipmapped dds files only load levels up to this size
 	Size maxsize;			///< max texture size 128, 256, 2048
 	bool mipmap;			///< build mip maps
 	bool cube;				///< is a cube map
@@ -46,6 +47,7 @@ struct TextureInfo
 		height(0),
 		bytespp(4),
 		anisotropy(0),
+		streamsize(0),
 		maxsize(LARGE),
 		mipmap(true),
 		cube(false),
@@ -0,0 +1,456 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#include "texturestreamer.h"
+#include "texture.h"
+#include "glcore.h"
+#include "unittest.h"
+
+#include <SDL2/SDL_thread.h>
+#include <algorithm>
+#include <cassert>
+#include <fstream>
+#include <ostream>
+
+// Level loads queued at once, keeps the loads in flight close to the current view.
+static const unsigned max_pending = 4;
+
+static bool ReadLevels(const std::string & path, unsigned long begin, unsigned long end, std::vector<char> & data)
+{
+	std::ifstream file(path.c_str(), std::ifstream::in | std::ifstream::binary);
+	if (!file || end <= begin)
+		return false;
+
+	data.resize(end - begin);
+	file.seekg(begin);
+	file.read(&data[0], end - begin);
+	return file.good();
+}
+
+TextureStreamer::TextureStreamer() :
+	budget(0),
+	pending_memory(0),
+	stream_size(0),
+	serial(0),
+	frame(0),
+	stats(),
+	lock(SDL_CreateMutex()),
+	wake(SDL_CreateCond()),
+	stopping(false),
+	loader_thread(0)
+{
+	// ctor
+}
+
+TextureStreamer::~TextureStreamer()
+{
+	Deinit();
+	SDL_DestroyCond(wake);
+	SDL_DestroyMutex(lock);
+}
+
+bool TextureStreamer::Init(unsigned long new_budget, unsigned new_stream_size, std::ostream & error_output)
+{
+	Deinit();
+
+	budget = new_budget;
+	stream_size = std::max(new_stream_size, 1u);
+	stats.budget = budget;
+
+	stopping = false;
+	loader_thread = SDL_CreateThread(LoaderThread, "texture streamer", this);
+	if (!loader_thread)
+	{
+		error_output << "Failed to start texture streaming thread." << std::endl;
+		return false;
+	}
+	return true;
+}
+
+void TextureStreamer::Deinit()
+{
+	if (!loader_thread)
+		return;
+
+	SDL_LockMutex(lock);
+	stopping = true;
+	SDL_CondSignal(wake);
+	SDL_UnlockMutex(lock);
+	SDL_WaitThread(loader_thread, 0);
+	loader_thread = 0;
+
+	queued.clear();
+	done.clear();
+	finished.clear();
+	entries.clear();
+	pending_memory = 0;
+	stats = Stats();
+}
+
+void TextureStreamer::Add(const std::shared_ptr<Texture> & texture, const std::string & path, bool stream)
+{
+	if (!Enabled() || !texture->GetId())
+		return;
+
+	Entry & entry = entries[texture->GetId()];
+	entry.texture = texture;
+	entry.path = path;
+	entry.serial = ++serial;
+	entry.size = std::max(texture->GetW(), texture->GetH());
+	entry.levels = (stream && texture->IsStreamable()) ? texture->GetLevels() : 0;
+	entry.floor = texture->GetBaseLevel();
+	entry.top = 0;
+	entry.want = entry.floor;
+	entry.used = frame - 1;
+	entry.pixels = 0;
+	entry.loading = false;
+}
+
+void TextureStreamer::Request(unsigned texid, float pixels)
+{
+	if (!texid)
+		return;
+
+	auto i = entries.find(texid);
+	if (i == entries.end() || !i->second.levels)
+		return;
+
+	Entry & entry = i->second;
+	const unsigned level = SelectLevel(entry.size, entry.levels, pixels);
+	if (entry.used != frame)
+	{
+		entry.used = frame;
+		entry.want = level;
+		entry.pixels = pixels;
+	}
+	else
+	{
+		entry.want = std::min(entry.want, level);
+		entry.pixels = std::max(entry.pixels, pixels);
+	}
+}
+
+void TextureStreamer::Update(std::ostream & error_output)
+{
+	if (!Enabled())
+		return;
+
+	// streaming binds the textures it changes, restore the binding afterwards
+	GLint binding = 0;
+	bool bound = false;
+	auto save_binding = [&]()
+	{
+		if (!bound)
+			glGetIntegerv(GL_TEXTURE_BINDING_2D, &binding);
+		bound = true;
+	};
+
+	// upload the levels read by the loader thread
+	SDL_LockMutex(lock);
+	finished.swap(done);
+	SDL_UnlockMutex(lock);
+
+	for (auto & job : finished)
+	{
+		pending_memory -= job.end - job.begin;
+		stats.pending--;
+
+		auto i = entries.find(job.texid);
+		if (i == entries.end() || i->second.serial != job.serial)
+			continue;
+
+		Entry & entry = i->second;
+		entry.loading = false;
+
+		std::shared_ptr<Texture> texture = entry.texture.lock();
+		if (!texture || texture->GetBaseLevel() != job.base)
+			continue;
+
+		if (!job.ok)
+		{
+			error_output << "Failed to stream texture levels: " << job.path << std::endl;
+			entry.top = job.base;
+			continue;
+		}
+
+		save_binding();
+		texture->SetBaseLevel(job.level, &job.data[0], error_output);
+		stats.loads++;
+	}
+	finished.clear();
+
+	// account resident memory and collect the textures to raise or lower
+	unsigned long memory = 0;
+	stats.streamed = 0;
+	loads.clear();
+	drops.clear();
+	for (auto i = entries.begin(); i != entries.end();)
+	{
+		Entry & entry = i->second;
+		std::shared_ptr<Texture> texture = entry.texture.lock();
+		if (!texture)
+		{
+			i = entries.erase(i);
+			continue;
+		}
+		++i;
+
+		memory += texture->GetMemory();
+		if (!entry.levels || entry.loading)
+			continue;
+
+		// visible textures want the level matching their screen size,
+		// the others can fall back to the level they were loaded with
+		const unsigned base = texture->GetBaseLevel();
+		const bool visible = (entry.used == frame);
+		const unsigned level = std::max(visible ? entry.want : entry.floor, entry.top);
+		if (base > 0)
+			stats.streamed++;
+		if (visible && level < base)
+		{
+			const unsigned long bytes = texture->GetLevelOffset(base) - texture->GetLevelOffset(level);
+			loads.push_back(Candidate{&entry, texture.get(), level, bytes, entry.pixels, entry.used, false});
+		}
+		else if (level > base)
+		{
+			const unsigned long bytes = texture->GetLevelOffset(level) - texture->GetLevelOffset(base);
+			drops.push_back(Candidate{&entry, texture.get(), level, bytes, entry.pixels, entry.used, false});
+		}
+	}
+
+	memory = SelectChanges(loads, drops, memory, pending_memory, stats.pending, budget);
+
+	for (const auto & drop : drops)
+	{
+		if (!drop.selected)
+			continue;
+
+		save_binding();
+		drop.texture->SetBaseLevel(drop.level, 0, error_output);
+		stats.drops++;
+	}
+
+	// queue the selected loads and wake the loader thread
+	SDL_LockMutex(lock);
+	for (const auto & load : loads)
+	{
+		if (!load.selected)
+			continue;
+
+		const unsigned base = load.texture->GetBaseLevel();
+		const unsigned long begin = load.texture->GetLevelOffset(load.level);
+		const unsigned long end = load.texture->GetLevelOffset(base);
+
+		Job job;
+		job.texid = load.texture->GetId();
+		job.serial = load.entry->serial;
+		job.path = load.entry->path;
+		job.base = base;
+		job.level = load.level;
+		job.begin = begin;
+		job.end = end;
+		job.ok = false;
+		queued.push_back(std::move(job));
+
+		load.entry->loading = true;
+		pending_memory += end - begin;
+		stats.pending++;
+	}
+	if (!queued.empty())
+		SDL_CondSignal(wake);
+	SDL_UnlockMutex(lock);
+
+	if (bound)
+		glBindTexture(GL_TEXTURE_2D, binding);
+
+	stats.memory = memory;
+	stats.textures = entries.size();
+	frame++;
+}
+
+void TextureStreamer::PrintProfilingInfo(std::ostream & out) const
+{
+	if (!Enabled())
+		return;
+
+	out << "textures: " << stats.memory / (1024 * 1024) << " / " << stats.budget / (1024 * 1024) << " MB, ";
+	out << stats.streamed << " of " << stats.textures << " streamed" << std::endl;
+	out << "texture levels: " << stats.pending << " pending, " << stats.loads << " loaded, " << stats.drops << " dropped" << std::endl;
+}
+
+unsigned TextureStreamer::SelectLevel(unsigned size, unsigned levels, float pixels)
+{
+	unsigned level = 0;
+	while (level + 1 < levels && float(size >> (level + 1)) >= pixels)
+		++level;
+	return level;
+}
+
+unsigned long TextureStreamer::SelectChanges(
+	std::vector<Candidate> & loads,
+	std::vector<Candidate> & drops,
+	unsigned long memory,
+	unsigned long pending_memory,
+	unsigned pending,
+	unsigned long budget)
+{
+	// nearest textures load first
+	std::sort(loads.begin(), loads.end(), [](const Candidate & a, const Candidate & b)
+	{
+		return a.pixels > b.pixels;
+	});
+	if (loads.size() + pending > max_pending)
+		loads.resize(max_pending > pending ? max_pending - pending : 0);
+
+	unsigned long required = memory + pending_memory;
+	for (const auto & load : loads)
+		required += load.bytes;
+
+	// drop levels of the least recently used textures until the loads fit
+	if (required > budget)
+	{
+		std::sort(drops.begin(), drops.end(), [](const Candidate & a, const Candidate & b)
+		{
+			return a.used < b.used;
+		});
+		for (auto & drop : drops)
+		{
+			if (required <= budget)
+				break;
+
+			drop.selected = true;
+			memory -= drop.bytes;
+			required -= drop.bytes;
+		}
+	}
+
+	// load what fits the budget after the drops
+	for (auto & load : loads)
+	{
+		if (memory + pending_memory + load.bytes > budget)
+			continue;
+
+		load.selected = true;
+		pending_memory += load.bytes;
+	}
+
+	return memory;
+}
+
+int TextureStreamer::LoaderThread(void * streamer)
+{
+	static_cast<TextureStreamer*>(streamer)->LoadLevels();
+	return 0;
+}
+
+void TextureStreamer::LoadLevels()
+{
+	Job job;
+	while (true)
+	{
+		SDL_LockMutex(lock);
+		while (queued.empty() && !stopping)
+			SDL_CondWait(wake, lock);
+		if (stopping)
+		{
+			SDL_UnlockMutex(lock);
+			break;
+		}
+		job = std::move(queued.front());
+		queued.pop_front();
+		SDL_UnlockMutex(lock);
+
+		job.ok = ReadLevels(job.path, job.begin, job.end, job.data);
+
+		SDL_LockMutex(lock);
+		done.push_back(std::move(job));
+		SDL_UnlockMutex(lock);
+	}
+}
+
+QT_TEST(texturestreamer_test)
+{
+	// 1024 texels, 11 levels
+	QT_CHECK_EQUAL(TextureStreamer::SelectLevel(1024, 11, 4096), 0u);
+	QT_CHECK_EQUAL(TextureStreamer::SelectLevel(1024, 11, 1024), 0u);
+	QT_CHECK_EQUAL(TextureStreamer::SelectLevel(1024, 11, 1000), 0u);
+	QT_CHECK_EQUAL(TextureStreamer::SelectLevel(1024, 11, 512), 1u);
+	QT_CHECK_EQUAL(TextureStreamer::SelectLevel(1024, 11, 300), 1u);
+	QT_CHECK_EQUAL(TextureStreamer::SelectLevel(1024, 11, 1), 10u);
+	QT_CHECK_EQUAL(TextureStreamer::SelectLevel(1024, 11, 0), 10u);
+
+	// truncated mip chain
+	QT_CHECK_EQUAL(TextureStreamer::SelectLevel(1024, 4, 0), 3u);
+	QT_CHECK_EQUAL(TextureStreamer::SelectLevel(1024, 1, 0), 0u);
+}
+
+QT_TEST(texturestreamer_select_test)
+{
+	typedef TextureStreamer::Candidate Candidate;
+	auto load = [](unsigned long bytes, float pixels)
+	{
+		return Candidate{0, 0, 0, bytes, pixels, 0, false};
+	};
+	auto drop = [](unsigned long bytes, unsigned used)
+	{
+		return Candidate{0, 0, 0, bytes, 0, used, false};
+	};
+
+	// within budget nothing is dropped
+	{
+		std::vector<Candidate> loads = {load(100, 10)};
+		std::vector<Candidate> drops = {drop(100, 1)};
+		QT_CHECK_EQUAL(TextureStreamer::SelectChanges(loads, drops, 500, 100, 1, 1000), 500u);
+		QT_CHECK(loads[0].selected);
+		QT_CHECK(!drops[0].selected);
+	}
+
+	// least recently used textures drop until the loads fit, nearest loads first
+	{
+		std::vector<Candidate> loads = {load(300, 100), load(300, 500)};
+		std::vector<Candidate> drops = {drop(200, 5), drop(100, 2), drop(100, 7)};
+		QT_CHECK_EQUAL(TextureStreamer::SelectChanges(loads, drops, 600, 0, 0, 1000), 300u);
+		QT_CHECK_EQUAL(drops[0].used, 2u);
+		QT_CHECK(drops[0].selected);
+		QT_CHECK(drops[1].selected);
+		QT_CHECK(!drops[2].selected);
+		QT_CHECK_CLOSE(loads[0].pixels, 500, 0);
+		QT_CHECK(loads[0].selected);
+		QT_CHECK(loads[1].selected);
+	}
+
+	// loads are trimmed to the pending limit
+	{
+		std::vector<Candidate> loads = {load(10, 1), load(10, 3), load(10, 2)};
+		std::vector<Candidate> drops;
+		TextureStreamer::SelectChanges(loads, drops, 0, 30, 3, 1000);
+		QT_CHECK_EQUAL(loads.size(), 1u);
+		QT_CHECK_CLOSE(loads[0].pixels, 3, 0);
+		QT_CHECK(loads[0].selected);
+	}
+
+	// loads that don't fit after all drops wait
+	{
+		std::vector<Candidate> loads = {load(200, 10)};
+		std::vector<Candidate> drops = {drop(50, 1)};
+		QT_CHECK_EQUAL(TextureStreamer::SelectChanges(loads, drops, 400, 0, 0, 500), 350u);
+		QT_CHECK(drops[0].selected);
+		QT_CHECK(!loads[0].selected);
+	}
+}
@@ -0,0 +1,178 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef _TEXTURESTREAMER_H
+#define _TEXTURESTREAMER_H
+
+#include <SDL2/SDL_mutex.h>
+#include <deque>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class Texture;
+struct SDL_Thread;
+
+/// Keeps the resident texture memory under a budget by streaming mip levels.
+///
+/// Streamable textures (mipmapped dds files) are loaded with the levels up
+/// to the stream size only. Culling reports the screen size of the textures
+/// of visible drawables. Once per frame Update uploads the levels read by the
+/// loader thread, drops the finer levels of the least recently used textures
+/// while over budget and queues reads of the levels visible textures miss.
+/// Other textures stay fully resident, but count against the budget.
+class TextureStreamer
+{
+private:
+	struct Entry;
+
+public:
+	struct Stats
+	{
+		unsigned long memory; ///< resident texture bytes
+		unsigned long budget; ///< texture budget in bytes
+		unsigned textures; ///< tracked textures
+		unsigned streamed; ///< textures missing fine levels
+		unsigned pending; ///< queued level loads
+		unsigned loads; ///< completed level loads
+		unsigned drops; ///< level drops
+	};
+
+	TextureStreamer();
+
+	~TextureStreamer();
+
+	/// Start the loader thread. Streamable textures are loaded with levels
+	/// up to stream_size texels, finer levels are streamed within budget bytes.
+	bool Init(unsigned long budget, unsigned stream_size, std::ostream & error_output);
+
+	/// Stop the loader thread and forget all textures.
+	void Deinit();
+
+	bool Enabled() const
+	{
+		return loader_thread != 0;
+	}
+
+	unsigned GetStreamSize() const
+	{
+		return stream_size;
+	}
+
+	/// Track a texture loaded from path. Textures that can't stream, or
+	/// shouldn't (sampled without mip filtering), only count against the budget.
+	void Add(const std::shared_ptr<Texture> & texture, const std::string & path, bool stream);
+
+	/// Texture texid is visible this frame, covering pixels screen pixels.
+	void Request(unsigned texid, float pixels);
+
+	/// Upload loaded levels, drop levels over budget and queue level loads.
+	/// Call once per frame from the render thread, after culling.
+	void Update(std::ostream & error_output);
+
+	const Stats & GetStats() const
+	{
+		return stats;
+	}
+
+	void PrintProfilingInfo(std::ostream & out) const;
+
+	/// Coarsest mip level of size texels still covering pixels screen pixels.
+	static unsigned SelectLevel(unsigned size, unsigned levels, float pixels);
+
+	/// A texture level change Update considers.
+	struct Candidate
+	{
+		Entry * entry;
+		Texture * texture;
+		unsigned level;
+		unsigned long bytes; ///< memory the change loads or frees
+		float pixels; ///< screen size, nearest textures load first
+		unsigned used; ///< frame of the last request, least recently used textures drop first
+		bool selected; ///< set by SelectChanges
+	};
+
+	/// Select the loads and drops of a frame, given the resident and pending
+	/// memory and the number of pending loads. Loads are trimmed to the pending
+	/// limit, drops are selected until the remaining loads fit the budget, then
+	/// the loads still fitting it are selected. Returns the memory after the drops.
+	static unsigned long SelectChanges(
+		std::vector<Candidate> & loads,
+		std::vector<Candidate> & drops,
+		unsigned long memory,
+		unsigned long pending_memory,
+		unsigned pending,
+		unsigned long budget);
+
+private:
+	struct Entry
+	{
+		std::weak_ptr<Texture> texture;
+		std::string path;
+		unsigned serial; ///< tells apart textures reusing an id
+		unsigned size; ///< max dimension of level 0
+		unsigned levels;
+		unsigned floor; ///< level the texture was loaded with
+		unsigned top; ///< finest level that can be loaded
+		unsigned want; ///< level requested in the current frame
+		unsigned used; ///< frame of the last request
+		float pixels; ///< screen size in the current frame
+		bool loading;
+	};
+
+	struct Job
+	{
+		unsigned texid;
+		unsigned serial;
+		std::string path;
+		unsigned base; ///< base level of the texture when queued
+		unsigned level; ///< level to load
+		unsigned long begin; ///< file offset of level
+		unsigned long end; ///< file offset of base
+		std::vector<char> data;
+		bool ok;
+	};
+
+	std::unordered_map<unsigned, Entry> entries;
+	std::vector<Candidate> loads;
+	std::vector<Candidate> drops;
+	std::vector<Job> finished;
+	unsigned long budget;
+	unsigned long pending_memory;
+	unsigned stream_size;
+	unsigned serial;
+	unsigned frame;
+	Stats stats;
+
+	// shared with the loader thread
+	SDL_mutex * lock;
+	SDL_cond * wake; ///< signaled when a job is queued or the thread should stop
+	std::deque<Job> queued;
+	std::vector<Job> done;
+	bool stopping;
+	SDL_Thread * loader_thread;
+
+	static int LoaderThread(void * streamer);
+
+	void LoadLevels();
+};
+
+#endif // _TEXTURESTREAMER_H
@@ -189,6 +189,11 @@ void VertexArray::Add(
 	SetColors(newcol, newcolcount, colors.size());
 
 	assert(!vertices.empty());
+	UpdateFormat();
+}
+
+void VertexArray::UpdateFormat()
+{
 	format = VertexFormat::P3;
 	if (!texcoords.empty())
 	{
@@ -166,6 +166,8 @@ public:
 		//_SERIALIZE_(s,colors); fixme
 		_SERIALIZE_(s,texcoords);
 		_SERIALIZE_(s,faces);
+		if (s.GetIODirection() == Serializer::DIRECTION_INPUT)
+			UpdateFormat();
 		return true;
 	}
 
@@ -178,6 +180,9 @@ private:
 	std::vector <unsigned int> faces;
 	VertexFormat::Enum format;
 
+	// derive vertex format from the available attributes
+	void UpdateFormat();
+
 	void SetColors(const unsigned char array[], unsigned count, unsigned offset = 0);
 
 	void SetTexCoords(const float array[], unsigned count, unsigned offset = 0);
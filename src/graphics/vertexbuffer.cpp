@@ -212,19 +212,6 @@ VertexBuffer::VertexBuffer() :
 	// ctor
 }
 
-VertexBuffer::Segment::Segment() :
-	ioffset(0),
-	icount(0),
-	voffset(0),
-	vcount(0),
-	vbuffer(0),
-	vformat(VertexFormat::LastFormat),
-	object(0),
-	age(0)
-{
-	// ctor
-}
-
 VertexBuffer::Object::Object() :
 	icapacity(0),
 	vcapacity(0),
@@ -62,7 +62,20 @@ public:
 		unsigned char vformat;		///< vertex format
 		unsigned char object;		///< object this segment belongs to
 		unsigned short age;			///< segment age
-		Segment();
+
+		// inline, models use segments without linking the buffer code
+		Segment() :
+			ioffset(0),
+			icount(0),
+			voffset(0),
+			vcount(0),
+			vbuffer(0),
+			vformat(VertexFormat::LastFormat),
+			object(0),
+			age(0)
+		{
+			// ctor
+		}
 	};
 
 	/// \brief Draw vertex buffer segment
@@ -0,0 +1,137 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#include "input_sampler.h"
+#include "perfclock.h"
+
+#include <SDL2/SDL_joystick.h>
+#include <SDL2/SDL_thread.h>
+#include <SDL2/SDL_timer.h>
+#include <ostream>
+
+InputSampler::InputSampler() :
+	thread(0),
+	stopping(false),
+	period(1000),
+	probe_period(0),
+	probe_type(0),
+	probe_count(0),
+	latency_sum(0),
+	latency_max(0)
+{
+	// ctor
+}
+
+InputSampler::~InputSampler()
+{
+	Stop();
+}
+
+bool InputSampler::Start(unsigned rate_hz, unsigned probe_hz, std::ostream & error_output)
+{
+	Stop();
+
+	if (rate_hz == 0)
+		return false;
+
+	if (probe_hz > 0 && probe_type == 0)
+	{
+		probe_type = SDL_RegisterEvents(1);
+		if (probe_type == (Uint32)-1)
+		{
+			error_output << "Failed to register input latency probe event" << std::endl;
+			probe_type = 0;
+			return false;
+		}
+	}
+
+	period = 1000000 / rate_hz;
+	probe_period = probe_hz > 0 ? 1000000 / probe_hz : 0;
+	probe_count = 0;
+	latency_sum = 0;
+	latency_max = 0;
+
+	stopping.store(false, std::memory_order_relaxed);
+	thread = SDL_CreateThread(SamplerThread, "input", this);
+	if (!thread)
+	{
+		error_output << "Failed to create input sampling thread: " << SDL_GetError() << std::endl;
+		return false;
+	}
+	return true;
+}
+
+void InputSampler::Stop()
+{
+	if (!thread)
+		return;
+
+	stopping.store(true, std::memory_order_release);
+	SDL_WaitThread(thread, 0);
+	thread = 0;
+}
+
+void InputSampler::RecordProbe(const SDL_Event & probe, unsigned long long now)
+{
+	// probe code holds the low 32 bits of the injection time
+	const Uint32 latency = Uint32(now) - Uint32(probe.user.code);
+	probe_count++;
+	latency_sum += latency;
+	if (latency > latency_max)
+		latency_max = latency;
+}
+
+int InputSampler::SamplerThread(void * sampler)
+{
+	static_cast<InputSampler *>(sampler)->Sample();
+	return 0;
+}
+
+void InputSampler::Sample()
+{
+	SDL_SetThreadPriority(SDL_THREAD_PRIORITY_HIGH);
+
+	unsigned long long next_sample = GetPerfClockTime();
+	unsigned long long next_probe = next_sample;
+	while (!stopping.load(std::memory_order_acquire))
+	{
+		// joystick updates push their events with the current timestamp
+		SDL_LockJoysticks();
+		SDL_JoystickUpdate();
+		SDL_UnlockJoysticks();
+
+		unsigned long long now = GetPerfClockTime();
+		if (probe_period > 0 && now >= next_probe)
+		{
+			SDL_Event probe;
+			SDL_zero(probe);
+			probe.type = probe_type;
+			probe.user.code = Sint32(Uint32(now));
+			SDL_PushEvent(&probe);
+			next_probe += probe_period;
+		}
+
+		next_sample += period;
+		now = GetPerfClockTime();
+		if (next_sample > now)
+			SDL_Delay(Uint32((next_sample - now + 999) / 1000));
+		else
+			next_sample = now;
+	}
+}
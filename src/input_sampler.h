@@ -0,0 +1,97 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef _INPUT_SAMPLER_H
+#define _INPUT_SAMPLER_H
+
+#include <SDL2/SDL_events.h>
+#include <atomic>
+#include <iosfwd>
+
+struct SDL_Thread;
+
+/// Joystick sampling thread. The main thread only pumps events once per
+/// frame, so joystick events would all carry the pump time. The sampler
+/// updates the joysticks at a fixed rate, queueing their events with the
+/// time they arrived, which lets the event system hand each event to the
+/// physics tick it belongs to.
+///
+/// In latency measurement mode it also injects probe events carrying the
+/// injection time. The game reports the probe when the tick consuming it
+/// has finished its physics step.
+class InputSampler
+{
+public:
+	InputSampler();
+
+	~InputSampler();
+
+	/// Start sampling rate_hz times per second, inject probe_hz probes
+	/// per second if probe_hz > 0.
+	bool Start(unsigned rate_hz, unsigned probe_hz, std::ostream & error_output);
+
+	void Stop();
+
+	bool Running() const
+	{
+		return thread != 0;
+	}
+
+	/// Event type of the latency probes, 0 if not measuring.
+	Uint32 GetProbeType() const
+	{
+		return probe_type;
+	}
+
+	/// A tick consumed probe and finished physics at time now.
+	void RecordProbe(const SDL_Event & probe, unsigned long long now);
+
+	unsigned GetProbeCount() const
+	{
+		return probe_count;
+	}
+
+	/// Average input to physics latency in microseconds.
+	double GetAverageLatency() const
+	{
+		return probe_count ? double(latency_sum) / probe_count : 0;
+	}
+
+	/// Worst input to physics latency in microseconds.
+	unsigned long long GetMaxLatency() const
+	{
+		return latency_max;
+	}
+
+private:
+	SDL_Thread * thread;
+	std::atomic<bool> stopping;
+	unsigned period; ///< sampling period in microseconds
+	unsigned probe_period; ///< probe period in microseconds, 0 if off
+	Uint32 probe_type;
+	unsigned probe_count;
+	unsigned long long latency_sum;
+	unsigned long long latency_max;
+
+	static int SamplerThread(void * sampler);
+
+	void Sample();
+};
+
+#endif // _INPUT_SAMPLER_H
@@ -22,6 +22,7 @@
 #include "unittest.h"
 
 #include <unordered_map>
+#include <algorithm>
 #include <fstream>
 #include <cassert>
 
@@ -194,6 +195,15 @@ void JoePack::Close()
 	impl->Close();
 }
 
+void JoePack::GetFileList(std::vector<std::string> & names) const
+{
+	names.clear();
+	names.reserve(impl->fat.size());
+	for (const auto & entry : impl->fat)
+		names.push_back(entry.first);
+	std::sort(names.begin(), names.end());
+}
+
 void JoePack::fclose() const
 {
 	impl->fclose();
@@ -230,4 +240,9 @@ QT_TEST(joepack_test)
 	string comparisonstr = "This is\na test.\n";
 	string filestr = buf;
 	QT_CHECK_EQUAL(buf,comparisonstr);
+
+	std::vector<string> names;
+	p.GetFileList(names);
+	QT_CHECK(std::find(names.begin(), names.end(), "testlist.txt") != names.end());
+	QT_CHECK(std::is_sorted(names.begin(), names.end()));
 }
@@ -21,6 +21,7 @@
 #define _JOEPACK_H
 
 #include <string>
+#include <vector>
 
 class JoePack
 {
@@ -35,6 +36,9 @@ public:
 
 	void Close();
 
+	/// Names of the files in the pack, sorted.
+	void GetFileList(std::vector<std::string> & names) const;
+
 	bool fopen(const std::string & fn) const;
 
 	void fclose() const;
@@ -22,6 +22,8 @@
 #include "quaternion.h"
 #include "unittest.h"
 
+#include <vector>
+
 QT_TEST(matrix4_test)
 {
 	Quat quat;
@@ -53,3 +55,98 @@ QT_TEST(matrix4_test)
 	QT_CHECK_CLOSE(in[1], orig[1], 0.001);
 	QT_CHECK_CLOSE(in[2], orig[2], 0.001);
 }
+
+static void RandomMatrix(Mat4 & m, unsigned & seed)
+{
+	for (int i = 0; i < 16; ++i)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		m[i] = (seed >> 8) * (2.0f / 16777216.0f) - 1.0f;
+	}
+}
+
+QT_TEST(matrix4_batch_test)
+{
+	unsigned seed = 1;
+	Mat4 a, b;
+	RandomMatrix(a, seed);
+	RandomMatrix(b, seed);
+
+	// float specialization against the generic implementation
+	float scalar[16];
+	Matrix4Helper::Multiply<float>(a.GetArray(), b.GetArray(), scalar);
+	Mat4 c = a.Multiply(b);
+	for (int i = 0; i < 16; ++i)
+	{
+		QT_CHECK_CLOSE(c[i], scalar[i], 1E-5);
+	}
+
+	Vec3 points[5];
+	for (int i = 0; i < 5; ++i)
+	{
+		points[i].Set(i, -2.0f * i, 0.5f + i);
+	}
+
+	Vec3 out[5];
+	a.TransformVectorsOut(points, out, 5);
+	a.TransformVectorsOut(points, points, 5);
+	for (int i = 0; i < 5; ++i)
+	{
+		Vec3 p(i, -2.0f * i, 0.5f + i);
+		a.TransformVectorOut(p[0], p[1], p[2]);
+		QT_CHECK_CLOSE(out[i][0], p[0], 1E-4);
+		QT_CHECK_CLOSE(out[i][1], p[1], 1E-4);
+		QT_CHECK_CLOSE(out[i][2], p[2], 1E-4);
+		QT_CHECK_EQUAL(points[i], out[i]);
+	}
+}
+
+QT_BENCHMARK(matrix4_benchmark)
+{
+	const unsigned iterations = 1000000;
+	unsigned seed = 1;
+	Mat4 a, b, c;
+	RandomMatrix(a, seed);
+	RandomMatrix(b, seed);
+
+	float sink = 0;
+	QT_TIME("Mat4 multiply scalar", iterations,
+		Matrix4Helper::Multiply<float>(a.GetArray(), b.GetArray(), c.GetArray());
+		a[12] = c[0] * 1E-6f);
+	sink += c[0];
+	QT_TIME("Mat4 multiply", iterations,
+		c = a.Multiply(b);
+		a[12] = c[0] * 1E-6f);
+	sink += c[0];
+
+	std::vector<Vec3> points(1024, Vec3(1, 2, 3)), results(1024);
+	QT_TIME("Mat4 transform 1024 points scalar", iterations / 1000,
+		Matrix4Helper::TransformPoints<float>(a.GetArray(), &points[0][0], &results[0][0], points.size());
+		points[0][0] = results[0][0] * 1E-6f);
+	sink += results[0][0];
+	QT_TIME("Mat4 transform 1024 points", iterations / 1000,
+		a.TransformVectorsOut(&points[0], &results[0], points.size());
+		points[0][0] = results[0][0] * 1E-6f);
+	sink += results[0][0];
+	QT_TIME("Mat4 transform 1024 points one by one", iterations / 1000,
+		for (unsigned i = 0; i < points.size(); ++i)
+		{
+			results[i] = points[i];
+			a.TransformVectorOut(results[i][0], results[i][1], results[i][2]);
+		}
+		points[0][0] = results[0][0] * 1E-6f);
+	sink += results[0][0];
+
+	Quat q;
+	q.Rotate(0.3, 0, 0, 1);
+	Vec3 v(1, 0, 0);
+	QT_TIME("Quat RotateVector", iterations,
+		q.RotateVector(v));
+	sink += v[0];
+	QT_TIME("Quat GetMatrix4", iterations,
+		q.GetMatrix4(c);
+		q[0] += c[1] * 1E-9f);
+	sink += c[0];
+
+	out << "\t(" << sink << ")" << std::endl;
+}
@@ -21,11 +21,82 @@
 #define _MATRIX4_H
 
 #include "mathvector.h"
+#include "simd.h"
 
 #include <cstring>
 #include <cmath>
 #include <cassert>
 
+namespace Matrix4Helper
+{
+/// out = a * b with row vectors, out must not alias a or b
+template <typename T>
+inline void Multiply(const T * a, const T * b, T * out)
+{
+	for (int i = 0, i4 = 0; i < 4; i++,i4+=4)
+	{
+		for (int j = 0; j < 4; j++)
+		{
+			out[i4+j] = 0;
+
+			for (int k = 0, k4 = 0; k < 4; k ++,k4+=4)
+				out[i4+j] += a[i4+k]*b[k4+j];
+		}
+	}
+}
+
+/// transform count points stored as consecutive xyz triplets, in and out may be the same
+template <typename T>
+inline void TransformPoints(const T * m, const T * in, T * out, unsigned count)
+{
+	// local copy, out might alias m as far as the compiler knows
+	const T m0 = m[0], m1 = m[1], m2 = m[2];
+	const T m4 = m[4], m5 = m[5], m6 = m[6];
+	const T m8 = m[8], m9 = m[9], m10 = m[10];
+	const T m12 = m[12], m13 = m[13], m14 = m[14];
+	for (unsigned i = 0; i < count; ++i, in += 3, out += 3)
+	{
+		const T x = in[0], y = in[1], z = in[2];
+		out[0] = x * m0 + y * m4 + z * m8 + m12;
+		out[1] = x * m1 + y * m5 + z * m9 + m13;
+		out[2] = x * m2 + y * m6 + z * m10 + m14;
+	}
+}
+
+#if defined(SIMD_ENABLED)
+inline void Multiply(const float * a, const float * b, float * out)
+{
+	const Simd::float4 b0 = Simd::Load(b);
+	const Simd::float4 b1 = Simd::Load(b + 4);
+	const Simd::float4 b2 = Simd::Load(b + 8);
+	const Simd::float4 b3 = Simd::Load(b + 12);
+	for (int i4 = 0; i4 < 16; i4 += 4)
+	{
+		Simd::float4 r = Simd::Mul(Simd::Splat(a[i4]), b0);
+		r = Simd::MulAdd(r, Simd::Splat(a[i4+1]), b1);
+		r = Simd::MulAdd(r, Simd::Splat(a[i4+2]), b2);
+		r = Simd::MulAdd(r, Simd::Splat(a[i4+3]), b3);
+		Simd::Store(out + i4, r);
+	}
+}
+
+inline void TransformPoints(const float * m, const float * in, float * out, unsigned count)
+{
+	const Simd::float4 m0 = Simd::Load(m);
+	const Simd::float4 m1 = Simd::Load(m + 4);
+	const Simd::float4 m2 = Simd::Load(m + 8);
+	const Simd::float4 m3 = Simd::Load(m + 12);
+	for (unsigned i = 0; i < count; ++i, in += 3, out += 3)
+	{
+		Simd::float4 r = Simd::MulAdd(m3, Simd::Splat(in[0]), m0);
+		r = Simd::MulAdd(r, Simd::Splat(in[1]), m1);
+		r = Simd::MulAdd(r, Simd::Splat(in[2]), m2);
+		Simd::Store3(out, r);
+	}
+}
+#endif
+}
+
 template <typename T>
 class Matrix4
 {
@@ -68,18 +139,7 @@ class Matrix4
 		Matrix4 <T> Multiply(const Matrix4 <T> & other) const
 		{
 			Matrix4 out;
-
-			for (int i = 0, i4 = 0; i < 4; i++,i4+=4)
-			{
-				for (int j = 0; j < 4; j++)
-				{
-					out.data[i4+j] = 0;
-
-					for (int k = 0, k4 = 0; k < 4; k ++,k4+=4)
-						out.data[i4+j] += data[i4+k]*other.data[k4+j];
-				}
-			}
-
+			Matrix4Helper::Multiply(data, other.data, out.data);
 			return out;
 		}
 
@@ -173,6 +233,14 @@ class Matrix4
 			z = outz + data[14];
 		}
 
+		/// batch version of TransformVectorOut, in and out may be the same array
+		void TransformVectorsOut(const MathVector <T, 3> * in, MathVector <T, 3> * out, unsigned count) const
+		{
+			static_assert(sizeof(MathVector <T, 3>) == 3 * sizeof(T), "MathVector<T, 3> is expected to be packed");
+			if (count)
+				Matrix4Helper::TransformPoints(data, &in[0][0], &out[0][0], count);
+		}
+
 		void Scale(T scalar)
 		{
 			Matrix4 <T> scalemat;
@@ -0,0 +1,106 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef _PARALLEL_FOR_H_
+#define _PARALLEL_FOR_H_
+
+#include <SDL2/SDL_atomic.h>
+#include <SDL2/SDL_thread.h>
+
+#include <vector>
+
+namespace Parallel
+{
+
+/// Run func(worker, i) for every i in [0, count) on up to thread_count workers.
+/// The calling thread is worker 0. Items are handed out one at a time, so
+/// func should be reasonably coarse grained. Returns the number of workers used.
+template <class Func>
+unsigned For(unsigned count, unsigned thread_count, Func & func);
+
+template <class Func>
+class ForJob
+{
+public:
+	ForJob(unsigned count, Func & func) : count(count), func(func)
+	{
+		SDL_AtomicSet(&next, 0);
+	}
+
+	void Run(unsigned worker)
+	{
+		int i;
+		while ((i = SDL_AtomicAdd(&next, 1)) < int(count))
+			func(worker, unsigned(i));
+	}
+
+private:
+	const unsigned count;
+	Func & func;
+	SDL_atomic_t next;
+};
+
+template <class Func>
+struct ForWorker
+{
+	ForJob<Func> * job;
+	unsigned id;
+
+	static int Dispatch(void * data)
+	{
+		ForWorker * worker = static_cast<ForWorker*>(data);
+		worker->job->Run(worker->id);
+		return 0;
+	}
+};
+
+template <class Func>
+inline unsigned For(unsigned count, unsigned thread_count, Func & func)
+{
+	if (thread_count > count)
+		thread_count = count;
+	if (thread_count < 1)
+		thread_count = 1;
+
+	ForJob<Func> job(count, func);
+
+	std::vector<ForWorker<Func> > workers(thread_count);
+	std::vector<SDL_Thread*> threads;
+	for (unsigned i = 1; i < thread_count; ++i)
+	{
+		workers[i].job = &job;
+		workers[i].id = threads.size() + 1;
+		SDL_Thread * thread = SDL_CreateThread(ForWorker<Func>::Dispatch, "worker", &workers[i]);
+		if (thread)
+			threads.push_back(thread);
+	}
+
+	job.Run(0);
+
+	for (auto thread : threads)
+	{
+		SDL_WaitThread(thread, NULL);
+	}
+
+	return threads.size() + 1;
+}
+
+}
+
+#endif
@@ -103,6 +103,8 @@ void PathManager::Init(std::ostream & info_output, std::ostream & error_output)
 	MakeDir(GetTrackRecordsPath());
 	MakeDir(GetReplayPath());
 	MakeDir(GetScreenshotPath());
+	MakeDir(GetShaderCachePath());
+	MakeDir(GetTrackMapCachePath());
 	MakeDir(GetTemporaryFolder());
 
 	// Print diagnostic info.
@@ -237,6 +239,11 @@ std::string PathManager::GetWriteableDataPath() const
 	return settings_path;
 }
 
+std::string PathManager::GetCookedDataPath() const
+{
+	return GetDataPath()+"/cooked";
+}
+
 std::string PathManager::GetCarPartsPath() const
 {
 	return GetDataPath()+"/carparts";
@@ -325,6 +332,16 @@ std::string PathManager::GetScreenshotPath() const
 	return settings_path+"/screenshots";
 }
 
+std::string PathManager::GetShaderCachePath() const
+{
+	return settings_path+"/shadercache";
+}
+
+std::string PathManager::GetTrackMapCachePath() const
+{
+	return settings_path+"/trackmapcache";
+}
+
 std::string PathManager::GetStaticReflectionMap() const
 {
 	return GetDataPath()+"/textures/weather/cubereflection-nosun.png";
@@ -43,6 +43,7 @@ public:
 
 	std::string GetDataPath() const;
 	std::string GetWriteableDataPath() const;
+	std::string GetCookedDataPath() const;
 	std::string GetCarPartsPath() const;
 	std::string GetTrackPartsPath() const;
 	std::string GetStartupFile() const;
@@ -59,6 +60,8 @@ public:
 	std::string GetDefaultCarControlsFile() const;
 	std::string GetReplayPath() const;
 	std::string GetScreenshotPath() const;
+	std::string GetShaderCachePath() const;
+	std::string GetTrackMapCachePath() const;
 	std::string GetStaticReflectionMap() const;
 	std::string GetStaticAmbientMap() const;
 	std::string GetShaderPath() const;
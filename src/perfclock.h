@@ -0,0 +1,34 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef _PERFCLOCK_H
+#define _PERFCLOCK_H
+
+#include <SDL2/SDL_timer.h>
+
+/// Wall clock time in microseconds from the performance counter.
+/// Shared by the input and force feedback threads, safe to call from any thread.
+inline unsigned long long GetPerfClockTime()
+{
+	const Uint64 count = SDL_GetPerformanceCounter();
+	const Uint64 frequency = SDL_GetPerformanceFrequency();
+	return count / frequency * 1000000 + count % frequency * 1000000 / frequency;
+}
+
+#endif // _PERFCLOCK_H
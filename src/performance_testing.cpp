@@ -24,14 +24,18 @@
 #include "content/contentmanager.h"
 #include "cfg/ptree.h"
 #include "joeserialize.h"
+#include "quickprof.h"
+#include "parallel_for.h"
 
 #include "BulletCollision/CollisionDispatch/btCollisionObject.h"
 #include "BulletCollision/CollisionShapes/btStaticPlaneShape.h"
+#include "BulletCollision/CollisionDispatch/btDefaultCollisionConfiguration.h"
+#include "BulletCollision/BroadphaseCollision/btDbvtBroadphase.h"
+#include "BulletDynamics/ConstraintSolver/btSequentialImpulseConstraintSolver.h"
 
 #include <vector>
 #include <iostream>
 #include <sstream>
-#include <ctime>
 
 static inline float ConvertToMPH(float ms)
 {
@@ -43,6 +47,23 @@ static inline float ConvertToFeet(float meters)
 	return meters * 3.2808399f;
 }
 
+PerformanceTesting::Result::Result() :
+	valid(false),
+	top_speed(0),
+	top_speed_time(0),
+	top_speed_downforce(0),
+	top_speed_drag(0),
+	time_to_60(0),
+	quarter_time(0),
+	quarter_speed(0),
+	stopping_distance(0),
+	stopping_distance_abs(0),
+	sim_time(0),
+	wall_time(0)
+{
+	// ctor
+}
+
 PerformanceTesting::PerformanceTesting(DynamicsWorld & world) :
 	world(world), track(0), plane(0)
 {
@@ -73,10 +94,14 @@ void PerformanceTesting::Test(
 	const std::string & carname,
 	ContentManager & content,
 	std::ostream & info_output,
-	std::ostream & error_output)
+	std::ostream & error_output,
+	SDL_mutex * content_lock)
 {
 	info_output << "Beginning car performance test on " << carname << std::endl;
 
+	result = Result();
+	result.carname = carname;
+
 	// init track
 	assert(!track);
 	assert(!plane);
@@ -91,19 +116,24 @@ void PerformanceTesting::Test(
 	world.addCollisionObject(track);
 
 	//load the car dynamics
+	if (content_lock)
+		SDL_LockMutex(content_lock);
+
 	std::shared_ptr<PTree> cfg;
 	content.load(cfg, cardir, carname + ".car");
-	if (!cfg->size())
-	{
-		return;
-	}
 
 	// position is the center of a 2 x 4 x 1 meter box on track surface
 	btVector3 pos(0.0, -2.0, 0.5);
 	btQuaternion rot = btQuaternion::getIdentity();
 	const std::string tire = "";
 	const bool damage = false;
-	if (!car.Load(*cfg, cardir, tire, pos, rot, damage, world, content, error_output))
+	bool loaded = cfg->size() &&
+		car.Load(*cfg, cardir, tire, pos, rot, damage, world, content, error_output);
+
+	if (content_lock)
+		SDL_UnlockMutex(content_lock);
+
+	if (!loaded)
 	{
 		return;
 	}
@@ -134,6 +164,7 @@ void PerformanceTesting::Test(
 	TestMaxSpeed(info_output, error_output);
 	TestStoppingDistance(false, info_output, error_output);
 	TestStoppingDistance(true, info_output, error_output);
+	result.valid = true;
 
 	info_output << "Car performance test complete." << std::endl;
 }
@@ -180,7 +211,7 @@ void PerformanceTesting::TestMaxSpeed(std::ostream & info_output, std::ostream &
 
 	ResetCar();
 
-	clock_t cpu_timer_start = clock();
+	quickprof::Clock timer;
 	while (t < maxtime)
 	{
 		if (car.GetTransmission().GetGear() == 1 &&
@@ -236,9 +267,18 @@ void PerformanceTesting::TestMaxSpeed(std::ostream & info_output, std::ostream &
 		t += dt;
 		i++;
 	}
-	clock_t cpu_timer_stop = clock();
-	clock_t clock_ticks = cpu_timer_stop - cpu_timer_start;
-	float sim_perf = (clock_ticks > 0) ? t / clock_ticks * CLOCKS_PER_SEC : 0;
+	float wall_time = timer.getTimeMicroseconds() * 1E-6f;
+	float sim_perf = (wall_time > 0) ? t / wall_time : 0;
+
+	result.top_speed = maxspeed.second;
+	result.top_speed_time = maxspeed.first;
+	result.top_speed_downforce = -maxlift;
+	result.top_speed_drag = -maxdrag;
+	result.time_to_60 = timeto60 - timeto60start;
+	result.quarter_time = timetoquarter;
+	result.quarter_speed = quarterspeed;
+	result.sim_time += t;
+	result.wall_time += wall_time;
 
 	info_output << "Top speed: " << ConvertToMPH(maxspeed.second) << " MPH at " << maxspeed.first << " s\n";
 	info_output << "Downforce at top speed: " << -maxlift << " N\n";
@@ -271,6 +311,7 @@ void PerformanceTesting::TestStoppingDistance(bool abs, std::ostream & info_outp
 
 	car.SetABS(abs);
 
+	quickprof::Clock timer;
 	while (t < maxtime)
 	{
 		if (accelerating && car.GetTransmission().GetGear() == 1 &&
@@ -333,13 +374,130 @@ void PerformanceTesting::TestStoppingDistance(bool abs, std::ostream & info_outp
 	}
 
 	btVector3 stopend = car.GetWheelPosition(WheelPosition(0));
+	float stopdistance = (stopend - stopstart).length();
+
+	if (abs)
+		result.stopping_distance_abs = stopdistance;
+	else
+		result.stopping_distance = stopdistance;
+	result.sim_time += t;
+	result.wall_time += timer.getTimeMicroseconds() * 1E-6f;
 
 	info_output << "60-0 stopping distance ";
 	if (abs)
 		info_output << "(ABS)";
 	else
 		info_output << "(no ABS)";
-	info_output << ": " << ConvertToFeet((stopend-stopstart).length()) << " ft\n"
+	info_output << ": " << ConvertToFeet(stopdistance) << " ft\n"
 		<< "Wheel lockup speed " << ConvertToMPH(front_lockup_speed)
 		<< ", " << ConvertToMPH(rear_lockup_speed) << std::endl;
 }
+
+void PerformanceTesting::TestBatch(
+	const std::vector<std::string> & cardirs,
+	const std::vector<std::string> & carnames,
+	ContentManager & content,
+	btScalar timestep,
+	unsigned thread_count,
+	std::ostream & info_output,
+	std::ostream & error_output,
+	std::vector<Result> & results)
+{
+	assert(cardirs.size() == carnames.size());
+
+	const unsigned count = carnames.size();
+	std::vector<std::string> info(count), error(count);
+	results.clear();
+	results.resize(count);
+
+	SDL_mutex * content_lock = SDL_CreateMutex();
+
+	auto test = [&](unsigned /*worker*/, unsigned i)
+	{
+		// every car gets a fresh world, tests don't share any simulation state
+		btDefaultCollisionConfiguration config;
+		FractureDispatcher dispatcher(&config);
+		btDbvtBroadphase broadphase;
+		btSequentialImpulseConstraintSolver solver;
+		DynamicsWorld world(&dispatcher, &broadphase, &solver, &config, timestep);
+
+		std::ostringstream info_stream, error_stream;
+		{
+			PerformanceTesting perftest(world);
+			perftest.Test(cardirs[i], carnames[i], content, info_stream, error_stream, content_lock);
+			results[i] = perftest.GetResult();
+		}
+		info[i] = info_stream.str();
+		error[i] = error_stream.str();
+	};
+
+	quickprof::Clock timer;
+
+	unsigned threads = Parallel::For(count, thread_count, test);
+
+	float wall_time = timer.getTimeMicroseconds() * 1E-6f;
+
+	SDL_DestroyMutex(content_lock);
+
+	// report in input order to keep the log readable
+	float test_time = 0;
+	for (unsigned i = 0; i < count; ++i)
+	{
+		info_output << info[i];
+		error_output << error[i];
+		test_time += results[i].wall_time;
+	}
+
+	info_output << "Tested " << count << " cars on " << threads << " threads: "
+		<< wall_time << " s wall time, " << test_time << " s test time" << std::endl;
+}
+
+void PerformanceTesting::WriteCSV(const std::vector<Result> & results, std::ostream & out)
+{
+	out << "car,valid,top_speed,top_speed_time,top_speed_downforce,top_speed_drag,"
+		"time_to_60,quarter_time,quarter_speed,stopping_distance,stopping_distance_abs,"
+		"sim_time,wall_time\n";
+	for (unsigned i = 0; i < results.size(); ++i)
+	{
+		const Result & r = results[i];
+		out << r.carname << ","
+			<< r.valid << ","
+			<< r.top_speed << ","
+			<< r.top_speed_time << ","
+			<< r.top_speed_downforce << ","
+			<< r.top_speed_drag << ","
+			<< r.time_to_60 << ","
+			<< r.quarter_time << ","
+			<< r.quarter_speed << ","
+			<< r.stopping_distance << ","
+			<< r.stopping_distance_abs << ","
+			<< r.sim_time << ","
+			<< r.wall_time << "\n";
+	}
+	out << std::flush;
+}
+
+void PerformanceTesting::WriteJSON(const std::vector<Result> & results, std::ostream & out)
+{
+	out << "[\n";
+	for (unsigned i = 0; i < results.size(); ++i)
+	{
+		const Result & r = results[i];
+		out << "\t{"
+			<< "\"car\": \"" << r.carname << "\", "
+			<< "\"valid\": " << (r.valid ? "true" : "false") << ", "
+			<< "\"top_speed\": " << r.top_speed << ", "
+			<< "\"top_speed_time\": " << r.top_speed_time << ", "
+			<< "\"top_speed_downforce\": " << r.top_speed_downforce << ", "
+			<< "\"top_speed_drag\": " << r.top_speed_drag << ", "
+			<< "\"time_to_60\": " << r.time_to_60 << ", "
+			<< "\"quarter_time\": " << r.quarter_time << ", "
+			<< "\"quarter_speed\": " << r.quarter_speed << ", "
+			<< "\"stopping_distance\": " << r.stopping_distance << ", "
+			<< "\"stopping_distance_abs\": " << r.stopping_distance_abs << ", "
+			<< "\"sim_time\": " << r.sim_time << ", "
+			<< "\"wall_time\": " << r.wall_time
+			<< "}" << (i + 1 < results.size() ? ",\n" : "\n");
+	}
+	out << "]" << std::endl;
+}
@@ -22,25 +22,72 @@
 
 #include "physics/cardynamics.h"
 
+#include <SDL2/SDL_mutex.h>
+
 class ContentManager;
 
 class PerformanceTesting
 {
 public:
+	/// measured car performance, speeds in m/s, distances in m, times in s
+	struct Result
+	{
+		std::string carname;
+		bool valid;
+		float top_speed;
+		float top_speed_time;
+		float top_speed_downforce;
+		float top_speed_drag;
+		float time_to_60;
+		float quarter_time;
+		float quarter_speed;
+		float stopping_distance;
+		float stopping_distance_abs;
+		float sim_time; ///< simulated time over all tests
+		float wall_time; ///< real time spent in the simulation loops
+
+		Result();
+	};
+
 	PerformanceTesting(DynamicsWorld & world);
 	~PerformanceTesting();
 
+	/// content_lock serializes content manager access when testing in parallel
 	void Test(
 		const std::string & cardir,
 		const std::string & carname,
 		ContentManager & content,
 		std::ostream & info_output,
-		std::ostream & error_output);
+		std::ostream & error_output,
+		SDL_mutex * content_lock = 0);
+
+	const Result & GetResult() const
+	{
+		return result;
+	}
+
+	/// test each car in its own dynamics world using a pool of worker threads
+	/// results are returned in the order of the input car names
+	static void TestBatch(
+		const std::vector<std::string> & cardirs,
+		const std::vector<std::string> & carnames,
+		ContentManager & content,
+		btScalar timestep,
+		unsigned thread_count,
+		std::ostream & info_output,
+		std::ostream & error_output,
+		std::vector<Result> & results);
+
+	static void WriteCSV(const std::vector<Result> & results, std::ostream & out);
+
+	static void WriteJSON(const std::vector<Result> & results, std::ostream & out);
 
 private:
 	DynamicsWorld & world;
 	TrackSurface surface;
 
+	Result result;
+
 	std::vector<float> carinput;
 	std::string carstate;
 	CarDynamics car;
@@ -0,0 +1,80 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef _BULLETSERIALIZE_H
+#define _BULLETSERIALIZE_H
+
+#include "macros.h"
+
+#include "BulletDynamics/Dynamics/btRigidBody.h"
+
+#define _SERIALIZEX_(s,var) if (!Serializex(s,var)) return false
+
+template <class Serializer>
+inline bool Serializex(Serializer & s, btQuaternion & q)
+{
+	_SERIALIZE_(s, q[0]);
+	_SERIALIZE_(s, q[1]);
+	_SERIALIZE_(s, q[2]);
+	_SERIALIZE_(s, q[3]);
+	return true;
+}
+
+template <class Serializer>
+inline bool Serializex(Serializer & s, btVector3 & v)
+{
+	_SERIALIZE_(s, v[0]);
+	_SERIALIZE_(s, v[1]);
+	_SERIALIZE_(s, v[2]);
+	return true;
+}
+
+template <class Serializer>
+inline bool Serializex(Serializer & s, btMatrix3x3 & m)
+{
+	_SERIALIZEX_(s, m[0]);
+	_SERIALIZEX_(s, m[1]);
+	_SERIALIZEX_(s, m[2]);
+	return true;
+}
+
+template <class Serializer>
+inline bool Serializex(Serializer & s, btTransform & t)
+{
+	_SERIALIZEX_(s, t.getBasis());
+	_SERIALIZEX_(s, t.getOrigin());
+	return true;
+}
+
+template <class Serializer>
+inline bool Serializex(Serializer & s, btRigidBody & b)
+{
+	btTransform t = b.getCenterOfMassTransform();
+	btVector3 v = b.getLinearVelocity();
+	btVector3 w = b.getAngularVelocity();
+	_SERIALIZEX_(s, t);
+	_SERIALIZEX_(s, v);
+	_SERIALIZEX_(s, w);
+	b.setCenterOfMassTransform(t);
+	b.setLinearVelocity(v);
+	b.setAngularVelocity(w);
+	return true;
+}
+
+#endif // _BULLETSERIALIZE_H
@@ -22,6 +22,8 @@
 #include "tracksurface.h"
 #include "dynamicsworld.h"
 #include "fracturebody.h"
+#include "roadpatch.h"
+#include "tobullet.h"
 #include "loadcollisionshape.h"
 #include "coordinatesystem.h"
 #include "content/contentmanager.h"
@@ -39,6 +41,92 @@ static const btScalar gravity = 9.81;
 static const int substeps = 10;
 static const btScalar rsubsteps = 1.0/substeps;
 
+// adaptive driveline substep levels, the last one is the full rate
+static const int substep_levels = 3;
+static const int level_substeps[substep_levels] = {2, 5, substeps};
+static const int level_iterations[substep_levels] = {2, 3, 4};
+
+// tire saturation below which a reduced level is chosen, and above which
+// its result is rejected and the tick is solved again at the full rate
+static const btScalar level_saturation[substep_levels - 1] = {0.25, 0.6};
+static const btScalar level_saturation_limit[substep_levels - 1] = {0.4, 0.8};
+
+// wheel surface acceleration (m/s^2) a reduced solve may produce, ~3g
+static const btScalar max_wheel_acceleration = 30;
+
+// contact velocity floor (m/s) for the saturation estimate, keeps it sane at standstill
+static const btScalar saturation_velocity_floor = 5;
+
+// ticks that stay at the full rate after a contact change or rejected solve
+static const int full_rate_hold_ticks = 10;
+
+// proxy speed profile friction factors, same as the standard ai
+static const btScalar proxy_friction_lon = 0.68;
+static const btScalar proxy_friction_lat = 0.62;
+
+// proxy lateral offset decay rate (1/s)
+static const btScalar proxy_offset_decay = 0.5;
+
+// racing line points lie on the patch back edge, road center if there is no racing line
+static btVector3 GetRacingLinePoint(const RoadPatch & patch)
+{
+	if (patch.HasRacingline())
+		return ToBulletVector(patch.GetRacingLine());
+	return ToBulletVector((patch.GetBL() + patch.GetBR()) * 0.5f);
+}
+
+// horizontal radius of the racing line through the patch and the next two
+static btScalar GetRacingLineRadius(const RoadPatch & patch)
+{
+	const btScalar max_radius = 1E4;
+	const RoadPatch * p1 = patch.GetNextPatch();
+	const RoadPatch * p2 = p1 ? p1->GetNextPatch() : 0;
+	if (!p2)
+		return max_radius;
+
+	btVector3 a = GetRacingLinePoint(*p1) - GetRacingLinePoint(patch);
+	btVector3 b = GetRacingLinePoint(*p2) - GetRacingLinePoint(*p1);
+	a.setZ(0);
+	b.setZ(0);
+
+	// circumradius of the triangle a, b, a + b
+	btScalar cross = std::abs(a.x() * b.y() - a.y() * b.x());
+	btScalar abc = a.length() * b.length() * (a + b).length();
+	if (abc >= 2 * max_radius * cross)
+		return max_radius;
+	return abc / (2 * cross);
+}
+
+// racing line point and road frame at position t of the segment starting at patch,
+// patch needs two successors, direction is blended into the next segment
+static void GetRacingLineFrame(
+	const RoadPatch & patch,
+	btScalar t,
+	btVector3 & point,
+	btVector3 & fwd,
+	btVector3 & right,
+	btVector3 & up)
+{
+	const RoadPatch & p1 = *patch.GetNextPatch();
+	const RoadPatch & p2 = *p1.GetNextPatch();
+	btVector3 l0 = GetRacingLinePoint(patch);
+	btVector3 l1 = GetRacingLinePoint(p1);
+	btVector3 l2 = GetRacingLinePoint(p2);
+	btVector3 d0 = l1 - l0;
+	btVector3 d1 = l2 - l1;
+	point = l0 + d0 * t;
+
+	fwd = d0.normalized() * (1 - t) + d1.normalized() * t;
+	fwd.normalize();
+
+	btVector3 side = ToBulletVector(patch.GetBR() - patch.GetBL());
+	up = side.cross(fwd).normalized();
+	if (up.z() < 0)
+		up = -up;
+	right = fwd.cross(up).normalized();
+	up = right.cross(fwd);
+}
+
 static inline std::istream & operator >> (std::istream & lhs, btVector3 & rhs)
 {
 	std::string str;
@@ -209,6 +297,7 @@ static bool LoadTire(const PTree & cfg_wheel, const PTree & cfg, CarTire & tire,
 	info.ar = aspect_ratio;
 
 	if (!cfg.get("pt", info.pt, error_output)) return false;
+	cfg_wheel.get("tire.pressure", info.pt); // optional per wheel inflation pressure
 	if (!cfg.get("ktx", info.ktx, error_output)) return false;
 	if (!cfg.get("kty", info.kty, error_output)) return false;
 	if (!cfg.get("kcb", info.kcb, error_output)) return false;
@@ -718,6 +807,52 @@ void CarDynamics::SetPosition(const btVector3 & position)
 		wheel_position[i] = transform.getBasis() * (suspension[i]->GetWheelPosition() + GetCenterOfMassOffset());
 }
 
+bool CarDynamics::SaveState(CarSnapshot & state)
+{
+	SnapshotWriter writer(state.data, state.capacity);
+	if (!SaveState(writer))
+	{
+		state.clear();
+		return false;
+	}
+	state.size = writer.GetSize();
+	state.layout = writer.GetLayout();
+	return true;
+}
+
+bool CarDynamics::LoadState(const CarSnapshot & state)
+{
+	if (state.empty())
+		return false;
+
+	// check the layout first, so a mismatching state leaves the car untouched
+	SnapshotReader reader(state.data, state.size, state.layout);
+	SnapshotWriter measure(0, ~0u);
+	if (!SaveState(measure) || !reader.Matches(measure))
+		return false;
+
+	return LoadState(reader) && reader.Valid();
+}
+
+bool CarDynamics::SaveState(SnapshotWriter & s)
+{
+	return SerializeState(s);
+}
+
+bool CarDynamics::LoadState(SnapshotReader & s)
+{
+	if (!SerializeState(s))
+		return false;
+
+	// snapshots hold the full dynamics state
+	proxy_patch = 0;
+
+	for (int i = 0; i < WHEEL_COUNT; ++i)
+		wheel_position[i] = transform.getBasis() * (suspension[i]->GetWheelPosition() + GetCenterOfMassOffset());
+	UpdateWheelTransform();
+	return true;
+}
+
 void CarDynamics::AlignWithGround()
 {
 	UpdateWheelContacts();
@@ -1017,6 +1152,11 @@ btScalar CarDynamics::GetTireSqueal(WheelPosition i) const
 	return Clamp(sq * vq - btScalar(0.4), btScalar(0), btScalar(1));
 }
 
+btScalar CarDynamics::GetWheelLoad(WheelPosition i) const
+{
+	return wheel_constraint[i].constraint[2].impulse / world->getTimeStep();
+}
+
 btScalar CarDynamics::GetMaxSpeed(btScalar radius, btScalar friction) const
 {
 	// m*v^2 / r = mu * (m*g + cl*v^2)
@@ -1191,6 +1331,12 @@ void CarDynamics::UpdateSuspension(int i, btScalar dt)
 // executed as last function(after integration) in bullet singlestepsimulation
 void CarDynamics::updateAction(btCollisionWorld * /*collisionWorld*/, btScalar dt)
 {
+	if (proxy_patch)
+	{
+		UpdateProxy(dt);
+		return;
+	}
+
 	// reset body transform
 	body->setCenterOfMassTransform(transform);
 
@@ -1305,15 +1451,17 @@ void CarDynamics::UpdateDrivelineGearRatio()
 	}
 }
 
-void CarDynamics::SetupDriveline(const btMatrix3x3 wheel_orientation[WHEEL_COUNT], btScalar dt)
+void CarDynamics::SetupDriveline(const btMatrix3x3 wheel_orientation[WHEEL_COUNT], btScalar dt, int steps)
 {
+	const btScalar rsteps = btScalar(1) / steps;
+
 	auto & c = driveline.clutch[0];
-	c.impulse_limit_delta = (clutch.GetTorque() * dt - c.impulse_limit) * rsubsteps;
+	c.impulse_limit_delta = (clutch.GetTorque() * dt - c.impulse_limit) * rsteps;
 
 	auto & m = driveline.motor[0];
 	m.shaft = &engine.GetShaft();
 	m.target_velocity = engine.GetTorque() > 0 ? 100000 : 0;
-	m.impulse_limit_delta = (std::abs(engine.GetTorque()) * dt - m.impulse_limit) * rsubsteps;
+	m.impulse_limit_delta = (std::abs(engine.GetTorque()) * dt - m.impulse_limit) * rsteps;
 	m.computeInertia(*body, body->getWorldTransform().getBasis().getColumn(0));
 
 	driveline.motor_count = 1;
@@ -1322,7 +1470,7 @@ void CarDynamics::SetupDriveline(const btMatrix3x3 wheel_orientation[WHEEL_COUNT
 		auto & m = driveline.motor[driveline.motor_count++];
 		m.shaft = &wheel[i].GetShaft();
 		m.target_velocity = 0;
-		m.impulse_limit_delta = (brake[i].GetTorque() * dt - m.impulse_limit) * rsubsteps;
+		m.impulse_limit_delta = (brake[i].GetTorque() * dt - m.impulse_limit) * rsteps;
 		m.computeInertia(*body, wheel_orientation[i].getColumn(0));
 	}
 }
@@ -1451,11 +1599,119 @@ void CarDynamics::UpdateWheelConstraints(btScalar rdt, btScalar sdt)
 	}
 }
 
+void CarDynamics::SetDrivelineSubsteps(int steps)
+{
+	if (steps == driveline_substeps)
+		return;
+
+	// per substep impulse limits carried over from the last tick
+	const btScalar scale = btScalar(driveline_substeps) / steps;
+	for (auto & m : driveline.motor)
+		m.impulse_limit *= scale;
+	driveline.clutch[0].impulse_limit *= scale;
+
+	// diff clutch softness and limits depend on the substep size
+	if (world)
+	{
+		const btScalar sdt = world->getTimeStep() / steps;
+		if (drive == AWD)
+			InitDriveline4(sdt);
+		else
+			InitDriveline2(sdt);
+	}
+
+	driveline_substeps = steps;
+}
+
+btScalar CarDynamics::GetTireSaturation() const
+{
+	btScalar saturation = 0;
+	for (int i = 0; i < WHEEL_COUNT; ++i)
+	{
+		if (!(suspension[i]->GetDisplacement() > 0))
+			continue;
+
+		const btScalar * v = wheel_velocity[i];
+		btScalar vref = Max(std::abs(v[0]), saturation_velocity_floor);
+		btScalar slip = std::abs(v[2] - v[0]) / (vref * Max(tire[i].getIdealSlip(), btScalar(1E-3)));
+		btScalar slip_angle = std::abs(v[1]) / (vref * Max(std::tan(tire[i].getIdealSlipAngle()), btScalar(1E-3)));
+		saturation = Max(saturation, Max(slip, slip_angle));
+	}
+	return saturation;
+}
+
+int CarDynamics::SelectSubstepLevel(bool contact_changed) const
+{
+	const int full = substep_levels - 1;
+	if (!adaptive_substeps || full_rate_ticks > 0 || contact_changed)
+		return full;
+
+	// shifting and a slipping clutch are stiff driveline events
+	btScalar clutch_position = clutch.GetPosition();
+	if (remaining_shift_time > 0 || (clutch_position > 0 && clutch_position < 1))
+		return full;
+
+	btScalar saturation = GetTireSaturation();
+	for (int level = 0; level < full; ++level)
+	{
+		if (saturation < level_saturation[level])
+			return level;
+	}
+	return full;
+}
+
+void CarDynamics::SolveDriveline(const btMatrix3x3 wheel_orientation[WHEEL_COUNT], btScalar dt, int level)
+{
+	const int steps = level_substeps[level];
+	const int solver_iterations = level_iterations[level];
+	const btScalar rdt = 1 / dt;
+	const btScalar sdt = dt / steps;
+
+	SetDrivelineSubsteps(steps);
+	SetupDriveline(wheel_orientation, sdt, steps);
+
+	// solve driveline
+	for (int n = 0; n < steps; ++n)
+	{
+		UpdateWheelConstraints(rdt, sdt);
+
+		driveline.clearImpulses();
+		driveline.updateImpulseLimits();
+		for (int m = 0; m < solver_iterations; ++m)
+		{
+			if (drive != AWD)
+				driveline.solve2(*body);
+			else
+				driveline.solve4(*body);
+
+			for (int i = 0; i < WHEEL_COUNT; ++i)
+				wheel_constraint[i].solveFriction();
+		}
+
+		for (int i = 0; i < WHEEL_COUNT; ++i)
+			wheel_constraint[i].solveSuspension();
+	}
+
+	for (int i = 0; i < WHEEL_COUNT; ++i)
+		wheel_constraint[i].getContactVelocity(wheel_velocity[i]);
+
+	substep_stats.substeps += steps;
+	substep_stats.last_substeps = steps;
+	substep_stats.last_iterations = solver_iterations;
+}
+
 void CarDynamics::UpdateDriveline(btScalar dt)
 {
 	const int solver_iterations = 4;
-	const btScalar rdt = 1 / dt;
-	const btScalar sdt = dt * rsubsteps;
+
+	// wheel contact state of the last tick
+	bool contact[WHEEL_COUNT];
+	const TrackSurface * surface[WHEEL_COUNT];
+	for (int i = 0; i < WHEEL_COUNT; ++i)
+	{
+		contact[i] = suspension[i]->GetDisplacement() > 0;
+		surface[i] = &wheel_contact[i].GetSurface();
+	}
 
 	UpdateWheelContacts();
 	btMatrix3x3 wheel_orientation[WHEEL_COUNT];
@@ -1466,6 +1722,14 @@ void CarDynamics::UpdateDriveline(btScalar dt)
 		wheel_position[i] = transform.getBasis() * (suspension[i]->GetWheelPosition() + GetCenterOfMassOffset());
 	}
 
+	bool contact_changed = false;
+	for (int i = 0; i < WHEEL_COUNT; ++i)
+	{
+		contact_changed = contact_changed ||
+			contact[i] != (suspension[i]->GetDisplacement() > 0) ||
+			surface[i] != &wheel_contact[i].GetSurface();
+	}
+
 	SetupWheelConstraints(wheel_orientation, dt);
 
 	// presolve suspension
@@ -1479,35 +1743,212 @@ void CarDynamics::UpdateDriveline(btScalar dt)
 	for (int i = 0; i < WHEEL_COUNT; ++i)
 		ApplyRollingResistance(i);
 
-	SetupDriveline(wheel_orientation, sdt);
+	const int full = substep_levels - 1;
+	int level = SelectSubstepLevel(contact_changed);
+	if (contact_changed)
+		full_rate_ticks = full_rate_hold_ticks;
+	else if (full_rate_ticks > 0)
+		full_rate_ticks--;
 
-	// solve driveline
-	for (int n = 0; n < substeps; ++n)
+	substep_stats.ticks++;
+	if (level == full)
 	{
-		UpdateWheelConstraints(rdt, sdt);
+		SolveDriveline(wheel_orientation, dt, full);
+	}
+	else
+	{
+		// keep the solver state, to redo the tick if the reduced solve is off
+		const btVector3 linear_velocity = body->getLinearVelocity();
+		const btVector3 angular_velocity = body->getAngularVelocity();
+		const btScalar engine_velocity = engine.GetShaft().ang_velocity;
+		btScalar wheel_ang_velocity[WHEEL_COUNT];
+		btScalar suspension_impulse[WHEEL_COUNT];
+		for (int i = 0; i < WHEEL_COUNT; ++i)
+		{
+			wheel_ang_velocity[i] = wheel[i].GetShaft().ang_velocity;
+			suspension_impulse[i] = wheel_constraint[i].constraint[2].impulse;
+		}
+		const Driveline driveline_state = driveline;
+		const int steps = driveline_substeps;
 
-		driveline.clearImpulses();
-		driveline.updateImpulseLimits();
-		for (int m = 0; m < solver_iterations; ++m)
+		SolveDriveline(wheel_orientation, dt, level);
+		substep_stats.reduced++;
+
+		// error check, the tires have to stay clear of their peak
+		// and the wheels must not have been kicked by the coarse steps
+		bool accept = GetTireSaturation() < level_saturation_limit[level];
+		for (int i = 0; i < WHEEL_COUNT && accept; ++i)
 		{
-			if (drive != AWD)
-				driveline.solve2(*body);
-			else
-				driveline.solve4(*body);
+			btScalar dw = wheel[i].GetShaft().ang_velocity - wheel_ang_velocity[i];
+			accept = std::abs(dw) * wheel[i].GetRadius() < max_wheel_acceleration * dt;
+		}
 
+		if (!accept)
+		{
+			body->setLinearVelocity(linear_velocity);
+			body->setAngularVelocity(angular_velocity);
+			engine.GetShaft().ang_velocity = engine_velocity;
 			for (int i = 0; i < WHEEL_COUNT; ++i)
-				wheel_constraint[i].solveFriction();
+			{
+				wheel[i].GetShaft().ang_velocity = wheel_ang_velocity[i];
+				wheel_constraint[i].constraint[2].impulse = suspension_impulse[i];
+			}
+			driveline = driveline_state;
+			driveline_substeps = steps;
+
+			SolveDriveline(wheel_orientation, dt, full);
+			substep_stats.rejected++;
+			substep_stats.reduced--;
+			full_rate_ticks = full_rate_hold_ticks;
 		}
+	}
 
-		for (int i = 0; i < WHEEL_COUNT; ++i)
-			wheel_constraint[i].solveSuspension();
+	for (int i = 0; i < WHEEL_COUNT; ++i)
+		wheel[i].Integrate(dt);
+}
+
+bool CarDynamics::EnterProxy()
+{
+	if (proxy_patch)
+		return true;
+
+	const RoadPatch * patch = wheel_contact[FRONT_LEFT].GetPatch();
+	if (!patch)
+		patch = wheel_contact[FRONT_RIGHT].GetPatch();
+	if (!patch || !patch->GetNextPatch() || !patch->GetNextPatch()->GetNextPatch())
+		return false;
+
+	// project the car onto the racing line segment
+	btVector3 l0 = GetRacingLinePoint(*patch);
+	btVector3 d = GetRacingLinePoint(*patch->GetNextPatch()) - l0;
+	btVector3 r = body->getCenterOfMassPosition() - l0;
+	btScalar dd = d.length2();
+	btScalar t = (dd > 1E-6f) ? Clamp(r.dot(d) / dd, btScalar(0), btScalar(1)) : btScalar(0);
+
+	btVector3 point, fwd, right, up;
+	GetRacingLineFrame(*patch, t, point, fwd, right, up);
+	btVector3 offset = body->getCenterOfMassPosition() - point;
+
+	proxy_patch = patch;
+	proxy_position = t;
+	proxy_speed = Max(body->getLinearVelocity().dot(fwd), btScalar(0));
+	proxy_offset = offset.dot(right);
+	proxy_height = offset.dot(up);
+	return true;
+}
+
+void CarDynamics::LeaveProxy()
+{
+	if (!proxy_patch)
+		return;
+
+	// body, wheel and engine speeds are kept consistent with the proxy motion
+	// so only the wheel contacts need a refresh for the first full tick
+	proxy_patch = 0;
+	UpdateWheelContacts();
+}
+
+btScalar CarDynamics::GetProxyTargetSpeed() const
+{
+	// brake for the first speed limit ahead within braking distance, like the ai
+	btScalar target = maxspeed;
+	btScalar lookahead = GetBrakeDistance(proxy_speed, 0, proxy_friction_lon) + 10;
+	const RoadPatch * patch = proxy_patch;
+	btScalar distance = 0;
+	for (int n = 0; n < 1000 && distance < lookahead; ++n)
+	{
+		const RoadPatch * next = patch->GetNextPatch();
+		if (!next)
+			return 0;
+
+		btScalar limit = GetMaxSpeed(GetRacingLineRadius(*patch), proxy_friction_lat);
+		if (limit < target && GetBrakeDistance(proxy_speed, limit, proxy_friction_lon) >= distance)
+			target = limit;
+
+		btScalar length = (GetRacingLinePoint(*next) - GetRacingLinePoint(*patch)).length();
+		distance += (n == 0) ? (1 - proxy_position) * length : length;
+		patch = next;
 	}
+	return target;
+}
 
+void CarDynamics::UpdateProxy(btScalar dt)
+{
+	// speed profile
+	const btScalar max_decel = proxy_friction_lon * lon_friction_coeff * gravity;
+	const btScalar max_accel = Min(max_decel,
+		engine.GetMaxPower() * GetInvMass() / Max(proxy_speed, btScalar(1)));
+	btScalar target = GetProxyTargetSpeed();
+	proxy_speed = Clamp(target, proxy_speed - max_decel * dt, proxy_speed + max_accel * dt);
+	proxy_speed = Max(proxy_speed, btScalar(0));
+
+	// advance along the racing line, stop at the end of an open road
+	btScalar distance = proxy_speed * dt;
+	while (true)
+	{
+		const RoadPatch * next = proxy_patch->GetNextPatch();
+		btScalar length = (GetRacingLinePoint(*next) - GetRacingLinePoint(*proxy_patch)).length();
+		btScalar remaining = (1 - proxy_position) * length;
+		if (distance < remaining)
+		{
+			proxy_position += distance / length;
+			break;
+		}
+		if (!next->GetNextPatch() || !next->GetNextPatch()->GetNextPatch())
+		{
+			proxy_position = 1;
+			proxy_speed = 0;
+			break;
+		}
+		distance -= remaining;
+		proxy_position = 0;
+		proxy_patch = next;
+	}
+
+	proxy_offset -= proxy_offset * Min(proxy_offset_decay * dt, btScalar(1));
+
+	// body
+	btVector3 point, fwd, right, up;
+	GetRacingLineFrame(*proxy_patch, proxy_position, point, fwd, right, up);
+	transform.setOrigin(point + right * proxy_offset + up * proxy_height);
+	transform.setBasis(btMatrix3x3(
+		right.x(), fwd.x(), up.x(),
+		right.y(), fwd.y(), up.y(),
+		right.z(), fwd.z(), up.z()));
+	body->setCenterOfMassTransform(transform);
+	body->setLinearVelocity(fwd * proxy_speed);
+	body->setAngularVelocity(btVector3(0, 0, 0));
+
+	// wheels roll without slip, contacts stay on the proxy patch for the lap timer and ai
 	for (int i = 0; i < WHEEL_COUNT; ++i)
 	{
-		wheel_constraint[i].getContactVelocity(wheel_velocity[i]);
+		wheel[i].GetShaft().ang_velocity = proxy_speed / wheel[i].GetRadius();
 		wheel[i].Integrate(dt);
+
+		wheel_velocity[i][0] = proxy_speed;
+		wheel_velocity[i][1] = 0;
+		wheel_velocity[i][2] = proxy_speed;
+
+		wheel_position[i] = transform.getBasis() * (suspension[i]->GetWheelPosition() + GetCenterOfMassOffset());
+		btVector3 wp = transform.getOrigin() + wheel_position[i];
+		btVector3 cp = wp - up * up.dot(wp - point);
+		btScalar depth = 2 * wheel[i].GetRadius() - suspension[i]->GetDisplacement();
+		wheel_contact[i] = CollisionContact(cp, up, depth, -1, proxy_patch, &wheel_contact[i].GetSurface(), 0);
 	}
+
+	// gear and clutch from the wheel speeds, engine locked to the clutch
+	UpdateTransmission(dt);
+	btScalar driveshaft_speed = driveshaft_rpm * btScalar(M_PI / 30);
+	btScalar engine_speed = transmission.GetClutchSpeed(driveshaft_speed);
+	engine.GetShaft().ang_velocity = Clamp(engine_speed,
+		engine.GetStartRPM() * btScalar(M_PI / 30),
+		engine.GetRPMLimit() * btScalar(M_PI / 30));
+
+	const btScalar tacho_factor = 0.1;
+	tacho_rpm += (engine.GetRPM() - tacho_rpm) * tacho_factor;
+	feedback = 0;
+
+	UpdateWheelTransform();
 }
 
 void CarDynamics::UpdateTransmission(btScalar dt)
@@ -1897,6 +2338,14 @@ void CarDynamics::Init()
 	remaining_shift_time = 0;
 	shift_gear = 0;
 	shifted = true;
+	driveline_substeps = substeps;
+	full_rate_ticks = 0;
+	adaptive_substeps = true;
+	proxy_patch = 0;
+	proxy_position = 0;
+	proxy_speed = 0;
+	proxy_offset = 0;
+	proxy_height = 0;
 	steering_assist = false;
 	autoreverse = false;
 	autoclutch = true;
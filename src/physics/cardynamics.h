@@ -35,7 +35,9 @@
 #include "wheelconstraint.h"
 #include "driveline.h"
 #include "motionstate.h"
+#include "bulletserialize.h"
 #include "macros.h"
+#include "snapshot.h"
 
 #include "BulletDynamics/Dynamics/btActionInterface.h"
 
@@ -45,9 +47,13 @@ class btManifoldPoint;
 class btIDebugDraw;
 class DynamicsWorld;
 class FractureBody;
+class RoadPatch;
 class ContentManager;
 class PTree;
 
+// fixed size dynamic car state block, see snapshot.h
+typedef Snapshot<1024> CarSnapshot;
+
 class CarDynamics : public btActionInterface
 {
 public:
@@ -151,12 +157,43 @@ public:
 
 	btScalar GetTireSqueal(WheelPosition i) const;
 
+	// suspension force of the last tick
+	btScalar GetWheelLoad(WheelPosition i) const;
+
 	// Maxumum speed for a curve with given radius and friction coefficient
 	btScalar GetMaxSpeed(btScalar radius, btScalar friction) const;
 
 	// Distance required to reduce initial to final speed
 	btScalar GetBrakeDistance(btScalar initial_speed, btScalar final_speed, btScalar friction) const;
 
+	// driveline substep counters since load
+	struct SubstepStats
+	{
+		unsigned ticks;			// driveline updates
+		unsigned substeps;		// substeps run, including rejected reduced solves
+		unsigned reduced;		// ticks solved with less than the full substep count
+		unsigned rejected;		// reduced solves redone at the full substep count
+		int last_substeps;		// substeps used in the last tick
+		int last_iterations;	// solver iterations per substep in the last tick
+		SubstepStats() : ticks(0), substeps(0), reduced(0), rejected(0), last_substeps(0), last_iterations(0) {}
+	};
+
+	const SubstepStats & GetSubstepStats() const {return substep_stats;}
+
+	// adaptive driveline substepping, enabled by default
+	// when disabled every tick runs the full substep and iteration count
+	void SetAdaptiveSubsteps(bool value) {adaptive_substeps = value;}
+
+	// Physics level of detail. A proxy car follows the road racing line
+	// kinematically with a speed profile, without wheel ray casts, tire
+	// model and driveline. Returns false if the car isn't on a road patch.
+	bool EnterProxy();
+
+	// hand the proxy pose and speed back to the full dynamics model
+	void LeaveProxy();
+
+	bool IsProxy() const {return proxy_patch != 0;}
+
 	// This is needed for ray casts in the AI implementation.
 	DynamicsWorld * getDynamicsWorld() const {return world;}
 
@@ -176,6 +213,18 @@ public:
 	template <class Serializer>
 	bool Serialize(Serializer & s);
 
+	// save dynamic state into a flat state block, no allocations
+	bool SaveState(CarSnapshot & state);
+
+	// restore dynamic state, false if the state layout doesn't match
+	bool LoadState(const CarSnapshot & state);
+
+	// append dynamic state to a larger snapshot
+	bool SaveState(SnapshotWriter & s);
+
+	// restore dynamic state from a larger snapshot
+	bool LoadState(SnapshotReader & s);
+
 	static bool WheelContactCallback(
 		btManifoldPoint& cp,
 		const btCollisionObjectWrapper* col0,
@@ -240,6 +289,19 @@ protected:
 	int shift_gear;
 	bool shifted;
 
+	// adaptive driveline substepping state
+	SubstepStats substep_stats;
+	int driveline_substeps;		// substep count the driveline is set up for
+	int full_rate_ticks;		// ticks left that are forced to the full substep count
+	bool adaptive_substeps;
+
+	// proxy state, proxy_patch is null when simulated in full
+	const RoadPatch * proxy_patch;	// patch the current racing line segment starts at
+	btScalar proxy_position;		// fraction of the racing line segment travelled
+	btScalar proxy_speed;			// speed along the racing line
+	btScalar proxy_offset;			// lateral offset from the racing line, decays to zero
+	btScalar proxy_height;			// center of mass height above the racing line
+
 	// assists
 	bool steering_assist;
 	bool autoreverse;
@@ -272,7 +334,18 @@ protected:
 
 	void UpdateDrivelineGearRatio();
 
-	void SetupDriveline(const btMatrix3x3 wheel_orientation[WHEEL_COUNT], btScalar dt);
+	void SetupDriveline(const btMatrix3x3 wheel_orientation[WHEEL_COUNT], btScalar dt, int steps);
+
+	// rescale the driveline impulse limits and diff clutches to a new substep count
+	void SetDrivelineSubsteps(int steps);
+
+	// pick a substep level from tire saturation and driveline state
+	int SelectSubstepLevel(bool contact_changed) const;
+
+	// largest slip over ideal slip of all wheels in contact, from the contact velocities
+	btScalar GetTireSaturation() const;
+
+	void SolveDriveline(const btMatrix3x3 wheel_orientation[WHEEL_COUNT], btScalar dt, int level);
 
 	void SetupWheelConstraints(const btMatrix3x3 wheel_orientation[WHEEL_COUNT], btScalar dt);
 
@@ -285,6 +358,12 @@ protected:
 	// run driveline constraint solver
 	void UpdateDriveline(btScalar dt);
 
+	// proxy speed limit from the racing line curvature ahead
+	btScalar GetProxyTargetSpeed() const;
+
+	// advance proxy along the racing line, update body, wheels and engine
+	void UpdateProxy(btScalar dt);
+
 	// calculate throttle, clutch, gear
 	void UpdateTransmission(btScalar dt);
 
@@ -338,6 +417,10 @@ protected:
 	void Clear();
 
 	void Init();
+
+	// replay state plus driveline and feedback state
+	template <class Serializer>
+	bool SerializeState(Serializer & s);
 };
 
 
@@ -370,6 +453,10 @@ inline void CarDynamics::DebugPrint(Stream & out, bool p1, bool p2, bool p3, boo
 		out << "Position: " << GetPosition() << "\n";
 		out << "Center of mass: " << -GetCenterOfMassOffset() << "\n";
 		out << "Total mass: " << 1 / GetInvMass() << "\n";
+		out << "Driveline substeps: " << substep_stats.last_substeps << " x " << substep_stats.last_iterations;
+		if (substep_stats.ticks)
+			out << " (avg " << float(substep_stats.substeps) / substep_stats.ticks << ", rejected " << substep_stats.rejected << ")";
+		out << "\n";
 		out << "\n";
 		fuel_tank.DebugPrint(out);
 		out << "\n";
@@ -431,59 +518,6 @@ inline void CarDynamics::DebugPrint(Stream & out, bool p1, bool p2, bool p3, boo
 }
 
 
-#define _SERIALIZEX_(s,var) if (!Serializex(s,var)) return false
-
-template <class Serializer>
-inline bool Serializex(Serializer & s, btQuaternion & q)
-{
-	_SERIALIZE_(s, q[0]);
-	_SERIALIZE_(s, q[1]);
-	_SERIALIZE_(s, q[2]);
-	_SERIALIZE_(s, q[3]);
-	return true;
-}
-
-template <class Serializer>
-inline bool Serializex(Serializer & s, btVector3 & v)
-{
-	_SERIALIZE_(s, v[0]);
-	_SERIALIZE_(s, v[1]);
-	_SERIALIZE_(s, v[2]);
-	return true;
-}
-
-template <class Serializer>
-inline bool Serializex(Serializer & s, btMatrix3x3 & m)
-{
-	_SERIALIZEX_(s, m[0]);
-	_SERIALIZEX_(s, m[1]);
-	_SERIALIZEX_(s, m[2]);
-	return true;
-}
-
-template <class Serializer>
-inline bool Serializex(Serializer & s, btTransform & t)
-{
-	_SERIALIZEX_(s, t.getBasis());
-	_SERIALIZEX_(s, t.getOrigin());
-	return true;
-}
-
-template <class Serializer>
-inline bool Serializex(Serializer & s, btRigidBody & b)
-{
-	btTransform t = b.getCenterOfMassTransform();
-	btVector3 v = b.getLinearVelocity();
-	btVector3 w = b.getAngularVelocity();
-	_SERIALIZEX_(s, t);
-	_SERIALIZEX_(s, v);
-	_SERIALIZEX_(s, w);
-	b.setCenterOfMassTransform(t);
-	b.setLinearVelocity(v);
-	b.setAngularVelocity(w);
-	return true;
-}
-
 template <class Serializer>
 inline bool CarDynamics::Serialize(Serializer & s)
 {
@@ -512,4 +546,19 @@ inline bool CarDynamics::Serialize(Serializer & s)
 	return true;
 }
 
+template <class Serializer>
+inline bool CarDynamics::SerializeState(Serializer & s)
+{
+	if (!Serialize(s)) return false;
+	// restored impulse limits are scaled for the saved substep count
+	int steps = driveline_substeps;
+	_SERIALIZE_(s, steps);
+	if (steps != driveline_substeps && steps > 0)
+		SetDrivelineSubsteps(steps);
+	_SERIALIZE_(s, driveline);
+	_SERIALIZE_(s, tacho_rpm);
+	_SERIALIZE_(s, feedback);
+	return true;
+}
+
 #endif
@@ -21,6 +21,7 @@
 #define _DRIVELINE_H
 
 #include "minmax.h"
+#include "macros.h"
 #include "driveshaft.h"
 #include "BulletDynamics/Dynamics/btRigidBody.h"
 
@@ -141,6 +142,17 @@ struct Driveline
 
 	Driveline() : gear_ratio(0), torque_split(0), motor_count(0), clutch_count(0) {}
 
+	// impulse limits are interpolated across ticks, the rest is set up per tick
+	template <class Serializer>
+	bool Serialize(Serializer & s)
+	{
+		for (unsigned i = 0; i < 5; ++i)
+			_SERIALIZE_(s, motor[i].impulse_limit);
+		for (unsigned i = 0; i < 4; ++i)
+			_SERIALIZE_(s, clutch[i].impulse_limit);
+		return true;
+	}
+
 	void clearImpulses()
 	{
 		for (unsigned i = 0; i < motor_count; ++i)
@@ -19,11 +19,21 @@
 
 #include "dynamicsworld.h"
 #include "fracturebody.h"
+#include "motionstate.h"
 #include "collision_contact.h"
 #include "tobullet.h"
-#include "track.h"
+#include "track_asset.h"
+#include "unittest.h"
 
 #include "BulletCollision/CollisionShapes/btCollisionShape.h"
+#include "BulletCollision/CollisionShapes/btBoxShape.h"
+#include "BulletCollision/CollisionShapes/btCompoundShape.h"
+#include "BulletCollision/CollisionShapes/btStaticPlaneShape.h"
+#include "BulletCollision/CollisionDispatch/btDefaultCollisionConfiguration.h"
+#include "BulletCollision/BroadphaseCollision/btDbvtBroadphase.h"
+#include "BulletDynamics/ConstraintSolver/btSequentialImpulseConstraintSolver.h"
+
+#include <vector>
 
 #define EXTBULLET
 
@@ -87,6 +97,40 @@ struct MyRayResultCallback : public btCollisionWorld::RayResultCallback
 	}
 };
 
+// manifold bodies are void pointers before bullet 2.81, const collision objects after
+static FractureBody* getFractureBody(const void* object)
+{
+	const btCollisionObject* body = static_cast<const btCollisionObject*>(object);
+	if (body->getInternalType() & CO_FRACTURE_TYPE)
+		return static_cast<FractureBody*>(const_cast<btCollisionObject*>(body));
+	return 0;
+}
+
+FractureDispatcher::FractureDispatcher(btCollisionConfiguration* collisionConfig) :
+	btCollisionDispatcher(collisionConfig)
+{
+	// ctor
+}
+
+#if (BT_BULLET_VERSION < 281)
+btPersistentManifold* FractureDispatcher::getNewManifold(void* b0, void* b1)
+#else
+btPersistentManifold* FractureDispatcher::getNewManifold(const btCollisionObject* b0, const btCollisionObject* b1)
+#endif
+{
+	btPersistentManifold* manifold = btCollisionDispatcher::getNewManifold(b0, b1);
+	if (getFractureBody(b0) || getFractureBody(b1))
+		fractureManifolds.push_back(manifold);
+	return manifold;
+}
+
+void FractureDispatcher::releaseManifold(btPersistentManifold* manifold)
+{
+	// bodies might be gone already, don't touch them
+	fractureManifolds.remove(manifold);
+	btCollisionDispatcher::releaseManifold(manifold);
+}
+
 DynamicsWorld::DynamicsWorld(
 	btDispatcher* dispatcher,
 	btBroadphaseInterface* broadphase,
@@ -95,7 +139,7 @@ DynamicsWorld::DynamicsWorld(
 	btScalar timeStep,
 	int maxSubSteps) :
 	btDiscreteDynamicsWorld(dispatcher, broadphase, constraintSolver, collisionConfig),
-	track(0),
+	fractureDispatcher(dynamic_cast<FractureDispatcher*>(dispatcher)),
 	timeStep(timeStep),
 	maxSubSteps(maxSubSteps)
 {
@@ -213,10 +257,10 @@ void DynamicsWorld::addCollisionObject(btCollisionObject* object)
 	btDiscreteDynamicsWorld::addCollisionObject(object);
 }
 
-void DynamicsWorld::reset(const Track & t)
+void DynamicsWorld::reset(const std::shared_ptr<const TrackAsset> & t)
 {
 	reset();
-	track = &t;
+	track = t;
 }
 
 void DynamicsWorld::reset()
@@ -224,7 +268,7 @@ void DynamicsWorld::reset()
 	getBroadphase()->resetPool(getDispatcher());
 	m_nonStaticRigidBodies.resize(0);
 	m_collisionObjects.resize(0);
-	track = 0;
+	track.reset();
 }
 
 void DynamicsWorld::setContactAddedCallback(ContactAddedCallback cb)
@@ -234,43 +278,21 @@ void DynamicsWorld::setContactAddedCallback(ContactAddedCallback cb)
 
 void DynamicsWorld::fractureCallback()
 {
-#if (BT_BULLET_VERSION < 281)
 	m_activeConnections.resize(0);
 
-	int numManifolds = getDispatcher()->getNumManifolds();
-	for (int i = 0; i < numManifolds; ++i)
+	if (fractureDispatcher)
 	{
-		btPersistentManifold* manifold = getDispatcher()->getManifoldByIndexInternal(i);
-		if (!manifold->getNumContacts()) continue;
-
-		FractureBody* body = static_cast<FractureBody*>(manifold->getBody0());
-		if (body->getInternalType() & CO_FRACTURE_TYPE)
+		for (int i = 0; i < fractureDispatcher->getNumFractureManifolds(); ++i)
 		{
-			for (int k = 0; k < manifold->getNumContacts(); ++k)
-			{
-				btManifoldPoint& point = manifold->getContactPoint(k);
-				int con_id = body->getConnectionId(point.m_index0);
-				if (point.m_appliedImpulse > 1E-3 &&
-					body->applyImpulse(con_id, point.m_appliedImpulse))
-				{
-					m_activeConnections.push_back(ActiveCon(body, con_id));
-				}
-			}
+			applyFractureImpulses(*fractureDispatcher->getFractureManifold(i));
 		}
-
-		body = static_cast<FractureBody*>(manifold->getBody1());
-		if (body->getInternalType() & CO_FRACTURE_TYPE)
+	}
+	else
+	{
+		int numManifolds = getDispatcher()->getNumManifolds();
+		for (int i = 0; i < numManifolds; ++i)
 		{
-			for (int k = 0; k < manifold->getNumContacts(); ++k)
-			{
-				btManifoldPoint& point = manifold->getContactPoint(k);
-				int con_id = body->getConnectionId(point.m_index1);
-				if (point.m_appliedImpulse > 1E-3 &&
-					body->applyImpulse(con_id, point.m_appliedImpulse))
-				{
-					m_activeConnections.push_back(ActiveCon(body, con_id));
-				}
-			}
+			applyFractureImpulses(*getDispatcher()->getManifoldByIndexInternal(i));
 		}
 	}
 
@@ -282,5 +304,179 @@ void DynamicsWorld::fractureCallback()
 		btRigidBody* child = body->updateConnection(con_id);
 		if (child) addRigidBody(child);
 	}
-#endif
+}
+
+void DynamicsWorld::applyFractureImpulses(btPersistentManifold& manifold)
+{
+	if (!manifold.getNumContacts()) return;
+
+	FractureBody* body = getFractureBody(manifold.getBody0());
+	if (body)
+	{
+		for (int k = 0; k < manifold.getNumContacts(); ++k)
+		{
+			btManifoldPoint& point = manifold.getContactPoint(k);
+			int con_id = body->getConnectionId(point.m_index0);
+			if (point.m_appliedImpulse > 1E-3 &&
+				body->applyImpulse(con_id, point.m_appliedImpulse))
+			{
+				m_activeConnections.push_back(ActiveCon(body, con_id));
+			}
+		}
+	}
+
+	body = getFractureBody(manifold.getBody1());
+	if (body)
+	{
+		for (int k = 0; k < manifold.getNumContacts(); ++k)
+		{
+			btManifoldPoint& point = manifold.getContactPoint(k);
+			int con_id = body->getConnectionId(point.m_index1);
+			if (point.m_appliedImpulse > 1E-3 &&
+				body->applyImpulse(con_id, point.m_appliedImpulse))
+			{
+				m_activeConnections.push_back(ActiveCon(body, con_id));
+			}
+		}
+	}
+}
+
+// cars resting on a ground plane between loose trackside objects
+class FractureTestScene
+{
+public:
+	btDefaultCollisionConfiguration config;
+	btDbvtBroadphase broadphase;
+	btSequentialImpulseConstraintSolver solver;
+	btStaticPlaneShape ground_shape;
+	btBoxShape object_shape;
+	btCollisionObject ground;
+	std::vector<FractureBody*> cars;
+	std::vector<btRigidBody*> objects;
+
+	struct World : public DynamicsWorld
+	{
+		World(btDispatcher * dispatcher, FractureTestScene & scene) :
+			DynamicsWorld(dispatcher, &scene.broadphase, &scene.solver, &scene.config)
+		{
+			// ctor
+		}
+
+		using DynamicsWorld::fractureCallback;
+	};
+
+	FractureTestScene() :
+		ground_shape(btVector3(0, 0, 1), 0),
+		object_shape(btVector3(0.25, 0.25, 0.25))
+	{
+		ground.setCollisionShape(&ground_shape);
+	}
+
+	void populate(World & world, int car_count, int object_count)
+	{
+		world.addCollisionObject(&ground);
+
+		for (int i = 0; i < car_count; ++i)
+		{
+			// chassis with a breakable bumper
+			btAlignedObjectArray<MotionState> states;
+			FractureBodyInfo info(states);
+			btTransform chassis(btQuaternion::getIdentity(), btVector3(0, 0, 0.4));
+			btTransform bumper(btQuaternion::getIdentity(), btVector3(0, 2.4, 0.3));
+			info.m_shape->addChildShape(chassis, new btBoxShape(btVector3(0.9, 2.2, 0.4)));
+			info.addMass(chassis.getOrigin(), 1000);
+			info.m_shape->addChildShape(bumper, new btBoxShape(btVector3(0.9, 0.2, 0.2)));
+			info.addMass(bumper.getOrigin(), 20);
+			info.addBody(1, btVector3(0, 0, 0), 20, 1E5, 1E5);
+
+			FractureBody * car = new FractureBody(info);
+			btVector3 position((i % 8) * 4.0, (i / 8) * 8.0, 0.5);
+			car->setCenterOfMassTransform(btTransform(btQuaternion::getIdentity(), position));
+			car->setActivationState(DISABLE_DEACTIVATION);
+			world.addRigidBody(car);
+			cars.push_back(car);
+		}
+
+		for (int i = 0; i < object_count; ++i)
+		{
+			btVector3 inertia;
+			object_shape.calculateLocalInertia(5, inertia);
+			btRigidBody * object = new btRigidBody(5, 0, &object_shape, inertia);
+			btVector3 position(-10 - (i % 50) * 2.0, (i / 50) * 2.0, 0.25);
+			object->setCenterOfMassTransform(btTransform(btQuaternion::getIdentity(), position));
+			object->setActivationState(DISABLE_DEACTIVATION);
+			world.addRigidBody(object);
+			objects.push_back(object);
+		}
+	}
+
+	void clear(World & world)
+	{
+		for (auto object : objects)
+		{
+			world.removeRigidBody(object);
+			delete object;
+		}
+		for (auto car : cars)
+		{
+			world.removeRigidBody(car);
+			btCompoundShape * shape = static_cast<btCompoundShape*>(car->getCollisionShape());
+			for (int i = 0; i < shape->getNumChildShapes(); ++i)
+				delete shape->getChildShape(i);
+			for (int i = 0; i < car->getNumChildren(); ++i)
+				delete car->getChildBody(i);
+			delete shape;
+			delete car;
+		}
+		world.removeCollisionObject(&ground);
+		objects.clear();
+		cars.clear();
+	}
+};
+
+QT_TEST(fracture_dispatcher_test)
+{
+	FractureTestScene scene;
+	FractureDispatcher dispatcher(&scene.config);
+	FractureTestScene::World world(&dispatcher, scene);
+	scene.populate(world, 2, 4);
+	for (int i = 0; i < 10; ++i)
+		world.update(1 / 60.0);
+
+	// exactly the manifolds with a car are tracked
+	int fracture_manifolds = 0;
+	for (int i = 0; i < dispatcher.getNumManifolds(); ++i)
+	{
+		const btPersistentManifold * manifold = dispatcher.getManifoldByIndexInternal(i);
+		if (getFractureBody(manifold->getBody0()) || getFractureBody(manifold->getBody1()))
+			fracture_manifolds++;
+	}
+	QT_CHECK(fracture_manifolds > 0);
+	QT_CHECK(fracture_manifolds < dispatcher.getNumManifolds());
+	QT_CHECK_EQUAL(dispatcher.getNumFractureManifolds(), fracture_manifolds);
+
+	scene.clear(world);
+	QT_CHECK_EQUAL(dispatcher.getNumFractureManifolds(), 0);
+}
+
+template <class Dispatcher>
+static void BenchmarkFracture(std::ostream & out, const std::string & name)
+{
+	FractureTestScene scene;
+	Dispatcher dispatcher(&scene.config);
+	FractureTestScene::World world(&dispatcher, scene);
+	scene.populate(world, 40, 2000);
+	for (int i = 0; i < 30; ++i)
+		world.update(1 / 60.0);
+
+	out << "\t" << name << ": " << dispatcher.getNumManifolds() << " manifolds" << std::endl;
+	QT_TIME(name + " fracture pass", 1000, world.fractureCallback());
+
+	scene.clear(world);
+}
+
+QT_BENCHMARK(fracture_benchmark)
+{
+	BenchmarkFracture<btCollisionDispatcher>(out, "manifold scan");
+	BenchmarkFracture<FractureDispatcher>(out, "fracture manifolds");
 }
@@ -21,12 +21,38 @@
 #define _DYNAMICSWORLD_H
 
 #include "BulletDynamics/Dynamics/btDiscreteDynamicsWorld.h"
+#include "BulletCollision/CollisionDispatch/btCollisionDispatcher.h"
 
-class Track;
+#include <memory>
+
+class TrackAsset;
 class CollisionContact;
 class FractureBody;
 class RoadPatch;
 
+// collision dispatcher keeping track of the manifolds with a fracture body
+// so that fracture processing doesn't have to scan all manifolds
+class FractureDispatcher : public btCollisionDispatcher
+{
+public:
+	FractureDispatcher(btCollisionConfiguration* collisionConfig);
+
+#if (BT_BULLET_VERSION < 281)
+	btPersistentManifold* getNewManifold(void* b0, void* b1);
+#else
+	btPersistentManifold* getNewManifold(const btCollisionObject* b0, const btCollisionObject* b1);
+#endif
+
+	void releaseManifold(btPersistentManifold* manifold);
+
+	int getNumFractureManifolds() const { return fractureManifolds.size(); }
+
+	btPersistentManifold* getFractureManifold(int i) const { return fractureManifolds[i]; }
+
+private:
+	btAlignedObjectArray<btPersistentManifold*> fractureManifolds;
+};
+
 class DynamicsWorld  : public btDiscreteDynamicsWorld
 {
 public:
@@ -43,7 +69,8 @@ public:
 	void addCollisionObject(btCollisionObject* object);
 
 	// reset collision world (unloads previous track)
-	void reset(const Track & t);
+	// the track asset is kept alive while attached
+	void reset(const std::shared_ptr<const TrackAsset> & t);
 
 	// set custon contact callback
 	void setContactAddedCallback(ContactAddedCallback cb);
@@ -73,7 +100,8 @@ protected:
 		int id;
 	};
 	btAlignedObjectArray<ActiveCon> m_activeConnections;
-	const Track * track;
+	FractureDispatcher * fractureDispatcher; // null if dispatcher isn't a fracture dispatcher
+	std::shared_ptr<const TrackAsset> track;
 	btScalar timeStep;
 	int maxSubSteps;
 
@@ -82,6 +110,9 @@ protected:
 	void solveConstraints(btContactSolverInfo& solverInfo);
 
 	void fractureCallback();
+
+	// accumulate contact impulses of the fracture bodies in the manifold
+	void applyFractureImpulses(btPersistentManifold& manifold);
 };
 
 #endif // _DYNAMICSWORLD_H
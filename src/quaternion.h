@@ -345,19 +345,18 @@ public:
 
 	///rotate a vector (accessible with []) by this quaternion
 	/// note that the output is saved back to the input vec variable
+	/// expanded q * vec * q' for a unit quaternion:
+	/// t = 2 * cross(q.xyz, vec), vec' = vec + q.w * t + cross(q.xyz, t)
 	template <typename T2>
 	void RotateVector(T2 & vec) const
 	{
-		Quaternion dirconj = -(*this);
-		Quaternion qtemp;
-		qtemp.v[3] = 0;
-		for (size_t i = 0; i < 3; i++)
-			qtemp.v[i] = vec[i];
-
-		Quaternion qout = (*this) * qtemp * dirconj;
-
-		for (size_t i = 0; i < 3; i++)
-			vec[i] = qout.v[i];
+		const T vx = vec[0], vy = vec[1], vz = vec[2];
+		const T tx = 2 * (v[1] * vz - v[2] * vy);
+		const T ty = 2 * (v[2] * vx - v[0] * vz);
+		const T tz = 2 * (v[0] * vy - v[1] * vx);
+		vec[0] = vx + v[3] * tx + (v[1] * tz - v[2] * ty);
+		vec[1] = vy + v[3] * ty + (v[2] * tx - v[0] * tz);
+		vec[2] = vz + v[3] * tz + (v[0] * ty - v[1] * tx);
 	}
 
 	///get the scalar angle (in radians) between two quaternions
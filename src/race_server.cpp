@@ -0,0 +1,300 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#include "race_server.h"
+#include "simulation_world.h"
+#include "track.h"
+#include "track_asset.h"
+#include "track_progress.h"
+#include "tobullet.h"
+#include "parallel_for.h"
+#include "quickprof.h"
+#include "minmax.h"
+#include "ai/ai.h"
+#include "physics/cardynamics.h"
+#include "content/contentmanager.h"
+#include "cfg/ptree.h"
+
+#include <iostream>
+#include <sstream>
+
+/// World the track is loaded into, only needed to build the track asset.
+struct TrackLoadWorld
+{
+	btDefaultCollisionConfiguration config;
+	FractureDispatcher dispatcher;
+	btDbvtBroadphase broadphase;
+	btSequentialImpulseConstraintSolver solver;
+	DynamicsWorld world;
+	Track track;
+
+	TrackLoadWorld(btScalar timestep) :
+		dispatcher(&config),
+		world(&dispatcher, &broadphase, &solver, &config, timestep)
+	{
+		// ctor
+	}
+};
+
+/// Lap progress of a car, sectors have to be passed in order.
+struct LapProgress
+{
+	unsigned next_sector;
+	float lap_start;
+	float laps_distance; ///< length of the completed laps
+	float lap_distance; ///< distance into the current lap
+
+	LapProgress() : next_sector(0), lap_start(-1), laps_distance(0), lap_distance(0) {}
+};
+
+RaceServer::Race::Race() :
+	ai_type(Ai::default_type),
+	ai_difficulty(1)
+{
+	// ctor
+}
+
+RaceServer::CarResult::CarResult() :
+	laps(0),
+	best_lap(0),
+	finish_time(0),
+	distance(0)
+{
+	// ctor
+}
+
+RaceServer::Result::Result() :
+	valid(false),
+	sim_time(0),
+	wall_time(0)
+{
+	// ctor
+}
+
+RaceServer::RaceServer(ContentManager & content, btScalar timestep) :
+	content(content),
+	content_lock(SDL_CreateMutex()),
+	timestep(timestep)
+{
+	// ctor
+}
+
+RaceServer::~RaceServer()
+{
+	SDL_DestroyMutex(content_lock);
+}
+
+bool RaceServer::LoadTrack(
+	const std::string & trackpath,
+	const std::string & trackdir,
+	const std::string & texturedir,
+	const std::string & sharedobjectpath,
+	const bool reverse,
+	std::ostream & info_output,
+	std::ostream & error_output)
+{
+	track.reset();
+
+	const int anisotropy = 0;
+	const bool dynamicobjects = true;
+	const bool dynamicshadows = false;
+	TrackLoadWorld load(timestep);
+	bool success = load.track.DeferredLoad(
+		content, load.world,
+		info_output, error_output,
+		trackpath, trackdir,
+		texturedir, sharedobjectpath,
+		anisotropy, reverse,
+		dynamicobjects, dynamicshadows);
+
+	while (success && !load.track.Loaded())
+		success = load.track.ContinueDeferredLoad();
+
+	if (!success)
+	{
+		error_output << "Error loading track: " << trackpath << std::endl;
+		return false;
+	}
+
+	// the asset outlives the load world, races only hold references
+	track = load.track.GetAsset();
+	return true;
+}
+
+void RaceServer::Run(
+	const std::vector<Race> & races,
+	unsigned laps,
+	float duration,
+	unsigned thread_count,
+	std::vector<Result> & results)
+{
+	assert(track);
+
+	results.clear();
+	results.resize(races.size());
+
+	auto simulate = [&](unsigned /*worker*/, unsigned i)
+	{
+		Simulate(races[i], laps, duration, results[i]);
+	};
+
+	Parallel::For(races.size(), thread_count, simulate);
+}
+
+void RaceServer::Simulate(const Race & race, unsigned laps, float duration, Result & result)
+{
+	assert(race.cardirs.size() == race.carnames.size());
+
+	result = Result();
+
+	const unsigned car_count = race.carnames.size();
+	if (car_count == 0)
+	{
+		result.error = "No cars";
+		return;
+	}
+
+	const bool dynamic_objects = true;
+	SimulationWorld sim(track, timestep, dynamic_objects);
+	btAlignedObjectArray<CarDynamics> cars;
+	cars.reserve(car_count);
+	TrackProgress track_progress;
+	Ai ai;
+
+	for (unsigned i = 0; i < car_count; ++i)
+	{
+		const std::pair<Vec3, Quat> start = track->GetStart(i);
+		const std::string tire = "";
+		const bool damage = false;
+
+		// tire configs are loaded through the content manager
+		std::ostringstream error_output;
+		SDL_LockMutex(content_lock);
+		std::shared_ptr<PTree> cfg;
+		content.load(cfg, race.cardirs[i], race.carnames[i] + ".car");
+		cars.push_back(CarDynamics());
+		bool loaded = cfg->size() && cars[i].Load(
+			*cfg, race.cardirs[i], tire,
+			ToBulletVector(start.first),
+			ToBulletQuaternion(start.second),
+			damage, sim.world, content, error_output);
+		SDL_UnlockMutex(content_lock);
+
+		if (!loaded)
+		{
+			result.error = "Failed to load " + race.carnames[i] + ": " + error_output.str();
+			return;
+		}
+
+		CarDynamics & car = cars[i];
+		car.SetSteeringAssist(true);
+		car.SetAutoReverse(true);
+		car.SetAutoClutch(true);
+		car.SetAutoShift(true);
+		car.SetABS(true);
+		car.SetTCS(true);
+
+		ai.AddCar(i, race.ai_difficulty, race.ai_type);
+
+		result.cars.push_back(CarResult());
+		result.cars.back().carname = race.carnames[i];
+	}
+
+	track_progress.Reset(track, car_count);
+	ai.SetTrackProgress(&track_progress);
+
+	const unsigned sectors = track->GetSectors();
+	std::vector<LapProgress> progress(car_count);
+	unsigned finished = 0;
+
+	quickprof::Clock timer;
+
+	float t = 0;
+	while (t < duration && (laps == 0 || finished < car_count))
+	{
+		ai.Update(timestep, &cars[0], car_count);
+		for (unsigned i = 0; i < car_count; ++i)
+			cars[i].Update(ai.GetInputs(i));
+		sim.world.update(timestep);
+		track_progress.Update(&cars[0], car_count);
+		t += timestep;
+
+		for (unsigned i = 0; i < car_count; ++i)
+		{
+			CarResult & cr = result.cars[i];
+			LapProgress & p = progress[i];
+			if (sectors > 0 && track_progress.OnSectorStart(i, p.next_sector))
+			{
+				// the first start line crossing starts the lap clock
+				if (p.next_sector == 0)
+				{
+					if (p.lap_start >= 0)
+					{
+						const float lap = t - p.lap_start;
+						cr.best_lap = (cr.laps == 0) ? lap : Min(cr.best_lap, lap);
+						cr.laps++;
+						if (cr.laps == laps)
+						{
+							cr.finish_time = t;
+							finished++;
+						}
+						p.laps_distance += p.lap_distance;
+					}
+					p.lap_start = t;
+					p.lap_distance = 0;
+				}
+				p.next_sector = (p.next_sector + 1) % sectors;
+			}
+
+			// distance is counted from the first start line crossing
+			if (p.lap_start >= 0 && track_progress.GetPatch(i))
+				p.lap_distance = track_progress.GetDistance(i);
+			cr.distance = p.laps_distance + p.lap_distance;
+		}
+	}
+
+	ai.SetTrackProgress(0);
+	ai.ClearCars();
+
+	result.sim_time = t;
+	result.wall_time = timer.getTimeMicroseconds() * 1E-6f;
+	result.valid = true;
+}
+
+void RaceServer::WriteCSV(const std::vector<Result> & results, std::ostream & out)
+{
+	out << "race,car,valid,laps,best_lap,finish_time,distance,sim_time,wall_time\n";
+	for (unsigned i = 0; i < results.size(); ++i)
+	{
+		const Result & r = results[i];
+		for (const auto & c : r.cars)
+		{
+			out << i << ","
+				<< c.carname << ","
+				<< r.valid << ","
+				<< c.laps << ","
+				<< c.best_lap << ","
+				<< c.finish_time << ","
+				<< c.distance << ","
+				<< r.sim_time << ","
+				<< r.wall_time << "\n";
+		}
+	}
+	out << std::flush;
+}
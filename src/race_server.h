@@ -0,0 +1,112 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef _RACE_SERVER_H
+#define _RACE_SERVER_H
+
+#include "LinearMath/btScalar.h"
+
+#include <SDL2/SDL_mutex.h>
+
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+
+class ContentManager;
+class TrackAsset;
+
+/// Headless host for many independent races in one process.
+/// The track is loaded once without graphics, its asset is attached
+/// read-only to a private world per race with its own ai driven cars and
+/// dynamic track bodies. Races are run on a shared pool of worker threads,
+/// a world only exists while its race is running.
+class RaceServer
+{
+public:
+	/// ai driven cars, placed on the track start positions in order
+	struct Race
+	{
+		std::vector<std::string> cardirs;
+		std::vector<std::string> carnames;
+		std::string ai_type;
+		float ai_difficulty;
+
+		Race();
+	};
+
+	struct CarResult
+	{
+		std::string carname;
+		unsigned laps; ///< completed laps
+		float best_lap; ///< best lap time in s, 0 without a completed lap
+		float finish_time; ///< time the requested laps were completed, 0 if not finished
+		float distance; ///< distance along the track in m, counted from the first start line crossing
+
+		CarResult();
+	};
+
+	struct Result
+	{
+		std::string error;
+		bool valid;
+		std::vector<CarResult> cars;
+		float sim_time; ///< simulated time in s
+		float wall_time; ///< real time spent simulating in s
+
+		Result();
+	};
+
+	RaceServer(ContentManager & content, btScalar timestep);
+
+	~RaceServer();
+
+	/// Load the track shared by all races. The content manager texture
+	/// factory is expected to be headless.
+	bool LoadTrack(
+		const std::string & trackpath,
+		const std::string & trackdir,
+		const std::string & texturedir,
+		const std::string & sharedobjectpath,
+		const bool reverse,
+		std::ostream & info_output,
+		std::ostream & error_output);
+
+	/// Run every race until all cars have completed laps or duration seconds passed.
+	/// With zero laps races run for duration. Results are returned in race order.
+	void Run(
+		const std::vector<Race> & races,
+		unsigned laps,
+		float duration,
+		unsigned thread_count,
+		std::vector<Result> & results);
+
+	/// One line per car.
+	static void WriteCSV(const std::vector<Result> & results, std::ostream & out);
+
+private:
+	ContentManager & content;
+	SDL_mutex * content_lock;
+	btScalar timestep;
+	std::shared_ptr<const TrackAsset> track;
+
+	void Simulate(const Race & race, unsigned laps, float duration, Result & result);
+};
+
+#endif // _RACE_SERVER_H
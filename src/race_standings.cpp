@@ -0,0 +1,208 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#include "race_standings.h"
+#include "minmax.h"
+#include "snapshot.h"
+#include "unittest.h"
+
+RaceStandings::CarStanding::CarStanding() :
+	distance(0),
+	place(1)
+{
+	// ctor
+}
+
+RaceStandings::RaceStandings() :
+	sectors(0),
+	swaps(0),
+	time(0)
+{
+	// ctor
+}
+
+void RaceStandings::Reset(unsigned car_count, unsigned newsectors)
+{
+	cars.assign(car_count, CarStanding());
+	order.resize(car_count);
+	for (unsigned i = 0; i < car_count; ++i)
+	{
+		order[i] = i;
+		cars[i].place = i + 1;
+	}
+	sectors = newsectors;
+	swaps = 0;
+	time = 0;
+}
+
+void RaceStandings::Clear()
+{
+	cars.clear();
+	order.clear();
+	sectors = 0;
+	swaps = 0;
+	time = 0;
+}
+
+void RaceStandings::Tick(float dt)
+{
+	time += dt;
+}
+
+void RaceStandings::SetDistance(unsigned car, float distance)
+{
+	assert(car < cars.size());
+	cars[car].distance = distance;
+}
+
+void RaceStandings::CrossSector(unsigned car)
+{
+	assert(car < cars.size());
+	cars[car].passes.push_back(time);
+}
+
+bool RaceStandings::Ahead(unsigned a, unsigned b) const
+{
+	const CarStanding & ca = cars[a];
+	const CarStanding & cb = cars[b];
+	if (ca.passes.size() == cb.passes.size())
+		return ca.distance > cb.distance;
+	return ca.passes.size() > cb.passes.size();
+}
+
+void RaceStandings::Update()
+{
+	// insertion sort, stable and close to linear for a nearly sorted field
+	swaps = 0;
+	for (unsigned i = 1; i < order.size(); ++i)
+	{
+		const unsigned car = order[i];
+		unsigned j = i;
+		while (j > 0 && Ahead(car, order[j - 1]))
+		{
+			order[j] = order[j - 1];
+			--j;
+		}
+		order[j] = car;
+		swaps += i - j;
+	}
+
+	for (unsigned i = 0; i < order.size(); ++i)
+		cars[order[i]].place = i + 1;
+}
+
+float RaceStandings::TimeBehind(unsigned car, unsigned ahead) const
+{
+	const std::vector<double> & passes = cars[car].passes;
+	const std::vector<double> & ahead_passes = cars[ahead].passes;
+	const unsigned count = Min(passes.size(), ahead_passes.size());
+	if (count == 0)
+		return 0;
+	return passes[count - 1] - ahead_passes[count - 1];
+}
+
+float RaceStandings::GetGap(unsigned car) const
+{
+	assert(car < cars.size());
+	return TimeBehind(car, order[0]);
+}
+
+float RaceStandings::GetInterval(unsigned car) const
+{
+	assert(car < cars.size());
+	const int place = cars[car].place;
+	if (place == 1)
+		return 0;
+	return TimeBehind(car, order[place - 2]);
+}
+
+float RaceStandings::GetSectorSplit(unsigned car, int lap, unsigned sector) const
+{
+	assert(car < cars.size());
+	assert(sector < sectors);
+	if (lap < 1)
+		return -1;
+
+	const std::vector<double> & passes = cars[car].passes;
+	const unsigned point = (lap - 1) * sectors + sector;
+	if (point + 1 >= passes.size())
+		return -1;
+	return passes[point + 1] - passes[point];
+}
+
+QT_TEST(race_standings_test)
+{
+	RaceStandings standings;
+	standings.Reset(3, 2);
+	QT_CHECK_EQUAL(standings.GetPlace(0), 1);
+	QT_CHECK_EQUAL(standings.GetPlace(2), 3);
+
+	// car 2 leads on distance before the start line
+	standings.SetDistance(0, 10);
+	standings.SetDistance(1, 20);
+	standings.SetDistance(2, 30);
+	standings.Update();
+	QT_CHECK_EQUAL(standings.GetCar(1), 2);
+	QT_CHECK_EQUAL(standings.GetCar(3), 0);
+	QT_CHECK_EQUAL(standings.GetSwaps(), 3);
+	QT_CHECK_EQUAL(standings.GetGap(1), 0);
+
+	// cars cross the start line one second apart, distance wraps to zero
+	for (unsigned car : {2, 1, 0})
+	{
+		standings.CrossSector(car);
+		standings.SetDistance(car, 0);
+		standings.Tick(1);
+	}
+	standings.Update();
+	QT_CHECK_EQUAL(standings.GetCar(1), 2);
+	QT_CHECK_EQUAL(standings.GetSwaps(), 0);
+	QT_CHECK_EQUAL(standings.GetGap(0), 2);
+	QT_CHECK_EQUAL(standings.GetInterval(0), 1);
+	QT_CHECK_EQUAL(standings.GetInterval(2), 0);
+
+	// car 0 passes sector 1 first and takes the lead
+	standings.Tick(5);
+	standings.CrossSector(0);
+	standings.SetDistance(0, 1);
+	standings.SetDistance(1, 900);
+	standings.SetDistance(2, 800);
+	standings.Update();
+	QT_CHECK_EQUAL(standings.GetPlace(0), 1);
+	QT_CHECK_EQUAL(standings.GetPlace(1), 2);
+	QT_CHECK_EQUAL(standings.GetPlace(2), 3);
+	QT_CHECK_EQUAL(standings.GetSectorSplit(0, 1, 0), 6);
+	QT_CHECK(standings.GetSectorSplit(1, 1, 0) < 0);
+	QT_CHECK(standings.GetSectorSplit(0, 0, 0) < 0);
+
+	// rewinding drops passes made after the snapshot
+	std::vector<unsigned char> buffer(256);
+	RaceStandings restored;
+	restored.Reset(3, 2);
+	restored.CrossSector(0);
+	restored.CrossSector(0);
+	restored.CrossSector(0);
+	SnapshotWriter writer(&buffer[0], buffer.size());
+	QT_CHECK(standings.Serialize(writer));
+	SnapshotReader reader(&buffer[0], writer.GetSize(), writer.GetLayout());
+	QT_CHECK(restored.Serialize(reader));
+	QT_CHECK(reader.Valid());
+	QT_CHECK_EQUAL(restored.GetTimingPoints(0), 2);
+	QT_CHECK_EQUAL(restored.GetTimingPoints(1), 0);
+}
@@ -0,0 +1,138 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef _RACE_STANDINGS_H
+#define _RACE_STANDINGS_H
+
+#include "macros.h"
+
+#include <cassert>
+#include <vector>
+
+/// Live race order with gaps, intervals and sector splits.
+/// Cars are ranked by timing points passed, then by distance from the start
+/// line. The order rarely changes between ticks, so it is kept with an
+/// insertion sort which is linear in the field size for a sorted field.
+/// Every car records the race time it passed each timing point, timing
+/// point k being sector k % sectors of lap k / sectors. Gaps and splits
+/// are a lookup into these times.
+class RaceStandings
+{
+public:
+	RaceStandings();
+
+	/// Clear race and set up car_count cars on a track with sectors timing sectors.
+	void Reset(unsigned car_count, unsigned sectors);
+
+	void Clear();
+
+	/// Advance the race clock.
+	void Tick(float dt);
+
+	/// Distance from the start line of car.
+	void SetDistance(unsigned car, float distance);
+
+	/// Car passed the start of its next timing sector.
+	void CrossSector(unsigned car);
+
+	/// Update race order, call once per tick after the car updates.
+	void Update();
+
+	unsigned GetNumCars() const
+	{
+		return cars.size();
+	}
+
+	/// Race position of car, starting at 1.
+	int GetPlace(unsigned car) const
+	{
+		assert(car < cars.size());
+		return cars[car].place;
+	}
+
+	/// Car at race position place, starting at 1.
+	unsigned GetCar(int place) const
+	{
+		assert(place > 0 && place <= int(order.size()));
+		return order[place - 1];
+	}
+
+	/// Timing points passed by car.
+	unsigned GetTimingPoints(unsigned car) const
+	{
+		assert(car < cars.size());
+		return cars[car].passes.size();
+	}
+
+	/// Time behind the leader at the last timing point passed by both, 0 if unknown.
+	float GetGap(unsigned car) const;
+
+	/// Time behind the car one position ahead, 0 for the leader.
+	float GetInterval(unsigned car) const;
+
+	/// Time car spent in sector of lap, lap counted from 1 like the timer.
+	/// Negative if the car has not completed the sector yet.
+	float GetSectorSplit(unsigned car, int lap, unsigned sector) const;
+
+	/// Car swaps of the last update.
+	unsigned GetSwaps() const
+	{
+		return swaps;
+	}
+
+	/// Race clock and timing points passed, for in-memory snapshots.
+	/// Passing times are kept on restore, rewinding only drops the passes
+	/// made after the snapshot.
+	template <class Serializer>
+	bool Serialize(Serializer & s)
+	{
+		_SERIALIZE_(s, time);
+		for (auto & car : cars)
+		{
+			unsigned passes = car.passes.size();
+			_SERIALIZE_(s, passes);
+			_SERIALIZE_(s, car.distance);
+			if (passes < car.passes.size())
+				car.passes.resize(passes);
+		}
+		return true;
+	}
+
+private:
+	struct CarStanding
+	{
+		std::vector<double> passes; ///< race time of each timing point passed
+		float distance;
+		int place;
+
+		CarStanding();
+	};
+
+	std::vector<CarStanding> cars;
+	std::vector<unsigned> order;
+	unsigned sectors;
+	unsigned swaps;
+	double time;
+
+	bool Ahead(unsigned a, unsigned b) const;
+
+	float TimeBehind(unsigned car, unsigned ahead) const;
+};
+
+#endif // _RACE_STANDINGS_H
@@ -0,0 +1,184 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#include "rewind.h"
+#include "macros.h"
+#include "unittest.h"
+
+#include <cassert>
+
+Rewind::Rewind() :
+	frame_size(0),
+	interval(0),
+	tick(0),
+	head(0),
+	count(0),
+	capture_start(0),
+	capture_time(0),
+	capture_time_avg(0)
+{
+	// ctor
+}
+
+void Rewind::Init(unsigned frame_count, unsigned new_frame_size, unsigned new_interval)
+{
+	assert(new_interval > 0);
+	frames.resize(frame_count);
+	data.resize(frame_count * new_frame_size);
+	frame_size = new_frame_size;
+	interval = new_interval;
+	Reset();
+}
+
+void Rewind::Clear()
+{
+	std::vector<Frame>().swap(frames);
+	std::vector<unsigned char>().swap(data);
+	frame_size = 0;
+	interval = 0;
+	Reset();
+}
+
+void Rewind::Reset()
+{
+	tick = 0;
+	head = 0;
+	count = 0;
+	capture_time = 0;
+	capture_time_avg = 0;
+}
+
+bool Rewind::Tick()
+{
+	if (!Enabled())
+		return false;
+
+	return (tick++ % interval) == 0;
+}
+
+SnapshotWriter Rewind::BeginCapture()
+{
+	assert(Enabled());
+	capture_start = clock.getTimeMicroseconds();
+	return SnapshotWriter(&data[head * frame_size], frame_size);
+}
+
+void Rewind::EndCapture(const SnapshotWriter & writer, bool success)
+{
+	capture_time = clock.getTimeMicroseconds() - capture_start;
+	capture_time_avg = (capture_time_avg == 0) ? capture_time :
+		capture_time_avg * 0.9 + capture_time * 0.1;
+
+	if (!success)
+		return;
+
+	Frame & f = frames[head];
+	f.tick = tick - 1;
+	f.layout = writer.GetLayout();
+	f.size = writer.GetSize();
+
+	head = (head + 1) % frames.size();
+	if (count < frames.size())
+		count++;
+}
+
+bool Rewind::Restore(unsigned min_age, SnapshotReader & reader)
+{
+	for (unsigned n = count; n > 0; --n)
+	{
+		unsigned i = (head + frames.size() - 1) % frames.size();
+		const Frame & f = frames[i];
+		if (f.tick + min_age <= tick)
+		{
+			tick = f.tick + 1;
+			reader = SnapshotReader(&data[i * frame_size], f.size, f.layout);
+			return true;
+		}
+
+		// drop frame from the future
+		head = i;
+		count--;
+	}
+	return false;
+}
+
+namespace
+{
+	struct RewindTestState
+	{
+		int value;
+
+		template <class Serializer>
+		bool Serialize(Serializer & s)
+		{
+			_SERIALIZE_(s, value);
+			return true;
+		}
+	};
+}
+
+QT_TEST(rewind_test)
+{
+	Rewind rewind;
+	QT_CHECK(!rewind.Enabled());
+	QT_CHECK(!rewind.Tick());
+
+	// 3 frames, capture every 2nd tick
+	rewind.Init(3, 16, 2);
+	QT_CHECK(rewind.Enabled());
+	QT_CHECK_EQUAL(rewind.GetMemory() >= 3 * 16, true);
+
+	RewindTestState state = {0};
+	for (int i = 0; i < 10; ++i)
+	{
+		state.value = i;
+		if (rewind.Tick())
+		{
+			SnapshotWriter writer = rewind.BeginCapture();
+			rewind.EndCapture(writer, state.Serialize(writer));
+		}
+	}
+
+	// captured at ticks 0, 2, 4, 6, 8, oldest two overwritten
+	QT_CHECK_EQUAL(rewind.GetFrames(), 3);
+	QT_CHECK_EQUAL(rewind.GetTick(), 10);
+
+	// newest frame at least 3 ticks old is tick 6
+	SnapshotReader reader(0, 0);
+	QT_CHECK(rewind.Restore(3, reader));
+	QT_CHECK(state.Serialize(reader));
+	QT_CHECK(reader.Valid());
+	QT_CHECK_EQUAL(state.value, 6);
+	QT_CHECK_EQUAL(rewind.GetFrames(), 2);
+	QT_CHECK_EQUAL(rewind.GetTick(), 7);
+
+	// step back again
+	QT_CHECK(rewind.Restore(2, reader));
+	QT_CHECK(state.Serialize(reader));
+	QT_CHECK_EQUAL(state.value, 4);
+	QT_CHECK_EQUAL(rewind.GetFrames(), 1);
+
+	// nothing older than the oldest frame
+	QT_CHECK(!rewind.Restore(2, reader));
+	QT_CHECK_EQUAL(rewind.GetFrames(), 0);
+
+	rewind.Clear();
+	QT_CHECK(!rewind.Enabled());
+	QT_CHECK_EQUAL(rewind.GetMemory(), 0);
+}
@@ -0,0 +1,135 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef _REWIND_H
+#define _REWIND_H
+
+#include "snapshot.h"
+#include "quickprof.h"
+
+#include <vector>
+
+/// Fixed size ring of simulation state frames for instant rewind.
+/// Storage is allocated once by Init, capture and restore don't allocate.
+/// When the ring is full the oldest frame is overwritten.
+class Rewind
+{
+public:
+	Rewind();
+
+	/// Allocate frame_count frames of frame_size bytes, capture every interval ticks.
+	void Init(unsigned frame_count, unsigned frame_size, unsigned interval);
+
+	/// Release storage, disables rewind.
+	void Clear();
+
+	/// Drop all frames, keep storage.
+	void Reset();
+
+	bool Enabled() const;
+
+	/// Advance tick counter, true if a frame should be captured this tick.
+	bool Tick();
+
+	/// Writer into the next frame slot. Pass it to EndCapture when done.
+	SnapshotWriter BeginCapture();
+
+	/// Commit the frame if capture succeeded, otherwise discard it.
+	void EndCapture(const SnapshotWriter & writer, bool success);
+
+	/// Get reader for the newest frame that is at least min_age ticks old.
+	/// Frames newer than it are dropped, tick counter is set to its tick.
+	/// Returns false if there is no such frame.
+	bool Restore(unsigned min_age, SnapshotReader & reader);
+
+	/// Number of captured frames.
+	unsigned GetFrames() const;
+
+	/// Bytes of frame storage.
+	unsigned GetMemory() const;
+
+	unsigned GetTick() const;
+
+	/// Capture time of the last frame in microseconds.
+	double GetCaptureTime() const;
+
+	/// Average capture time per frame in microseconds.
+	double GetAverageCaptureTime() const;
+
+	/// Average capture cost per simulation tick in microseconds.
+	double GetAverageTickTime() const;
+
+private:
+	struct Frame
+	{
+		unsigned tick;
+		unsigned layout;
+		unsigned size;
+	};
+
+	std::vector<Frame> frames;
+	std::vector<unsigned char> data;
+	unsigned frame_size;
+	unsigned interval;
+	unsigned tick;
+	unsigned head; ///< next frame slot
+	unsigned count; ///< captured frames
+
+	quickprof::Clock clock;
+	unsigned long long capture_start;
+	double capture_time;
+	double capture_time_avg;
+};
+
+inline bool Rewind::Enabled() const
+{
+	return !frames.empty();
+}
+
+inline unsigned Rewind::GetFrames() const
+{
+	return count;
+}
+
+inline unsigned Rewind::GetMemory() const
+{
+	return data.size() + frames.size() * sizeof(Frame);
+}
+
+inline unsigned Rewind::GetTick() const
+{
+	return tick;
+}
+
+inline double Rewind::GetCaptureTime() const
+{
+	return capture_time;
+}
+
+inline double Rewind::GetAverageCaptureTime() const
+{
+	return capture_time_avg;
+}
+
+inline double Rewind::GetAverageTickTime() const
+{
+	return interval ? capture_time_avg / interval : 0;
+}
+
+#endif // _REWIND_H
@@ -44,6 +44,7 @@ Settings::Settings() :
 	depth_bpp(24),
 	fullscreen(false),
 	vsync(false),
+	frames_in_flight(2),
 	renderer("gl3/deferred.conf"),
 	skin("simple"),
 	language("en"),
@@ -74,10 +75,12 @@ Settings::Settings() :
 	selected_replay("none"),
 	texture_size("large"),
 	texture_compress(true),
+	texture_budget(0),
 	button_ramp(5),
 	ff_device("/dev/input/event0"),
 	ff_gain(1.0),
 	ff_invert(false),
+	ff_rate(500),
 	trackreverse(false),
 	trackdynamic(false),
 	shadows(true),
@@ -101,6 +104,8 @@ Settings::Settings() :
 	camera_id(0),
 	camera_bounce(1.0),
 	number_of_laps(1),
+	rewind_time(30),
+	physics_lod_distance(300),
 	contrast(1.0),
 	hgateshifter(false),
 	ai_level(1.0),
@@ -150,6 +155,8 @@ void Settings::Serialize(bool write, Config & config)
 	Param(config, write, section, "track_dynamic", trackdynamic);
 	Param(config, write, section, "number_of_laps", number_of_laps);
 	Param(config, write, section, "camera_id", camera_id);
+	Param(config, write, section, "rewind_time", rewind_time);
+	Param(config, write, section, "physics_lod_distance", physics_lod_distance);
 
 	config.get("display", section);
 	if (!res_override)
@@ -157,6 +164,7 @@ void Settings::Serialize(bool write, Config & config)
 	Param(config, write, section, "zdepth", depth_bpp);
 	Param(config, write, section, "fullscreen", fullscreen);
 	Param(config, write, section, "vsync", vsync);
+	Param(config, write, section, "frames_in_flight", frames_in_flight);
 	Param(config, write, section, "renderer", renderer);
 	Param(config, write, section, "skin", skin);
 	Param(config, write, section, "language", language);
@@ -171,6 +179,7 @@ void Settings::Serialize(bool write, Config & config)
 	Param(config, write, section, "racingline", racingline);
 	Param(config, write, section, "texture_size", texture_size);
 	Param(config, write, section, "texture_compress", texture_compress);
+	Param(config, write, section, "texture_budget", texture_budget);
 	Param(config, write, section, "shadows", shadows);
 	Param(config, write, section, "shadow_distance", shadow_distance);
 	Param(config, write, section, "shadow_quality", shadow_quality);
@@ -204,6 +213,7 @@ void Settings::Serialize(bool write, Config & config)
 	Param(config, write, section, "ff_device", ff_device);
 	Param(config, write, section, "ff_gain", ff_gain);
 	Param(config, write, section, "ff_invert", ff_invert);
+	Param(config, write, section, "ff_rate", ff_rate);
 	Param(config, write, section, "hgateshifter", hgateshifter);
 
 	config.get("control", section);
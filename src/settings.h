@@ -69,6 +69,11 @@ public:
 		return vsync;
 	}
 
+	int GetFramesInFlight() const
+	{
+		return frames_in_flight;
+	}
+
 	const std::string & GetRenderer() const
 	{
 		return renderer;
@@ -227,6 +232,11 @@ public:
 		return texture_compress;
 	}
 
+	int GetTextureBudget() const
+	{
+		return texture_budget;
+	}
+
 	float GetButtonRamp() const
 	{
 		return button_ramp;
@@ -247,6 +257,11 @@ public:
 		return ff_invert;
 	}
 
+	unsigned int GetFFRate() const
+	{
+		return ff_rate;
+	}
+
 	bool GetTrackReverse() const
 	{
 		return trackreverse;
@@ -352,6 +367,16 @@ public:
 	    return number_of_laps;
 	}
 
+	float GetRewindTime() const
+	{
+		return rewind_time;
+	}
+
+	float GetPhysicsLodDistance() const
+	{
+		return physics_lod_distance;
+	}
+
 	float GetContrast() const
 	{
 		return contrast;
@@ -409,6 +434,7 @@ private:
 	int depth_bpp;
 	bool fullscreen;
 	bool vsync;
+	int frames_in_flight; //max frames queued on the gpu, 0 leaves it to the driver
 	std::string renderer;
 	std::string skin;
 	std::string language;
@@ -440,10 +466,12 @@ private:
 	std::string selected_replay;
 	std::string texture_size;
 	bool texture_compress;
+	int texture_budget; //texture memory in MB, streams mip levels when exceeded, 0 keeps all textures resident
 	float button_ramp;
 	std::string ff_device;
 	float ff_gain;
 	bool ff_invert;
+	unsigned int ff_rate;
 	bool trackreverse;
 	bool trackdynamic;
 	bool shadows;
@@ -467,6 +495,8 @@ private:
 	int camera_id;
 	float camera_bounce;
 	int number_of_laps;
+	float rewind_time; //seconds of race kept for rewind, 0 disables it
+	float physics_lod_distance; //meters from the player beyond which ai cars use proxy physics, 0 disables it
 	float contrast;
 	bool hgateshifter;
 	float ai_level;
@@ -0,0 +1,214 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#include "setup_sweep.h"
+#include "simulation_world.h"
+#include "track.h"
+#include "parallel_for.h"
+#include "quickprof.h"
+#include "ai/ai.h"
+#include "physics/dynamicsworld.h"
+#include "physics/carinput.h"
+
+#include <sstream>
+
+class SetupSweep::Worker : public SimulationWorld
+{
+public:
+	Ai ai;
+
+	Worker(const Track & track, btScalar timestep) :
+		SimulationWorld(track.GetAsset(), timestep)
+	{
+		// ctor
+	}
+};
+
+SetupSweep::Result::Result() :
+	valid(false),
+	distance(0),
+	sim_time(0),
+	wall_time(0)
+{
+	// ctor
+}
+
+SetupSweep::SetupSweep(const Track & track, ContentManager & content, btScalar timestep) :
+	track(track),
+	content(content),
+	content_lock(SDL_CreateMutex()),
+	timestep(timestep)
+{
+	// ctor
+}
+
+SetupSweep::~SetupSweep()
+{
+	workers.clear();
+	SDL_DestroyMutex(content_lock);
+}
+
+bool SetupSweep::Init(
+	const std::shared_ptr<const PTree> & newcarcfg,
+	const std::string & newcardir,
+	const std::string & newcartire,
+	CarDynamics & car,
+	std::ostream & error_output)
+{
+	if (!newcarcfg || !newcarcfg->size())
+	{
+		error_output << "Setup sweep: invalid car config" << std::endl;
+		return false;
+	}
+
+	if (!car.SaveState(carstate))
+	{
+		error_output << "Setup sweep: failed to save car state" << std::endl;
+		return false;
+	}
+
+	carcfg = newcarcfg;
+	cardir = newcardir;
+	cartire = newcartire;
+	cartransform = car.getCollisionObject().getWorldTransform();
+
+	return true;
+}
+
+void SetupSweep::Run(
+	const std::vector<Variant> & variants,
+	float duration,
+	unsigned thread_count,
+	std::vector<Result> & results,
+	const std::string & ai_type,
+	float ai_difficulty)
+{
+	assert(carcfg);
+
+	results.clear();
+	results.resize(variants.size());
+
+	if (thread_count > variants.size())
+		thread_count = variants.size();
+	if (thread_count < 1)
+		thread_count = 1;
+
+	// worker worlds are kept alive between runs, setting up the track proxies isn't free
+	while (workers.size() < thread_count)
+		workers.emplace_back(new Worker(track, timestep));
+
+	auto simulate = [&](unsigned worker, unsigned i)
+	{
+		Simulate(*workers[worker], variants[i], duration, ai_type, ai_difficulty, results[i]);
+	};
+
+	Parallel::For(variants.size(), thread_count, simulate);
+}
+
+void SetupSweep::Simulate(
+	Worker & worker,
+	const Variant & variant,
+	float duration,
+	const std::string & ai_type,
+	float ai_difficulty,
+	Result & result)
+{
+	result = Result();
+	result.name = variant.name;
+
+	PTree cfg(*carcfg);
+	for (const auto & param : variant.params)
+	{
+		cfg.set(param.first, param.second);
+	}
+
+	// tire configs are loaded through the content manager
+	std::ostringstream error_output;
+	CarDynamics car;
+	SDL_LockMutex(content_lock);
+	bool loaded = car.Load(
+		cfg, cardir, cartire,
+		cartransform.getOrigin(), cartransform.getRotation(),
+		false, worker.world, content, error_output);
+	SDL_UnlockMutex(content_lock);
+
+	if (!loaded)
+	{
+		result.error = error_output.str();
+		return;
+	}
+
+	if (!car.LoadState(carstate))
+	{
+		result.error = "Car state doesn't match variant setup";
+		return;
+	}
+
+	car.SetSteeringAssist(true);
+	car.SetAutoReverse(true);
+	car.SetAutoClutch(true);
+	car.SetAutoShift(true);
+	car.SetABS(true);
+	car.SetTCS(true);
+
+	worker.ai.ClearCars();
+	worker.ai.AddCar(0, ai_difficulty, ai_type);
+
+	const unsigned sectors = track.GetSectors();
+	int last_sector = -1;
+
+	quickprof::Clock timer;
+
+	float t = 0;
+	while (t < duration)
+	{
+		worker.ai.Update(timestep, &car, 1);
+		car.Update(worker.ai.GetInputs(0));
+		worker.world.update(timestep);
+		t += timestep;
+
+		result.distance += car.GetSpeed() * timestep;
+
+		for (unsigned s = 0; s < sectors; ++s)
+		{
+			if (int(s) == last_sector)
+				continue;
+
+			const RoadPatch * patch = track.GetSectorPatch(s);
+			for (int w = 0; w < 4; ++w)
+			{
+				if (car.GetWheelContact(WheelPosition(w)).GetPatch() == patch)
+				{
+					Split split;
+					split.sector = s;
+					split.time = t;
+					result.splits.push_back(split);
+					last_sector = s;
+					break;
+				}
+			}
+		}
+	}
+
+	worker.ai.ClearCars();
+
+	result.sim_time = t;
+	result.wall_time = timer.getTimeMicroseconds() * 1E-6f;
+	result.valid = true;
+}
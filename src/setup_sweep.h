@@ -0,0 +1,119 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef _SETUP_SWEEP_H
+#define _SETUP_SWEEP_H
+
+#include "physics/cardynamics.h"
+#include "cfg/ptree.h"
+
+#include <SDL2/SDL_mutex.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+class Track;
+class ContentManager;
+
+/// What-if simulation of car setup variants.
+/// Clones a car from a running simulation into private dynamics worlds that
+/// share the static collision geometry of a loaded track, applies setup
+/// changes and drives every variant with an AI for a given time on a pool
+/// of worker threads. The track is only read, it must not be modified or
+/// reloaded during Run.
+class SetupSweep
+{
+public:
+	/// car config overrides like ("wheel.fl.tire.pressure", "2.1")
+	struct Variant
+	{
+		std::string name;
+		std::vector<std::pair<std::string, std::string> > params;
+	};
+
+	/// time at which a sector boundary was crossed, relative to the start
+	struct Split
+	{
+		unsigned sector;
+		float time;
+	};
+
+	struct Result
+	{
+		std::string name;
+		std::string error;
+		bool valid;
+		std::vector<Split> splits;
+		float distance; ///< distance driven in m
+		float sim_time; ///< simulated time in s
+		float wall_time; ///< real time spent simulating in s
+
+		Result();
+	};
+
+	SetupSweep(const Track & track, ContentManager & content, btScalar timestep);
+
+	~SetupSweep();
+
+	/// Use car with config carcfg as base for all variants.
+	/// The current dynamic state of the car is the starting state of every variant.
+	bool Init(
+		const std::shared_ptr<const PTree> & carcfg,
+		const std::string & cardir,
+		const std::string & cartire,
+		CarDynamics & car,
+		std::ostream & error_output);
+
+	/// Simulate every variant for duration seconds driven by an ai of the given type.
+	/// Results are returned in variant order.
+	void Run(
+		const std::vector<Variant> & variants,
+		float duration,
+		unsigned thread_count,
+		std::vector<Result> & results,
+		const std::string & ai_type,
+		float ai_difficulty = 1);
+
+private:
+	class Worker;
+
+	const Track & track;
+	ContentManager & content;
+	SDL_mutex * content_lock;
+	btScalar timestep;
+
+	std::shared_ptr<const PTree> carcfg;
+	std::string cardir;
+	std::string cartire;
+	btTransform cartransform;
+	CarSnapshot carstate;
+
+	std::vector<std::unique_ptr<Worker> > workers;
+
+	void Simulate(
+		Worker & worker,
+		const Variant & variant,
+		float duration,
+		const std::string & ai_type,
+		float ai_difficulty,
+		Result & result);
+};
+
+#endif // _SETUP_SWEEP_H
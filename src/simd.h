@@ -0,0 +1,96 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef _SIMD_H
+#define _SIMD_H
+
+// minimal 4-wide float abstraction used by the float specializations of the math types
+// define DISABLE_SIMD to fall back to the scalar code paths
+
+#if !defined(DISABLE_SIMD)
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define SIMD_SSE
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define SIMD_NEON
+#include <arm_neon.h>
+#endif
+#endif
+
+#if defined(SIMD_SSE) || defined(SIMD_NEON)
+#define SIMD_ENABLED
+
+namespace Simd
+{
+
+#if defined(SIMD_SSE)
+
+typedef __m128 float4;
+
+/// unaligned load of 4 floats
+inline float4 Load(const float * p) { return _mm_loadu_ps(p); }
+
+/// unaligned store of 4 floats
+inline void Store(float * p, float4 a) { _mm_storeu_ps(p, a); }
+
+/// store the first 3 floats
+inline void Store3(float * p, float4 a)
+{
+	_mm_storel_pi(reinterpret_cast<__m64*>(p), a);
+	_mm_store_ss(p + 2, _mm_movehl_ps(a, a));
+}
+
+inline float4 Splat(float a) { return _mm_set1_ps(a); }
+
+inline float4 Add(float4 a, float4 b) { return _mm_add_ps(a, b); }
+
+inline float4 Mul(float4 a, float4 b) { return _mm_mul_ps(a, b); }
+
+/// a + b * c
+inline float4 MulAdd(float4 a, float4 b, float4 c) { return _mm_add_ps(a, _mm_mul_ps(b, c)); }
+
+#elif defined(SIMD_NEON)
+
+typedef float32x4_t float4;
+
+inline float4 Load(const float * p) { return vld1q_f32(p); }
+
+inline void Store(float * p, float4 a) { vst1q_f32(p, a); }
+
+inline void Store3(float * p, float4 a)
+{
+	vst1_f32(p, vget_low_f32(a));
+	vst1q_lane_f32(p + 2, a, 2);
+}
+
+inline float4 Splat(float a) { return vdupq_n_f32(a); }
+
+inline float4 Add(float4 a, float4 b) { return vaddq_f32(a, b); }
+
+inline float4 Mul(float4 a, float4 b) { return vmulq_f32(a, b); }
+
+inline float4 MulAdd(float4 a, float4 b, float4 c) { return vmlaq_f32(a, b, c); }
+
+#endif
+
+}
+
+#endif // SIMD_SSE || SIMD_NEON
+
+#endif // _SIMD_H
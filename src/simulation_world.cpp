@@ -0,0 +1,62 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#include "simulation_world.h"
+#include "track_asset.h"
+#include "physics/cardynamics.h"
+
+#include "BulletCollision/CollisionDispatch/btCollisionObject.h"
+#include "BulletDynamics/Dynamics/btRigidBody.h"
+
+SimulationWorld::SimulationWorld(
+	const std::shared_ptr<const TrackAsset> & track,
+	btScalar timestep,
+	bool dynamic_objects) :
+	dispatcher(&config),
+	world(&dispatcher, &broadphase, &solver, &config, timestep)
+{
+	world.reset(track);
+	world.setContactAddedCallback(&CarDynamics::WheelContactCallback);
+
+	for (const auto & body : track->GetBodies())
+	{
+		if (body.mass == 0)
+		{
+			btCollisionObject * object = TrackAsset::CreateStaticObject(body);
+			world.addCollisionObject(object);
+			objects.push_back(object);
+		}
+		else if (dynamic_objects)
+		{
+			body_transforms.push_back(MotionState());
+			btRigidBody * object = TrackAsset::CreateRigidBody(body, body_transforms.back());
+			world.addRigidBody(object);
+			objects.push_back(object);
+		}
+	}
+}
+
+SimulationWorld::~SimulationWorld()
+{
+	for (auto object : objects)
+	{
+		world.removeCollisionObject(object);
+		delete object;
+	}
+}
@@ -0,0 +1,64 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef _SIMULATION_WORLD_H
+#define _SIMULATION_WORLD_H
+
+#include "physics/dynamicsworld.h"
+#include "physics/motionstate.h"
+
+#include "BulletCollision/CollisionDispatch/btDefaultCollisionConfiguration.h"
+#include "BulletCollision/BroadphaseCollision/btDbvtBroadphase.h"
+#include "BulletDynamics/ConstraintSolver/btSequentialImpulseConstraintSolver.h"
+
+#include <list>
+#include <memory>
+#include <vector>
+
+class TrackAsset;
+class btCollisionObject;
+
+/// Private dynamics world for simulating cars on a loaded track.
+/// The track asset is attached read-only, the world only owns collision
+/// objects referencing the asset shapes and the motion states of its
+/// dynamic track bodies.
+class SimulationWorld
+{
+public:
+	btDefaultCollisionConfiguration config;
+	FractureDispatcher dispatcher;
+	btDbvtBroadphase broadphase;
+	btSequentialImpulseConstraintSolver solver;
+	DynamicsWorld world;
+
+	/// Dynamic track bodies are only simulated with dynamic_objects,
+	/// else they are left out.
+	SimulationWorld(
+		const std::shared_ptr<const TrackAsset> & track,
+		btScalar timestep,
+		bool dynamic_objects = false);
+
+	~SimulationWorld();
+
+private:
+	std::vector<btCollisionObject*> objects;
+	std::list<MotionState> body_transforms;
+};
+
+#endif // _SIMULATION_WORLD_H
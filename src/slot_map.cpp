@@ -0,0 +1,162 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#include "slot_map.h"
+#include "keyed_container.h"
+#include "unittest.h"
+
+#include <string>
+#include <algorithm>
+
+QT_TEST(slot_map_test)
+{
+	slot_map <int> data;
+	QT_CHECK(data.empty());
+	QT_CHECK_EQUAL(data.size(), 0);
+	QT_CHECK(data.begin() == data.end());
+	QT_CHECK(!slot_map<int>::handle().valid());
+
+	slot_map <int>::handle handle1 = data.insert(1);
+	slot_map <int>::handle handle2 = data.insert(2);
+	slot_map <int>::handle handle3 = data.insert(3);
+
+	QT_CHECK(handle1.valid());
+	QT_CHECK(handle1 != handle2);
+	QT_CHECK(handle1 != handle3);
+	QT_CHECK(handle3 != handle2);
+	QT_CHECK_EQUAL(data.size(), 3);
+	QT_CHECK(data.contains(handle1));
+	QT_CHECK(data.contains(handle2));
+	QT_CHECK(data.contains(handle3));
+	QT_CHECK_EQUAL(data.get(handle1), 1);
+	QT_CHECK_EQUAL(data.get(handle2), 2);
+	QT_CHECK_EQUAL(data.get(handle3), 3);
+
+	// addresses are stable
+	const int * item3 = &data.get(handle3);
+
+	data.erase(handle2);
+	data.erase(handle1);
+
+	QT_CHECK_EQUAL(data.size(), 1);
+	QT_CHECK(!data.contains(handle1));
+	QT_CHECK(!data.contains(handle2));
+	QT_CHECK(data.contains(handle3));
+	QT_CHECK(data.find(handle1) == 0);
+	QT_CHECK_EQUAL(data.find(handle3), item3);
+
+	int count = 0;
+	for (const auto item : data)
+	{
+		QT_CHECK_EQUAL(item, 3);
+		count++;
+	}
+	QT_CHECK_EQUAL(count, 1);
+
+	// reused slot doesn't validate stale handles
+	handle1 = data.insert(1);
+	QT_CHECK(data.contains(handle1));
+	QT_CHECK(!data.contains(handle2));
+	QT_CHECK_EQUAL(data.size(), 2);
+
+	// growth past a chunk keeps existing elements in place
+	std::vector<slot_map<int>::handle> handles;
+	for (int i = 0; i < 200; ++i)
+		handles.push_back(data.insert(i + 10));
+	QT_CHECK_EQUAL(&data.get(handle3), item3);
+	QT_CHECK_EQUAL(data.size(), 202);
+	for (int i = 0; i < 200; i += 2)
+		data.erase(handles[i]);
+
+	int sum = 0;
+	count = 0;
+	for (const auto item : data)
+	{
+		sum += item;
+		count++;
+	}
+	QT_CHECK_EQUAL(count, 102);
+	QT_CHECK_EQUAL(sum, 1 + 3 + 100 * 11 + 2 * (99 * 100 / 2));
+
+	slot_map <int> copy(data);
+	QT_CHECK_EQUAL(copy.size(), data.size());
+	QT_CHECK_EQUAL(copy.get(handles[1]), 11);
+
+	data.clear();
+	QT_CHECK(data.empty());
+	QT_CHECK(data.begin() == data.end());
+	QT_CHECK(!data.contains(handle3));
+	QT_CHECK(copy.contains(handle3));
+
+	slot_map <std::string> strings;
+	slot_map <std::string>::handle hs = strings.insert(std::string("test"));
+	QT_CHECK_EQUAL(strings.get(hs), "test");
+	strings.erase(hs);
+	QT_CHECK(strings.empty());
+}
+
+template <class Container>
+static void BenchmarkContainer(std::ostream & out, const std::string & name)
+{
+	const unsigned n = 10000;
+	const unsigned iterations = 100;
+
+	std::vector<typename Container::handle> handles(n);
+	std::vector<unsigned> order(n);
+	for (unsigned i = 0; i < n; ++i)
+		order[i] = (i * 7919) % n;
+
+	Container data;
+	long long sink = 0;
+
+	QT_TIME(name + " insert/erase 10000", iterations,
+		for (unsigned i = 0; i < n; ++i)
+			handles[i] = data.insert(i);
+		for (unsigned i = 0; i < n; ++i)
+			data.erase(handles[order[i]]));
+
+	for (unsigned i = 0; i < n; ++i)
+		handles[i] = data.insert(i);
+
+	QT_TIME(name + " get 10000", iterations,
+		for (unsigned i = 0; i < n; ++i)
+			sink += data.get(handles[order[i]]));
+
+	QT_TIME(name + " iterate 10000", iterations,
+		for (const auto & item : data)
+			sink += item);
+
+	// churn: erase and reinsert every other element, fragmenting the slot map
+	for (unsigned i = 0; i < n; i += 2)
+		data.erase(handles[order[i]]);
+	for (unsigned i = 0; i < n; i += 2)
+		handles[order[i]] = data.insert(i);
+
+	QT_TIME(name + " iterate 10000 after churn", iterations,
+		for (const auto & item : data)
+			sink += item);
+
+	out << "\t(" << sink << ")" << std::endl;
+}
+
+QT_BENCHMARK(slot_map_benchmark)
+{
+	BenchmarkContainer<keyed_container<int> >(out, "keyed_container");
+	BenchmarkContainer<slot_map<int> >(out, "slot_map");
+}
@@ -0,0 +1,325 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef _SLOT_MAP_H
+#define _SLOT_MAP_H
+
+#include <vector>
+#include <memory>
+#include <iterator>
+#include <utility>
+#include <new>
+#include <cassert>
+#include <stdint.h>
+
+/// 64 bit slot map handle, slot index in the low and generation in the high 32 bits.
+/// Generations start at 1, a zero handle is never valid.
+class slot_map_handle
+{
+template <typename> friend class slot_map;
+public:
+	slot_map_handle() : id(0) {}
+	bool operator==(const slot_map_handle & other) const {return id == other.id;}
+	bool operator!=(const slot_map_handle & other) const {return id != other.id;}
+	bool operator<(const slot_map_handle & other) const {return id < other.id;}
+	bool valid() const {return id != 0;}
+	void invalidate() {id = 0;}
+	uint64_t value() const {return id;}
+
+private:
+	uint64_t id;
+	slot_map_handle(uint32_t index, uint32_t generation) : id(uint64_t(generation) << 32 | index) {}
+	uint32_t index() const {return uint32_t(id);}
+	uint32_t generation() const {return uint32_t(id >> 32);}
+};
+
+/// Slot map with stable element addresses.
+/// Elements are stored in fixed size chunks which are never moved or released
+/// before clear, so pointers to elements stay valid until they are erased.
+/// Iteration walks the chunks in memory order using a per chunk occupancy mask,
+/// lookup is a single indexed access plus a generation check.
+/// Drop-in alternative to keyed_container where element addresses need to be
+/// stable or erase heavy use makes swap and pop expensive.
+template <typename T>
+class slot_map
+{
+private:
+	static const unsigned chunk_bits = 6;
+	static const unsigned chunk_size = 1 << chunk_bits; ///< one occupancy mask bit per slot
+
+	struct Chunk
+	{
+		uint64_t used;
+		uint32_t generation[chunk_size];
+		typename std::aligned_storage<sizeof(T), alignof(T)>::type slots[chunk_size];
+
+		Chunk() : used(0)
+		{
+			for (auto & g : generation)
+				g = 1;
+		}
+
+		T * slot(unsigned i) {return reinterpret_cast<T*>(&slots[i]);}
+		const T * slot(unsigned i) const {return reinterpret_cast<const T*>(&slots[i]);}
+	};
+
+	std::vector<std::unique_ptr<Chunk> > chunks;
+	std::vector<uint32_t> freeslots;
+	unsigned count;
+
+	static unsigned FirstBit(uint64_t mask)
+	{
+		assert(mask);
+#if defined(__GNUC__)
+		return __builtin_ctzll(mask);
+#else
+		unsigned n = 0;
+		while (!(mask & 1))
+		{
+			mask >>= 1;
+			n++;
+		}
+		return n;
+#endif
+	}
+
+	const T * lookup(const slot_map_handle & key) const
+	{
+		uint32_t i = key.index();
+		uint32_t c = i >> chunk_bits;
+		uint32_t s = i & (chunk_size - 1);
+		if (c >= chunks.size())
+			return 0;
+
+		const Chunk & chunk = *chunks[c];
+		if (chunk.generation[s] != key.generation() || !(chunk.used & (uint64_t(1) << s)))
+			return 0;
+
+		return chunk.slot(s);
+	}
+
+	uint32_t allocate()
+	{
+		if (freeslots.empty())
+		{
+			// slots are handed out from the free list back, push in reverse to fill new chunks front to back
+			uint32_t base = chunks.size() << chunk_bits;
+			chunks.emplace_back(new Chunk());
+			for (uint32_t i = chunk_size; i > 0; --i)
+				freeslots.push_back(base + i - 1);
+		}
+		uint32_t i = freeslots.back();
+		freeslots.pop_back();
+		return i;
+	}
+
+	slot_map_handle commit(uint32_t i)
+	{
+		Chunk & chunk = *chunks[i >> chunk_bits];
+		chunk.used |= uint64_t(1) << (i & (chunk_size - 1));
+		count++;
+		return slot_map_handle(i, chunk.generation[i & (chunk_size - 1)]);
+	}
+
+	/// destroy the element in slot s and invalidate its handles
+	static void release(Chunk & chunk, unsigned s)
+	{
+		chunk.slot(s)->~T();
+		chunk.used &= ~(uint64_t(1) << s);
+		if (++chunk.generation[s] == 0)
+			chunk.generation[s] = 1;
+	}
+
+	/// walks the occupancy masks chunk by chunk
+	template <typename MAP, typename CHUNK, typename VALUE>
+	class iterator_base : public std::iterator<std::forward_iterator_tag, VALUE>
+	{
+	friend class slot_map;
+	public:
+		iterator_base() : map(0), chunk(0), c(0), mask(0) {}
+		VALUE & operator*() const {return *chunk->slot(FirstBit(mask));}
+		VALUE * operator->() const {return &**this;}
+		iterator_base & operator++()
+		{
+			mask &= mask - 1;
+			if (!mask)
+				seek(c + 1);
+			return *this;
+		}
+		iterator_base operator++(int) {iterator_base t(*this); ++*this; return t;}
+		bool operator==(const iterator_base & other) const {return c == other.c && mask == other.mask;}
+		bool operator!=(const iterator_base & other) const {return !(*this == other);}
+
+	private:
+		MAP * map;
+		CHUNK * chunk;
+		uint32_t c;
+		uint64_t mask; ///< slots of the current chunk not visited yet
+
+		iterator_base(MAP * map, uint32_t c) : map(map), chunk(0), c(c), mask(0)
+		{
+			seek(c);
+		}
+
+		/// move to the first used slot in chunk i or later
+		void seek(uint32_t i)
+		{
+			const uint32_t end = map->chunks.size();
+			for (c = i; c < end; ++c)
+			{
+				chunk = map->chunks[c].get();
+				mask = chunk->used;
+				if (mask)
+					return;
+			}
+			c = end;
+			chunk = 0;
+			mask = 0;
+		}
+	};
+
+public:
+	typedef slot_map_handle handle;
+	typedef iterator_base<slot_map, Chunk, T> iterator;
+	typedef iterator_base<const slot_map, const Chunk, const T> const_iterator;
+
+	slot_map() : count(0) {}
+
+	slot_map(const slot_map & other) : count(0)
+	{
+		*this = other;
+	}
+
+	/// copies keep slot positions, handles of the source are valid for the copy
+	slot_map & operator=(const slot_map & other)
+	{
+		if (this == &other)
+			return *this;
+
+		clear();
+		chunks.clear();
+		for (const auto & src : other.chunks)
+		{
+			chunks.emplace_back(new Chunk());
+			Chunk & dst = *chunks.back();
+			for (unsigned s = 0; s < chunk_size; ++s)
+			{
+				dst.generation[s] = src->generation[s];
+				if (src->used & (uint64_t(1) << s))
+					new (dst.slot(s)) T(*src->slot(s));
+			}
+			dst.used = src->used;
+		}
+		freeslots = other.freeslots;
+		count = other.count;
+		return *this;
+	}
+
+	~slot_map()
+	{
+		clear();
+	}
+
+	handle insert(const T & item)
+	{
+		uint32_t i = allocate();
+		new (chunks[i >> chunk_bits]->slot(i & (chunk_size - 1))) T(item);
+		return commit(i);
+	}
+
+	handle insert(T && item)
+	{
+		uint32_t i = allocate();
+		new (chunks[i >> chunk_bits]->slot(i & (chunk_size - 1))) T(std::move(item));
+		return commit(i);
+	}
+
+	/// asserts that the item is found
+	const T & get(const handle & key) const
+	{
+		const T * item = lookup(key);
+		assert(item);
+		return *item;
+	}
+
+	T & get(const handle & key)
+	{
+		return const_cast<T&>(static_cast<const slot_map*>(this)->get(key));
+	}
+
+	/// null if not found
+	const T * find(const handle & key) const
+	{
+		return lookup(key);
+	}
+
+	T * find(const handle & key)
+	{
+		return const_cast<T*>(lookup(key));
+	}
+
+	bool contains(const handle & key) const
+	{
+		return lookup(key) != 0;
+	}
+
+	/// asserts that the item was found and erased
+	void erase(const handle & key)
+	{
+		assert(contains(key));
+		uint32_t i = key.index();
+		uint32_t s = i & (chunk_size - 1);
+		release(*chunks[i >> chunk_bits], s);
+		freeslots.push_back(i);
+		count--;
+	}
+
+	/// keeps the chunks allocated, O(capacity)
+	void clear()
+	{
+		for (auto & chunk : chunks)
+		{
+			for (uint64_t mask = chunk->used; mask; mask &= mask - 1)
+			{
+				release(*chunk, FirstBit(mask));
+			}
+		}
+
+		// rebuild the free list so slots are reused front to back
+		freeslots.clear();
+		for (uint32_t i = chunks.size() << chunk_bits; i > 0; --i)
+			freeslots.push_back(i - 1);
+		count = 0;
+	}
+
+	iterator begin() {return iterator(this, 0);}
+	const_iterator begin() const {return const_iterator(this, 0);}
+
+	iterator end() {return iterator(this, chunks.size());}
+	const_iterator end() const {return const_iterator(this, chunks.size());}
+
+	unsigned size() const {return count;}
+
+	bool empty() const {return count == 0;}
+
+	/// number of slots allocated
+	unsigned capacity() const {return chunks.size() << chunk_bits;}
+};
+
+#endif // _SLOT_MAP_H
@@ -0,0 +1,117 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#include "snapshot.h"
+#include "macros.h"
+#include "unittest.h"
+
+namespace
+{
+	struct SnapshotTestPart
+	{
+		float f;
+		bool b;
+
+		template <class Serializer>
+		bool Serialize(Serializer & s)
+		{
+			_SERIALIZE_(s, f);
+			_SERIALIZE_(s, b);
+			return true;
+		}
+	};
+
+	struct SnapshotTestState
+	{
+		int i;
+		double d;
+		SnapshotTestPart part[2];
+
+		template <class Serializer>
+		bool Serialize(Serializer & s)
+		{
+			_SERIALIZE_(s, i);
+			_SERIALIZE_(s, d);
+			_SERIALIZE_(s, part[0]);
+			_SERIALIZE_(s, part[1]);
+			return true;
+		}
+	};
+
+	struct SnapshotTestOther
+	{
+		int i;
+		float f;
+
+		template <class Serializer>
+		bool Serialize(Serializer & s)
+		{
+			_SERIALIZE_(s, i);
+			_SERIALIZE_(s, f);
+			return true;
+		}
+	};
+}
+
+QT_TEST(snapshot_test)
+{
+	static_assert(std::is_trivially_copyable<Snapshot<64> >::value, "snapshot must be memcpy-able");
+
+	SnapshotTestState a;
+	a.i = 7;
+	a.d = 0.25;
+	a.part[0].f = 1.5f;
+	a.part[0].b = true;
+	a.part[1].f = -3.0f;
+	a.part[1].b = false;
+
+	Snapshot<64> snapshot;
+	QT_CHECK(snapshot.empty());
+	QT_CHECK(SaveSnapshot(snapshot, a));
+	QT_CHECK_EQUAL(snapshot.size, sizeof(int) + sizeof(double) + 2 * (sizeof(float) + sizeof(bool)));
+
+	// copy by value, restore into a different object
+	Snapshot<64> copy;
+	std::memcpy(&copy, &snapshot, sizeof(copy));
+	SnapshotTestState b = {0, 0, {{0, false}, {0, true}}};
+	QT_CHECK(LoadSnapshot(copy, b));
+	QT_CHECK_EQUAL(b.i, 7);
+	QT_CHECK_EQUAL(b.d, 0.25);
+	QT_CHECK_EQUAL(b.part[0].f, 1.5f);
+	QT_CHECK_EQUAL(b.part[0].b, true);
+	QT_CHECK_EQUAL(b.part[1].f, -3.0f);
+	QT_CHECK_EQUAL(b.part[1].b, false);
+
+	// layout mismatch leaves the object untouched
+	SnapshotTestOther c = {3, 0.5f};
+	QT_CHECK(!LoadSnapshot(snapshot, c));
+	QT_CHECK_EQUAL(c.i, 3);
+	QT_CHECK_EQUAL(c.f, 0.5f);
+
+	// measuring writes nothing
+	SnapshotWriter measure(0, ~0u);
+	QT_CHECK(a.Serialize(measure));
+	QT_CHECK_EQUAL(measure.GetSize(), snapshot.size);
+	QT_CHECK_EQUAL(measure.GetLayout(), snapshot.layout);
+
+	// capacity exceeded
+	Snapshot<8> small;
+	QT_CHECK(!SaveSnapshot(small, a));
+	QT_CHECK(small.empty());
+}
@@ -0,0 +1,202 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef _SNAPSHOT_H
+#define _SNAPSHOT_H
+
+#include <cstring>
+#include <type_traits>
+
+/// Fixed size state block, trivially copyable, no allocations.
+/// Filled by SnapshotWriter and applied by SnapshotReader through the
+/// usual Serialize(Serializer &) methods. Data is stored in host byte
+/// order, it is meant for in-memory state (rewind, i-frames), not files.
+template <unsigned N>
+struct Snapshot
+{
+	static const unsigned capacity = N;
+	unsigned layout; ///< hash of the serialized field types and order
+	unsigned size; ///< bytes of data in use, zero if empty
+	unsigned char data[N];
+
+	Snapshot() : layout(0), size(0) {}
+
+	bool empty() const { return size == 0; }
+
+	void clear() { layout = 0; size = 0; }
+};
+
+/// Layout hash step, FNV-1a over field size and kind.
+template <typename T>
+inline unsigned SnapshotLayoutHash(unsigned layout)
+{
+	const unsigned kind = sizeof(T) | (std::is_floating_point<T>::value << 8);
+	return (layout ^ kind) * 16777619u;
+}
+
+/// Types stored as raw bytes, everything else is serialized member-wise.
+/// Pointers are stored as is, they are only valid within the same process.
+template <typename T>
+struct SnapshotRaw : std::integral_constant<bool,
+	std::is_arithmetic<T>::value || std::is_enum<T>::value || std::is_pointer<T>::value> {};
+
+/// Non-virtual serializer writing raw field bytes into a Snapshot.
+/// Field names are ignored, they are never converted to std::string.
+/// Without data it only measures the size and layout of the fields.
+class SnapshotWriter
+{
+public:
+	SnapshotWriter(unsigned char * data, unsigned capacity) :
+		data(data), capacity(capacity), size(0), layout(2166136261u)
+	{
+		// ctor
+	}
+
+	template <typename T>
+	bool Serialize(const char * /*name*/, T & t)
+	{
+		return Write(t, SnapshotRaw<T>());
+	}
+
+	template <typename T>
+	bool Serialize(T & t)
+	{
+		return t.Serialize(*this);
+	}
+
+	unsigned GetSize() const { return size; }
+
+	unsigned GetLayout() const { return layout; }
+
+private:
+	unsigned char * data;
+	unsigned capacity;
+	unsigned size;
+	unsigned layout;
+
+	template <typename T>
+	bool Write(const T & t, std::true_type)
+	{
+		if (size + sizeof(T) > capacity)
+			return false;
+		if (data)
+			std::memcpy(data + size, &t, sizeof(T));
+		size += sizeof(T);
+		layout = SnapshotLayoutHash<T>(layout);
+		return true;
+	}
+
+	template <typename T>
+	bool Write(T & t, std::false_type)
+	{
+		return t.Serialize(*this);
+	}
+};
+
+/// Non-virtual serializer reading raw field bytes from a Snapshot.
+class SnapshotReader
+{
+public:
+	SnapshotReader(const unsigned char * data, unsigned size, unsigned expected_layout = 0) :
+		data(data), capacity(size), size(0), layout(2166136261u), expected_layout(expected_layout)
+	{
+		// ctor
+	}
+
+	template <typename T>
+	bool Serialize(const char * /*name*/, T & t)
+	{
+		return Read(t, SnapshotRaw<T>());
+	}
+
+	template <typename T>
+	bool Serialize(T & t)
+	{
+		return t.Serialize(*this);
+	}
+
+	unsigned GetSize() const { return size; }
+
+	unsigned GetLayout() const { return layout; }
+
+	/// True if all data has been read and the layout matches.
+	bool Valid() const { return size == capacity && layout == expected_layout; }
+
+	/// True if the data has the size and layout measured by writer.
+	bool Matches(const SnapshotWriter & writer) const
+	{
+		return writer.GetSize() == capacity && writer.GetLayout() == expected_layout;
+	}
+
+private:
+	const unsigned char * data;
+	unsigned capacity;
+	unsigned size;
+	unsigned layout;
+	unsigned expected_layout;
+
+	template <typename T>
+	bool Read(T & t, std::true_type)
+	{
+		if (size + sizeof(T) > capacity)
+			return false;
+		std::memcpy(&t, data + size, sizeof(T));
+		size += sizeof(T);
+		layout = SnapshotLayoutHash<T>(layout);
+		return true;
+	}
+
+	template <typename T>
+	bool Read(T & t, std::false_type)
+	{
+		return t.Serialize(*this);
+	}
+};
+
+/// Save object state into snapshot, false if it doesn't fit.
+template <unsigned N, class T>
+inline bool SaveSnapshot(Snapshot<N> & snapshot, T & object)
+{
+	SnapshotWriter writer(snapshot.data, N);
+	if (!object.Serialize(writer))
+	{
+		snapshot.clear();
+		return false;
+	}
+	snapshot.size = writer.GetSize();
+	snapshot.layout = writer.GetLayout();
+	return true;
+}
+
+/// Restore object state from snapshot, false if the layout doesn't match.
+/// The layout is checked against the object before reading, so a mismatching
+/// snapshot leaves the object untouched.
+template <unsigned N, class T>
+inline bool LoadSnapshot(const Snapshot<N> & snapshot, T & object)
+{
+	if (snapshot.empty())
+		return false;
+	SnapshotReader reader(snapshot.data, snapshot.size, snapshot.layout);
+	SnapshotWriter measure(0, ~0u);
+	if (!object.Serialize(measure) || !reader.Matches(measure))
+		return false;
+	return object.Serialize(reader) && reader.Valid();
+}
+
+#endif // _SNAPSHOT_H
@@ -0,0 +1,403 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#include "telemetry_recorder.h"
+#include "minmax.h"
+#include "unittest.h"
+
+#include <SDL2/SDL_thread.h>
+#include <SDL2/SDL_timer.h>
+
+#include <cassert>
+#include <cstdio>
+#include <iomanip>
+#include <sstream>
+
+static const char telemetry_magic[4] = {'V', 'D', 'T', 'L'};
+static const uint32_t telemetry_version = 1;
+
+// rows per compressed column block
+static const unsigned block_rows = 256;
+
+template <typename T>
+static void Write(std::ostream & out, const T & value)
+{
+	out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template <typename T>
+static bool Read(std::istream & in, T & value)
+{
+	return bool(in.read(reinterpret_cast<char *>(&value), sizeof(T)));
+}
+
+TelemetryRecorder::TelemetryRecorder() :
+	row(1, 0),
+	ring_rows(0),
+	row_size(1),
+	head(0),
+	tail(0),
+	stopping(false),
+	dropped_rows(0),
+	writer_thread(0)
+{
+	// ctor
+}
+
+TelemetryRecorder::~TelemetryRecorder()
+{
+	Stop();
+}
+
+int TelemetryRecorder::AddChannel(const std::string & name)
+{
+	assert(!Recording());
+	channels.push_back(name);
+	row.push_back(0);
+	return channels.size() - 1;
+}
+
+void TelemetryRecorder::ClearChannels()
+{
+	assert(!Recording());
+	channels.clear();
+	row.assign(1, 0);
+}
+
+bool TelemetryRecorder::Start(const std::string & filename, std::ostream & error_output, unsigned min_ring_rows)
+{
+	Stop();
+
+	file.open(filename.c_str(), std::ios::binary);
+	if (!file)
+	{
+		error_output << "Failed to open telemetry file " << filename << std::endl;
+		return false;
+	}
+
+	file.write(telemetry_magic, sizeof(telemetry_magic));
+	Write(file, telemetry_version);
+	Write(file, uint32_t(channels.size()));
+	for (const auto & name : channels)
+	{
+		Write(file, uint32_t(name.size()));
+		file.write(name.data(), name.size());
+	}
+
+	// power of two ring, indices wrap around cleanly
+	ring_rows = block_rows;
+	while (ring_rows < min_ring_rows)
+		ring_rows *= 2;
+	row_size = channels.size() + 1;
+	ring.assign(size_t(ring_rows) * row_size, 0);
+	column.resize(block_rows);
+	head = 0;
+	tail = 0;
+	stopping = false;
+	dropped_rows = 0;
+
+	writer_thread = SDL_CreateThread(WriterThread, "telemetry", this);
+	if (!writer_thread)
+	{
+		error_output << "Failed to start telemetry writer thread" << std::endl;
+		file.close();
+		return false;
+	}
+	return true;
+}
+
+void TelemetryRecorder::Stop()
+{
+	if (!writer_thread)
+		return;
+
+	stopping.store(true, std::memory_order_release);
+	SDL_WaitThread(writer_thread, 0);
+	writer_thread = 0;
+	file.close();
+}
+
+void TelemetryRecorder::Commit(uint32_t tick)
+{
+	if (!writer_thread)
+		return;
+
+	row[0] = tick;
+	const unsigned h = head.load(std::memory_order_relaxed);
+	if (h - tail.load(std::memory_order_acquire) >= ring_rows)
+	{
+		dropped_rows++;
+		return;
+	}
+	std::memcpy(&ring[size_t(h & (ring_rows - 1)) * row_size], &row[0], row_size * sizeof(uint32_t));
+	head.store(h + 1, std::memory_order_release);
+}
+
+int TelemetryRecorder::WriterThread(void * recorder)
+{
+	static_cast<TelemetryRecorder *>(recorder)->WriteBlocks();
+	return 0;
+}
+
+void TelemetryRecorder::WriteBlocks()
+{
+	while (true)
+	{
+		// stop flag before head, rows committed before Stop are written
+		const bool stop = stopping.load(std::memory_order_acquire);
+		const unsigned available = head.load(std::memory_order_acquire) - tail.load(std::memory_order_relaxed);
+		if (available >= block_rows || (stop && available > 0))
+			WriteBlock(Min(available, block_rows));
+		else if (stop)
+			break;
+		else
+			SDL_Delay(10);
+	}
+	file.flush();
+}
+
+void TelemetryRecorder::WriteBlock(unsigned rows)
+{
+	const unsigned t = tail.load(std::memory_order_relaxed);
+	Write(file, uint32_t(rows));
+	for (unsigned c = 0; c < row_size; ++c)
+	{
+		for (unsigned r = 0; r < rows; ++r)
+			column[r] = ring[size_t((t + r) & (ring_rows - 1)) * row_size + c];
+
+		packed.clear();
+		EncodeColumn(&column[0], rows, packed);
+		Write(file, uint32_t(packed.size()));
+		file.write(reinterpret_cast<const char *>(&packed[0]), packed.size());
+	}
+	tail.store(t + rows, std::memory_order_release);
+}
+
+void TelemetryRecorder::EncodeColumn(const uint32_t * values, unsigned count, std::vector<unsigned char> & out)
+{
+	// slowly changing channels leave the high bytes of the xor delta zero,
+	// byte plane p holds byte p of every delta
+	for (unsigned p = 0; p < 4; ++p)
+	{
+		const unsigned shift = p * 8;
+		uint32_t prev = 0;
+		unsigned zeros = 0;
+		for (unsigned i = 0; i < count; ++i)
+		{
+			const unsigned char b = ((values[i] ^ prev) >> shift) & 0xff;
+			prev = values[i];
+			if (b == 0)
+			{
+				if (++zeros == 255)
+				{
+					out.push_back(0);
+					out.push_back(zeros);
+					zeros = 0;
+				}
+				continue;
+			}
+			if (zeros)
+			{
+				out.push_back(0);
+				out.push_back(zeros);
+				zeros = 0;
+			}
+			out.push_back(b);
+		}
+		if (zeros)
+		{
+			out.push_back(0);
+			out.push_back(zeros);
+		}
+	}
+}
+
+bool TelemetryRecorder::DecodeColumn(const unsigned char * data, unsigned size, unsigned count, uint32_t * values)
+{
+	std::memset(values, 0, count * sizeof(uint32_t));
+
+	unsigned pos = 0;
+	for (unsigned p = 0; p < 4; ++p)
+	{
+		const unsigned shift = p * 8;
+		unsigned i = 0;
+		while (i < count)
+		{
+			if (pos >= size)
+				return false;
+
+			const unsigned char b = data[pos++];
+			if (b != 0)
+			{
+				values[i++] |= uint32_t(b) << shift;
+				continue;
+			}
+
+			if (pos >= size)
+				return false;
+
+			const unsigned run = data[pos++];
+			if (run == 0 || i + run > count)
+				return false;
+			i += run;
+		}
+	}
+	if (pos != size)
+		return false;
+
+	for (unsigned i = 1; i < count; ++i)
+		values[i] ^= values[i - 1];
+
+	return true;
+}
+
+bool TelemetryRecorder::ConvertToCsv(std::istream & in, std::ostream & out, std::ostream & error_output)
+{
+	char magic[sizeof(telemetry_magic)];
+	uint32_t version = 0, channel_count = 0;
+	if (!in.read(magic, sizeof(magic)) ||
+		std::memcmp(magic, telemetry_magic, sizeof(magic)) ||
+		!Read(in, version) || version != telemetry_version ||
+		!Read(in, channel_count))
+	{
+		error_output << "Not a telemetry recording" << std::endl;
+		return false;
+	}
+
+	out << "tick";
+	for (uint32_t c = 0; c < channel_count; ++c)
+	{
+		uint32_t length = 0;
+		if (!Read(in, length) || length > 1024)
+		{
+			error_output << "Corrupt telemetry header" << std::endl;
+			return false;
+		}
+		std::string name(length, ' ');
+		if (length && !in.read(&name[0], length))
+		{
+			error_output << "Corrupt telemetry header" << std::endl;
+			return false;
+		}
+		out << "," << name;
+	}
+	out << "\n";
+	out << std::setprecision(9);
+
+	const unsigned columns = channel_count + 1;
+	std::vector<uint32_t> values;
+	std::vector<unsigned char> data;
+	uint32_t rows = 0;
+	while (Read(in, rows))
+	{
+		if (rows == 0 || rows > block_rows)
+		{
+			error_output << "Corrupt telemetry block" << std::endl;
+			return false;
+		}
+
+		values.resize(size_t(rows) * columns);
+		for (unsigned c = 0; c < columns; ++c)
+		{
+			uint32_t size = 0;
+			if (!Read(in, size) || size > rows * 8)
+			{
+				error_output << "Corrupt telemetry block" << std::endl;
+				return false;
+			}
+			data.resize(size);
+			if ((size && !in.read(reinterpret_cast<char *>(&data[0]), size)) ||
+				!DecodeColumn(data.empty() ? 0 : &data[0], size, rows, &values[size_t(c) * rows]))
+			{
+				error_output << "Corrupt telemetry block" << std::endl;
+				return false;
+			}
+		}
+
+		for (unsigned r = 0; r < rows; ++r)
+		{
+			out << values[r];
+			for (unsigned c = 1; c < columns; ++c)
+			{
+				float value;
+				std::memcpy(&value, &values[size_t(c) * rows + r], sizeof(value));
+				out << "," << value;
+			}
+			out << "\n";
+		}
+	}
+	return true;
+}
+
+QT_TEST(telemetry_recorder_test)
+{
+	// column codec round trip
+	std::vector<uint32_t> values(1000), decoded(1000);
+	for (unsigned i = 0; i < values.size(); ++i)
+	{
+		float value = (i < 300) ? 1.0f : (i < 700) ? i * 0.37f : -float(i * i);
+		std::memcpy(&values[i], &value, sizeof(value));
+	}
+	std::vector<unsigned char> packed;
+	TelemetryRecorder::EncodeColumn(&values[0], values.size(), packed);
+	QT_CHECK(packed.size() < values.size() * sizeof(uint32_t));
+	QT_CHECK(TelemetryRecorder::DecodeColumn(&packed[0], packed.size(), values.size(), &decoded[0]));
+	QT_CHECK(values == decoded);
+	QT_CHECK(!TelemetryRecorder::DecodeColumn(&packed[0], packed.size() - 1, values.size(), &decoded[0]));
+
+	// record and convert
+	const std::string filename = "telemetry_test.vdt";
+	{
+		TelemetryRecorder recorder;
+		int speed = recorder.AddChannel("speed");
+		int rpm = recorder.AddChannel("rpm");
+		std::ostringstream error;
+		QT_CHECK(recorder.Start(filename, error, 1024));
+		for (unsigned i = 0; i < 600; ++i)
+		{
+			recorder.Set(speed, i * 0.5f);
+			if (i % 2 == 0)
+				recorder.Set(rpm, 1000 + i);
+			recorder.Commit(i);
+		}
+		recorder.Stop();
+		QT_CHECK(!recorder.Recording());
+		QT_CHECK_EQUAL(recorder.GetDroppedRows(), 0);
+	}
+
+	std::ifstream in(filename.c_str(), std::ios::binary);
+	std::ostringstream csv, error;
+	QT_CHECK(TelemetryRecorder::ConvertToCsv(in, csv, error));
+	in.close();
+	std::remove(filename.c_str());
+
+	std::istringstream lines(csv.str());
+	std::string line;
+	std::getline(lines, line);
+	QT_CHECK_EQUAL(line, "tick,speed,rpm");
+	unsigned count = 0;
+	std::string last;
+	while (std::getline(lines, line))
+	{
+		last = line;
+		count++;
+	}
+	QT_CHECK_EQUAL(count, 600);
+	QT_CHECK_EQUAL(last, "599,299.5,1598");
+}
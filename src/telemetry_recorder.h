@@ -0,0 +1,115 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef _TELEMETRY_RECORDER_H
+#define _TELEMETRY_RECORDER_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+struct SDL_Thread;
+
+/// Binary telemetry recorder for per tick samples.
+/// Channels are registered once and addressed by id. Set writes into a
+/// staging row, Commit copies it into a single producer, single consumer
+/// ring. A writer thread packs the ring rows into compressed column
+/// blocks, so the recording thread never formats or writes anything.
+///
+/// File layout, host byte order:
+///   "VDTL", version, channel count, channel names (length, chars)
+///   blocks: row count, then per column (tick first) byte size, bytes
+/// Columns are xor deltas of the 32 bit values, split into byte planes
+/// with zero runs encoded as a zero byte followed by the run length.
+class TelemetryRecorder
+{
+public:
+	TelemetryRecorder();
+
+	~TelemetryRecorder();
+
+	/// Register a channel before Start. Returns the channel id.
+	int AddChannel(const std::string & name);
+
+	/// Remove all channels, only valid while not recording.
+	void ClearChannels();
+
+	/// Open the file and start the writer thread.
+	/// The ring holds ring_rows rows, rows committed into a full ring are dropped.
+	bool Start(const std::string & filename, std::ostream & error_output, unsigned ring_rows = 4096);
+
+	/// Write the remaining rows, stop the writer thread and close the file.
+	void Stop();
+
+	bool Recording() const
+	{
+		return writer_thread != 0;
+	}
+
+	/// Set a channel value of the current row. Values persist until set again.
+	void Set(int channel, float value)
+	{
+		std::memcpy(&row[channel + 1], &value, sizeof(value));
+	}
+
+	/// Publish the current row.
+	void Commit(uint32_t tick);
+
+	/// Rows lost because the writer couldn't keep up.
+	unsigned GetDroppedRows() const
+	{
+		return dropped_rows;
+	}
+
+	/// Convert a recording to CSV with a header line of channel names.
+	static bool ConvertToCsv(std::istream & in, std::ostream & out, std::ostream & error_output);
+
+	/// Column codec, exposed for testing.
+	static void EncodeColumn(const uint32_t * values, unsigned count, std::vector<unsigned char> & out);
+	static bool DecodeColumn(const unsigned char * data, unsigned size, unsigned count, uint32_t * values);
+
+private:
+	std::vector<std::string> channels;
+	std::vector<uint32_t> row;
+	std::vector<uint32_t> ring;
+	unsigned ring_rows;
+	unsigned row_size;
+	std::atomic<unsigned> head;
+	std::atomic<unsigned> tail;
+	std::atomic<bool> stopping;
+	unsigned dropped_rows;
+	std::ofstream file;
+	SDL_Thread * writer_thread;
+
+	// writer thread state
+	std::vector<uint32_t> column;
+	std::vector<unsigned char> packed;
+
+	static int WriterThread(void * recorder);
+
+	void WriteBlocks();
+
+	void WriteBlock(unsigned rows);
+};
+
+#endif // _TELEMETRY_RECORDER_H
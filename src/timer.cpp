@@ -20,7 +20,6 @@
 #include "timer.h"
 #include "unittest.h"
 
-#include <list>
 #include <string>
 #include <sstream>
 
@@ -120,53 +119,3 @@ void Timer::UpdateDistance(const unsigned int carid, const double newdistance)
 	assert(carid < car.size());
 	car[carid].UpdateLapDistance(newdistance);
 }
-
-class Place
-{
-private:
-	int index;
-	int laps;
-	double distance;
-
-public:
-	Place(int newindex, int newlaps, double newdistance) : index(newindex), laps(newlaps), distance(newdistance) {}
-
-	int GetIndex() const {return index;}
-
-	bool operator< (const Place & other) const
-	{
-		if (laps == other.laps)
-			return distance > other.distance;
-		else
-			return laps > other.laps;
-	}
-};
-
-std::pair <int, int> Timer::GetCarPlace(int index)
-{
-    assert(index<(int)car.size());
-    assert(index >= 0);
-
-    int place = 1;
-    int total = car.size();
-
-	std::list <Place> distances;
-
-    for (int i = 0; i < (int)car.size(); i++)
-    {
-		distances.push_back(Place(i, car[i].GetCurrentLap(), car[i].GetLapDistance()));
-    }
-
-    distances.sort();
-
-    int curplace = 1;
-	for (auto & distance : distances)
-    {
-        if (distance.GetIndex() == index)
-            place = curplace;
-
-        curplace++;
-    }
-
-    return std::make_pair(place, total);
-}
@@ -21,6 +21,7 @@
 #define _TIMER_H
 
 #include "cfg/config.h"
+#include "macros.h"
 
 #include <ostream>
 #include <string>
@@ -62,9 +63,6 @@ public:
 
 	float GetStagingTimeLeft() const {return pretime;}
 
-	///return the place (first element) out of total (second element)
-	std::pair <int, int> GetCarPlace(int index);
-
 	float GetDriftScore(unsigned int index) const
 	{
 		assert(index<car.size());
@@ -104,6 +102,16 @@ public:
 			car[index].GetDriftScore().SetMaxSpeed(speed);
 	}
 
+	/// Lap and drift state of all cars, for in-memory snapshots.
+	template <class Serializer>
+	bool Serialize(Serializer & s)
+	{
+		_SERIALIZE_(s, pretime);
+		for (auto & lapinfo : car)
+			_SERIALIZE_(s, lapinfo);
+		return true;
+	}
+
 	template <class Stream>
 	void DebugPrint(Stream & out) const
 	{
@@ -206,6 +214,17 @@ private:
 			return max_speed;
 		}
 
+		template <class Serializer>
+		bool Serialize(Serializer & s)
+		{
+			_SERIALIZE_(s, score);
+			_SERIALIZE_(s, thisdriftscore);
+			_SERIALIZE_(s, drifting);
+			_SERIALIZE_(s, max_angle);
+			_SERIALIZE_(s, max_speed);
+			return true;
+		}
+
 		float GetBonusScore() const
 		{
 			return max_speed * 0.5f + max_angle * 40 / 3.141593f + thisdriftscore; //including thisdriftscore here is redundant on purpose to give more points to long drifts
@@ -264,6 +283,20 @@ private:
 			num_laps++;
 		}
 
+		template <class Serializer>
+		bool Serialize(Serializer & s)
+		{
+			_SERIALIZE_(s, bestlap);
+			_SERIALIZE_(s, lastlap);
+			_SERIALIZE_(s, time);
+			_SERIALIZE_(s, totaltime);
+			_SERIALIZE_(s, lapdistance);
+			_SERIALIZE_(s, num_laps);
+			_SERIALIZE_(s, sector);
+			_SERIALIZE_(s, driftscore);
+			return true;
+		}
+
 		const std::string & GetCarType() const
 		{
 			return cartype;
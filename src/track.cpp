@@ -20,11 +20,9 @@
 #include "track.h"
 #include "trackloader.h"
 #include "physics/dynamicsworld.h"
-#include "coordinatesystem.h"
 #include "tobullet.h"
-
-#include "BulletCollision/CollisionShapes/btCollisionShape.h"
-#include "BulletCollision/CollisionShapes/btStridingMeshInterface.h"
+#include "snapshot.h"
+#include "physics/bulletserialize.h"
 
 Track::Track() : racingline_visible(false)
 {
@@ -52,8 +50,8 @@ bool Track::DeferredLoad(
 {
 	Clear();
 
-	world.reset(*this);
 	data.world = &world;
+	world.reset(data.asset);
 
 	loader.reset(
 		new Loader(
@@ -100,59 +98,18 @@ void Track::Clear()
 	}
 	data.objects.clear();
 
-	for (auto & shape : data.shapes)
-	{
-		delete shape;
-	}
-	data.shapes.clear();
-
-	for (auto & mesh : data.meshes)
-	{
-		delete mesh;
-	}
-	data.meshes.clear();
+	// worlds still attached keep their reference
+	data.asset.reset(new TrackAsset());
 
 	data.static_node.Clear();
-	data.surfaces.clear();
 	data.models.clear();
 	data.dynamic_node.Clear();
 	data.body_nodes.clear();
 	data.body_transforms.clear();
-	data.lap.clear();
-	data.roads.clear();
-	data.start_positions.clear();
 	data.racingline_node.Clear();
 	data.loaded = false;
 }
 
-bool Track::CastRay(
-	const Vec3 & origin,
-	const Vec3 & direction,
-	const float seglen,
-	int & patch_id,
-	Vec3 & outtri,
-	const RoadPatch * & colpatch,
-	Vec3 & normal) const
-{
-	bool col = false;
-	for (const auto & road : data.roads)
-	{
-		Vec3 tri, norm;
-		const RoadPatch * patch = NULL;
-		if (road.Collide(origin, direction, seglen, patch_id, tri, patch, norm))
-		{
-			if (!col || (tri - origin).MagnitudeSquared() < (outtri - origin).MagnitudeSquared())
-			{
-				outtri = tri;
-				normal = norm;
-				colpatch = patch;
-			}
-			col = true;
-		}
-	}
-	return col;
-}
-
 void Track::Update()
 {
 	if (!data.loaded) return;
@@ -166,24 +123,41 @@ void Track::Update()
 	}
 }
 
-std::pair <Vec3, Quat > Track::GetStart(unsigned int index) const
+template <class Serializer>
+static bool SerializeBodies(Serializer & s, const std::vector<btCollisionObject*> & objects)
+{
+	for (auto object : objects)
+	{
+		btRigidBody * body = btRigidBody::upcast(object);
+		if (body && !body->isStaticObject())
+			_SERIALIZEX_(s, *body);
+	}
+	return true;
+}
+
+bool Track::Serialize(SnapshotWriter & s)
 {
-	assert(!data.start_positions.empty());
-	unsigned int laststart = data.start_positions.size() - 1;
-	if (index > laststart)
+	return SerializeBodies(s, data.objects);
+}
+
+bool Track::Serialize(SnapshotReader & s)
+{
+	if (!SerializeBodies(s, data.objects))
+		return false;
+
+	// restored bodies might have been sleeping
+	for (auto object : data.objects)
 	{
-		std::pair <Vec3, Quat > sp = data.start_positions[laststart];
-		Vec3 backward = -Direction::Forward * 6 * (index - laststart);
-		sp.second.RotateVector(backward);
-		sp.first = sp.first + backward;
-		return sp;
+		btRigidBody * body = btRigidBody::upcast(object);
+		if (body && !body->isStaticObject())
+			body->activate(true);
 	}
-	return data.start_positions[index];
+	return true;
 }
 
 Track::Data::Data() :
 	world(0),
-	reverse(false),
+	asset(new TrackAsset()),
 	loaded(false),
 	cull(true),
 	vertical_tracking_skyboxes(false)
@@ -20,9 +20,7 @@
 #ifndef _TRACK_H
 #define _TRACK_H
 
-#include "roadstrip.h"
-#include "mathvector.h"
-#include "quaternion.h"
+#include "track_asset.h"
 #include "graphics/scenenode.h"
 #include "physics/motionstate.h"
 #include "physics/tracksurface.h"
@@ -36,13 +34,15 @@
 
 class Model;
 class Texture;
-class RoadStrip;
 class DynamicsWorld;
 class ContentManager;
-class btStridingMeshInterface;
-class btCollisionShape;
 class btCollisionObject;
+class SnapshotWriter;
+class SnapshotReader;
 
+/// Track loaded into a world. The immutable track data lives in a shared
+/// TrackAsset, the track owns the collision objects of its world, the
+/// dynamic bodies and the scene graph.
 class Track
 {
 public:
@@ -90,32 +90,49 @@ public:
 		int & patch_id,
 		Vec3 & outtri,
 		const RoadPatch * & colpatch,
-		Vec3 & normal) const;
+		Vec3 & normal) const
+	{
+		return data.asset->CastRay(origin, direction, seglen, patch_id, outtri, colpatch, normal);
+	}
 
 	/// Synchronize graphics and physics.
 	void Update();
 
-	std::pair <Vec3, Quat > GetStart(unsigned int index) const;
+	/// Save dynamic track object state into an in-memory snapshot.
+	bool Serialize(SnapshotWriter & s);
+
+	/// Restore dynamic track object state from an in-memory snapshot.
+	bool Serialize(SnapshotReader & s);
+
+	/// Immutable track data, can be attached to other worlds.
+	std::shared_ptr<const TrackAsset> GetAsset() const
+	{
+		return data.asset;
+	}
+
+	std::pair <Vec3, Quat > GetStart(unsigned int index) const
+	{
+		return data.asset->GetStart(index);
+	}
 
 	int GetNumStartPositions() const
 	{
-		return data.start_positions.size();
+		return data.asset->GetNumStartPositions();
 	}
 
 	const std::vector <RoadStrip> & GetRoadList() const
 	{
-		return data.roads;
+		return data.asset->GetRoadList();
 	}
 
 	unsigned int GetSectors() const
 	{
-		return data.lap.size();
+		return data.asset->GetSectors();
 	}
 
 	const RoadPatch * GetSectorPatch(unsigned int sector) const
 	{
-		assert (sector < data.lap.size());
-		return data.lap[sector];
+		return data.asset->GetSectorPatch(sector);
 	}
 
 	void SetRacingLineVisibility(bool newvis)
@@ -125,7 +142,7 @@ public:
 
 	bool IsReversed() const
 	{
-		return data.reverse;
+		return data.asset->IsReversed();
 	}
 
 	bool IsFixedSkybox() const
@@ -135,7 +152,13 @@ public:
 
 	const std::vector<TrackSurface> & GetSurfaces() const
 	{
-		return data.surfaces;
+		return data.asset->GetSurfaces();
+	}
+
+	/// Track collision objects of the world, static geometry and dynamic bodies.
+	const std::vector<btCollisionObject*> & GetCollisionObjects() const
+	{
+		return data.objects;
 	}
 
 	SceneNode & GetRacinglineNode()
@@ -160,6 +183,7 @@ private:
 	struct Data
 	{
 		DynamicsWorld* world;
+		std::shared_ptr<TrackAsset> asset;
 
 		// content used by track
 		std::set<std::shared_ptr<Model> > models;
@@ -167,9 +191,6 @@ private:
 
 		// static track objects
 		SceneNode static_node;
-		std::vector<TrackSurface> surfaces;
-		std::vector<btStridingMeshInterface*> meshes;
-		std::vector<btCollisionShape*> shapes;
 		std::vector<btCollisionObject*> objects;
 
 		// dynamic track objects
@@ -177,15 +198,9 @@ private:
 		std::vector<SceneNode::Handle> body_nodes;
 		std::list<MotionState> body_transforms;
 
-		// road information
-		std::vector<const RoadPatch*> lap;
-		std::vector<RoadStrip> roads;
-		std::vector<std::pair<Vec3, Quat > > start_positions;
-
 		SceneNode racingline_node;
 
 		// track state
-		bool reverse;
 		bool loaded;
 		bool cull;
 		bool vertical_tracking_skyboxes;
@@ -0,0 +1,195 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#include "track_asset.h"
+#include "coordinatesystem.h"
+#include "physics/motionstate.h"
+
+#include "BulletCollision/CollisionDispatch/btCollisionObject.h"
+#include "BulletCollision/CollisionShapes/btCollisionShape.h"
+#include "BulletCollision/CollisionShapes/btStridingMeshInterface.h"
+#include "BulletDynamics/Dynamics/btRigidBody.h"
+#include "LinearMath/btAlignedAllocator.h"
+
+TrackAsset::Body::Body() :
+	shape(0),
+	transform(btTransform::getIdentity()),
+	center(0, 0, 0),
+	inertia(0, 0, 0),
+	mass(0)
+{
+	// ctor
+}
+
+TrackAsset::PatchProgress::PatchProgress() :
+	distance(0),
+	sector(-1),
+	sector_start(false)
+{
+	// ctor
+}
+
+TrackAsset::TrackAsset() :
+	reverse(false)
+{
+	// ctor
+}
+
+TrackAsset::~TrackAsset()
+{
+	for (auto & shape : shapes)
+	{
+		delete shape;
+	}
+
+	for (auto & buffer : bvh_buffers)
+	{
+		btAlignedFree(buffer);
+	}
+
+	for (auto & mesh : meshes)
+	{
+		delete mesh;
+	}
+}
+
+bool TrackAsset::CastRay(
+	const Vec3 & origin,
+	const Vec3 & direction,
+	const float seglen,
+	int & patch_id,
+	Vec3 & outtri,
+	const RoadPatch * & colpatch,
+	Vec3 & normal) const
+{
+	bool col = false;
+	for (const auto & road : roads)
+	{
+		Vec3 tri, norm;
+		const RoadPatch * patch = NULL;
+		if (road.Collide(origin, direction, seglen, patch_id, tri, patch, norm))
+		{
+			if (!col || (tri - origin).MagnitudeSquared() < (outtri - origin).MagnitudeSquared())
+			{
+				outtri = tri;
+				normal = norm;
+				colpatch = patch;
+			}
+			col = true;
+		}
+	}
+	return col;
+}
+
+std::pair <Vec3, Quat > TrackAsset::GetStart(unsigned int index) const
+{
+	assert(!start_positions.empty());
+	unsigned int laststart = start_positions.size() - 1;
+	if (index > laststart)
+	{
+		std::pair <Vec3, Quat > sp = start_positions[laststart];
+		Vec3 backward = -Direction::Forward * 6 * (index - laststart);
+		sp.second.RotateVector(backward);
+		sp.first = sp.first + backward;
+		return sp;
+	}
+	return start_positions[index];
+}
+
+int TrackAsset::GetPatchIndex(const RoadPatch * patch) const
+{
+	int offset = 0;
+	for (const auto & road : roads)
+	{
+		const auto & patches = road.GetPatches();
+		if (!patches.empty() && patch >= &patches[0] && patch < &patches[0] + patches.size())
+			return offset + int(patch - &patches[0]);
+		offset += patches.size();
+	}
+	return -1;
+}
+
+void TrackAsset::BuildPatchProgress()
+{
+	patch_progress.clear();
+	for (const auto & road : roads)
+	{
+		for (const auto & patch : road.GetPatches())
+		{
+			PatchProgress p;
+			p.distance = patch.GetDistFromStart();
+			patch_progress.push_back(p);
+		}
+	}
+
+	if (lap.empty())
+		return;
+
+	// walk the lap loop from the start line, sectors follow in driving order
+	int sector = 0;
+	const RoadPatch * patch = lap[0];
+	do
+	{
+		int index = GetPatchIndex(patch);
+		if (index < 0)
+			break;
+
+		if (sector + 1 < int(lap.size()) && patch == lap[sector + 1])
+			sector++;
+
+		patch_progress[index].sector = sector;
+		patch = patch->GetNextPatch();
+	}
+	while (patch && patch != lap[0]);
+
+	// sector patches might sit on roads the walk did not reach
+	for (int s = 0; s < int(lap.size()); ++s)
+	{
+		int index = GetPatchIndex(lap[s]);
+		if (index < 0)
+			continue;
+
+		patch_progress[index].sector = s;
+		patch_progress[index].sector_start = true;
+	}
+}
+
+btCollisionObject * TrackAsset::CreateStaticObject(const Body & body)
+{
+	btCollisionObject * object = new btCollisionObject();
+	object->setActivationState(DISABLE_SIMULATION);
+	object->setWorldTransform(body.transform);
+	object->setCollisionShape(body.shape);
+	object->setUserPointer(body.shape->getUserPointer());
+	return object;
+}
+
+btRigidBody * TrackAsset::CreateRigidBody(const Body & body, MotionState & state)
+{
+	state.rotation = body.transform.getRotation();
+	state.position = body.transform.getOrigin();
+	state.massCenterOffset = -body.center;
+
+	btRigidBody::btRigidBodyConstructionInfo info(body.mass, &state, body.shape, body.inertia);
+	info.m_friction = 0.9;
+
+	btRigidBody * object = new btRigidBody(info);
+	object->setContactProcessingThreshold(0.0);
+	return object;
+}
@@ -0,0 +1,163 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef _TRACK_ASSET_H
+#define _TRACK_ASSET_H
+
+#include "roadstrip.h"
+#include "mathvector.h"
+#include "quaternion.h"
+#include "physics/tracksurface.h"
+
+#include "LinearMath/btTransform.h"
+
+#include <cassert>
+#include <utility>
+#include <vector>
+
+class Track;
+class btStridingMeshInterface;
+class btCollisionShape;
+class btCollisionObject;
+class btRigidBody;
+struct MotionState;
+
+/// Immutable track data, built once by the track loader and shared by
+/// reference between every world simulating on the track: collision
+/// meshes and shapes, surfaces, roads with their racing line, lap sectors,
+/// start positions and the placement of the track bodies. Worlds only own
+/// the collision objects referencing the shapes and, for dynamic bodies,
+/// their motion state.
+class TrackAsset
+{
+public:
+	/// Track body placement, static bodies have zero mass.
+	struct Body
+	{
+		btCollisionShape * shape;
+		btTransform transform;
+		btVector3 center; ///< mass center in body space
+		btVector3 inertia;
+		btScalar mass;
+
+		Body();
+	};
+
+	TrackAsset();
+
+	~TrackAsset();
+
+	bool CastRay(
+		const Vec3 & origin,
+		const Vec3 & direction,
+		const float seglen,
+		int & patch_id,
+		Vec3 & outtri,
+		const RoadPatch * & colpatch,
+		Vec3 & normal) const;
+
+	std::pair <Vec3, Quat > GetStart(unsigned int index) const;
+
+	int GetNumStartPositions() const
+	{
+		return start_positions.size();
+	}
+
+	const std::vector <RoadStrip> & GetRoadList() const
+	{
+		return roads;
+	}
+
+	unsigned int GetSectors() const
+	{
+		return lap.size();
+	}
+
+	const RoadPatch * GetSectorPatch(unsigned int sector) const
+	{
+		assert (sector < lap.size());
+		return lap[sector];
+	}
+
+	/// Lap progress of a road patch, precomputed at load.
+	struct PatchProgress
+	{
+		float distance; ///< distance of the patch start from the start line
+		int sector; ///< timing sector containing the patch, -1 if not on the lap
+		bool sector_start; ///< first patch of its sector
+
+		PatchProgress();
+	};
+
+	/// Road patches over all roads, the size of the progress table.
+	unsigned GetNumPatches() const
+	{
+		return patch_progress.size();
+	}
+
+	/// Dense index of a road patch over all roads, -1 if not a road patch.
+	int GetPatchIndex(const RoadPatch * patch) const;
+
+	const PatchProgress & GetPatchProgress(unsigned index) const
+	{
+		assert(index < patch_progress.size());
+		return patch_progress[index];
+	}
+
+	bool IsReversed() const
+	{
+		return reverse;
+	}
+
+	const std::vector<TrackSurface> & GetSurfaces() const
+	{
+		return surfaces;
+	}
+
+	const std::vector<Body> & GetBodies() const
+	{
+		return bodies;
+	}
+
+	/// Static collision object referencing the body shape, caller owns it.
+	static btCollisionObject * CreateStaticObject(const Body & body);
+
+	/// Rigid body driven by state, caller owns it.
+	static btRigidBody * CreateRigidBody(const Body & body, MotionState & state);
+
+private:
+	// filled by Track::Loader
+	friend class Track;
+
+	/// Build the patch progress table from roads and lap sectors.
+	void BuildPatchProgress();
+
+	std::vector<TrackSurface> surfaces;
+	std::vector<btStridingMeshInterface*> meshes;
+	std::vector<btCollisionShape*> shapes;
+	std::vector<void*> bvh_buffers; ///< cooked collision bvhs referenced by shapes
+	std::vector<Body> bodies;
+	std::vector<const RoadPatch*> lap;
+	std::vector<RoadStrip> roads;
+	std::vector<PatchProgress> patch_progress;
+	std::vector<std::pair<Vec3, Quat > > start_positions;
+	bool reverse;
+};
+
+#endif // _TRACK_ASSET_H
@@ -0,0 +1,122 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#include "track_progress.h"
+#include "physics/cardynamics.h"
+#include "tobullet.h"
+
+TrackProgress::CarProgress::CarProgress() :
+	patch(0),
+	wheels_on_road(0),
+	sector(-1),
+	distance(0)
+{
+	for (int & index : wheel_patch)
+		index = -1;
+}
+
+TrackProgress::TrackProgress()
+{
+	// ctor
+}
+
+void TrackProgress::Reset(const std::shared_ptr<const TrackAsset> & newtrack, unsigned car_count)
+{
+	track = newtrack;
+	cars.assign(car_count, CarProgress());
+}
+
+void TrackProgress::Clear()
+{
+	track.reset();
+	cars.clear();
+}
+
+void TrackProgress::Update(const CarDynamics dynamics[], unsigned car_count)
+{
+	assert(car_count == cars.size());
+	if (!track)
+		return;
+
+	for (unsigned i = 0; i < car_count; ++i)
+	{
+		const CarDynamics & car = dynamics[i];
+		CarProgress & progress = cars[i];
+
+		const RoadPatch * patches[WHEEL_COUNT];
+		progress.wheels_on_road = 0;
+		for (int w = 0; w < WHEEL_COUNT; ++w)
+		{
+			patches[w] = car.GetWheelContact(WheelPosition(w)).GetPatch();
+			progress.wheel_patch[w] = patches[w] ? track->GetPatchIndex(patches[w]) : -1;
+			if (patches[w])
+				progress.wheels_on_road++;
+		}
+
+		// track the patch under the front left wheel, front right if off road
+		int w = patches[FRONT_LEFT] ? FRONT_LEFT : FRONT_RIGHT;
+		const RoadPatch * patch = patches[w];
+		progress.patch = patch;
+		if (!patch || progress.wheel_patch[w] < 0)
+			continue;
+
+		const TrackAsset::PatchProgress & entry = track->GetPatchProgress(progress.wheel_patch[w]);
+		if (entry.sector >= 0)
+			progress.sector = entry.sector;
+
+		Vec3 back_left, front_left;
+		if (!track->IsReversed())
+		{
+			back_left = patch->GetBL();
+			front_left = patch->GetFL();
+		}
+		else
+		{
+			back_left = patch->GetFL();
+			front_left = patch->GetBL();
+		}
+
+		Vec3 pos = ToMathVector<float>(car.GetCenterOfMass());
+		Vec3 forwardvec = front_left - back_left;
+		Vec3 relative_pos = pos - back_left;
+		float dist_from_back = 0;
+		if (forwardvec.MagnitudeSquared() > 1E-8f)
+			dist_from_back = relative_pos.dot(forwardvec.Normalize());
+
+		progress.distance = entry.distance + dist_from_back;
+	}
+}
+
+bool TrackProgress::OnSectorStart(unsigned car, int sector) const
+{
+	assert(car < cars.size());
+	if (!track)
+		return false;
+
+	for (int index : cars[car].wheel_patch)
+	{
+		if (index < 0)
+			continue;
+
+		const TrackAsset::PatchProgress & entry = track->GetPatchProgress(index);
+		if (entry.sector_start && entry.sector == sector)
+			return true;
+	}
+	return false;
+}
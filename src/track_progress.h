@@ -0,0 +1,100 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef _TRACK_PROGRESS_H
+#define _TRACK_PROGRESS_H
+
+#include "track_asset.h"
+#include "physics/carwheelposition.h"
+
+#include <memory>
+#include <vector>
+
+class CarDynamics;
+
+/// Per car progress along the track, updated once per tick after physics.
+/// Wheel patches are resolved into the dense patch progress table of the
+/// track asset, timer, drift score, ai and race position read the cached
+/// result instead of scanning the wheel contacts themselves.
+class TrackProgress
+{
+public:
+	TrackProgress();
+
+	/// Attach to track and clear progress of car_count cars.
+	void Reset(const std::shared_ptr<const TrackAsset> & track, unsigned car_count);
+
+	void Clear();
+
+	/// Resolve wheel patches and lap distance of all cars.
+	void Update(const CarDynamics cars[], unsigned car_count);
+
+	unsigned GetNumCars() const
+	{
+		return cars.size();
+	}
+
+	/// Patch under the front wheels, null if off road.
+	const RoadPatch * GetPatch(unsigned car) const
+	{
+		assert(car < cars.size());
+		return cars[car].patch;
+	}
+
+	/// Number of wheels on a road patch.
+	int GetWheelsOnRoad(unsigned car) const
+	{
+		assert(car < cars.size());
+		return cars[car].wheels_on_road;
+	}
+
+	/// Timing sector the car is in, -1 if unknown.
+	int GetSector(unsigned car) const
+	{
+		assert(car < cars.size());
+		return cars[car].sector;
+	}
+
+	/// Distance from the start line, kept while the car is off road.
+	float GetDistance(unsigned car) const
+	{
+		assert(car < cars.size());
+		return cars[car].distance;
+	}
+
+	/// True if a wheel touches the first patch of sector.
+	bool OnSectorStart(unsigned car, int sector) const;
+
+private:
+	struct CarProgress
+	{
+		const RoadPatch * patch;
+		int wheel_patch[WHEEL_COUNT]; ///< dense patch index, -1 if off road
+		int wheels_on_road;
+		int sector;
+		float distance;
+
+		CarProgress();
+	};
+
+	std::shared_ptr<const TrackAsset> track;
+	std::vector<CarProgress> cars;
+};
+
+#endif // _TRACK_PROGRESS_H
@@ -19,6 +19,7 @@
 
 #include "trackloader.h"
 #include "loadcollisionshape.h"
+#include "collision_bvh.h"
 #include "physics/dynamicsworld.h"
 #include "coordinatesystem.h"
 #include "tobullet.h"
@@ -31,6 +32,7 @@
 #include "BulletCollision/CollisionShapes/btBoxShape.h"
 #include "BulletCollision/CollisionShapes/btBvhTriangleMeshShape.h"
 #include "BulletCollision/CollisionShapes/btCompoundShape.h"
+#include "BulletCollision/CollisionShapes/btOptimizedBvh.h"
 #include "BulletCollision/CollisionShapes/btTriangleIndexVertexArray.h"
 #include "BulletDynamics/Dynamics/btRigidBody.h"
 
@@ -62,31 +64,10 @@ static inline std::istream & operator >> (std::istream & lhs, std::vector<std::s
 	return lhs;
 }
 
-static btIndexedMesh GetIndexedMesh(const Model & model)
-{
-	const float * vertices;
-	unsigned int vcount;
-	const unsigned int * faces;
-	unsigned int fcount;
-	model.GetVertexArray().GetVertices(vertices, vcount);
-	model.GetVertexArray().GetFaces(faces, fcount);
-
-	assert(fcount % 3 == 0); //Face count is not a multiple of 3
-
-	btIndexedMesh mesh;
-	mesh.m_numTriangles = fcount / 3;
-	mesh.m_triangleIndexBase = (const unsigned char *)faces;
-	mesh.m_triangleIndexStride = sizeof(unsigned int) * 3;
-	mesh.m_numVertices = vcount / 3;
-	mesh.m_vertexBase = (const unsigned char *)vertices;
-	mesh.m_vertexStride = sizeof(float) * 3;
-	mesh.m_vertexType = PHY_FLOAT;
-	return mesh;
-}
-
 struct Track::Loader::Object
 {
 	std::shared_ptr<Model> model;
+	std::string model_name;
 	std::string texture;
 	int transparent_blend;
 	int clamptexture;
@@ -115,6 +96,7 @@ Track::Loader::Loader(
 	content(content),
 	world(world),
 	data(data),
+	asset(*data.asset),
 	info_output(info_output),
 	error_output(error_output),
 	trackpath(trackpath),
@@ -137,7 +119,7 @@ Track::Loader::Loader(
 {
 	objectpath = trackpath + "/objects";
 	objectdir = trackdir + "/objects";
-	data.reverse = reverse;
+	asset.reverse = reverse;
 }
 
 Track::Loader::~Loader()
@@ -166,7 +148,7 @@ bool Track::Loader::BeginLoad()
 	if (!LoadRoads())
 	{
 		error_output << "Error during road loading; continuing with an unsmoothed track" << std::endl;
-		data.roads.clear();
+		asset.roads.clear();
 	}
 
 	if (!CreateRacingLines())
@@ -199,6 +181,8 @@ bool Track::Loader::BeginLoad()
 		return false;
 	}
 
+	asset.BuildPatchProgress();
+
 	if (!BeginObjectLoad())
 	{
 		return false;
@@ -223,12 +207,9 @@ bool Track::Loader::ContinueLoad()
 	if (!loadstatus.second)
 	{
 #ifndef EXTBULLET
-		btCollisionObject * track_object = new btCollisionObject();
 		//track_shape->createAabbTreeFromChildren();
-		track_object->setCollisionShape(track_shape);
-		world.addCollisionObject(track_object);
-		data.objects.push_back(track_object);
-		data.shapes.push_back(track_shape);
+		asset.shapes.push_back(track_shape);
+		AddStaticBody(btTransform::getIdentity(), track_shape);
 		track_shape = 0;
 #endif
 		data.loaded = true;
@@ -289,7 +270,7 @@ bool Track::Loader::Begin()
 		{
 			node_it = nodes->begin();
 			numobjects = nodes->size();
-			data.meshes.reserve(numobjects);
+			asset.meshes.reserve(numobjects);
 			return true;
 		}
 	}
@@ -313,25 +294,51 @@ std::pair<bool, bool> Track::Loader::Continue()
 	return std::make_pair(false, true);
 }
 
-bool Track::Loader::LoadShape(const PTree & cfg, const Model & model, Body & body)
+btBvhTriangleMeshShape * Track::Loader::CreateMeshShape(const Model & model, const std::string & model_name)
+{
+	btTriangleIndexVertexArray * mesh = new btTriangleIndexVertexArray();
+	mesh->addIndexedMesh(GetIndexedMesh(model));
+	asset.meshes.push_back(mesh);
+
+	// use the bvh cooked with the model if it still fits the mesh
+	void * buffer = 0;
+	const std::string bvh_path = content.getCookedPath(objectdir, model_name + ".bvh");
+	btOptimizedBvh * bvh = bvh_path.empty() ? 0 : ReadCollisionBvh(*mesh, bvh_path, buffer);
+	if (!bvh)
+	{
+		return new btBvhTriangleMeshShape(mesh, true);
+	}
+
+	asset.bvh_buffers.push_back(buffer);
+	btBvhTriangleMeshShape * shape = new btBvhTriangleMeshShape(mesh, true, false);
+	shape->setOptimizedBvh(bvh);
+	return shape;
+}
+
+bool Track::Loader::LoadModel(std::shared_ptr<Model> & model, const std::string & model_name)
+{
+	// cooked pack members are preferred over the pack
+	return (packload && content.getCookedPath(objectdir, model_name).empty() &&
+		content.load(model, objectdir, model_name, pack)) ||
+		content.load(model, objectdir, model_name);
+}
+
+bool Track::Loader::LoadShape(const PTree & cfg, const Model & model, const std::string & model_name, Body & body)
 {
 	if (body.mass < 1E-3f)
 	{
-		btTriangleIndexVertexArray * mesh = new btTriangleIndexVertexArray();
-		mesh->addIndexedMesh(GetIndexedMesh(model));
-		data.meshes.push_back(mesh);
-		body.mesh = mesh;
+		btBvhTriangleMeshShape * shape = CreateMeshShape(model, model_name);
+		body.mesh = shape->getMeshInterface();
 
 		int surface = 0;
 		cfg.get("surface", surface);
-		if (surface >= (int)data.surfaces.size())
+		if (surface >= (int)asset.surfaces.size())
 		{
 			surface = 0;
 		}
 
-		btBvhTriangleMeshShape * shape = new btBvhTriangleMeshShape(mesh, true);
-		shape->setUserPointer((void*)&data.surfaces[surface]);
-		data.shapes.push_back(shape);
+		shape->setUserPointer((void*)&asset.surfaces[surface]);
+		asset.shapes.push_back(shape);
 		body.shape = shape;
 	}
 	else
@@ -355,7 +362,7 @@ bool Track::Loader::LoadShape(const PTree & cfg, const Model & model, Body & bod
 		{
 			shape = compound;
 		}
-		data.shapes.push_back(shape);
+		asset.shapes.push_back(shape);
 
 		shape->calculateLocalInertia(body.mass, body.inertia);
 		body.shape = shape;
@@ -365,6 +372,18 @@ bool Track::Loader::LoadShape(const PTree & cfg, const Model & model, Body & bod
 	return true;
 }
 
+void Track::Loader::AddStaticBody(const btTransform & transform, btCollisionShape * shape)
+{
+	TrackAsset::Body body;
+	body.shape = shape;
+	body.transform = transform;
+	asset.bodies.push_back(body);
+
+	btCollisionObject * object = TrackAsset::CreateStaticObject(body);
+	data.objects.push_back(object);
+	world.addCollisionObject(object);
+}
+
 Track::Loader::body_iterator Track::Loader::LoadBody(const PTree & cfg)
 {
 	Body body;
@@ -419,8 +438,7 @@ Track::Loader::body_iterator Track::Loader::LoadBody(const PTree & cfg)
 	}
 
 	std::shared_ptr<Model> model;
-	if ((packload && content.load(model, objectdir, model_name, pack)) ||
-		content.load(model, objectdir, model_name))
+	if (LoadModel(model, model_name))
 	{
 		data.models.insert(model);
 	}
@@ -433,7 +451,7 @@ Track::Loader::body_iterator Track::Loader::LoadBody(const PTree & cfg)
 	body.collidable = cfg.get("mass", body.mass);
 	if (body.collidable)
 	{
-		LoadShape(cfg, *model, body);
+		LoadShape(cfg, *model, model_name, body);
 	}
 
 	// load textures
@@ -551,13 +569,7 @@ bool Track::Loader::LoadNode(const PTree & sec)
 #ifndef EXTBULLET
 			track_shape->addChildShape(transform, body.shape);
 #else
-			btCollisionObject * object = new btCollisionObject();
-			object->setActivationState(DISABLE_SIMULATION);
-			object->setWorldTransform(transform);
-			object->setCollisionShape(body.shape);
-			object->setUserPointer(body.shape->getUserPointer());
-			data.objects.push_back(object);
-			world.addCollisionObject(object);
+			AddStaticBody(transform, body.shape);
 #endif
 		}
 	}
@@ -572,16 +584,17 @@ bool Track::Loader::LoadNode(const PTree & sec)
 		if (dynamic_objects)
 		{
 			// dynamic geometry
-			data.body_transforms.push_back(MotionState());
-			data.body_transforms.back().rotation = ToBulletQuaternion(rotation);
-			data.body_transforms.back().position = ToBulletVector(position);
-			data.body_transforms.back().massCenterOffset = -body.center;
-
-			btRigidBody::btRigidBodyConstructionInfo info(body.mass, &data.body_transforms.back(), body.shape, body.inertia);
-			info.m_friction = 0.9;
+			TrackAsset::Body asset_body;
+			asset_body.shape = body.shape;
+			asset_body.transform.setOrigin(ToBulletVector(position));
+			asset_body.transform.setRotation(ToBulletQuaternion(rotation));
+			asset_body.center = body.center;
+			asset_body.inertia = body.inertia;
+			asset_body.mass = body.mass;
+			asset.bodies.push_back(asset_body);
 
-			btRigidBody * object = new btRigidBody(info);
-			object->setContactProcessingThreshold(0.0);
+			data.body_transforms.push_back(MotionState());
+			btRigidBody * object = TrackAsset::CreateRigidBody(asset_body, data.body_transforms.back());
 			data.objects.push_back(object);
 			world.addRigidBody(object);
 
@@ -598,14 +611,7 @@ bool Track::Loader::LoadNode(const PTree & sec)
 			btTransform transform;
 			transform.setOrigin(ToBulletVector(position));
 			transform.setRotation(ToBulletQuaternion(rotation));
-
-			btCollisionObject * object = new btCollisionObject();
-			object->setActivationState(DISABLE_SIMULATION);
-			object->setWorldTransform(transform);
-			object->setCollisionShape(body.shape);
-			object->setUserPointer(body.shape->getUserPointer());
-			data.objects.push_back(object);
-			world.addCollisionObject(object);
+			AddStaticBody(transform, body.shape);
 
 			SceneNode::Handle h = data.static_node.AddNode();
 			SceneNode & node = data.static_node.GetNode(h);
@@ -754,25 +760,16 @@ bool Track::Loader::AddObject(const Object & object)
 
 	if (object.collideable)
 	{
-		btTriangleIndexVertexArray * mesh = new btTriangleIndexVertexArray();
-		mesh->addIndexedMesh(GetIndexedMesh(*object.model));
-		data.meshes.push_back(mesh);
-
-		assert(object.surface >= 0 && object.surface < (int)data.surfaces.size());
-		btBvhTriangleMeshShape * shape = new btBvhTriangleMeshShape(mesh, true);
-		shape->setUserPointer((void*)&data.surfaces[object.surface]);
-		data.shapes.push_back(shape);
+		assert(object.surface >= 0 && object.surface < (int)asset.surfaces.size());
+		btBvhTriangleMeshShape * shape = CreateMeshShape(*object.model, object.model_name);
+		shape->setUserPointer((void*)&asset.surfaces[object.surface]);
+		asset.shapes.push_back(shape);
 
 #ifndef EXTBULLET
 		btTransform transform = btTransform::getIdentity();
 		track_shape->addChildShape(transform, shape);
 #else
-		btCollisionObject * co = new btCollisionObject();
-		co->setActivationState(DISABLE_SIMULATION);
-		co->setCollisionShape(shape);
-		co->setUserPointer(shape->getUserPointer());
-		data.objects.push_back(co);
-		world.addCollisionObject(co);
+		AddStaticBody(btTransform::getIdentity(), shape);
 #endif
 	}
 	return true;
@@ -816,14 +813,8 @@ std::pair<bool, bool> Track::Loader::ContinueOld()
 		return std::make_pair(false, true);
 	}
 
-	if (packload)
-	{
-		content.load(object.model, objectdir, model_name, pack);
-	}
-	else
-	{
-		content.load(object.model, objectdir, model_name);
-	}
+	LoadModel(object.model, model_name);
+	object.model_name = model_name;
 
 	// fixme: ugly hack to make vertical tracking work
 	// should be fixed in the model data instead
@@ -862,8 +853,8 @@ bool Track::Loader::LoadSurfaces()
 		}
 
 		const PTree & surf_cfg = node.second;
-		data.surfaces.push_back(TrackSurface());
-		TrackSurface & surface = data.surfaces.back();
+		asset.surfaces.push_back(TrackSurface());
+		TrackSurface & surface = asset.surfaces.back();
 
 		std::string type;
 		surf_cfg.get("Type", type);
@@ -893,14 +884,14 @@ bool Track::Loader::LoadSurfaces()
 		surf_cfg.get("RollingDrag", temp, error_output);
 		surface.rollingDrag = temp;
 	}
-	info_output << "Loaded surfaces file, " << data.surfaces.size() << " surfaces." << std::endl;
+	info_output << "Loaded surfaces file, " << asset.surfaces.size() << " surfaces." << std::endl;
 
 	return true;
 }
 
 bool Track::Loader::LoadRoads()
 {
-	data.roads.clear();
+	asset.roads.clear();
 
 	std::string roadpath = trackpath + "/roads.trk";
 	std::ifstream trackfile(roadpath.c_str());
@@ -912,11 +903,11 @@ bool Track::Loader::LoadRoads()
 
 	int numroads = 0;
 	trackfile >> numroads;
-	data.roads.reserve(numroads);
+	asset.roads.reserve(numroads);
 	for (int i = 0; i < numroads && trackfile; ++i)
 	{
-		data.roads.push_back(RoadStrip());
-		data.roads.back().ReadFrom(trackfile, data.reverse, error_output);
+		asset.roads.push_back(RoadStrip());
+		asset.roads.back().ReadFrom(trackfile, asset.reverse, error_output);
 	}
 
 	return true;
@@ -925,7 +916,7 @@ bool Track::Loader::LoadRoads()
 bool Track::Loader::CreateRacingLines()
 {
 	K1999 k1999;
-	for (auto & road : data.roads)
+	for (auto & road : asset.roads)
 	{
 		// K1999 requires a closed circuit
 		if (road.GetClosed())
@@ -1062,7 +1053,7 @@ bool Track::Loader::LoadStartPositions(const PTree & info)
 
 		Vec3 pos(f3[2], f3[0], f3[1]);
 
-		data.start_positions.push_back(
+		asset.start_positions.push_back(
 			std::pair <Vec3, Quat >(pos, orient));
 
 		sp_num++;
@@ -1070,16 +1061,16 @@ bool Track::Loader::LoadStartPositions(const PTree & info)
 		sp_name << "start position " << sp_num;
 	}
 
-	if (data.reverse)
+	if (asset.reverse)
 	{
 		// flip start positions
-		for (auto & start_position : data.start_positions)
+		for (auto & start_position : asset.start_positions)
 		{
 			start_position.second.Rotate(M_PI, 0, 0, 1);
 		}
 
 		// reverse start positions
-		std::reverse(data.start_positions.begin(), data.start_positions.end());
+		std::reverse(asset.start_positions.begin(), asset.start_positions.end());
 	}
 
 	return true;
@@ -1088,7 +1079,7 @@ bool Track::Loader::LoadStartPositions(const PTree & info)
 bool Track::Loader::LoadLapSections(const PTree & info)
 {
 	// get timing sectors
-	unsigned num_roads = data.roads.size();
+	unsigned num_roads = asset.roads.size();
 	unsigned lapmarkers = 0;
 	if (info.get("lap sequences", lapmarkers))
 	{
@@ -1100,47 +1091,47 @@ bool Track::Loader::LoadLapSections(const PTree & info)
 			info.get(lapname.str(), lapraw);
 
 			unsigned roadid = Min(num_roads, lapraw[0]);
-			auto & road = data.roads[roadid];
+			auto & road = asset.roads[roadid];
 
 			unsigned num_patches = road.GetPatches().size();
 			unsigned patchid = Min(num_patches, lapraw[1]);
 
 			// adjust id for reverse case
-			if (data.reverse)
+			if (asset.reverse)
 				patchid = num_patches - patchid;
 
-			data.lap.push_back(&road.GetPatches()[patchid]);
+			asset.lap.push_back(&road.GetPatches()[patchid]);
 		}
 	}
 
-	if (data.lap.empty())
+	if (asset.lap.empty())
 	{
 		info_output << "No lap sequence found. Lap timing will not be possible." << std::endl;
 		return true;
 	}
 
 	// adjust timing sectors if reverse
-	if (data.reverse)
+	if (asset.reverse)
 	{
-		if (data.lap.size() > 1)
+		if (asset.lap.size() > 1)
 		{
 			// reverse the lap sequence, but keep the first patch where it is (remember, the track is a loop)
 			// so, for example, now instead of 1 2 3 4 we should have 1 4 3 2
-			auto second_patch = data.lap.begin() + 1;
-			assert(second_patch != data.lap.end());
-			std::reverse(second_patch, data.lap.end());
+			auto second_patch = asset.lap.begin() + 1;
+			assert(second_patch != asset.lap.end());
+			std::reverse(second_patch, asset.lap.end());
 		}
 
 		// move timing sector 0 back so we'll still drive over it when going in reverse around the track
 		// find patch in front of first start position
 		const RoadPatch * lap0 = 0;
 		float minlen2 = 10E6;
-		Vec3 pos = data.start_positions[0].first;
+		Vec3 pos = asset.start_positions[0].first;
 		Vec3 dir = Direction::Forward;
-		data.start_positions[0].second.RotateVector(dir);
+		asset.start_positions[0].second.RotateVector(dir);
 		Vec3 bpos(pos[1], pos[2], pos[0]);
 		Vec3 bdir(dir[1], dir[2], dir[0]);
-		for (const auto & road : data.roads)
+		for (const auto & road : asset.roads)
 		{
 			for (const auto & p : road.GetPatches())
 			{
@@ -1155,13 +1146,13 @@ bool Track::Loader::LoadLapSections(const PTree & info)
 			}
 		}
 		if (lap0)
-			data.lap[0] = lap0;
+			asset.lap[0] = lap0;
 	}
 
 	// calculate distance from starting line for each patch to account for those tracks
 	// where starting line is not on the 1st patch of the road
 	// note this only updates the road with lap sequence 0 on it
-	const_cast<RoadPatch*>(data.lap[0])->CalculateDistanceFromStart();
+	const_cast<RoadPatch*>(asset.lap[0])->CalculateDistanceFromStart();
 
 	info_output << "Track timing sectors: " << lapmarkers << std::endl;
 	return true;
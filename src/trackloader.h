@@ -50,6 +50,7 @@ class ContentManager;
 class btStridingMeshInterface;
 class btCompoundShape;
 class btCollisionShape;
+class btBvhTriangleMeshShape;
 class PTree;
 
 class Track::Loader
@@ -84,6 +85,7 @@ private:
 	ContentManager & content;
 	DynamicsWorld & world;
 	Track::Data & data;
+	TrackAsset & asset;
 	std::ostream & info_output;
 	std::ostream & error_output;
 
@@ -166,7 +168,16 @@ private:
 
 	bool LoadNode(const PTree & sec);
 
-	bool LoadShape(const PTree & body_cfg, const Model & body_model, Body & body);
+	/// Load model_name from the cooked data, the object pack or the object directory.
+	bool LoadModel(std::shared_ptr<Model> & model, const std::string & model_name);
+
+	/// Static triangle mesh shape of model, using the cooked collision bvh of model_name if it fits.
+	btBvhTriangleMeshShape * CreateMeshShape(const Model & model, const std::string & model_name);
+
+	bool LoadShape(const PTree & body_cfg, const Model & body_model, const std::string & model_name, Body & body);
+
+	/// Add static body to the asset and its collision object to the world.
+	void AddStaticBody(const btTransform & transform, btCollisionShape * shape);
 
 	body_iterator LoadBody(const PTree & cfg);
 
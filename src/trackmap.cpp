@@ -22,10 +22,20 @@
 #include "graphics/texture.h"
 #include "minmax.h"
 
+#include <SDL2/SDL_thread.h>
+
+#include <fstream>
+#include <sstream>
+#include <cstring>
+
+static const char map_magic[4] = {'V', 'D', 'T', 'M'};
+
 TrackMap::TrackMap() :
 	map_width(256),
 	map_height(256),
-	map_scale(1.0)
+	map_scale(1.0),
+	build_thread(0),
+	road_hash(0)
 {
 	// ctor
 }
@@ -37,25 +47,22 @@ TrackMap::~TrackMap()
 
 void TrackMap::Unload()
 {
+	WaitBuild();
+	pixels.clear();
+	road_coords.clear();
 	dotlist.clear();
 	mapnode.Clear();
 	mapdraw.invalidate();
 }
 
-bool TrackMap::BuildMap(
-	const int screen_width,
-	const int screen_height,
+void TrackMap::BeginBuild(
 	const std::vector <RoadStrip> & roads,
 	const std::string & trackname,
-	const std::string & texturepath,
-	ContentManager & content,
-	std::ostream & /*error_output*/)
+	const bool reverse,
+	const std::string & cachepath)
 {
 	Unload();
 
-	pixel_size[0] = 1.0f / screen_width;
-	pixel_size[1] = 1.0f / screen_height;
-
 	// track aabb
 	track_min[0] = +1E6;
 	track_min[1] = +1E6;
@@ -100,36 +107,183 @@ bool TrackMap::BuildMap(
 	const float map_scale_h = (map_height - 2) / track_height;
 	map_scale = Min(map_scale_w, map_scale_h);
 
-	std::vector<unsigned> pixels(map_width * map_height, 0);
-	const unsigned color = 0xffffffff;
-
+	// map space patch corners, fr fl bl br per patch
+	road_coords.clear();
 	for (const auto & road : roads)
 	{
 		for (const auto & p : road.GetPatches())
 		{
-			const Vec3 & bl = p.GetBL();
-			const Vec3 & br = p.GetBR();
-			const Vec3 & fl = p.GetFL();
-			const Vec3 & fr = p.GetFR();
-
-			float x[6], y[6];
-			x[2] = (bl[1] - track_min[0]) * map_scale + 1;
-			y[2] = (bl[0] - track_min[1]) * map_scale + 1;
-			x[1] = (fl[1] - track_min[0]) * map_scale + 1;
-			y[1] = (fl[0] - track_min[1]) * map_scale + 1;
-			x[0] = (fr[1] - track_min[0]) * map_scale + 1;
-			y[0] = (fr[0] - track_min[1]) * map_scale + 1;
-			x[3] = x[2];
-			y[3] = y[2];
-			x[4] = (br[1] - track_min[0]) * map_scale + 1;
-			y[4] = (br[0] - track_min[1]) * map_scale + 1;
-			x[5] = x[0];
-			y[5] = y[0];
-
-			RasterizeTriangle(x, y, color, &pixels[0], map_width);
-			RasterizeTriangle(x + 3, y + 3, color, &pixels[0], map_width);
+			const Vec3 * corners[4] = {&p.GetFR(), &p.GetFL(), &p.GetBL(), &p.GetBR()};
+			for (const Vec3 * c : corners)
+			{
+				road_coords.push_back(((*c)[1] - track_min[0]) * map_scale + 1);
+				road_coords.push_back(((*c)[0] - track_min[1]) * map_scale + 1);
+			}
 		}
 	}
+
+	// 64 bit FNV-1a of the map geometry, a changed road file misses the cache
+	road_hash = 14695981039346656037ULL;
+	const unsigned char * bytes = (const unsigned char *)road_coords.data();
+	for (size_t i = 0, n = road_coords.size() * sizeof(float); i < n; ++i)
+	{
+		road_hash ^= bytes[i];
+		road_hash *= 1099511628211ULL;
+	}
+
+	map_name = trackname;
+	cache_file.clear();
+	if (!cachepath.empty())
+	{
+		std::ostringstream name;
+		name << cachepath << "/" << trackname << (reverse ? "-reverse" : "")
+			<< "-" << map_width << "x" << map_height << ".map";
+		cache_file = name.str();
+	}
+
+	build_thread = SDL_CreateThread(BuildThread, "trackmap", this);
+	if (!build_thread)
+		BuildImage();
+}
+
+bool TrackMap::BuildMap(
+	const int screen_width,
+	const int screen_height,
+	const std::string & texturepath,
+	ContentManager & content,
+	std::ostream & /*error_output*/)
+{
+	WaitBuild();
+	if (pixels.empty())
+		return false;
+
+	pixel_size[0] = 1.0f / screen_width;
+	pixel_size[1] = 1.0f / screen_height;
+
+	const float track_width = track_max[0] - track_min[0];
+	const float track_height = track_max[1] - track_min[1];
+
+	TextureInfo texinfo;
+	texinfo.data = (unsigned char*)&pixels[0];
+	texinfo.width = map_width;
+	texinfo.height = map_height;
+	texinfo.bytespp = sizeof(unsigned);
+	texinfo.repeatu = false;
+	texinfo.repeatv = false;
+	content.load(track_map, "", map_name, texinfo);
+
+	//std::cout << "Loading track map dots" << std::endl;
+	TextureInfo dotinfo;
+	content.load(cardot0, texturepath, "cardot0.png", dotinfo);
+	content.load(cardot1, texturepath, "cardot1.png", dotinfo);
+	content.load(cardot0_focused, texturepath, "cardot0_focused.png", dotinfo);
+	content.load(cardot1_focused, texturepath, "cardot1_focused.png", dotinfo);
+
+	// map position on screen: right side 16 pixel padding
+	map_min[0] = 1 - (track_width * map_scale + 16)  * pixel_size[0];
+	map_min[1] = 0.5f * (1 - track_height * map_scale * pixel_size[1]);
+
+	map_max[0] = map_min[0] + map_width * pixel_size[0];
+	map_max[1] = map_min[1] + map_height * pixel_size[1];
+
+	dot_size[0] = 0.5f * cardot0->GetW() * pixel_size[0];
+	dot_size[1] = 0.5f * cardot0->GetH() * pixel_size[1];
+
+	mapverts.SetToBillboard(map_min[0], map_min[1], map_max[0], map_max[1]);
+	mapdraw = mapnode.GetDrawList().twodim.insert(Drawable());
+	Drawable & mapdrawref = mapnode.GetDrawList().twodim.get(mapdraw);
+	mapdrawref.SetTextures(track_map->GetId());
+	mapdrawref.SetVertArray(&mapverts);
+	mapdrawref.SetCull(false);
+	//mapdrawref.SetColor(1, 1, 1, 0.7);
+	mapdrawref.SetDrawOrder(0);
+
+	return true;
+}
+
+int TrackMap::BuildThread(void * data)
+{
+	static_cast<TrackMap *>(data)->BuildImage();
+	return 0;
+}
+
+void TrackMap::WaitBuild()
+{
+	if (build_thread)
+	{
+		SDL_WaitThread(build_thread, NULL);
+		build_thread = 0;
+	}
+}
+
+void TrackMap::BuildImage()
+{
+	if (LoadImage())
+		return;
+
+	RasterizeImage();
+
+	if (!cache_file.empty())
+		SaveImage();
+}
+
+bool TrackMap::LoadImage()
+{
+	if (cache_file.empty())
+		return false;
+
+	std::ifstream file(cache_file.c_str(), std::ios::binary);
+	if (!file)
+		return false;
+
+	char magic[4];
+	int width = 0, height = 0;
+	unsigned long long hash = 0;
+	if (!file.read(magic, sizeof(magic)) ||
+		!file.read((char *)&width, sizeof(width)) ||
+		!file.read((char *)&height, sizeof(height)) ||
+		!file.read((char *)&hash, sizeof(hash)))
+		return false;
+
+	if (std::memcmp(magic, map_magic, sizeof(magic)) != 0 ||
+		width != map_width || height != map_height || hash != road_hash)
+		return false;
+
+	pixels.resize(map_width * map_height);
+	if (!file.read((char *)&pixels[0], pixels.size() * sizeof(unsigned)))
+	{
+		pixels.clear();
+		return false;
+	}
+
+	return true;
+}
+
+void TrackMap::SaveImage() const
+{
+	std::ofstream file(cache_file.c_str(), std::ios::binary);
+	file.write(map_magic, sizeof(map_magic));
+	file.write((const char *)&map_width, sizeof(map_width));
+	file.write((const char *)&map_height, sizeof(map_height));
+	file.write((const char *)&road_hash, sizeof(road_hash));
+	file.write((const char *)&pixels[0], pixels.size() * sizeof(unsigned));
+}
+
+void TrackMap::RasterizeImage()
+{
+	pixels.assign(map_width * map_height, 0);
+	const unsigned color = 0xffffffff;
+
+	for (size_t i = 0; i + 8 <= road_coords.size(); i += 8)
+	{
+		// two triangles per patch: fr fl bl and bl br fr
+		const float * c = &road_coords[i];
+		const float x[6] = {c[0], c[2], c[4], c[4], c[6], c[0]};
+		const float y[6] = {c[1], c[3], c[5], c[5], c[7], c[1]};
+
+		RasterizeTriangle(x, y, color, &pixels[0], map_width);
+		RasterizeTriangle(x + 3, y + 3, color, &pixels[0], map_width);
+	}
 /*
 	// should operate on alpha only or on each channel?
 	// horizontal blur 3x3
@@ -199,43 +353,6 @@ bool TrackMap::BuildMap(
 			}
 		}
 	}
-
-	TextureInfo texinfo;
-	texinfo.data = (unsigned char*)&pixels[0];
-	texinfo.width = map_width;
-	texinfo.height = map_height;
-	texinfo.bytespp = sizeof(unsigned);
-	texinfo.repeatu = false;
-	texinfo.repeatv = false;
-	content.load(track_map, "", trackname, texinfo);
-
-	//std::cout << "Loading track map dots" << std::endl;
-	TextureInfo dotinfo;
-	content.load(cardot0, texturepath, "cardot0.png", dotinfo);
-	content.load(cardot1, texturepath, "cardot1.png", dotinfo);
-	content.load(cardot0_focused, texturepath, "cardot0_focused.png", dotinfo);
-	content.load(cardot1_focused, texturepath, "cardot1_focused.png", dotinfo);
-
-	// map position on screen: right side 16 pixel padding
-	map_min[0] = 1 - (track_width * map_scale + 16)  * pixel_size[0];
-	map_min[1] = 0.5f * (1 - track_height * map_scale * pixel_size[1]);
-
-	map_max[0] = map_min[0] + map_width * pixel_size[0];
-	map_max[1] = map_min[1] + map_height * pixel_size[1];
-
-	dot_size[0] = 0.5f * cardot0->GetW() * pixel_size[0];
-	dot_size[1] = 0.5f * cardot0->GetH() * pixel_size[1];
-
-	mapverts.SetToBillboard(map_min[0], map_min[1], map_max[0], map_max[1]);
-	mapdraw = mapnode.GetDrawList().twodim.insert(Drawable());
-	Drawable & mapdrawref = mapnode.GetDrawList().twodim.get(mapdraw);
-	mapdrawref.SetTextures(track_map->GetId());
-	mapdrawref.SetVertArray(&mapverts);
-	mapdrawref.SetCull(false);
-	//mapdrawref.SetColor(1, 1, 1, 0.7);
-	mapdrawref.SetDrawOrder(0);
-
-	return true;
 }
 
 void TrackMap::Update(bool visible, unsigned player, const std::vector<Vec3> & carpositions)
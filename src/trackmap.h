@@ -32,6 +32,7 @@
 #include <vector>
 
 class ContentManager;
+struct SDL_Thread;
 
 class TrackMap
 {
@@ -40,13 +41,21 @@ public:
 
 	~TrackMap();
 
+	/// start generating the map image on a worker thread
+	/// the image is read from cachepath if a matching one exists, written to it otherwise
+	/// an empty cachepath disables the cache
+	void BeginBuild(
+		const std::vector <RoadStrip> & roads,
+		const std::string & trackname,
+		const bool reverse,
+		const std::string & cachepath);
+
 	/// w and h are the display device dimensions in pixels
+	/// waits for the map image and uploads it, BeginBuild has to be called first
 	/// returns true if successful
 	bool BuildMap(
 		const int screen_width,
 		const int screen_height,
-		const std::vector <RoadStrip> & roads,
-		const std::string & trackname,
 		const std::string & texturepath,
 		ContentManager & content,
 		std::ostream & error_output);
@@ -88,6 +97,27 @@ private:
 	// size of the car dot in screen space
 	Vec2 dot_size;
 
+	// map image generation state, owned by the worker while it runs
+	SDL_Thread * build_thread;
+	std::string map_name;
+	std::string cache_file;
+	std::vector<float> road_coords;
+	std::vector<unsigned> pixels;
+	unsigned long long road_hash;
+
+	static int BuildThread(void * data);
+
+	/// load the map image from the cache or rasterize it
+	void BuildImage();
+
+	void RasterizeImage();
+
+	bool LoadImage();
+
+	void SaveImage() const;
+
+	void WaitBuild();
+
 	SceneNode mapnode;
 	SceneNode::DrawableHandle mapdraw;
 	VertexArray mapverts;
@@ -26,16 +26,22 @@
 class Transform
 {
 public:
+	Transform() : changed(true) {}
 	const Quat & GetRotation() const {return rotation;}
 	const Vec3 & GetTranslation() const {return translation;}
-	void SetRotation(const Quat & rot) {rotation = rot;}
-	void SetTranslation(const Vec3 & trans) {translation = trans;}
+	void SetRotation(const Quat & rot) {changed |= (rotation != rot); rotation = rot;}
+	void SetTranslation(const Vec3 & trans) {changed |= (translation != trans); translation = trans;}
 	bool IsIdentityTransform() const {return (rotation == Quat() && translation == Vec3());}
-	void Clear() {rotation.LoadIdentity();translation.Set(0.0f);}
+	void Clear() {SetRotation(Quat()); SetTranslation(Vec3());}
+
+	/// dirty flag, set by any modification, cleared by the owner once the change has been consumed
+	bool GetChanged() const {return changed;}
+	void ClearChanged() {changed = false;}
 
 private:
 	Quat rotation;
 	Vec3 translation;
+	bool changed;
 };
 
 #endif // _TRANSFORM_H
@@ -38,6 +38,7 @@
 #include <vector>
 #include <iostream>
 #include <cmath>
+#include <chrono>
 
 // -----------------------------------------------------------------------
 // Design Notes
@@ -50,6 +51,10 @@
 // constructor and destructor.  Tests that need fixtures should staticly
 // allocate one of these objects at the beginning of the test.  This method
 // is flexible and conceptually simple.
+//
+// * Micro benchmarks are registered the same way as tests, but only run on
+// request through QT_RUN_BENCHMARKS.  They time code with QT_TIME and print
+// the average time per iteration, nothing is checked.
 
 namespace quicktest
 {
@@ -92,6 +97,17 @@ namespace quicktest
 		std::string mTestName;
 	};
 
+	class Benchmark
+	{
+	public:
+		Benchmark(const std::string& benchmarkName);
+
+		virtual void run(std::ostream& out) = 0;
+
+		/// The unique name of this benchmark.
+		std::string mBenchmarkName;
+	};
+
 	class TestManager
 	{
 	public:
@@ -106,6 +122,11 @@ namespace quicktest
 			mTests.push_back(test);
 		}
 
+		void addBenchmark(Benchmark* benchmark)
+		{
+			mBenchmarks.push_back(benchmark);
+		}
+
 		void setOutputStream(std::ostream* stream)
 		{
 			mOutputStream = stream;
@@ -156,6 +177,24 @@ namespace quicktest
 			return numFailures;
 		}
 
+		void runBenchmarks()
+		{
+			*getOutputStream()
+				<< "[-------------- RUNNING BENCHMARKS --------------]"
+				<< std::endl;
+
+			std::vector<Benchmark*>::iterator iter;
+			for (iter = mBenchmarks.begin(); iter != mBenchmarks.end(); ++iter)
+			{
+				*getOutputStream() << (*iter)->mBenchmarkName << std::endl;
+				(*iter)->run(*getOutputStream());
+			}
+
+			*getOutputStream()
+				<< "[-------------- BENCHMARKS FINISHED -------------]"
+				<< std::endl;
+		}
+
 	private:
 		TestManager()
 		{
@@ -170,10 +209,19 @@ namespace quicktest
 		/// so we don't need to destroy them manually.
 		std::vector<Test*> mTests;
 
+		/// List of pointers to Benchmarks, staticly allocated like Tests.
+		std::vector<Benchmark*> mBenchmarks;
+
 		std::ostream* mOutputStream;
 
 		TestResult mResult;
 	};
+
+	inline Benchmark::Benchmark(const std::string& benchmarkName)
+	{
+		mBenchmarkName = benchmarkName;
+		TestManager::instance().addBenchmark(this);
+	}
 }
 
 /// Macro to define a single test without using a fixture.
@@ -193,6 +241,41 @@ namespace quicktest
 /// Macro that runs all tests.
 #define QT_RUN_TESTS quicktest::TestManager::instance().runTests()
 
+/// Macro to define a micro benchmark.  The body has access to the output
+/// stream 'out' and should use QT_TIME to measure.
+#define QT_BENCHMARK(benchmarkName)\
+	class benchmarkName##Benchmark : public quicktest::Benchmark\
+	{\
+	public:\
+		benchmarkName##Benchmark()\
+		: Benchmark(#benchmarkName)\
+		{\
+		}\
+		void run(std::ostream& out);\
+	}benchmarkName##BenchmarkInstance;\
+	void benchmarkName##Benchmark::run(std::ostream& out)
+
+/// Macro that runs all benchmarks.
+#define QT_RUN_BENCHMARKS quicktest::TestManager::instance().runBenchmarks()
+
+/// Runs the statement the given number of times and prints the average
+/// time per iteration.  Results of the statement should be consumed, else
+/// the compiler might remove the work being measured.
+#define QT_TIME(label, iterations, statement)\
+	{\
+		const unsigned long qtIterations = (iterations);\
+		std::chrono::high_resolution_clock::time_point qtStart =\
+			std::chrono::high_resolution_clock::now();\
+		for (unsigned long qtIteration = 0; qtIteration < qtIterations; ++qtIteration)\
+		{\
+			statement;\
+		}\
+		std::chrono::duration<double, std::nano> qtTime =\
+			std::chrono::high_resolution_clock::now() - qtStart;\
+		out << "\t" << (label) << ": " << qtTime.count() / qtIterations\
+			<< " ns" << std::endl;\
+	}
+
 /// Macro that sets the output stream to use.
 #define QT_SET_OUTPUT(stream)\
 	quicktest::TestManager::instance().setOutputStream(stream)